@@ -0,0 +1,913 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+/*
+ * Headless benchmark of the library and playlist hot paths.
+ *
+ * A synthetic library of tiny but valid MP3, FLAC and Ogg Vorbis files with
+ * random tags is written to a temporary directory, that also holds the user
+ * config and cache, so the real database is never touched. Then each step is
+ * timed through librena, without a display, and reported as CSV:
+ *
+ *   step,items,total_us,per_item_us
+ *
+ * The scanner runs as is. The library pane and the playlist need a display,
+ * so their steps go through the stores the widgets are built on.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tag_c.h>
+
+#include "src/rena-database.h"
+#include "src/rena-database-provider.h"
+#include "src/rena-debug.h"
+#include "src/rena-library-pane.h"
+#include "src/rena-musicobject.h"
+#include "src/rena-musicobject-mgmt.h"
+#include "src/rena-playlist.h"
+#include "src/rena-playlists-mgmt.h"
+#include "src/rena-preferences.h"
+#include "src/rena-scanner.h"
+#include "src/rena-utils.h"
+
+#ifdef DEBUG
+extern GThread *rena_main_thread;
+#endif
+
+#define BENCH_PLAYLIST  "rena-bench"
+#define BENCH_SEARCH    "ka"
+
+static gint     bench_tracks = 1000;
+static gint     bench_seed = 1;
+static gchar   *bench_output = NULL;
+static gboolean bench_keep = FALSE;
+
+static GOptionEntry bench_entries[] = {
+	{ "tracks", 'n', 0, G_OPTION_ARG_INT, &bench_tracks, "Number of files in the synthetic library", "N" },
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &bench_seed, "Seed of the random tags", "SEED" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &bench_output, "Write the results to FILE instead of stdout", "FILE" },
+	{ "keep", 'k', 0, G_OPTION_ARG_NONE, &bench_keep, "Keep the temporary directory", NULL },
+	{ NULL }
+};
+
+typedef struct {
+	GString *results;
+	gint     failures;
+} RenaBench;
+
+typedef struct {
+	guint nodes;
+	guint tracks;
+	guint matches;
+} RenaBenchCount;
+
+static void
+rena_bench_report (RenaBench *bench, const gchar *step, guint items, gint64 start)
+{
+	gint64 elapsed = g_get_monotonic_time () - start;
+
+	g_string_append_printf (bench->results, "%s,%u,%" G_GINT64_FORMAT ",%.2f\n",
+	                        step, items, elapsed, items ? (gdouble) elapsed / items : 0.0);
+}
+
+static void
+rena_bench_check (RenaBench *bench, const gchar *step, guint expected, guint got)
+{
+	if (expected == got)
+		return;
+
+	g_printerr ("%s: expected %u items but got %u\n", step, expected, got);
+	bench->failures++;
+}
+
+/*
+ * Synthetic library.
+ */
+
+static const gchar *syllables[] = {
+	"ka", "lo", "mi", "ra", "te", "su", "no", "vi", "an", "del", "mar", "sol", "ur", "be", "zi", "po"
+};
+
+static gchar *
+rena_bench_random_words (GRand *grand, guint words)
+{
+	GString *str = g_string_new (NULL);
+	guint i, j, n;
+
+	for (i = 0; i < words; i++) {
+		if (i > 0)
+			g_string_append_c (str, ' ');
+		n = g_rand_int_range (grand, 2, 4);
+		for (j = 0; j < n; j++)
+			g_string_append (str, syllables[g_rand_int_range (grand, 0, G_N_ELEMENTS (syllables))]);
+	}
+	str->str[0] = g_ascii_toupper (str->str[0]);
+
+	return g_string_free (str, FALSE);
+}
+
+typedef struct {
+	gchar *title;
+	gchar *artist;
+	gchar *album;
+	gchar *genre;
+	gint   year;
+	gint   track_no;
+	gint   length;
+} RenaBenchTags;
+
+static void
+rena_bench_put_be32 (GByteArray *data, guint32 value)
+{
+	guint8 b[4] = { value >> 24, value >> 16, value >> 8, value };
+	g_byte_array_append (data, b, 4);
+}
+
+static void
+rena_bench_put_le32 (GByteArray *data, guint32 value)
+{
+	guint8 b[4] = { value, value >> 8, value >> 16, value >> 24 };
+	g_byte_array_append (data, b, 4);
+}
+
+static void
+rena_bench_put_synchsafe (GByteArray *data, guint32 value)
+{
+	guint8 b[4] = { (value >> 21) & 0x7f, (value >> 14) & 0x7f, (value >> 7) & 0x7f, value & 0x7f };
+	g_byte_array_append (data, b, 4);
+}
+
+/* ID3v2.4 tag with UTF-8 text frames, followed by silent MPEG-1 Layer III
+ * frames of 128 kbps at 44.1 kHz. */
+
+static void
+rena_bench_id3_frame (GByteArray *data, const gchar *id, const gchar *text)
+{
+	guint8 flags[2] = { 0, 0 }, encoding = 3;
+
+	g_byte_array_append (data, (const guint8 *) id, 4);
+	rena_bench_put_synchsafe (data, strlen (text) + 1);
+	g_byte_array_append (data, flags, 2);
+	g_byte_array_append (data, &encoding, 1);
+	g_byte_array_append (data, (const guint8 *) text, strlen (text));
+}
+
+static GByteArray *
+rena_bench_mp3_new (RenaBenchTags *tags)
+{
+	GByteArray *data, *frames;
+	guint8 header[6] = { 'I', 'D', '3', 4, 0, 0 };
+	guint8 mpeg[4] = { 0xff, 0xfb, 0x90, 0x00 };
+	gchar *value;
+	guint i;
+
+	frames = g_byte_array_new ();
+	rena_bench_id3_frame (frames, "TIT2", tags->title);
+	rena_bench_id3_frame (frames, "TPE1", tags->artist);
+	rena_bench_id3_frame (frames, "TALB", tags->album);
+	rena_bench_id3_frame (frames, "TCON", tags->genre);
+	value = g_strdup_printf ("%d", tags->track_no);
+	rena_bench_id3_frame (frames, "TRCK", value);
+	g_free (value);
+	value = g_strdup_printf ("%d", tags->year);
+	rena_bench_id3_frame (frames, "TDRC", value);
+	g_free (value);
+
+	data = g_byte_array_new ();
+	g_byte_array_append (data, header, sizeof (header));
+	rena_bench_put_synchsafe (data, frames->len);
+	g_byte_array_append (data, frames->data, frames->len);
+	g_byte_array_free (frames, TRUE);
+
+	for (i = 0; i < 8; i++) {
+		g_byte_array_append (data, mpeg, sizeof (mpeg));
+		g_byte_array_set_size (data, data->len + 417 - sizeof (mpeg));
+		memset (data->data + data->len - (417 - sizeof (mpeg)), 0, 417 - sizeof (mpeg));
+	}
+
+	return data;
+}
+
+/* Vorbis comments, shared by FLAC and Ogg Vorbis. */
+
+static void
+rena_bench_vorbis_comments (GByteArray *data, RenaBenchTags *tags)
+{
+	const gchar *vendor = "rena-bench";
+	gchar *comments[7];
+	guint i;
+
+	comments[0] = g_strdup_printf ("TITLE=%s", tags->title);
+	comments[1] = g_strdup_printf ("ARTIST=%s", tags->artist);
+	comments[2] = g_strdup_printf ("ALBUM=%s", tags->album);
+	comments[3] = g_strdup_printf ("GENRE=%s", tags->genre);
+	comments[4] = g_strdup_printf ("TRACKNUMBER=%d", tags->track_no);
+	comments[5] = g_strdup_printf ("DATE=%d", tags->year);
+	comments[6] = NULL;
+
+	rena_bench_put_le32 (data, strlen (vendor));
+	g_byte_array_append (data, (const guint8 *) vendor, strlen (vendor));
+	rena_bench_put_le32 (data, G_N_ELEMENTS (comments) - 1);
+	for (i = 0; comments[i] != NULL; i++) {
+		rena_bench_put_le32 (data, strlen (comments[i]));
+		g_byte_array_append (data, (const guint8 *) comments[i], strlen (comments[i]));
+		g_free (comments[i]);
+	}
+}
+
+/* STREAMINFO and VORBIS_COMMENT blocks, without audio frames. */
+
+static GByteArray *
+rena_bench_flac_new (RenaBenchTags *tags)
+{
+	GByteArray *data, *comments;
+	guint8 streaminfo[34];
+	guint64 samples, packed;
+	guint i;
+
+	data = g_byte_array_new ();
+	g_byte_array_append (data, (const guint8 *) "fLaC", 4);
+
+	memset (streaminfo, 0, sizeof (streaminfo));
+	streaminfo[0] = 0x10;  /* Block sizes of 4096 */
+	streaminfo[2] = 0x10;
+
+	samples = (guint64) tags->length * 44100;
+	packed = ((guint64) 44100 << 44) | ((guint64) (2 - 1) << 41) | ((guint64) (16 - 1) << 36) | samples;
+	for (i = 0; i < 8; i++)
+		streaminfo[10 + i] = packed >> (56 - i * 8);
+
+	rena_bench_put_be32 (data, (0 << 24) | sizeof (streaminfo));
+	g_byte_array_append (data, streaminfo, sizeof (streaminfo));
+
+	comments = g_byte_array_new ();
+	rena_bench_vorbis_comments (comments, tags);
+	rena_bench_put_be32 (data, (0x84 << 24) | comments->len);
+	g_byte_array_append (data, comments->data, comments->len);
+	g_byte_array_free (comments, TRUE);
+
+	return data;
+}
+
+/* Ogg pages with the three Vorbis headers and one silent audio packet whose
+ * granule position gives the length. */
+
+static guint32
+rena_bench_ogg_crc (const guint8 *data, gsize len)
+{
+	static guint32 table[256];
+	guint32 crc = 0, r;
+	gsize i;
+	gint j;
+
+	if (table[1] == 0) {
+		for (i = 0; i < 256; i++) {
+			r = i << 24;
+			for (j = 0; j < 8; j++)
+				r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : (r << 1);
+			table[i] = r;
+		}
+	}
+
+	for (i = 0; i < len; i++)
+		crc = (crc << 8) ^ table[((crc >> 24) & 0xff) ^ data[i]];
+
+	return crc;
+}
+
+static void
+rena_bench_ogg_page (GByteArray *data, guint8 flags, guint64 granule, guint32 sequence, GPtrArray *packets)
+{
+	GByteArray *page, *packet;
+	guint8 header[6] = { 'O', 'g', 'g', 'S', 0, flags };
+	guint32 crc;
+	gsize len;
+	guint i, j, start;
+
+	page = g_byte_array_new ();
+	g_byte_array_append (page, header, sizeof (header));
+	for (i = 0; i < 8; i++) {
+		guint8 b = granule >> (i * 8);
+		g_byte_array_append (page, &b, 1);
+	}
+	rena_bench_put_le32 (page, 0x52454e41);  /* Serial */
+	rena_bench_put_le32 (page, sequence);
+	rena_bench_put_le32 (page, 0);           /* CRC */
+
+	start = page->len;
+	g_byte_array_set_size (page, page->len + 1);
+	page->data[start] = 0;
+
+	for (i = 0; i < packets->len; i++) {
+		packet = g_ptr_array_index (packets, i);
+		for (len = packet->len; ; len -= 255) {
+			guint8 lacing = MIN (len, 255);
+			g_byte_array_append (page, &lacing, 1);
+			page->data[start]++;
+			if (lacing < 255)
+				break;
+		}
+	}
+	for (i = 0; i < packets->len; i++) {
+		packet = g_ptr_array_index (packets, i);
+		g_byte_array_append (page, packet->data, packet->len);
+	}
+
+	crc = rena_bench_ogg_crc (page->data, page->len);
+	for (j = 0; j < 4; j++)
+		page->data[22 + j] = crc >> (j * 8);
+
+	g_byte_array_append (data, page->data, page->len);
+	g_byte_array_free (page, TRUE);
+}
+
+static GByteArray *
+rena_bench_vorbis_header (guint8 type)
+{
+	GByteArray *packet = g_byte_array_new ();
+
+	g_byte_array_append (packet, &type, 1);
+	g_byte_array_append (packet, (const guint8 *) "vorbis", 6);
+
+	return packet;
+}
+
+/* Vorbis packs the setup fields from the least significant bit. */
+
+typedef struct {
+	GByteArray *data;
+	guint       bit;
+} RenaBenchBits;
+
+static void
+rena_bench_put_bits (RenaBenchBits *bits, guint32 value, guint n)
+{
+	guint8 zero = 0;
+	guint i;
+
+	for (i = 0; i < n; i++) {
+		if (bits->bit == 0)
+			g_byte_array_append (bits->data, &zero, 1);
+		if (value & (1u << i))
+			bits->data->data[bits->data->len - 1] |= 1 << bits->bit;
+		bits->bit = (bits->bit + 1) % 8;
+	}
+}
+
+/* The smallest setup a decoder accepts: one codebook of two entries, one
+ * floor 1 without partitions, one residue 0 without books, one mapping and
+ * one short block mode. Each audio packet then only says "no floor". */
+
+static GByteArray *
+rena_bench_vorbis_setup (void)
+{
+	RenaBenchBits bits;
+
+	bits.data = rena_bench_vorbis_header (0x05);
+	bits.bit = 0;
+
+	rena_bench_put_bits (&bits, 0, 8);         /* Codebooks - 1 */
+	rena_bench_put_bits (&bits, 0x564342, 24); /* Codebook sync */
+	rena_bench_put_bits (&bits, 1, 16);        /* Dimensions */
+	rena_bench_put_bits (&bits, 2, 24);        /* Entries */
+	rena_bench_put_bits (&bits, 0, 1);         /* Not ordered */
+	rena_bench_put_bits (&bits, 0, 1);         /* Not sparse */
+	rena_bench_put_bits (&bits, 0, 5);         /* Length 1 */
+	rena_bench_put_bits (&bits, 0, 5);         /* Length 1 */
+	rena_bench_put_bits (&bits, 0, 4);         /* No lookup */
+
+	rena_bench_put_bits (&bits, 0, 6);         /* Time transforms - 1 */
+	rena_bench_put_bits (&bits, 0, 16);
+
+	rena_bench_put_bits (&bits, 0, 6);         /* Floors - 1 */
+	rena_bench_put_bits (&bits, 1, 16);        /* Floor 1 */
+	rena_bench_put_bits (&bits, 0, 5);         /* Partitions */
+	rena_bench_put_bits (&bits, 0, 2);         /* Multiplier - 1 */
+	rena_bench_put_bits (&bits, 0, 4);         /* Range bits */
+
+	rena_bench_put_bits (&bits, 0, 6);         /* Residues - 1 */
+	rena_bench_put_bits (&bits, 0, 16);        /* Residue 0 */
+	rena_bench_put_bits (&bits, 0, 24);        /* Begin */
+	rena_bench_put_bits (&bits, 0, 24);        /* End */
+	rena_bench_put_bits (&bits, 0, 24);        /* Partition size - 1 */
+	rena_bench_put_bits (&bits, 0, 6);         /* Classifications - 1 */
+	rena_bench_put_bits (&bits, 0, 8);         /* Class book */
+	rena_bench_put_bits (&bits, 0, 3);         /* No cascade */
+	rena_bench_put_bits (&bits, 0, 1);
+
+	rena_bench_put_bits (&bits, 0, 6);         /* Mappings - 1 */
+	rena_bench_put_bits (&bits, 0, 16);        /* Mapping 0 */
+	rena_bench_put_bits (&bits, 0, 1);         /* One submap */
+	rena_bench_put_bits (&bits, 0, 1);         /* No coupling */
+	rena_bench_put_bits (&bits, 0, 2);         /* Reserved */
+	rena_bench_put_bits (&bits, 0, 8);         /* Unused time */
+	rena_bench_put_bits (&bits, 0, 8);         /* Floor */
+	rena_bench_put_bits (&bits, 0, 8);         /* Residue */
+
+	rena_bench_put_bits (&bits, 0, 6);         /* Modes - 1 */
+	rena_bench_put_bits (&bits, 0, 1);         /* Short block */
+	rena_bench_put_bits (&bits, 0, 16);        /* Window */
+	rena_bench_put_bits (&bits, 0, 16);        /* Transform */
+	rena_bench_put_bits (&bits, 0, 8);         /* Mapping */
+
+	rena_bench_put_bits (&bits, 1, 1);         /* Framing */
+
+	return bits.data;
+}
+
+static GByteArray *
+rena_bench_ogg_new (RenaBenchTags *tags)
+{
+	GByteArray *data, *packet;
+	GPtrArray *packets;
+	guint8 byte;
+
+	data = g_byte_array_new ();
+	packets = g_ptr_array_new_with_free_func ((GDestroyNotify) g_byte_array_unref);
+
+	/* Identification, alone in the first page */
+	packet = rena_bench_vorbis_header (0x01);
+	rena_bench_put_le32 (packet, 0);        /* Version */
+	byte = 2;
+	g_byte_array_append (packet, &byte, 1); /* Channels */
+	rena_bench_put_le32 (packet, 44100);    /* Rate */
+	rena_bench_put_le32 (packet, 0);        /* Maximum bitrate */
+	rena_bench_put_le32 (packet, 128000);   /* Nominal bitrate */
+	rena_bench_put_le32 (packet, 0);        /* Minimum bitrate */
+	byte = 0xb8;
+	g_byte_array_append (packet, &byte, 1); /* Block sizes of 2^8 and 2^11 */
+	byte = 0x01;
+	g_byte_array_append (packet, &byte, 1); /* Framing */
+	g_ptr_array_add (packets, packet);
+	rena_bench_ogg_page (data, 0x02, 0, 0, packets);
+	g_ptr_array_set_size (packets, 0);
+
+	/* Comments and setup */
+	packet = rena_bench_vorbis_header (0x03);
+	rena_bench_vorbis_comments (packet, tags);
+	byte = 0x01;
+	g_byte_array_append (packet, &byte, 1); /* Framing */
+	g_ptr_array_add (packets, packet);
+	g_ptr_array_add (packets, rena_bench_vorbis_setup ());
+	rena_bench_ogg_page (data, 0x00, 0, 1, packets);
+	g_ptr_array_set_size (packets, 0);
+
+	/* Audio: packet type, and the floor of both channels unused */
+	packet = g_byte_array_new ();
+	byte = 0x00;
+	g_byte_array_append (packet, &byte, 1);
+	g_ptr_array_add (packets, packet);
+	rena_bench_ogg_page (data, 0x04, (guint64) tags->length * 44100, 2, packets);
+
+	g_ptr_array_free (packets, TRUE);
+
+	return data;
+}
+
+/* Artists with some albums of about ten tracks, spread over the formats. */
+
+static gboolean
+rena_bench_generate_library (const gchar *library_dir, gint n_tracks, GRand *grand)
+{
+	RenaBenchTags tags;
+	GByteArray *data;
+	GError *error = NULL;
+	gchar *album_dir = NULL, *path, *filename;
+	const gchar *extension;
+	gboolean written = TRUE;
+	gint i;
+
+	memset (&tags, 0, sizeof (tags));
+
+	for (i = 0; i < n_tracks; i++) {
+		if (i % 10 == 0) {
+			if (i % 50 == 0) {
+				g_free (tags.artist);
+				tags.artist = rena_bench_random_words (grand, 2);
+				g_free (tags.genre);
+				tags.genre = rena_bench_random_words (grand, 1);
+			}
+			g_free (tags.album);
+			tags.album = rena_bench_random_words (grand, 3);
+			tags.year = g_rand_int_range (grand, 1960, 2025);
+
+			g_free (album_dir);
+			album_dir = g_strdup_printf ("%s%c%04d%c%04d", library_dir, G_DIR_SEPARATOR,
+			                             i / 50, G_DIR_SEPARATOR, i / 10);
+			g_mkdir_with_parents (album_dir, S_IRWXU);
+		}
+
+		tags.title = rena_bench_random_words (grand, g_rand_int_range (grand, 1, 5));
+		tags.track_no = i % 10 + 1;
+		tags.length = g_rand_int_range (grand, 90, 420);
+
+		switch (i % 3) {
+			case 0:
+				data = rena_bench_mp3_new (&tags);
+				extension = "mp3";
+				break;
+			case 1:
+				data = rena_bench_flac_new (&tags);
+				extension = "flac";
+				break;
+			default:
+				data = rena_bench_ogg_new (&tags);
+				extension = "ogg";
+				break;
+		}
+
+		filename = g_strdup_printf ("%02d - track.%s", tags.track_no, extension);
+		path = g_build_filename (album_dir, filename, NULL);
+		written = g_file_set_contents (path, (const gchar *) data->data, data->len, &error);
+		if (!written) {
+			g_printerr ("Unable to write %s: %s\n", path, error->message);
+			g_clear_error (&error);
+		}
+
+		g_free (path);
+		g_free (filename);
+		g_byte_array_free (data, TRUE);
+		g_free (tags.title);
+		tags.title = NULL;
+
+		if (!written)
+			break;
+	}
+
+	g_free (album_dir);
+	g_free (tags.artist);
+	g_free (tags.album);
+	g_free (tags.genre);
+
+	return written;
+}
+
+static void
+rena_bench_remove_dir (const gchar *dir_name)
+{
+	const gchar *name;
+	gchar *path;
+	GDir *dir;
+
+	dir = g_dir_open (dir_name, 0, NULL);
+	if (dir != NULL) {
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			path = g_build_filename (dir_name, name, NULL);
+			if (g_file_test (path, G_FILE_TEST_IS_DIR) && !g_file_test (path, G_FILE_TEST_IS_SYMLINK))
+				rena_bench_remove_dir (path);
+			else
+				g_unlink (path);
+			g_free (path);
+		}
+		g_dir_close (dir);
+	}
+	g_rmdir (dir_name);
+}
+
+/*
+ * Steps.
+ */
+
+/* The scanner walks the provider on the calling thread, and saves what it
+ * found in one transaction. */
+
+static void
+rena_bench_scan (RenaBench *bench, RenaDatabase *cdbase, const gchar *library_dir)
+{
+	RenaDatabaseProvider *provider;
+	RenaScanner *scanner;
+	GSList *providers;
+	guint scanned;
+	gint64 start;
+
+	provider = rena_database_provider_get ();
+	rena_provider_add_new (provider, library_dir, "local", "Local Music", "drive-harddisk");
+
+	scanner = rena_scanner_new ();
+	providers = g_slist_append (NULL, (gpointer) library_dir);
+
+	start = g_get_monotonic_time ();
+	scanned = rena_scanner_scan_providers_sync (scanner, providers);
+	rena_bench_report (bench, "scan", scanned, start);
+
+	rena_bench_check (bench, "scan", bench_tracks, scanned);
+
+	start = g_get_monotonic_time ();
+	rena_scanner_save_scanned (scanner);
+	rena_bench_report (bench, "database-insert", scanned, start);
+
+	rena_bench_check (bench, "database-insert", scanned, rena_database_get_track_count (cdbase));
+
+	g_slist_free (providers);
+	rena_scanner_free (scanner);
+	g_object_unref (provider);
+}
+
+/* The library pane store with the artist and album style, then its filter. */
+
+static GtkTreeStore *
+rena_bench_library_tree (RenaBench *bench, RenaLibraryView *view, const gchar *library_dir)
+{
+	GtkTreeStore *store;
+	GtkTreeIter iter;
+	gint64 start;
+
+	store = rena_library_view_store_new ();
+
+	start = g_get_monotonic_time ();
+	gtk_tree_store_append (store, &iter, NULL);
+	gtk_tree_store_set (store, &iter,
+	                    L_NODE_DATA, "Local Music",
+	                    L_NODE_TYPE, NODE_CATEGORY_PROVIDER,
+	                    L_MACH, FALSE,
+	                    L_VISIBILE, TRUE,
+	                    -1);
+	rena_library_view_append_provider (view, GTK_TREE_MODEL(store), &iter, library_dir);
+	rena_bench_report (bench, "library-tree", bench_tracks, start);
+
+	return store;
+}
+
+static gboolean
+rena_bench_count_node (GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer data)
+{
+	RenaBenchCount *count = data;
+	LibraryNodeType node_type;
+	gboolean mach;
+
+	gtk_tree_model_get (model, iter,
+	                    L_NODE_TYPE, &node_type,
+	                    L_MACH, &mach,
+	                    -1);
+	count->nodes++;
+	if (node_type == NODE_TRACK)
+		count->tracks++;
+	if (mach)
+		count->matches++;
+
+	return FALSE;
+}
+
+static void
+rena_bench_library_search (RenaBench *bench, RenaLibraryView *view, GtkTreeStore *store)
+{
+	RenaBenchCount count;
+	gint64 start;
+
+	memset (&count, 0, sizeof (count));
+	gtk_tree_model_foreach (GTK_TREE_MODEL(store), rena_bench_count_node, &count);
+	rena_bench_check (bench, "library-tree", bench_tracks, count.tracks);
+
+	start = g_get_monotonic_time ();
+	rena_library_view_set_filter (view, BENCH_SEARCH);
+	rena_library_view_filter (view, GTK_TREE_MODEL(store));
+	rena_bench_report (bench, "library-search", count.nodes, start);
+
+	memset (&count, 0, sizeof (count));
+	gtk_tree_model_foreach (GTK_TREE_MODEL(store), rena_bench_count_node, &count);
+	if (count.matches == 0) {
+		g_printerr ("library-search: no node matched \"%s\"\n", BENCH_SEARCH);
+		bench->failures++;
+	}
+}
+
+/* The songs of the library, as they are dropped in the playlist. */
+
+static GList *
+rena_bench_library_songs (RenaDatabase *cdbase)
+{
+	RenaPreparedStatement *statement;
+	RenaMusicobject *mobj;
+	GList *list = NULL;
+
+	statement = rena_database_create_statement (cdbase, "SELECT location FROM TRACK ORDER BY location");
+	while (rena_prepared_statement_step (statement)) {
+		mobj = new_musicobject_from_db (cdbase, rena_prepared_statement_get_int (statement, 0));
+		if (G_LIKELY(mobj))
+			list = g_list_prepend (list, mobj);
+	}
+	rena_prepared_statement_free (statement);
+
+	return g_list_reverse (list);
+}
+
+/* The current playlist store, then a walk in shuffle mode where each next
+ * song is picked at random among the unplayed ones and remembered. */
+
+static GtkListStore *
+rena_bench_playlist_append (RenaBench *bench, GList *list)
+{
+	GtkListStore *store;
+	GtkTreeIter iter;
+	gint64 start;
+	GList *l;
+
+	store = rena_playlist_store_new ();
+
+	start = g_get_monotonic_time ();
+	for (l = list; l != NULL; l = l->next)
+		rena_playlist_store_append_mobj (store, l->data, &iter);
+	rena_bench_report (bench, "playlist-append", g_list_length (list), start);
+
+	rena_bench_check (bench, "playlist-append", g_list_length (list),
+	                  gtk_tree_model_iter_n_children (GTK_TREE_MODEL(store), NULL));
+
+	return store;
+}
+
+static void
+rena_bench_playlist_shuffle (RenaBench *bench, GtkListStore *store, GRand *grand)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(store);
+	GtkTreePath *path;
+	GList *refs = NULL;
+	gint i, n_rows;
+	gint64 start;
+
+	n_rows = gtk_tree_model_iter_n_children (model, NULL);
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < n_rows; i++) {
+		path = rena_playlist_store_get_unplayed_random (model, grand);
+		if (path == NULL)
+			break;
+		refs = g_list_append (refs, gtk_tree_row_reference_new (model, path));
+		rena_playlist_store_set_played (model, path, TRUE);
+		gtk_tree_path_free (path);
+	}
+	rena_bench_report (bench, "playlist-shuffle", n_rows, start);
+
+	rena_bench_check (bench, "playlist-shuffle", n_rows, g_list_length (refs));
+
+	g_list_free_full (refs, (GDestroyNotify) gtk_tree_row_reference_free);
+}
+
+/* As the playlist state is saved on exit and restored on start. */
+
+static void
+rena_bench_playlist_save_restore (RenaBench *bench, RenaDatabase *cdbase, GList *list)
+{
+	GList *restored = NULL;
+	gint64 start;
+
+	start = g_get_monotonic_time ();
+	rena_playlist_database_insert_playlist (cdbase, BENCH_PLAYLIST, list);
+	rena_bench_report (bench, "playlist-save", g_list_length (list), start);
+
+	start = g_get_monotonic_time ();
+	restored = add_playlist_to_mobj_list (cdbase, BENCH_PLAYLIST, NULL);
+	rena_bench_report (bench, "playlist-restore", g_list_length (restored), start);
+
+	rena_bench_check (bench, "playlist-restore", g_list_length (list), g_list_length (restored));
+
+	g_list_free_full (restored, g_object_unref);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+	GOptionContext *context;
+	RenaDatabase *cdbase;
+	RenaPreferences *preferences;
+	RenaLibraryView *view;
+	RenaBench bench;
+	GtkTreeStore *tree;
+	GtkListStore *playlist;
+	GError *error = NULL;
+	GRand *grand;
+	GList *list;
+	gchar *tmp_dir, *config_dir, *library_dir;
+	gint64 start;
+
+#ifdef DEBUG
+	rena_main_thread = g_thread_self ();
+#endif
+	debug_level = 0;
+
+	context = g_option_context_new ("- benchmark the library and playlist of Rena");
+	g_option_context_add_main_entries (context, bench_entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (bench_tracks <= 0) {
+		g_printerr ("The number of tracks must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Everything lives in a temporary home. Must be set before GLib caches
+	 * the user directories. */
+
+	tmp_dir = g_dir_make_tmp ("rena-bench-XXXXXX", &error);
+	if (tmp_dir == NULL) {
+		g_printerr ("Unable to create the temporary directory: %s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+
+	config_dir = g_build_filename (tmp_dir, "config", "rena", NULL);
+	g_mkdir_with_parents (config_dir, S_IRWXU);
+	g_free (config_dir);
+
+	config_dir = g_build_filename (tmp_dir, "config", NULL);
+	g_setenv ("XDG_CONFIG_HOME", config_dir, TRUE);
+	g_free (config_dir);
+	config_dir = g_build_filename (tmp_dir, "cache", NULL);
+	g_setenv ("XDG_CACHE_HOME", config_dir, TRUE);
+	g_free (config_dir);
+	config_dir = g_build_filename (tmp_dir, "data", NULL);
+	g_setenv ("XDG_DATA_HOME", config_dir, TRUE);
+	g_free (config_dir);
+
+	taglib_set_strings_unicode (TRUE);
+	taglib_set_string_management_enabled (FALSE);
+
+	bench.results = g_string_new ("step,items,total_us,per_item_us\n");
+	bench.failures = 0;
+
+	grand = g_rand_new_with_seed (bench_seed);
+
+	library_dir = g_build_filename (tmp_dir, "library", NULL);
+
+	start = g_get_monotonic_time ();
+	if (!rena_bench_generate_library (library_dir, bench_tracks, grand))
+		bench.failures++;
+	rena_bench_report (&bench, "generate", bench_tracks, start);
+
+	cdbase = rena_database_get ();
+	if (!rena_database_start_successfully (cdbase)) {
+		g_printerr ("Unable to open the database\n");
+		bench.failures++;
+	}
+	else {
+		rena_bench_scan (&bench, cdbase, library_dir);
+
+		preferences = rena_preferences_get ();
+		rena_preferences_set_library_style (preferences, ARTIST_ALBUM);
+		view = rena_library_view_new ();
+		tree = rena_bench_library_tree (&bench, view, library_dir);
+		rena_bench_library_search (&bench, view, tree);
+		g_object_unref (tree);
+		rena_library_view_free (view);
+		g_object_unref (preferences);
+
+		list = rena_bench_library_songs (cdbase);
+
+		playlist = rena_bench_playlist_append (&bench, list);
+		rena_bench_playlist_shuffle (&bench, playlist, grand);
+		g_object_unref (playlist);
+
+		rena_bench_playlist_save_restore (&bench, cdbase, list);
+
+		g_list_free_full (list, g_object_unref);
+	}
+	g_object_unref (cdbase);
+
+	if (bench_output) {
+		if (!g_file_set_contents (bench_output, bench.results->str, bench.results->len, &error)) {
+			g_printerr ("Unable to write %s: %s\n", bench_output, error->message);
+			g_error_free (error);
+			bench.failures++;
+		}
+	}
+	else {
+		g_print ("%s", bench.results->str);
+	}
+
+	if (bench_keep)
+		g_printerr ("Synthetic library kept in %s\n", tmp_dir);
+	else
+		rena_bench_remove_dir (tmp_dir);
+
+	g_string_free (bench.results, TRUE);
+	g_rand_free (grand);
+	g_free (library_dir);
+	g_free (tmp_dir);
+
+	return bench.failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -30,6 +30,8 @@
 #include <gmodule.h>
 #include <gtk/gtk.h>
 
+#include <glib/gstdio.h>
+
 #include <gst/gst.h>
 
 #include <libsoup/soup.h>
@@ -50,6 +52,7 @@
 #include "src/rena-tags-dialog.h"
 #include "src/rena-background-task-bar.h"
 #include "src/rena-background-task-widget.h"
+#include "src/rena-simple-async.h"
 
 #include "plugins/rena-plugin-macros.h"
 
@@ -63,9 +66,8 @@
 struct _RenaAcoustidPluginPrivate {
 	RenaApplication          *rena;
 
-	RenaMusicobject          *mobj;
-
-	RenaBackgroundTaskWidget *task_widget;
+	RenaDatabase             *cdbase;
+	GList                    *jobs;
 
 	GtkActionGroup             *action_group_main_menu;
 	guint                       merge_id_main_menu;
@@ -76,6 +78,134 @@ RENA_PLUGIN_REGISTER (RENA_TYPE_ACOUSTID_PLUGIN,
                         RenaAcoustidPlugin,
                         rena_acoustid_plugin)
 
+/* Seconds of audio used by chromaprint. Decoding stops once it is reached. */
+#define ACOUSTID_FINGERPRINT_DURATION 120
+
+/*
+ * One search, from the fingerprint to the tags dialog.
+ */
+
+typedef struct {
+	RenaAcoustidPlugin       *plugin;
+	RenaMusicobject          *mobj;
+	RenaBackgroundTaskWidget *task_widget;
+	gchar                    *filename;
+	gint                      duration;
+	gint64                    size;
+	gint64                    mtime;
+	gchar                    *fingerprint;
+	GCancellable             *cancellable;
+} RenaAcoustidJob;
+
+static RenaAcoustidJob *
+rena_acoustid_job_new (RenaAcoustidPlugin *plugin, RenaMusicobject *mobj)
+{
+	RenaAcoustidJob *job;
+	GStatBuf buf;
+
+	job = g_slice_new0 (RenaAcoustidJob);
+	job->plugin = plugin;
+	job->mobj = rena_musicobject_dup (mobj);
+	job->filename = g_strdup (rena_musicobject_get_file (mobj));
+	job->duration = rena_musicobject_get_length (mobj);
+	job->cancellable = g_cancellable_new ();
+
+	plugin->priv->jobs = g_list_prepend (plugin->priv->jobs, job);
+
+	if (g_stat (job->filename, &buf) == 0) {
+		job->size = buf.st_size;
+		job->mtime = buf.st_mtime;
+	}
+
+	return job;
+}
+
+static void
+rena_acoustid_job_free (gpointer data)
+{
+	RenaBackgroundTaskBar *taskbar;
+	RenaAcoustidJob *job = data;
+
+	if (job->plugin)
+		job->plugin->priv->jobs = g_list_remove (job->plugin->priv->jobs, job);
+
+	if (job->task_widget) {
+		taskbar = rena_background_task_bar_get ();
+		rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(job->task_widget));
+		g_object_unref(G_OBJECT(taskbar));
+		g_object_unref (job->task_widget);
+	}
+
+	g_object_unref (job->mobj);
+	g_object_unref (job->cancellable);
+	g_free (job->filename);
+	g_free (job->fingerprint);
+	g_slice_free (RenaAcoustidJob, job);
+}
+
+/* The plugin is going away. Running jobs just finish silently. */
+
+static void
+rena_acoustid_job_detach (RenaAcoustidJob *job)
+{
+	job->plugin = NULL;
+	g_cancellable_cancel (job->cancellable);
+}
+
+/*
+ * Fingerprint cache.
+ */
+
+static void
+rena_acoustid_cache_init (RenaAcoustidPlugin *plugin)
+{
+	RenaAcoustidPluginPrivate *priv = plugin->priv;
+
+	priv->cdbase = rena_database_get ();
+	rena_database_exec_query (priv->cdbase,
+		"CREATE TABLE IF NOT EXISTS ACOUSTID_FINGERPRINT "
+			"(file TEXT PRIMARY KEY,"
+			"size INT,"
+			"mtime INT,"
+			"fingerprint TEXT);");
+}
+
+static gchar *
+rena_acoustid_cache_lookup (RenaAcoustidPlugin *plugin, RenaAcoustidJob *job)
+{
+	RenaPreparedStatement *statement;
+	gchar *fingerprint = NULL;
+
+	RenaAcoustidPluginPrivate *priv = plugin->priv;
+
+	statement = rena_database_create_statement (priv->cdbase,
+		"SELECT fingerprint FROM ACOUSTID_FINGERPRINT WHERE file = ? AND size = ? AND mtime = ?");
+	rena_prepared_statement_bind_string (statement, 1, job->filename);
+	rena_prepared_statement_bind_int64 (statement, 2, job->size);
+	rena_prepared_statement_bind_int64 (statement, 3, job->mtime);
+	if (rena_prepared_statement_step (statement))
+		fingerprint = g_strdup (rena_prepared_statement_get_string (statement, 0));
+	rena_prepared_statement_free (statement);
+
+	return fingerprint;
+}
+
+static void
+rena_acoustid_cache_store (RenaAcoustidPlugin *plugin, RenaAcoustidJob *job)
+{
+	RenaPreparedStatement *statement;
+	RenaAcoustidPluginPrivate *priv = plugin->priv;
+
+	statement = rena_database_create_statement (priv->cdbase,
+		"INSERT OR REPLACE INTO ACOUSTID_FINGERPRINT (file, size, mtime, fingerprint) VALUES (?, ?, ?, ?)");
+	rena_prepared_statement_bind_string (statement, 1, job->filename);
+	rena_prepared_statement_bind_int64 (statement, 2, job->size);
+	rena_prepared_statement_bind_int64 (statement, 3, job->mtime);
+	rena_prepared_statement_bind_string (statement, 4, job->fingerprint);
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+}
+
 /*
  * Prototypes
  */
@@ -200,21 +330,27 @@ rena_acoustid_plugin_get_metadata_done (SoupSession *session,
 	gchar *otitle = NULL, *oartist = NULL, *oalbum = NULL;
 	gchar *ntitle = NULL, *nartist = NULL, *nalbum = NULL;
 	gint prechanged = 0;
+	RenaAcoustidPluginPrivate *priv;
 
-	RenaAcoustidPlugin *plugin = user_data;
-	RenaAcoustidPluginPrivate *priv = plugin->priv;
+	RenaAcoustidJob *job = user_data;
+	RenaAcoustidPlugin *plugin = job->plugin;
 
-	taskbar = rena_background_task_bar_get ();
-	rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(priv->task_widget));
-	g_object_unref(G_OBJECT(taskbar));
+	if (plugin == NULL) {
+		rena_acoustid_job_free (job);
+		return;
+	}
+	priv = plugin->priv;
 
 	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
-		notification = rena_app_notification_new ("AcoustID", _("There was an error when searching your tags on AcoustID"));
-		rena_app_notification_show (notification);
+		if (msg->status_code != SOUP_STATUS_CANCELLED) {
+			notification = rena_app_notification_new ("AcoustID", _("There was an error when searching your tags on AcoustID"));
+			rena_app_notification_show (notification);
+		}
+		rena_acoustid_job_free (job);
 		return;
 	}
 
-	g_object_get (priv->mobj,
+	g_object_get (job->mobj,
 	              "title", &otitle,
 	              "artist", &oartist,
 	              "album", &oalbum,
@@ -226,7 +362,7 @@ rena_acoustid_plugin_get_metadata_done (SoupSession *session,
 	if (xi && string_is_not_empty(xi->content)) {
 		ntitle = unescape_HTML (xi->content);
 		if (g_strcmp0(otitle, ntitle)) {
-			rena_musicobject_set_title (priv->mobj, ntitle);
+			rena_musicobject_set_title (job->mobj, ntitle);
 			prechanged |= TAG_TITLE_CHANGED;
 		}
 		g_free (ntitle);
@@ -236,7 +372,7 @@ rena_acoustid_plugin_get_metadata_done (SoupSession *session,
 	if (xi && string_is_not_empty(xi->content)) {
 		nartist = unescape_HTML (xi->content);
 		if (g_strcmp0(oartist, nartist)) {
-			rena_musicobject_set_artist (priv->mobj, nartist);
+			rena_musicobject_set_artist (job->mobj, nartist);
 			prechanged |= TAG_ARTIST_CHANGED;
 		}
 		g_free (nartist);
@@ -246,7 +382,7 @@ rena_acoustid_plugin_get_metadata_done (SoupSession *session,
 	if (xi && string_is_not_empty(xi->content)) {
 		nalbum = unescape_HTML (xi->content);
 		if (g_strcmp0(oalbum, nalbum)) {
-			rena_musicobject_set_album (priv->mobj, nalbum);
+			rena_musicobject_set_album (job->mobj, nalbum);
 			prechanged |= TAG_ALBUM_CHANGED;
 		}
 		g_free (nalbum);
@@ -260,7 +396,7 @@ rena_acoustid_plugin_get_metadata_done (SoupSession *session,
 		g_signal_connect (G_OBJECT (dialog), "response",
 		                  G_CALLBACK (rena_acoustid_dialog_response), plugin);
 
-		rena_tags_dialog_set_musicobject (RENA_TAGS_DIALOG(dialog), priv->mobj);
+		rena_tags_dialog_set_musicobject (RENA_TAGS_DIALOG(dialog), job->mobj);
 		rena_tags_dialog_set_changed (RENA_TAGS_DIALOG(dialog), prechanged);
 
 		gtk_widget_show (dialog);
@@ -274,25 +410,38 @@ rena_acoustid_plugin_get_metadata_done (SoupSession *session,
 	g_free (oartist);
 	g_free (oalbum);
 
-	g_object_unref (priv->mobj);
 	xmlnode_free (xml);
+	rena_acoustid_job_free (job);
 }
 
 static void
-rena_acoustid_plugin_get_metadata (RenaAcoustidPlugin *plugin, gint duration, const gchar *fingerprint)
+rena_acoustid_plugin_msg_cancelled (GCancellable *cancellable, gpointer user_data)
+{
+	SoupSession *session = user_data;
+	soup_session_abort (session);
+}
+
+static void
+rena_acoustid_plugin_get_metadata (RenaAcoustidJob *job)
 {
 	SoupSession *session;
 	SoupMessage *msg;
 	gchar *query = NULL;
 
 	query = g_strdup_printf ("http://api.acoustid.org/v2/lookup?client=%s&meta=%s&format=%s&duration=%d&fingerprint=%s",
-	                         "yPvUXBmO", "recordings+releasegroups+compress", "xml", duration, fingerprint);
+	                         "yPvUXBmO", "recordings+releasegroups+compress", "xml", job->duration, job->fingerprint);
 
 	session = soup_session_new ();
 
 	msg = soup_message_new ("GET", query);
 	soup_session_queue_message (session, msg,
-	                            rena_acoustid_plugin_get_metadata_done, plugin);
+	                            rena_acoustid_plugin_get_metadata_done, job);
+
+	g_cancellable_connect (job->cancellable,
+	                       G_CALLBACK (rena_acoustid_plugin_msg_cancelled),
+	                       g_object_ref (session),
+	                       g_object_unref);
+	g_object_unref (session);
 
 	g_free (query);
 }
@@ -311,8 +460,11 @@ error_cb (GstBus *bus, GstMessage *msg, void *data)
 	g_free (debug_info);
 }
 
+/* Decode only until chromaprint has the audio it needs, polling the bus so
+ * the job can be cancelled. */
+
 static gboolean
-rena_acoustid_get_fingerprint (const gchar *filename, gchar **fingerprint)
+rena_acoustid_get_fingerprint (const gchar *filename, GCancellable *cancellable, gchar **fingerprint)
 {
 	GstElement *pipeline, *chromaprint;
 	GstBus *bus;
@@ -320,30 +472,77 @@ rena_acoustid_get_fingerprint (const gchar *filename, gchar **fingerprint)
 	gchar *uri, *pipestring = NULL;
 
 	uri = g_filename_to_uri(filename, NULL, NULL);
-	pipestring = g_strdup_printf("uridecodebin uri=%s ! audioconvert ! chromaprint name=chromaprint0 ! fakesink", uri);
+	pipestring = g_strdup_printf("uridecodebin uri=\"%s\" ! audioconvert ! chromaprint name=chromaprint0 duration=%d ! fakesink",
+	                             uri, ACOUSTID_FINGERPRINT_DURATION);
 	g_free (uri);
 
 	pipeline = gst_parse_launch (pipestring, NULL);
+	g_free (pipestring);
+	if (pipeline == NULL)
+		return FALSE;
 
-	bus = gst_element_get_bus (pipeline);
-	g_signal_connect (G_OBJECT (bus), "message::error", (GCallback)error_cb, NULL);
+	chromaprint = gst_bin_get_by_name (GST_BIN(pipeline), "chromaprint0");
 
+	bus = gst_element_get_bus (pipeline);
 	gst_element_set_state (pipeline, GST_STATE_PLAYING);
 
-	msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_ERROR | GST_MESSAGE_EOS);
-	if (msg != NULL)
-		gst_message_unref (msg);
-	gst_object_unref (bus);
+	while (*fingerprint == NULL && !g_cancellable_is_cancelled (cancellable)) {
+		msg = gst_bus_timed_pop_filtered (bus, 100 * GST_MSECOND, GST_MESSAGE_ERROR | GST_MESSAGE_EOS);
 
-	gst_element_set_state (pipeline, GST_STATE_NULL);
+		/* Available as soon as the duration is reached, or at the end of shorter files. */
+		g_object_get (chromaprint, "fingerprint", fingerprint, NULL);
 
-	chromaprint = gst_bin_get_by_name (GST_BIN(pipeline), "chromaprint0");
-	g_object_get (chromaprint, "fingerprint", fingerprint, NULL);
+		if (msg != NULL) {
+			if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+				error_cb (bus, msg, NULL);
+			gst_message_unref (msg);
+			break;
+		}
+	}
 
+	gst_object_unref (bus);
+	gst_element_set_state (pipeline, GST_STATE_NULL);
+
+	gst_object_unref (chromaprint);
 	gst_object_unref (pipeline);
-	g_free (pipestring);
 
-	return TRUE;
+	return string_is_not_empty (*fingerprint);
+}
+
+static gpointer
+rena_acoustid_fingerprint_worker (gpointer data)
+{
+	RenaAcoustidJob *job = data;
+
+	RENA_PROFILE_BEGIN(span);
+	rena_acoustid_get_fingerprint (job->filename, job->cancellable, &job->fingerprint);
+	RENA_PROFILE_END(span, "acoustid-fingerprint");
+
+	return job;
+}
+
+static gboolean
+rena_acoustid_fingerprint_done (gpointer data)
+{
+	RenaAppNotification *notification;
+	RenaAcoustidJob *job = data;
+
+	if (job->plugin == NULL || g_cancellable_is_cancelled (job->cancellable)) {
+		rena_acoustid_job_free (job);
+		return FALSE;
+	}
+
+	if (string_is_empty (job->fingerprint)) {
+		notification = rena_app_notification_new ("AcoustID", _("There was an error when searching your tags on AcoustID"));
+		rena_app_notification_show (notification);
+		rena_acoustid_job_free (job);
+		return FALSE;
+	}
+
+	rena_acoustid_cache_store (job->plugin, job);
+	rena_acoustid_plugin_get_metadata (job);
+
+	return FALSE;
 }
 
 /*
@@ -352,47 +551,41 @@ rena_acoustid_get_fingerprint (const gchar *filename, gchar **fingerprint)
 static void
 rena_acoustid_get_metadata_dialog (RenaAcoustidPlugin *plugin)
 {
-	RenaAppNotification *notification;
 	RenaBackend *backend = NULL;
-	RenaMusicobject *mobj = NULL;
 	RenaBackgroundTaskBar *taskbar;
-	const gchar *file = NULL;
-	gchar *fingerprint = NULL;
-	gint duration = 0;
+	RenaAcoustidJob *job;
+	gchar *key = NULL;
 
 	RenaAcoustidPluginPrivate *priv = plugin->priv;
 
 	backend = rena_application_get_backend (priv->rena);
-	mobj = rena_backend_get_musicobject (backend);
-
-	priv->mobj = rena_musicobject_dup (mobj);
-
-	file = rena_musicobject_get_file (mobj);
-	duration = rena_musicobject_get_length (mobj);
+	job = rena_acoustid_job_new (plugin, rena_backend_get_musicobject (backend));
 
-	priv->task_widget = rena_background_task_widget_new (_("Searching tags on AcoustID"),
+	job->task_widget = rena_background_task_widget_new (_("Searching tags on AcoustID"),
 	                                                      "edit-find",
 	                                                      0,
-	                                                      NULL);
-	g_object_unref (G_OBJECT(priv->task_widget));
+	                                                      job->cancellable);
+	g_object_ref_sink (G_OBJECT(job->task_widget));
 
 	taskbar = rena_background_task_bar_get ();
-	rena_background_task_bar_prepend_widget (taskbar, GTK_WIDGET(priv->task_widget));
+	rena_background_task_bar_prepend_widget (taskbar, GTK_WIDGET(job->task_widget));
 	g_object_unref(G_OBJECT(taskbar));
 
-	if (rena_acoustid_get_fingerprint (file, &fingerprint))
-		rena_acoustid_plugin_get_metadata (plugin, duration, fingerprint);
-	else {
-		taskbar = rena_background_task_bar_get ();
-		rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(priv->task_widget));
-		g_object_unref(G_OBJECT(taskbar));
-		priv->task_widget = NULL;
+	/* Unchanged files reuse the fingerprint without decoding them again. */
 
-		notification = rena_app_notification_new ("AcoustID", _("There was an error when searching your tags on AcoustID"));
-		rena_app_notification_show (notification);
+	job->fingerprint = rena_acoustid_cache_lookup (plugin, job);
+	if (job->fingerprint) {
+		CDEBUG(DBG_PLUGIN, "AcoustID fingerprint cached for %s", job->filename);
+		rena_acoustid_plugin_get_metadata (job);
+		return;
 	}
 
-	g_free (fingerprint);
+	key = g_strdup_printf ("acoustid\x1f%s", job->filename);
+	rena_async_launch_task (RENA_ASYNC_PRIORITY_LONG, key, job->cancellable,
+	                        rena_acoustid_fingerprint_worker,
+	                        rena_acoustid_fingerprint_done,
+	                        job, rena_acoustid_job_free);
+	g_free (key);
 }
 
 static void
@@ -430,6 +623,9 @@ rena_plugin_activate (PeasActivatable *activatable)
 
 	CDEBUG(DBG_PLUGIN, "AcustId plugin %s", G_STRFUNC);
 
+	priv->jobs = NULL;
+	rena_acoustid_cache_init (plugin);
+
 	/* Attach main menu */
 
 	priv->action_group_main_menu = gtk_action_group_new ("RenaAcoustidPlugin");
@@ -480,4 +676,13 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 	priv->merge_id_main_menu = 0;
 
 	rena_menubar_remove_action (priv->rena, "rena-plugins-placeholder", "search-metadata");
+
+	/* Detach running searches, that are freed when they finish */
+
+	g_list_foreach (priv->jobs, (GFunc) rena_acoustid_job_detach, NULL);
+	g_list_free (priv->jobs);
+	priv->jobs = NULL;
+
+	g_object_unref (priv->cdbase);
+	priv->cdbase = NULL;
 }
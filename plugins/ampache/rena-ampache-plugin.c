@@ -44,6 +44,7 @@
 
 #include <libxml/parser.h>
 #include <libxml/xmlmemory.h>
+#include <libxml/xmlreader.h>
 
 #include "rena-ampache-plugin.h"
 
@@ -90,7 +91,10 @@ struct _RenaAmpachePluginPrivate {
 	guint                       ping_timer_id;
 
 	gint                        pending_threads;
-	GHashTable                 *tracks_table;
+	gboolean                    pending_flagged;
+	gboolean                    sync_failed;
+	gint                        max_threads;
+	gint                        songs_offset;
 	gint                        songs_cache;
 	GHashTable                 *favorites_table;
 
@@ -117,6 +121,10 @@ RENA_PLUGIN_REGISTER (RENA_TYPE_AMPACHE_PLUGIN,
 #define KEY_AMPACHE_SERVER "server"
 #define KEY_AMPACHE_USER   "username"
 #define KEY_AMPACHE_PASS   "password"
+#define KEY_AMPACHE_CONCURRENCY "concurrency"
+
+#define AMPACHE_PAGE_LIMIT          250
+#define AMPACHE_DEFAULT_CONCURRENCY 2
 
 /*
  * Propotypes
@@ -211,19 +219,6 @@ rena_ampache_raw_url_get_clean_url (const gchar *raw_uri)
 	return url;
 }
 
-static void
-rena_ampache_plugin_add_track_db (gpointer key,
-                                    gpointer value,
-                                    gpointer user_data)
-{
-	RenaMusicobject *mobj = value;
-	RenaDatabase *database = user_data;
-
-	rena_database_add_new_musicobject (database, mobj);
-
-	rena_process_gtk_events ();
-}
-
 static void
 rena_ampache_plugin_add_favorites (gpointer key,
                                      gpointer value,
@@ -249,16 +244,6 @@ rena_ampache_plugin_add_favorites (gpointer key,
  * Basic Cache.
  */
 
-static void
-rena_ampache_tracks_cache_insert (RenaAmpachePlugin *plugin,
-                                    RenaMusicobject   *mobj)
-{
-	RenaAmpachePluginPrivate *priv = plugin->priv;
-	g_hash_table_insert (priv->tracks_table,
-	                     g_strdup(rena_musicobject_get_file(mobj)),
-	                     mobj);
-}
-
 static void
 rena_ampache_favorites_cache_insert (RenaAmpachePlugin *plugin,
                                        RenaMusicobject   *mobj)
@@ -464,6 +449,151 @@ rena_ampache_xml_get_media (xmlDocPtr doc, xmlNodePtr node)
 	return mobj;
 }
 
+/* Walk the <song> elements of a response without building the whole document.
+ * Each song subtree is expanded, handed to the callback and released before
+ * reading the next one. Never ask the reader for its document here: that marks
+ * it as preserved and keeps every song in memory until the reader is freed. */
+
+typedef void (*RenaAmpacheSongFunc) (RenaAmpachePlugin *plugin, RenaMusicobject *mobj);
+
+static guint
+rena_ampache_xml_foreach_song (RenaAmpachePlugin   *plugin,
+                                 const gchar         *content,
+                                 RenaAmpacheSongFunc  func)
+{
+	xmlTextReaderPtr reader;
+	xmlNodePtr node;
+	RenaMusicobject *mobj;
+	guint count = 0;
+	gint ret;
+
+	RenaAmpachePluginPrivate *priv = plugin->priv;
+
+	reader = xmlReaderForMemory (content, strlen(content), NULL, NULL,
+	                             XML_PARSE_RECOVER | XML_PARSE_NOBLANKS);
+	if (reader == NULL)
+		return 0;
+
+	ret = xmlTextReaderRead (reader);
+	while (ret == 1)
+	{
+		if (xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT &&
+		    !xmlStrcmp (xmlTextReaderConstName (reader), (const xmlChar *) "song"))
+		{
+			node = xmlTextReaderExpand (reader);
+			if (node != NULL) {
+				mobj = rena_ampache_xml_get_media (node->doc, node);
+				if (G_LIKELY(mobj)) {
+					rena_musicobject_set_provider (mobj, priv->server);
+					func (plugin, mobj);
+				}
+				count++;
+			}
+			ret = xmlTextReaderNext (reader);
+		}
+		else {
+			ret = xmlTextReaderRead (reader);
+		}
+	}
+
+	xmlFreeTextReader (reader);
+
+	return count;
+}
+
+/*
+ * Sync of the library.
+ *
+ * The songs of the previous sync are kept until this one completes. Each song
+ * received replaces its old row and is marked on a temporary table, and once
+ * all pages arrived the songs not marked are removed. A cancelled or failed
+ * sync removes nothing, and is retried on next login.
+ */
+
+static void
+rena_ampache_plugin_add_track_db (RenaAmpachePlugin *plugin,
+                                    RenaMusicobject   *mobj)
+{
+	RenaDatabase *database;
+	RenaPreparedStatement *statement;
+	gint location_id;
+
+	database = rena_database_get ();
+
+	location_id = rena_database_find_location (database, rena_musicobject_get_file (mobj));
+	if (location_id) {
+		statement = rena_database_create_statement (database, "DELETE FROM TRACK WHERE location = ?");
+		rena_prepared_statement_bind_int (statement, 1, location_id);
+		rena_prepared_statement_step (statement);
+		rena_prepared_statement_free (statement);
+	}
+
+	rena_database_add_new_musicobject (database, mobj);
+
+	if (!location_id)
+		location_id = rena_database_find_location (database, rena_musicobject_get_file (mobj));
+
+	statement = rena_database_create_statement (database, "INSERT OR IGNORE INTO AMPACHE_SYNC (location) VALUES (?)");
+	rena_prepared_statement_bind_int (statement, 1, location_id);
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+
+	g_object_unref (database);
+
+	g_object_unref (mobj);
+}
+
+static void
+rena_ampache_plugin_sync_begin (RenaAmpachePlugin *plugin)
+{
+	RenaDatabase *database;
+
+	database = rena_database_get ();
+	rena_database_exec_query (database, "CREATE TEMP TABLE IF NOT EXISTS AMPACHE_SYNC (location INTEGER PRIMARY KEY)");
+	rena_database_exec_query (database, "DELETE FROM AMPACHE_SYNC");
+	g_object_unref (database);
+}
+
+/* Remove the songs of the server that were not received on this sync. */
+
+static void
+rena_ampache_plugin_sync_forget_stale (RenaAmpachePlugin *plugin)
+{
+	RenaDatabase *database;
+	RenaPreparedStatement *statement;
+	const gchar *sql;
+
+	RenaAmpachePluginPrivate *priv = plugin->priv;
+
+	database = rena_database_get ();
+	rena_database_begin_transaction (database);
+
+	sql = "DELETE FROM TRACK WHERE provider = ? AND location NOT IN (SELECT location FROM AMPACHE_SYNC)";
+	statement = rena_database_create_statement (database, sql);
+	rena_prepared_statement_bind_int (statement, 1, rena_database_find_provider (database, priv->server));
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+
+	rena_database_exec_query (database, "DELETE FROM LOCATION WHERE id NOT IN (SELECT location FROM TRACK)");
+	rena_database_exec_query (database, "DELETE FROM PLAYLIST_TRACKS WHERE file NOT IN (SELECT name FROM LOCATION)");
+
+	rena_database_commit_transaction (database);
+
+	rena_database_flush_stale_entries (database);
+
+	g_object_unref (database);
+}
+
+static void
+rena_ampache_plugin_sync_end (RenaAmpachePlugin *plugin)
+{
+	RenaDatabase *database;
+
+	database = rena_database_get ();
+	rena_database_exec_query (database, "DELETE FROM AMPACHE_SYNC");
+	g_object_unref (database);
+}
+
 static void
 rena_ampache_plugin_import_finished (RenaAmpachePlugin *plugin)
 {
@@ -479,45 +609,28 @@ rena_ampache_plugin_import_finished (RenaAmpachePlugin *plugin)
 	rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(priv->task_widget));
 	g_object_unref(G_OBJECT(taskbar));
 
-	/* If cancelled just clean and return */
-
-	if (g_cancellable_is_cancelled (priv->cancellable))
-	{
-		g_hash_table_remove_all (priv->tracks_table);
-		g_hash_table_remove_all (priv->favorites_table);
-
-		g_cancellable_reset (priv->cancellable);
-
-		return;
-	}
-
-	/* Generate provider */
-
 	database = rena_database_get ();
 	provider = rena_database_provider_get ();
-	if (rena_database_find_provider (database, priv->server))
+
+	/* If cancelled or failed keep the previous songs, and sync again on next login */
+
+	if (g_cancellable_is_cancelled (priv->cancellable) || priv->sync_failed)
 	{
-		rena_provider_forget_songs (provider, priv->server);
+		rena_ampache_plugin_set_need_upgrade (plugin, TRUE);
+		g_cancellable_reset (priv->cancellable);
 	}
 	else
 	{
-		rena_provider_add_new (provider,
-		                         priv->server,
-		                         "AMPACHE",
-		                         priv->server,
-		                         "folder-remote");
-		rena_provider_set_visible (provider, priv->server, TRUE);
-	}
+		rena_ampache_plugin_sync_forget_stale (plugin);
 
-	/* Insert songs and favorites */
+		/* Insert favorites */
 
-	g_hash_table_foreach (priv->tracks_table,
-	                      rena_ampache_plugin_add_track_db,
-	                      database);
+		g_hash_table_foreach (priv->favorites_table,
+		                      rena_ampache_plugin_add_favorites,
+		                      database);
+	}
 
-	g_hash_table_foreach (priv->favorites_table,
-	                      rena_ampache_plugin_add_favorites,
-	                      database);
+	rena_ampache_plugin_sync_end (plugin);
 
 	/* Inform provides changes */
 
@@ -525,7 +638,6 @@ rena_ampache_plugin_import_finished (RenaAmpachePlugin *plugin)
 
 	/* Clean */
 
-	g_hash_table_remove_all (priv->tracks_table);
 	g_hash_table_remove_all (priv->favorites_table);
 
 	priv->songs_cache = 0;
@@ -541,16 +653,13 @@ rena_ampache_get_flagged_done (GObject      *object,
 {
 	GError *wc_error = NULL;
 	gchar *content = NULL;
-	RenaMusicobject *mobj;
-	xmlDocPtr doc;
-	xmlNodePtr node;
 
 	RenaAmpachePlugin *plugin = user_data;
 	RenaAmpachePluginPrivate *priv = plugin->priv;
 
-	/* Set thread as handled */
+	/* Set request as handled */
 
-	priv->pending_threads--;
+	priv->pending_flagged = FALSE;
 
 	/* Check error */
 
@@ -562,34 +671,13 @@ rena_ampache_get_flagged_done (GObject      *object,
 	{
 		if (!g_cancellable_is_cancelled (priv->cancellable))
 			g_warning ("Failed to get flagged songs: %s", wc_error->message);
+		g_error_free (wc_error);
 	}
 
 	if (content)
 	{
-		doc = xmlReadMemory (content, strlen(content), NULL, NULL,
-		                     XML_PARSE_RECOVER | XML_PARSE_NOBLANKS);
-
-		node = xmlDocGetRootElement (doc);
-		node = node->xmlChildrenNode;
-
-		while(node)
-		{
-			if (!xmlStrcmp (node->name, (const xmlChar *) "song"))
-			{
-				mobj = rena_ampache_xml_get_media (doc, node);
-				if (G_LIKELY(mobj)) {
-					rena_musicobject_set_provider (mobj, priv->server);
-					rena_ampache_favorites_cache_insert (plugin, mobj);
-				}
-
-				/* Have to give control to GTK periodically ... */
-				rena_process_gtk_events ();
-			}
-			node = node->next;
- 		}
-
-		xmlFreeDoc (doc);
-
+		rena_ampache_xml_foreach_song (plugin, content,
+		                                 rena_ampache_favorites_cache_insert);
 	}
 
 	/* If it is last response finishing import */
@@ -601,15 +689,46 @@ rena_ampache_get_flagged_done (GObject      *object,
 
 }
 
+static void
+rena_ampache_get_songs_done (GObject      *object,
+                               GAsyncResult *res,
+                               gpointer      user_data);
+
+static void
+rena_ampache_plugin_request_songs (RenaAmpachePlugin *plugin)
+{
+	gchar *url = NULL;
+
+	RenaAmpachePluginPrivate *priv = plugin->priv;
+
+	if (g_cancellable_is_cancelled (priv->cancellable))
+		return;
+
+	while (priv->pending_threads < priv->max_threads &&
+	       priv->songs_offset < priv->songs_count)
+	{
+		url = g_strdup_printf("%s/server/xml.server.php?action=songs&offset=%i&limit=%i&auth=%s",
+		                      priv->server, priv->songs_offset, AMPACHE_PAGE_LIMIT, priv->auth);
+
+		grl_net_wc_request_async (priv->glrnet,
+		                          url,
+		                          priv->cancellable,
+		                          rena_ampache_get_songs_done,
+		                          plugin);
+		g_free (url);
+
+		priv->songs_offset += AMPACHE_PAGE_LIMIT;
+		priv->pending_threads++;
+	}
+}
+
 static void
 rena_ampache_get_songs_done (GObject      *object,
                                GAsyncResult *res,
                                gpointer      user_data)
 {
-	RenaMusicobject *mobj;
+	RenaDatabase *database;
 	GError *wc_error = NULL;
-	xmlDocPtr doc;
-	xmlNodePtr node;
 	gchar *content = NULL, *summary = NULL;
 
 	RenaAmpachePlugin *plugin = user_data;
@@ -629,35 +748,25 @@ rena_ampache_get_songs_done (GObject      *object,
 	{
 		if (!g_cancellable_is_cancelled (priv->cancellable))
 			g_warning ("Failed to get songs: %s", wc_error->message);
+		g_error_free (wc_error);
+		priv->sync_failed = TRUE;
 	}
 
+	/* Each page goes straight to the database in a single transaction. */
+
 	if (content)
 	{
-		doc = xmlReadMemory (content, strlen(content), NULL, NULL,
-		                     XML_PARSE_RECOVER | XML_PARSE_NOBLANKS);
-
-		node = xmlDocGetRootElement (doc);
-		node = node->xmlChildrenNode;
-
-		while(node)
-		{
-			if (!xmlStrcmp (node->name, (const xmlChar *) "song"))
-			{
-				mobj = rena_ampache_xml_get_media (doc, node);
-				if (G_LIKELY(mobj)) {
-					rena_musicobject_set_provider (mobj, priv->server);
-					rena_ampache_tracks_cache_insert (plugin, mobj);
-				}
-				priv->songs_cache++;
+		database = rena_database_get ();
+		rena_database_begin_transaction (database);
+		priv->songs_cache += rena_ampache_xml_foreach_song (plugin, content,
+		                                                    rena_ampache_plugin_add_track_db);
+		rena_database_commit_transaction (database);
+		g_object_unref (database);
+	}
 
-				/* Have to give control to GTK periodically ... */
-				rena_process_gtk_events ();
-			}
-			node = node->next;
- 		}
+	/* Request the next page only after handling this one. */
 
-		xmlFreeDoc (doc);
-	}
+	rena_ampache_plugin_request_songs (plugin);
 
 	/* Show status update to user. */
 
@@ -674,9 +783,9 @@ rena_ampache_get_songs_done (GObject      *object,
 		g_free (summary);
 	}
 
-	/* If last thread save on database. */
+	/* If last request save on database. */
 
-	if (priv->pending_threads == 0)
+	if (priv->pending_threads == 0 && !priv->pending_flagged)
 	{
 		rena_ampache_plugin_import_finished (plugin);
 	}
@@ -687,9 +796,10 @@ rena_ampache_plugin_cache_music (RenaAmpachePlugin *plugin)
 {
 	RenaAppNotification *notification;
 	RenaBackgroundTaskBar *taskbar;
-	gchar *url = NULL;
-	const guint limit = 250;
-	guint i = 0;
+	RenaDatabase *database;
+	RenaPreferences *preferences;
+	gchar *url = NULL, *plugin_group = NULL;
+	gint concurrency = 0;
 
 	RenaAmpachePluginPrivate *priv = plugin->priv;
 
@@ -710,26 +820,44 @@ rena_ampache_plugin_cache_music (RenaAmpachePlugin *plugin)
 	rena_background_task_bar_prepend_widget (taskbar, GTK_WIDGET(priv->task_widget));
 	g_object_unref(G_OBJECT(taskbar));
 
-	/* Launch threads to get music */
+	/* Songs are inserted as pages arrive, so generate the provider first */
 
-	priv->pending_threads = priv->songs_count/limit + 1;
-	for (i = 0 ; i < priv->pending_threads; i++)
+	database = rena_database_get ();
+	if (!rena_database_find_provider (database, priv->server))
 	{
-		url = g_strdup_printf("%s/server/xml.server.php?action=songs&offset=%i&limit=%i&auth=%s",
-		                      priv->server, i*limit, limit, priv->auth);
-
-		grl_net_wc_request_async (priv->glrnet,
-		                          url,
-		                          priv->cancellable,
-		                          rena_ampache_get_songs_done,
-		                          plugin);
-		g_free (url);
+		rena_provider_add_new (priv->db_provider,
+		                         priv->server,
+		                         "AMPACHE",
+		                         priv->server,
+		                         "folder-remote");
+		rena_provider_set_visible (priv->db_provider, priv->server, TRUE);
 	}
+	g_object_unref (database);
 
-	/* Finally launch get favorites as last thread */
+	/* Hidden preference. Maximum pages requested at the same time */
+
+	preferences = rena_preferences_get ();
+	plugin_group = rena_preferences_get_plugin_group_name (preferences, GROUP_KEY_AMPACHE);
+	concurrency = rena_preferences_get_integer (preferences, plugin_group, KEY_AMPACHE_CONCURRENCY);
+	priv->max_threads = (concurrency > 0) ? concurrency : AMPACHE_DEFAULT_CONCURRENCY;
+	g_free (plugin_group);
+	g_object_unref (preferences);
+
+	/* Launch first requests to get music */
+
+	rena_ampache_plugin_sync_begin (plugin);
+
+	priv->pending_threads = 0;
+	priv->pending_flagged = FALSE;
+	priv->sync_failed = FALSE;
+	priv->songs_offset = 0;
+	priv->songs_cache = 0;
+	rena_ampache_plugin_request_songs (plugin);
+
+	/* Favorites are requested apart, and do not take a page slot */
 
 	if (priv->implement_flags) {
-		priv->pending_threads++;
+		priv->pending_flagged = TRUE;
 
 		url = g_strdup_printf("%s/server/xml.server.php?action=stats&type=song&filter=flagged&auth=%s",
 		                      priv->server, priv->auth);
@@ -1367,6 +1495,42 @@ rena_ampache_plugin_download_done (RenaBackend       *backend,
 	rena_song_cache_put_location (priv->cache, location, filename);
 }
 
+static void
+rena_ampache_plugin_prefetch_upcoming (RenaAmpachePlugin *plugin)
+{
+	RenaPlaylist *playlist;
+	RenaMusicobject *mobj;
+	GList *upcoming, *l, *locations = NULL, *uris = NULL;
+	const gchar *location = NULL;
+	guint count = 0;
+
+	RenaAmpachePluginPrivate *priv = plugin->priv;
+
+	count = rena_song_cache_get_prefetch_count (priv->cache);
+	if (count == 0 || priv->auth == NULL) {
+		rena_song_cache_cancel_prefetch (priv->cache, plugin);
+		return;
+	}
+
+	playlist = rena_application_get_playlist (priv->rena);
+	upcoming = rena_playlist_get_upcoming_mobj_list (playlist, count);
+	for (l = upcoming ; l != NULL ; l = l->next) {
+		mobj = l->data;
+		if (!rena_musicobject_is_ampache_file (mobj))
+			continue;
+
+		location = rena_musicobject_get_file (mobj);
+		locations = g_list_append (locations, g_strdup (location));
+		uris = g_list_append (uris, g_strdup_printf ("%s&ssid=%s", location, priv->auth));
+	}
+
+	rena_song_cache_prefetch (priv->cache, plugin, locations, uris);
+
+	g_list_free_full (locations, g_free);
+	g_list_free_full (uris, g_free);
+	g_list_free (upcoming);
+}
+
 /*
  * Plugin.
  */
@@ -1375,6 +1539,7 @@ static void
 rena_plugin_activate (PeasActivatable *activatable)
 {
 	RenaBackend *backend;
+	RenaPlaylist *playlist;
 	GMenuItem *item;
 	GSimpleAction *action;
 
@@ -1402,11 +1567,6 @@ rena_plugin_activate (PeasActivatable *activatable)
 
 	/* Temp tables.*/
 
-	priv->tracks_table = g_hash_table_new_full (g_str_hash,
-	                                            g_str_equal,
-	                                            g_free,
-	                                            g_object_unref);
-
 	priv->favorites_table = g_hash_table_new_full (g_str_hash,
 	                                               g_str_equal,
 	                                               g_free,
@@ -1461,6 +1621,18 @@ rena_plugin_activate (PeasActivatable *activatable)
 	g_signal_connect (backend, "download-done",
 	                  G_CALLBACK(rena_ampache_plugin_download_done), plugin);
 
+	/* Prefetch the upcoming songs into the cache */
+
+	playlist = rena_application_get_playlist (priv->rena);
+	g_signal_connect_swapped (playlist, "playlist-set-track",
+	                          G_CALLBACK(rena_ampache_plugin_prefetch_upcoming), plugin);
+	g_signal_connect_swapped (playlist, "playlist-changed",
+	                          G_CALLBACK(rena_ampache_plugin_prefetch_upcoming), plugin);
+	g_signal_connect_swapped (playlist, "playlist-queue-changed",
+	                          G_CALLBACK(rena_ampache_plugin_prefetch_upcoming), plugin);
+	g_signal_connect_swapped (rena_application_get_preferences (priv->rena), "notify::shuffle",
+	                          G_CALLBACK(rena_ampache_plugin_prefetch_upcoming), plugin);
+
 	/* Favorites handler */
 
 	priv->favorites = rena_favorites_get ();
@@ -1482,6 +1654,7 @@ static void
 rena_plugin_deactivate (PeasActivatable *activatable)
 {
 	RenaBackend *backend;
+	RenaPlaylist *playlist;
 	RenaDatabaseProvider *provider;
 	RenaPreferences *preferences;
 	gchar *plugin_group = NULL;
@@ -1493,7 +1666,12 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 
 	/* Cache */
 
-	g_hash_table_destroy (priv->tracks_table);
+	playlist = rena_application_get_playlist (priv->rena);
+	g_signal_handlers_disconnect_by_func (playlist, rena_ampache_plugin_prefetch_upcoming, plugin);
+	g_signal_handlers_disconnect_by_func (rena_application_get_preferences (priv->rena),
+	                                      rena_ampache_plugin_prefetch_upcoming, plugin);
+	rena_song_cache_cancel_prefetch (priv->cache, plugin);
+
 	g_object_unref (priv->cache);
 
 	/* Favorites */
@@ -0,0 +1,294 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "rena-cdrom-disc.h"
+
+#include "src/rena-debug.h"
+#include "src/rena-musicobject.h"
+#include "src/rena-music-enum.h"
+
+/*
+ * Table of contents.
+ */
+
+RenaCdromToc *
+rena_cdrom_toc_new (guint n_tracks)
+{
+	RenaCdromToc *toc;
+
+	toc = g_slice_new0 (RenaCdromToc);
+	toc->n_tracks = n_tracks;
+	toc->tracks = g_new0 (RenaCdromTocTrack, n_tracks);
+
+	return toc;
+}
+
+void
+rena_cdrom_toc_free (RenaCdromToc *toc)
+{
+	g_free (toc->tracks);
+	g_slice_free (RenaCdromToc, toc);
+}
+
+/* CDDB disc with the track offsets of the TOC, and its disc ID computed. */
+
+cddb_disc_t *
+rena_cdrom_disc_new_from_toc (const RenaCdromToc *toc)
+{
+	cddb_disc_t *cddb_disc;
+	cddb_track_t *track;
+	guint i;
+
+	if (toc->n_tracks == 0 || toc->leadout_lba < 0)
+		return NULL;
+
+	cddb_disc = cddb_disc_new ();
+	if (!cddb_disc)
+		return NULL;
+
+	cddb_disc_set_length (cddb_disc, FRAMES_TO_SECONDS(toc->leadout_lba));
+
+	for (i = 0; i < toc->n_tracks; i++) {
+		if (toc->tracks[i].lba < 0)
+			goto error;
+
+		track = cddb_track_new ();
+		if (!track)
+			goto error;
+
+		cddb_disc_add_track (cddb_disc, track);
+		cddb_track_set_frame_offset (track, toc->tracks[i].lba);
+	}
+
+	if (!cddb_disc_calc_discid (cddb_disc))
+		goto error;
+
+	return cddb_disc;
+
+error:
+	cddb_disc_destroy (cddb_disc);
+	return NULL;
+}
+
+/*
+ * CDDB cache.
+ *
+ * Discs read from the server are stored in the CDDB_DISC table keyed by disc
+ * ID, with one row per track. Track 0 holds the album title, artist, year
+ * and genre.
+ */
+
+void
+rena_cdrom_disc_cache_init (RenaDatabase *cdbase)
+{
+	rena_database_exec_query (cdbase,
+		"CREATE TABLE IF NOT EXISTS CDDB_DISC "
+			"(discid INT,"
+			"track INT,"
+			"title TEXT,"
+			"artist TEXT,"
+			"year INT,"
+			"genre TEXT,"
+			"PRIMARY KEY(discid, track));");
+}
+
+gboolean
+rena_cdrom_disc_cache_lookup (RenaDatabase *cdbase, cddb_disc_t *cddb_disc)
+{
+	RenaPreparedStatement *statement;
+	cddb_track_t *track;
+	const gchar *title, *artist, *genre;
+	gint track_no, year;
+	gboolean found = FALSE;
+
+	statement = rena_database_create_statement (cdbase,
+		"SELECT track, title, artist, year, genre FROM CDDB_DISC WHERE discid = ?");
+	rena_prepared_statement_bind_int64 (statement, 1, cddb_disc_get_discid (cddb_disc));
+	while (rena_prepared_statement_step (statement)) {
+		track_no = rena_prepared_statement_get_int (statement, 0);
+		title = rena_prepared_statement_get_string (statement, 1);
+		artist = rena_prepared_statement_get_string (statement, 2);
+		year = rena_prepared_statement_get_int (statement, 3);
+		genre = rena_prepared_statement_get_string (statement, 4);
+
+		if (track_no == 0) {
+			if (title)
+				cddb_disc_set_title (cddb_disc, title);
+			if (artist)
+				cddb_disc_set_artist (cddb_disc, artist);
+			if (genre)
+				cddb_disc_set_genre (cddb_disc, genre);
+			cddb_disc_set_year (cddb_disc, year);
+		}
+		else {
+			track = cddb_disc_get_track (cddb_disc, track_no - 1);
+			if (track == NULL)
+				continue;
+			if (title)
+				cddb_track_set_title (track, title);
+			if (artist)
+				cddb_track_set_artist (track, artist);
+		}
+		found = TRUE;
+	}
+	rena_prepared_statement_free (statement);
+
+	return found;
+}
+
+static void
+rena_cdrom_disc_cache_store_row (RenaDatabase *cdbase,
+                                 guint         discid,
+                                 gint          track_no,
+                                 const gchar  *title,
+                                 const gchar  *artist,
+                                 gint          year,
+                                 const gchar  *genre)
+{
+	RenaPreparedStatement *statement;
+
+	statement = rena_database_create_statement (cdbase,
+		"INSERT OR REPLACE INTO CDDB_DISC (discid, track, title, artist, year, genre) VALUES (?, ?, ?, ?, ?, ?)");
+	rena_prepared_statement_bind_int64 (statement, 1, discid);
+	rena_prepared_statement_bind_int (statement, 2, track_no);
+	rena_prepared_statement_bind_string (statement, 3, title);
+	rena_prepared_statement_bind_string (statement, 4, artist);
+	rena_prepared_statement_bind_int (statement, 5, year);
+	rena_prepared_statement_bind_string (statement, 6, genre);
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+}
+
+void
+rena_cdrom_disc_cache_store (RenaDatabase *cdbase, cddb_disc_t *cddb_disc)
+{
+	cddb_track_t *track;
+	guint discid;
+	gint i, num_tracks;
+
+	discid = cddb_disc_get_discid (cddb_disc);
+	num_tracks = cddb_disc_get_track_count (cddb_disc);
+
+	rena_database_begin_transaction (cdbase);
+	rena_cdrom_disc_cache_store_row (cdbase, discid, 0,
+	                                 cddb_disc_get_title (cddb_disc),
+	                                 cddb_disc_get_artist (cddb_disc),
+	                                 cddb_disc_get_year (cddb_disc),
+	                                 cddb_disc_get_genre (cddb_disc));
+	for (i = 0; i < num_tracks; i++) {
+		track = cddb_disc_get_track (cddb_disc, i);
+		if (track == NULL)
+			continue;
+		rena_cdrom_disc_cache_store_row (cdbase, discid, i + 1,
+		                                 cddb_track_get_title (track),
+		                                 cddb_track_get_artist (track),
+		                                 0, NULL);
+	}
+	rena_database_commit_transaction (cdbase);
+}
+
+/*
+ * Musicobjects.
+ */
+
+static RenaMusicobject *
+rena_cdrom_disc_new_musicobject (const RenaCdromTocTrack *toc_track,
+                                 cddb_track_t            *track,
+                                 cddb_disc_t             *cddb_disc,
+                                 const gchar             *provider)
+{
+	RenaMusicEnum *enum_map = NULL;
+	RenaMusicobject *mobj = NULL;
+	const gchar *title = NULL, *artist, *album, *genre;
+	gchar *ntitle = NULL, *nfile = NULL;
+	gint year;
+
+	CDEBUG(DBG_PLUGIN, "Creating new musicobject from cdda: %d", toc_track->track_no);
+
+	mobj = g_object_new (RENA_TYPE_MUSICOBJECT,
+	                     NULL);
+
+	if (track) {
+		title = cddb_track_get_title(track);
+
+		artist = cddb_track_get_artist(track);
+		if(artist)
+			rena_musicobject_set_artist(mobj, artist);
+
+		album = cddb_disc_get_title(cddb_disc);
+		if(album)
+			rena_musicobject_set_album(mobj, album);
+
+		year = cddb_disc_get_year(cddb_disc);
+		if(year)
+			rena_musicobject_set_year(mobj, year);
+
+		genre = cddb_disc_get_genre(cddb_disc);
+		if(genre)
+			rena_musicobject_set_genre(mobj, genre);
+	}
+
+	enum_map = rena_music_enum_get ();
+	rena_musicobject_set_source (mobj, rena_music_enum_map_get(enum_map, "CDROM"));
+	g_object_unref (enum_map);
+
+	if (provider)
+		rena_musicobject_set_provider (mobj, provider);
+
+	nfile = g_strdup_printf("cdda://%d", toc_track->track_no);
+	rena_musicobject_set_file(mobj, nfile);
+	rena_musicobject_set_track_no(mobj, toc_track->track_no);
+
+	ntitle = title ? g_strdup(title) : g_strdup_printf("Track %d", toc_track->track_no);
+	rena_musicobject_set_title(mobj, ntitle);
+
+	rena_musicobject_set_length(mobj, (toc_track->last_sector - toc_track->first_sector) / FRAMES_PER_SECOND);
+	rena_musicobject_set_channels(mobj, (toc_track->channels > 0) ? toc_track->channels : 0);
+
+	g_free(nfile);
+	g_free(ntitle);
+
+	return mobj;
+}
+
+/* One musicobject per track, with the tags of the disc when given. */
+
+GList *
+rena_cdrom_disc_get_mobj_list (const RenaCdromToc *toc,
+                               cddb_disc_t        *cddb_disc,
+                               const gchar        *provider)
+{
+	RenaMusicobject *mobj;
+	cddb_track_t *track = NULL;
+	GList *list = NULL;
+	guint i;
+
+	for (i = 0; i < toc->n_tracks; i++) {
+		if (cddb_disc)
+			track = cddb_disc_get_track (cddb_disc, i);
+
+		mobj = rena_cdrom_disc_new_musicobject (&toc->tracks[i], track, cddb_disc, provider);
+		if (G_LIKELY(mobj))
+			list = g_list_prepend (list, mobj);
+	}
+
+	return g_list_reverse (list);
+}
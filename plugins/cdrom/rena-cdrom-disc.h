@@ -0,0 +1,73 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#ifndef __RENA_CDROM_DISC_H__
+#define __RENA_CDROM_DISC_H__
+
+#include <glib.h>
+#include <cddb/cddb.h>
+
+#include "src/rena-database.h"
+
+G_BEGIN_DECLS
+
+/*
+ * What is read from the drive, so the disc can be identified and turned into
+ * musicobjects without a drive.
+ */
+typedef struct {
+	gint  track_no;
+	glong lba;           /* Frame offset used by CDDB. */
+	glong first_sector;
+	glong last_sector;
+	gint  channels;
+} RenaCdromTocTrack;
+
+typedef struct {
+	glong              leadout_lba;
+	guint              n_tracks;
+	RenaCdromTocTrack *tracks;
+} RenaCdromToc;
+
+RenaCdromToc *
+rena_cdrom_toc_new                 (guint n_tracks);
+
+void
+rena_cdrom_toc_free                (RenaCdromToc *toc);
+
+cddb_disc_t *
+rena_cdrom_disc_new_from_toc       (const RenaCdromToc *toc);
+
+void
+rena_cdrom_disc_cache_init         (RenaDatabase *cdbase);
+
+gboolean
+rena_cdrom_disc_cache_lookup       (RenaDatabase *cdbase,
+                                    cddb_disc_t  *cddb_disc);
+
+void
+rena_cdrom_disc_cache_store        (RenaDatabase *cdbase,
+                                    cddb_disc_t  *cddb_disc);
+
+GList *
+rena_cdrom_disc_get_mobj_list      (const RenaCdromToc *toc,
+                                    cddb_disc_t        *cddb_disc,
+                                    const gchar        *provider);
+
+G_END_DECLS
+
+#endif /* __RENA_CDROM_DISC_H__ */
@@ -54,6 +54,8 @@
 
 #include "plugins/rena-plugin-macros.h"
 
+#include "rena-cdrom-disc.h"
+
 #define RENA_TYPE_CDROM_PLUGIN         (rena_cdrom_plugin_get_type ())
 #define RENA_CDROM_PLUGIN(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), RENA_TYPE_CDROM_PLUGIN, RenaCdromPlugin))
 #define RENA_CDROM_PLUGIN_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST((k), RENA_TYPE_CDROM_PLUGIN, RenaCdromPlugin))
@@ -63,6 +65,7 @@
 
 struct _RenaCdromPluginPrivate {
 	RenaApplication *rena;
+	RenaDatabase    *cdbase;
 
 #if HAVE_GUDEV
 	RenaDeviceClient *device_client;
@@ -156,133 +159,36 @@ rena_preferences_set_audio_cd_device (RenaPreferences *preferences,
 	g_free (plugin_group);
 }
 
-static RenaMusicobject *
-new_musicobject_from_cdda (RenaCdromPlugin *plugin,
-                           cdrom_drive_t     *cdda_drive,
-                           cddb_disc_t       *cddb_disc,
-                           gint               track_no)
-{
-	RenaPreferences *preferences;
-	RenaMusicEnum *enum_map = NULL;
-	RenaMusicobject *mobj = NULL;
-	gint channels, start, end;
-	gchar *ntitle = NULL, *nfile = NULL;
-
-	RenaCdromPluginPrivate *priv = plugin->priv;
-
-	CDEBUG(DBG_PLUGIN, "Creating new musicobject from cdda: %d", track_no);
+/* Read what identifies the disc on the drive. The rest works from it. */
 
-	channels = cdio_get_track_channels(cdda_drive->p_cdio, track_no);
-	start = cdio_cddap_track_firstsector(cdda_drive, track_no);
-	end = cdio_cddap_track_lastsector(cdda_drive, track_no);
-
-	mobj = g_object_new (RENA_TYPE_MUSICOBJECT,
-	                     NULL);
-
-	preferences = rena_application_get_preferences (priv->rena);
-	if (rena_preferences_get_use_cddb (preferences) && cddb_disc) {
-		cddb_track_t *track;
-		const gchar *title, *artist, *album, *genre;
-		gint year;
-
-		track = cddb_disc_get_track(cddb_disc, track_no - 1);
-		if (track) {
-			title = cddb_track_get_title(track);
-			if (title)
-				ntitle = g_strdup(title);
-
-			artist = cddb_track_get_artist(track);
-			if(artist)
-				rena_musicobject_set_artist(mobj, artist);
-
-			album = cddb_disc_get_title(cddb_disc);
-			if(album)
-				rena_musicobject_set_album(mobj, album);
-
-			year = cddb_disc_get_year(cddb_disc);
-			if(year)
-				rena_musicobject_set_year(mobj, year);
-
-			genre = cddb_disc_get_genre(cddb_disc);
-			if(genre)
-				rena_musicobject_set_genre(mobj, genre);
-		}
-	}
-
-	enum_map = rena_music_enum_get ();
-	rena_musicobject_set_source (mobj, rena_music_enum_map_get(enum_map, "CDROM"));
-	g_object_unref (enum_map);
-
-	if (priv->disc_id)
-		rena_musicobject_set_provider (mobj, priv->disc_id);
-
-	nfile = g_strdup_printf("cdda://%d", track_no);
-	rena_musicobject_set_file(mobj, nfile);
-	rena_musicobject_set_track_no(mobj, track_no);
-
-	if (!ntitle)
-		ntitle = g_strdup_printf("Track %d", track_no);
-	rena_musicobject_set_title(mobj, ntitle);
-
-	rena_musicobject_set_length(mobj, (end - start) / CDIO_CD_FRAMES_PER_SEC);
-	rena_musicobject_set_channels(mobj, (channels > 0) ? channels : 0);
-
-	g_free(nfile);
-	g_free(ntitle);
-
-	return mobj;
-}
-
-static gint
-rena_cdrom_plugin_add_cddb_tracks (cdrom_drive_t *cdda_drive,
-                                     cddb_disc_t   *cddb_disc)
+static RenaCdromToc *
+rena_cdrom_plugin_read_toc (cdrom_drive_t *cdda_drive)
 {
-	cddb_track_t *track;
-	lba_t lba;
-	gint num_tracks, first_track, i = 0;
+	RenaCdromToc *toc;
+	RenaCdromTocTrack *toc_track;
+	gint num_tracks, first_track, i;
 
 	num_tracks = cdio_cddap_tracks(cdda_drive);
 	if (!num_tracks)
-		return -1;
+		return NULL;
 
 	first_track = cdio_get_first_track_num(cdda_drive->p_cdio);
-	for (i = first_track; i <= num_tracks; i++) {
-		track = cddb_track_new();
-		if (!track)
-			return -1;
-
-		lba = cdio_get_track_lba(cdda_drive->p_cdio, i);
-		if (lba == CDIO_INVALID_LBA)
-			return -1;
-
-		cddb_disc_add_track(cddb_disc, track);
-		cddb_track_set_frame_offset(track, lba);
-	}
-
-	return 0;
-}
-
-static GList *
-rena_cdrom_plugin_get_mobj_list (RenaCdromPlugin *plugin,
-                                   cdrom_drive_t     *cdda_drive,
-                                   cddb_disc_t       *cddb_disc)
-{
-	RenaMusicobject *mobj;
-	gint num_tracks = 0, i = 0;
-	GList *list = NULL;
-
-	num_tracks = cdio_cddap_tracks(cdda_drive);
-	if (!num_tracks)
+	if (first_track < 1 || first_track > num_tracks)
 		return NULL;
 
-	for (i = 1; i <= num_tracks; i++) {
-		mobj = new_musicobject_from_cdda (plugin, cdda_drive, cddb_disc, i);
-		if (G_LIKELY(mobj))
-			list = g_list_append(list, mobj);
+	toc = rena_cdrom_toc_new (num_tracks - first_track + 1);
+	toc->leadout_lba = cdio_get_track_lba(cdda_drive->p_cdio, CDIO_CDROM_LEADOUT_TRACK);
 
-		rena_process_gtk_events ();
+	for (i = first_track; i <= num_tracks; i++) {
+		toc_track = &toc->tracks[i - first_track];
+		toc_track->track_no = i;
+		toc_track->lba = cdio_get_track_lba(cdda_drive->p_cdio, i);
+		toc_track->first_sector = cdio_cddap_track_firstsector(cdda_drive, i);
+		toc_track->last_sector = cdio_cddap_track_lastsector(cdda_drive, i);
+		toc_track->channels = cdio_get_track_channels(cdda_drive->p_cdio, i);
 	}
-	return list;
+
+	return toc;
 }
 
 static cdrom_drive_t *
@@ -333,7 +239,7 @@ rena_application_append_audio_cd (RenaCdromPlugin *plugin)
 	RenaPlaylist *playlist;
 	RenaPreferences *preferences;
 	RenaMusicobject *mobj;
-	lba_t lba;
+	RenaCdromToc *toc = NULL;
 	gint matches;
 	cdrom_drive_t *cdda_drive = NULL;
 	cddb_disc_t *cddb_disc = NULL;
@@ -355,29 +261,34 @@ rena_application_append_audio_cd (RenaCdromPlugin *plugin)
 		return;
 	}
 
-	if (rena_preferences_get_use_cddb (preferences)) {
-		cddb_conn = cddb_new ();
-		if (!cddb_conn)
-			goto add;
+	toc = rena_cdrom_plugin_read_toc (cdda_drive);
+	cdio_cddap_close(cdda_drive);
+	if (!toc) {
+		g_warning("Unable to read the tracks of Audio CD");
+		return;
+	}
 
-		cddb_disc = cddb_disc_new();
+	if (rena_preferences_get_use_cddb (preferences)) {
+		cddb_disc = rena_cdrom_disc_new_from_toc (toc);
 		if (!cddb_disc)
 			goto add;
 
-		lba = cdio_get_track_lba(cdda_drive->p_cdio, CDIO_CDROM_LEADOUT_TRACK);
-		if (lba == CDIO_INVALID_LBA)
-			goto add;
+		discid = cddb_disc_get_discid (cddb_disc);
+		if (discid) {
+			g_free (priv->disc_id);
+			priv->disc_id = g_strdup_printf ("Discid://%x", discid);
+		}
 
-		cddb_disc_set_length(cddb_disc, FRAMES_TO_SECONDS(lba));
-		if (rena_cdrom_plugin_add_cddb_tracks(cdda_drive, cddb_disc) < 0)
-			goto add;
+		/* Known discs do not need the server. */
 
-		if (!cddb_disc_calc_discid(cddb_disc))
+		if (rena_cdrom_disc_cache_lookup (priv->cdbase, cddb_disc)) {
+			CDEBUG(DBG_PLUGIN, "CDDB disc %x found on cache", discid);
 			goto add;
+		}
 
-		discid = cddb_disc_get_discid (cddb_disc);
-		if (discid)
-			priv->disc_id = g_strdup_printf ("Discid://%x", discid);
+		cddb_conn = cddb_new ();
+		if (!cddb_conn)
+			goto add;
 
 		cddb_disc_set_category(cddb_disc, CDDB_CAT_MISC);
 
@@ -390,19 +301,21 @@ rena_application_append_audio_cd (RenaCdromPlugin *plugin)
 			goto add;
 		}
 
+		rena_cdrom_disc_cache_store (priv->cdbase, cddb_disc);
+
 		CDEBUG(DBG_PLUGIN, "Successfully initialized CDDB");
 
 		goto add;
 	}
 
 add:
-	list = rena_cdrom_plugin_get_mobj_list (plugin, cdda_drive, cddb_disc);
+	list = rena_cdrom_disc_get_mobj_list (toc, cddb_disc, priv->disc_id);
 	if (list) {
 		playlist = rena_application_get_playlist (priv->rena);
 		rena_playlist_append_mobj_list (playlist, list);
 
 		if (priv->disc_id) {
-			title_disc = cddb_disc_get_title (cddb_disc);
+			title_disc = cddb_disc ? cddb_disc_get_title (cddb_disc) : NULL;
 
 			provider = rena_database_provider_get ();
 			rena_provider_add_new (provider,
@@ -425,8 +338,7 @@ add:
 
 	CDEBUG(DBG_PLUGIN, "Successfully opened Audio CD device");
 
-	if (cdda_drive)
-		cdio_cddap_close(cdda_drive);
+	rena_cdrom_toc_free (toc);
 	if (cddb_disc)
 		cddb_disc_destroy(cddb_disc);
 	if (cddb_conn)
@@ -779,6 +691,9 @@ rena_plugin_activate (PeasActivatable *activatable)
 
 	priv->rena = g_object_get_data (G_OBJECT (plugin), "object");
 
+	priv->cdbase = rena_database_get ();
+	rena_cdrom_disc_cache_init (priv->cdbase);
+
 	/* Attach main menu */
 
 	priv->action_group_main_menu = gtk_action_group_new ("RenaCdromPlugin");
@@ -879,6 +794,8 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 		g_object_unref (provider);
 	}
 
+	g_object_unref (priv->cdbase);
+
 	/* Crop library to not save from playlist */
 
 	enum_map = rena_music_enum_get ();
@@ -0,0 +1,227 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+/*
+ * Identification and cache of a disc recorded from a drive, without a drive.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "src/rena-debug.h"
+#include "src/rena-musicobject.h"
+
+#include "rena-cdrom-disc.h"
+
+/* Table of contents as read from a six tracks audio disc. */
+
+static RenaCdromTocTrack recorded_tracks[] = {
+	{ 1, 150,   0,     18754,  2 },
+	{ 2, 18905, 18755, 36029,  2 },
+	{ 3, 36180, 36030, 52189,  2 },
+	{ 4, 52340, 52190, 71471,  2 },
+	{ 5, 71622, 71472, 89959,  2 },
+	{ 6, 90110, 89960, 108269, 2 },
+};
+
+static const RenaCdromToc recorded_toc = {
+	108420, G_N_ELEMENTS (recorded_tracks), recorded_tracks
+};
+
+#define RECORDED_DISCID   0x4505a306
+#define RECORDED_PROVIDER "Discid://4505a306"
+
+static const gint recorded_lengths[] = { 250, 230, 215, 257, 246, 244 };
+
+static const gchar *recorded_titles[] = {
+	"Opening", "Second Song", "Interlude", "Fourth Song", "Ballad", "Closing"
+};
+
+static RenaDatabase *cdbase = NULL;
+
+static void
+fill_disc_from_server (cddb_disc_t *cddb_disc)
+{
+	cddb_track_t *track;
+	guint i;
+
+	cddb_disc_set_title (cddb_disc, "Recorded Album");
+	cddb_disc_set_artist (cddb_disc, "Recorded Artist");
+	cddb_disc_set_genre (cddb_disc, "Rock");
+	cddb_disc_set_year (cddb_disc, 1999);
+
+	for (i = 0; i < G_N_ELEMENTS (recorded_titles); i++) {
+		track = cddb_disc_get_track (cddb_disc, i);
+		cddb_track_set_title (track, recorded_titles[i]);
+		cddb_track_set_artist (track, "Recorded Artist");
+	}
+}
+
+static void
+test_disc_id (void)
+{
+	cddb_disc_t *cddb_disc;
+
+	cddb_disc = rena_cdrom_disc_new_from_toc (&recorded_toc);
+	g_assert_nonnull (cddb_disc);
+	g_assert_cmpuint (cddb_disc_get_discid (cddb_disc), ==, RECORDED_DISCID);
+	g_assert_cmpint (cddb_disc_get_track_count (cddb_disc), ==, G_N_ELEMENTS (recorded_tracks));
+
+	cddb_disc_destroy (cddb_disc);
+}
+
+static void
+test_invalid_toc (void)
+{
+	RenaCdromToc *toc;
+
+	toc = rena_cdrom_toc_new (0);
+	g_assert_null (rena_cdrom_disc_new_from_toc (toc));
+	rena_cdrom_toc_free (toc);
+
+	toc = rena_cdrom_toc_new (2);
+	toc->leadout_lba = 36180;
+	toc->tracks[0].lba = 150;
+	toc->tracks[1].lba = -1;
+	g_assert_null (rena_cdrom_disc_new_from_toc (toc));
+	rena_cdrom_toc_free (toc);
+}
+
+static void
+test_without_disc (void)
+{
+	RenaMusicobject *mobj;
+	GList *list, *l;
+	gchar *title;
+	gint i = 0;
+
+	list = rena_cdrom_disc_get_mobj_list (&recorded_toc, NULL, NULL);
+	g_assert_cmpuint (g_list_length (list), ==, G_N_ELEMENTS (recorded_tracks));
+
+	for (l = list; l != NULL; l = l->next, i++) {
+		mobj = l->data;
+		title = g_strdup_printf ("Track %d", i + 1);
+		g_assert_cmpstr (rena_musicobject_get_title (mobj), ==, title);
+		g_assert_cmpint (rena_musicobject_get_length (mobj), ==, recorded_lengths[i]);
+		g_assert_cmpstr (rena_musicobject_get_provider (mobj), ==, "");
+		g_free (title);
+	}
+
+	g_list_free_full (list, g_object_unref);
+}
+
+static void
+test_cache_miss (void)
+{
+	cddb_disc_t *cddb_disc;
+
+	cddb_disc = rena_cdrom_disc_new_from_toc (&recorded_toc);
+	g_assert_false (rena_cdrom_disc_cache_lookup (cdbase, cddb_disc));
+	g_assert_null (cddb_disc_get_title (cddb_disc));
+	cddb_disc_destroy (cddb_disc);
+}
+
+static void
+test_cache_hit (void)
+{
+	RenaMusicobject *mobj;
+	cddb_disc_t *cddb_disc;
+	GList *list, *l;
+	gchar *file;
+	gint i = 0;
+
+	/* Stored once read from the server... */
+
+	cddb_disc = rena_cdrom_disc_new_from_toc (&recorded_toc);
+	fill_disc_from_server (cddb_disc);
+	rena_cdrom_disc_cache_store (cdbase, cddb_disc);
+	cddb_disc_destroy (cddb_disc);
+
+	/* ...found for the same disc inserted again. */
+
+	cddb_disc = rena_cdrom_disc_new_from_toc (&recorded_toc);
+	g_assert_true (rena_cdrom_disc_cache_lookup (cdbase, cddb_disc));
+	g_assert_cmpstr (cddb_disc_get_title (cddb_disc), ==, "Recorded Album");
+
+	list = rena_cdrom_disc_get_mobj_list (&recorded_toc, cddb_disc, RECORDED_PROVIDER);
+	g_assert_cmpuint (g_list_length (list), ==, G_N_ELEMENTS (recorded_tracks));
+
+	for (l = list; l != NULL; l = l->next, i++) {
+		mobj = l->data;
+		file = g_strdup_printf ("cdda://%d", i + 1);
+		g_assert_cmpstr (rena_musicobject_get_file (mobj), ==, file);
+		g_assert_cmpstr (rena_musicobject_get_title (mobj), ==, recorded_titles[i]);
+		g_assert_cmpstr (rena_musicobject_get_artist (mobj), ==, "Recorded Artist");
+		g_assert_cmpstr (rena_musicobject_get_album (mobj), ==, "Recorded Album");
+		g_assert_cmpstr (rena_musicobject_get_genre (mobj), ==, "Rock");
+		g_assert_cmpint (rena_musicobject_get_year (mobj), ==, 1999);
+		g_assert_cmpint (rena_musicobject_get_track_no (mobj), ==, i + 1);
+		g_assert_cmpint (rena_musicobject_get_length (mobj), ==, recorded_lengths[i]);
+		g_assert_cmpstr (rena_musicobject_get_provider (mobj), ==, RECORDED_PROVIDER);
+		g_free (file);
+	}
+
+	g_list_free_full (list, g_object_unref);
+	cddb_disc_destroy (cddb_disc);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+	gchar *config_dir, *rena_dir, *database_file;
+	gint ret;
+
+	debug_level = 0;
+
+	g_test_init (&argc, &argv, NULL);
+
+	/* The database of the test lives in a temporary folder. */
+
+	config_dir = g_dir_make_tmp ("rena-test-cdrom-XXXXXX", NULL);
+	g_assert_nonnull (config_dir);
+	g_setenv ("XDG_CONFIG_HOME", config_dir, TRUE);
+	rena_dir = g_build_filename (config_dir, "rena", NULL);
+	g_mkdir_with_parents (rena_dir, 0700);
+
+	cdbase = rena_database_get ();
+	g_assert_true (rena_database_start_successfully (cdbase));
+	rena_cdrom_disc_cache_init (cdbase);
+
+	g_test_add_func ("/cdrom/disc/id", test_disc_id);
+	g_test_add_func ("/cdrom/disc/invalid-toc", test_invalid_toc);
+	g_test_add_func ("/cdrom/disc/without-disc", test_without_disc);
+	g_test_add_func ("/cdrom/cache/miss", test_cache_miss);
+	g_test_add_func ("/cdrom/cache/hit", test_cache_hit);
+
+	ret = g_test_run ();
+
+	g_object_unref (cdbase);
+
+	database_file = g_build_filename (rena_dir, "rena.db", NULL);
+	g_unlink (database_file);
+	g_rmdir (rena_dir);
+	g_rmdir (config_dir);
+	g_free (database_file);
+	g_free (rena_dir);
+	g_free (config_dir);
+
+	return ret;
+}
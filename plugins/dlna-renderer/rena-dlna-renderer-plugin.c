@@ -38,6 +38,7 @@
 #include <grilo.h>
 
 #include "rena-dlna-renderer-plugin.h"
+#include "rena-dlna-renderer-walk.h"
 
 #include "src/rena.h"
 #include "src/rena-app-notification.h"
@@ -48,6 +49,8 @@
 #include "src/rena-musicobject.h"
 #include "src/rena-musicobject-mgmt.h"
 #include "src/rena-window.h"
+#include "src/rena-background-task-bar.h"
+#include "src/rena-background-task-widget.h"
 
 #include "plugins/rena-plugin-macros.h"
 
@@ -56,6 +59,11 @@ typedef struct _RenaDlnaRendererPluginPrivate RenaDlnaRendererPluginPrivate;
 struct _RenaDlnaRendererPluginPrivate {
 	RenaApplication    *rena;
 
+	RenaBackgroundTaskWidget *task_widget;
+	GCancellable         *cancellable;
+
+	RenaDlnaRendererWalk *walk;
+
 	GtkActionGroup       *action_group_main_menu;
 	guint                 merge_id_main_menu;
 };
@@ -63,6 +71,9 @@ struct _RenaDlnaRendererPluginPrivate {
 RENA_PLUGIN_REGISTER (RENA_TYPE_DLNA_RENDERER_PLUGIN,
                         RenaDlnaRendererPlugin,
                         rena_dlna_renderer_plugin)
+
+#define KEY_DLNA_RENDERER_PAGE_SIZE "page_size"
+#define DEFAULT_PAGE_SIZE           100
 /*
  *
  */
@@ -102,131 +113,111 @@ static const gchar *main_menu_xml = "<ui>						\
 	</menubar>													\
 </ui>";
 
-static GList *
-rena_dlna_renderer_append_media (GList *list, GrlMedia *media)
-{
-	RenaMusicobject *mobj;
-	const gchar *title = NULL, *url = NULL;
-	guint seconds = 0;
+/*
+ * Async browse, appending each page to the playlist as it arrives.
+ */
 
-	url = grl_media_get_url (media);
-	title = grl_media_get_title (media);
-	seconds = grl_media_get_duration (media);
+static void
+rena_dlna_renderer_page_added (GList *list, gpointer user_data)
+{
+	RenaPlaylist *playlist;
+	gchar *summary = NULL;
 
-	mobj = g_object_new (RENA_TYPE_MUSICOBJECT,
-	                     "file", url,
-	                     "source", FILE_HTTP,
-	                     "title", title,
-	                     "length", seconds,
-	                     NULL);
+	RenaDlnaRendererPlugin *plugin = user_data;
+	RenaDlnaRendererPluginPrivate *priv = plugin->priv;
 
-	if (G_LIKELY(mobj))
-		list = g_list_prepend (list, mobj);
+	playlist = rena_application_get_playlist (priv->rena);
+	rena_playlist_append_mobj_list (playlist, list);
+	g_list_free (list);
 
-	return list;
+	summary = g_strdup_printf (_("%i songs added"), rena_dlna_renderer_walk_get_songs_added (priv->walk));
+	rena_background_task_widget_set_description (priv->task_widget, summary);
+	g_free (summary);
 }
 
-static GList *
-rena_dlna_renderer_append_source (GList     *list,
-                                    GrlSource *source,
-                                    GrlMedia  *container)
+static void
+rena_dlna_renderer_search_finished (RenaDlnaRendererWalk *walk, gpointer user_data)
 {
-	GrlOperationOptions *options;
-	GrlCaps *caps;
-	GrlMedia *media;
-	GList *keys = NULL;
-	GList *medias = NULL, *media_iter;
-
-	keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
-	                                  GRL_METADATA_KEY_DURATION,
-	                                  GRL_METADATA_KEY_URL,
-	                                  GRL_METADATA_KEY_CHILDCOUNT,
-	                                  GRL_METADATA_KEY_INVALID);
-
-	caps = grl_source_get_caps (source, GRL_OP_BROWSE);
-	options = grl_operation_options_new (caps);
-
-#ifdef HAVE_GRILO3
-	grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_IDLE_RELAY);
-#endif
-#ifdef HAVE_GRILO2
-	grl_operation_options_set_flags (options, GRL_RESOLVE_IDLE_RELAY);
-#endif
+	RenaAppNotification *notification;
+	RenaBackgroundTaskBar *taskbar;
+	gchar *msge = NULL;
 
-	medias = grl_source_browse_sync (source, container, keys, options, NULL);
-	for (media_iter = medias; media_iter; media_iter = g_list_next (media_iter)) {
-		if (media_iter->data == NULL)
-			continue;
+	RenaDlnaRendererPlugin *plugin = user_data;
+	RenaDlnaRendererPluginPrivate *priv = plugin->priv;
 
-		media = GRL_MEDIA (media_iter->data);
+	taskbar = rena_background_task_bar_get ();
+	rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(priv->task_widget));
+	g_object_unref(G_OBJECT(taskbar));
 
-#ifdef HAVE_GRILO3
-		if (grl_media_is_container (media)) {
-#endif
-#ifdef HAVE_GRILO2
-		if (GRL_IS_MEDIA_BOX (media)) {
-#endif
-			list = rena_dlna_renderer_append_source (list, source, media);
-		}
-#ifdef HAVE_GRILO3
-		else if (grl_media_is_audio (media)) {
-#endif
-#ifdef HAVE_GRILO2
-		else if (GRL_IS_MEDIA_AUDIO (media)) {
-#endif
-			list = rena_dlna_renderer_append_media (list, media);
-		}
-		rena_process_gtk_events ();
-
-		g_object_unref (media);
+	if (rena_dlna_renderer_walk_get_songs_added (walk)) {
+		msge = g_strdup_printf (_("Music of the %s server was added."),
+		                        rena_dlna_renderer_walk_get_source_name (walk));
+		notification = rena_app_notification_new (_("Search music on DLNA server"), msge);
+		rena_app_notification_show (notification);
+		g_free (msge);
+	}
+	else if (!rena_dlna_renderer_walk_is_cancelled (walk)) {
+		notification = rena_app_notification_new (_("Search music on DLNA server"), _("Could not find any DLNA server."));
+		rena_app_notification_show (notification);
 	}
 
-	g_object_unref (options);
-
-	g_list_free (keys);
-	g_list_free (medias);
-
-	return list;
+	/* The walk frees itself after returning. */
+	priv->walk = NULL;
 }
 
 static void
 rena_dlna_renderer_plugin_search_music (RenaDlnaRendererPlugin *plugin)
 {
 	RenaAppNotification *notification;
-	RenaPlaylist *playlist;
-	GList *sources = NULL, *sources_iter;
+	RenaBackgroundTaskBar *taskbar;
+	RenaPreferences *preferences;
 	GrlRegistry *registry;
-	GList *list = NULL;
+	GList *sources;
+	gchar *plugin_group = NULL;
+	gint page_size = 0;
 
-	CDEBUG(DBG_PLUGIN, "DLNA Renderer plugin %s", G_STRFUNC);
+	RenaDlnaRendererPluginPrivate *priv = plugin->priv;
 
-	registry = grl_registry_get_default ();
+	CDEBUG(DBG_PLUGIN, "DLNA Renderer plugin %s", G_STRFUNC);
 
-	sources = grl_registry_get_sources_by_operations (registry, GRL_OP_BROWSE, FALSE);
-	for (sources_iter = sources; sources_iter; sources_iter = g_list_next (sources_iter)) {
-		list = rena_dlna_renderer_append_source (list, GRL_SOURCE(sources_iter->data), NULL);
-		if (list)
-			break;
-	}
+	/* Already walking a server */
 
-	if (list) {
-		playlist = rena_application_get_playlist (plugin->priv->rena);
+	if (priv->walk != NULL)
+		return;
 
-		rena_playlist_append_mobj_list (playlist, list);
-		g_list_free (list);
+	g_cancellable_reset (priv->cancellable);
 
-		const gchar *server = grl_source_get_name (GRL_SOURCE(sources_iter->data));
-		gchar *msge = g_strdup_printf (_("Music of the %s server was added."), server);
-		notification = rena_app_notification_new (_("Search music on DLNA server"), msge);
-		rena_app_notification_show (notification);
-		g_free (msge);
-	}
-	else {
+	registry = grl_registry_get_default ();
+	sources = grl_registry_get_sources_by_operations (registry, GRL_OP_BROWSE, FALSE);
+	if (sources == NULL) {
 		notification = rena_app_notification_new (_("Search music on DLNA server"), _("Could not find any DLNA server."));
 		rena_app_notification_show (notification);
+		return;
 	}
 
+	/* Hidden preference. Number of children requested on each browse */
+
+	preferences = rena_preferences_get ();
+	plugin_group = rena_preferences_get_plugin_group_name (preferences, "dlna-renderer");
+	page_size = rena_preferences_get_integer (preferences, plugin_group, KEY_DLNA_RENDERER_PAGE_SIZE);
+	if (page_size <= 0)
+		page_size = DEFAULT_PAGE_SIZE;
+	g_free (plugin_group);
+	g_object_unref (preferences);
+
+	priv->walk = rena_dlna_renderer_walk_new (sources,
+	                                          page_size,
+	                                          priv->cancellable,
+	                                          rena_dlna_renderer_page_added,
+	                                          rena_dlna_renderer_search_finished,
+	                                          plugin);
 	g_list_free (sources);
+
+	taskbar = rena_background_task_bar_get ();
+	rena_background_task_bar_prepend_widget (taskbar, GTK_WIDGET(priv->task_widget));
+	g_object_unref(G_OBJECT(taskbar));
+
+	rena_dlna_renderer_walk_start (priv->walk);
 }
 
 /*
@@ -267,6 +258,16 @@ rena_plugin_activate (PeasActivatable *activatable)
 	}
 #endif
 
+	/* Cancellable background walk */
+
+	priv->cancellable = g_cancellable_new ();
+
+	priv->task_widget = rena_background_task_widget_new (_("Searching music on DLNA server"),
+	                                                       "network-server",
+	                                                       0,
+	                                                       priv->cancellable);
+	g_object_ref (G_OBJECT(priv->task_widget));
+
 	/* Attach main menu */
 
 	priv->action_group_main_menu = gtk_action_group_new ("RenaDlnaPlugin");
@@ -291,9 +292,17 @@ rena_plugin_activate (PeasActivatable *activatable)
 	g_object_unref (item);
 }
 
+static void
+rena_dlna_renderer_grl_deinit (gpointer data)
+{
+	grl_deinit ();
+}
+
 static void
 rena_plugin_deactivate (PeasActivatable *activatable)
 {
+	RenaBackgroundTaskBar *taskbar;
+
 	RenaDlnaRendererPlugin *plugin = RENA_DLNA_RENDERER_PLUGIN (activatable);
 
 	RenaDlnaRendererPluginPrivate *priv = plugin->priv;
@@ -307,5 +316,20 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 
 	rena_menubar_remove_action (priv->rena, "rena-plugins-placeholder", "search-dlna");
 
-	grl_deinit ();
+	/* Leave a running walk behind. Grilo must outlive its last callback. */
+
+	if (priv->walk != NULL) {
+		taskbar = rena_background_task_bar_get ();
+		rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(priv->task_widget));
+		g_object_unref(G_OBJECT(taskbar));
+
+		rena_dlna_renderer_walk_detach (priv->walk, rena_dlna_renderer_grl_deinit);
+		priv->walk = NULL;
+	}
+	else {
+		grl_deinit ();
+	}
+
+	g_object_unref (priv->cancellable);
+	g_object_unref (priv->task_widget);
 }
@@ -0,0 +1,360 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <grilo.h>
+
+#include "src/rena-musicobject.h"
+#include "src/rena-debug.h"
+
+#include "rena-dlna-renderer-walk.h"
+
+/*
+ * Async browse. Containers are walked one page at a time and each page is
+ * handed over as soon as it arrives.
+ *
+ * The walk owns its state, so the plugin can leave it behind: a detached
+ * walk drops what still arrives and frees itself once grilo ends the
+ * operation in flight. Each step after a page runs from an idle, so the
+ * walk is never freed below grl_operation_cancel().
+ */
+
+typedef struct {
+	GrlMedia *container;
+	guint     skip;
+} RenaDlnaRendererNode;
+
+struct _RenaDlnaRendererWalk {
+	GList                            *sources;
+	GList                            *keys;
+	GQueue                           *pending;
+	RenaDlnaRendererNode             *browsing;
+	guint                             operation_id;
+	guint                             page_size;
+	guint                             page_count;
+	GList                            *batch;
+	gint                              songs_added;
+
+	GCancellable                     *cancellable;
+	gulong                            cancelled_id;
+
+	RenaDlnaRendererWalkPageFunc      page_func;
+	RenaDlnaRendererWalkFinishedFunc  finished_func;
+	gpointer                          user_data;
+
+	gboolean                          detached;
+	GDestroyNotify                    notify;
+};
+
+static RenaDlnaRendererNode *
+rena_dlna_renderer_node_new (GrlMedia *container, guint skip)
+{
+	RenaDlnaRendererNode *node = g_slice_new0 (RenaDlnaRendererNode);
+	node->container = container ? g_object_ref (container) : NULL;
+	node->skip = skip;
+	return node;
+}
+
+static void
+rena_dlna_renderer_node_free (RenaDlnaRendererNode *node)
+{
+	if (node->container)
+		g_object_unref (node->container);
+	g_slice_free (RenaDlnaRendererNode, node);
+}
+
+static GList *
+rena_dlna_renderer_append_media (GList *list, GrlMedia *media)
+{
+	RenaMusicobject *mobj;
+	const gchar *title = NULL, *url = NULL;
+	guint seconds = 0;
+
+	url = grl_media_get_url (media);
+	title = grl_media_get_title (media);
+	seconds = grl_media_get_duration (media);
+
+	mobj = g_object_new (RENA_TYPE_MUSICOBJECT,
+	                     "file", url,
+	                     "source", FILE_HTTP,
+	                     "title", title,
+	                     "length", seconds,
+	                     NULL);
+
+	if (G_LIKELY(mobj))
+		list = g_list_prepend (list, mobj);
+
+	return list;
+}
+
+static void
+rena_dlna_renderer_walk_free (RenaDlnaRendererWalk *walk)
+{
+	g_cancellable_disconnect (walk->cancellable, walk->cancelled_id);
+	g_object_unref (walk->cancellable);
+
+	if (walk->browsing)
+		rena_dlna_renderer_node_free (walk->browsing);
+	g_queue_free_full (walk->pending, (GDestroyNotify) rena_dlna_renderer_node_free);
+	g_list_free_full (walk->batch, g_object_unref);
+	g_list_free_full (walk->sources, g_object_unref);
+	g_list_free (walk->keys);
+
+	if (walk->notify)
+		walk->notify (walk->user_data);
+
+	g_slice_free (RenaDlnaRendererWalk, walk);
+}
+
+static void
+rena_dlna_renderer_walk_finish (RenaDlnaRendererWalk *walk)
+{
+	if (walk->finished_func)
+		walk->finished_func (walk, walk->user_data);
+
+	rena_dlna_renderer_walk_free (walk);
+}
+
+static void
+rena_dlna_renderer_walk_browse_cb (GrlSource    *source,
+                                   guint         operation_id,
+                                   GrlMedia     *media,
+                                   guint         remaining,
+                                   gpointer      user_data,
+                                   const GError *error);
+
+static gboolean
+rena_dlna_renderer_walk_next (gpointer user_data)
+{
+	GrlOperationOptions *options;
+	GrlCaps *caps;
+	GrlSource *source;
+
+	RenaDlnaRendererWalk *walk = user_data;
+
+	if (walk->detached) {
+		rena_dlna_renderer_walk_free (walk);
+		return G_SOURCE_REMOVE;
+	}
+
+	if (g_cancellable_is_cancelled (walk->cancellable)) {
+		rena_dlna_renderer_walk_finish (walk);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* Source walked. Stop at the first one with music, or try the next. */
+
+	if (g_queue_is_empty (walk->pending)) {
+		if (walk->songs_added || walk->sources->next == NULL) {
+			rena_dlna_renderer_walk_finish (walk);
+			return G_SOURCE_REMOVE;
+		}
+		g_object_unref (walk->sources->data);
+		walk->sources = g_list_delete_link (walk->sources, walk->sources);
+		g_queue_push_tail (walk->pending, rena_dlna_renderer_node_new (NULL, 0));
+	}
+
+	source = GRL_SOURCE(walk->sources->data);
+
+	walk->browsing = g_queue_pop_head (walk->pending);
+	walk->page_count = 0;
+
+	caps = grl_source_get_caps (source, GRL_OP_BROWSE);
+	options = grl_operation_options_new (caps);
+	grl_operation_options_set_skip (options, walk->browsing->skip);
+	grl_operation_options_set_count (options, walk->page_size);
+
+#ifdef HAVE_GRILO3
+	grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_IDLE_RELAY);
+#endif
+#ifdef HAVE_GRILO2
+	grl_operation_options_set_flags (options, GRL_RESOLVE_IDLE_RELAY);
+#endif
+
+	walk->operation_id = grl_source_browse (source,
+	                                        walk->browsing->container,
+	                                        walk->keys,
+	                                        options,
+	                                        rena_dlna_renderer_walk_browse_cb,
+	                                        walk);
+
+	g_object_unref (options);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+rena_dlna_renderer_walk_browse_cb (GrlSource    *source,
+                                   guint         operation_id,
+                                   GrlMedia     *media,
+                                   guint         remaining,
+                                   gpointer      user_data,
+                                   const GError *error)
+{
+	RenaDlnaRendererWalk *walk = user_data;
+
+	if (error != NULL && !walk->detached &&
+	    !g_error_matches (error, GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_CANCELLED))
+		g_warning ("Failed to browse DLNA server: %s", error->message);
+
+	if (media != NULL) {
+		if (!walk->detached) {
+			walk->page_count++;
+#ifdef HAVE_GRILO3
+			if (grl_media_is_container (media)) {
+#endif
+#ifdef HAVE_GRILO2
+			if (GRL_IS_MEDIA_BOX (media)) {
+#endif
+				g_queue_push_tail (walk->pending, rena_dlna_renderer_node_new (media, 0));
+			}
+#ifdef HAVE_GRILO3
+			else if (grl_media_is_audio (media)) {
+#endif
+#ifdef HAVE_GRILO2
+			else if (GRL_IS_MEDIA_AUDIO (media)) {
+#endif
+				walk->batch = rena_dlna_renderer_append_media (walk->batch, media);
+			}
+		}
+		g_object_unref (media);
+	}
+
+	if (remaining > 0)
+		return;
+
+	/* Page complete. Hand over the partial results. */
+
+	walk->operation_id = 0;
+
+	if (walk->batch && !walk->detached) {
+		walk->songs_added += g_list_length (walk->batch);
+		walk->page_func (g_list_reverse (walk->batch), walk->user_data);
+		walk->batch = NULL;
+	}
+
+	/* A full page means the container may have more children. */
+
+	if (error == NULL && walk->page_count >= walk->page_size)
+		g_queue_push_head (walk->pending,
+			rena_dlna_renderer_node_new (walk->browsing->container,
+			                             walk->browsing->skip + walk->page_size));
+
+	rena_dlna_renderer_node_free (walk->browsing);
+	walk->browsing = NULL;
+
+	g_idle_add (rena_dlna_renderer_walk_next, walk);
+}
+
+static void
+rena_dlna_renderer_walk_cancelled (GCancellable *cancellable, gpointer user_data)
+{
+	RenaDlnaRendererWalk *walk = user_data;
+
+	if (walk->operation_id)
+		grl_operation_cancel (walk->operation_id);
+}
+
+/*
+ * Public api.
+ */
+
+RenaDlnaRendererWalk *
+rena_dlna_renderer_walk_new (GList                            *sources,
+                             guint                             page_size,
+                             GCancellable                     *cancellable,
+                             RenaDlnaRendererWalkPageFunc      page_func,
+                             RenaDlnaRendererWalkFinishedFunc  finished_func,
+                             gpointer                          user_data)
+{
+	RenaDlnaRendererWalk *walk;
+
+	walk = g_slice_new0 (RenaDlnaRendererWalk);
+
+	walk->sources = g_list_copy_deep (sources, (GCopyFunc) g_object_ref, NULL);
+	walk->keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+	                                        GRL_METADATA_KEY_DURATION,
+	                                        GRL_METADATA_KEY_URL,
+	                                        GRL_METADATA_KEY_CHILDCOUNT,
+	                                        GRL_METADATA_KEY_INVALID);
+	walk->page_size = page_size;
+
+	walk->pending = g_queue_new ();
+	g_queue_push_tail (walk->pending, rena_dlna_renderer_node_new (NULL, 0));
+
+	walk->cancellable = g_object_ref (cancellable);
+	walk->cancelled_id = g_cancellable_connect (cancellable,
+	                                            G_CALLBACK (rena_dlna_renderer_walk_cancelled),
+	                                            walk, NULL);
+
+	walk->page_func = page_func;
+	walk->finished_func = finished_func;
+	walk->user_data = user_data;
+
+	return walk;
+}
+
+void
+rena_dlna_renderer_walk_start (RenaDlnaRendererWalk *walk)
+{
+	g_idle_add (rena_dlna_renderer_walk_next, walk);
+}
+
+/*
+ * Leaves the walk behind. Nothing is handed over anymore, and the walk is
+ * freed, calling notify with the user data, once grilo ends the operation
+ * in flight.
+ */
+void
+rena_dlna_renderer_walk_detach (RenaDlnaRendererWalk *walk,
+                                GDestroyNotify        notify)
+{
+	CDEBUG(DBG_PLUGIN, "DLNA Renderer walk detached");
+
+	walk->detached = TRUE;
+	walk->page_func = NULL;
+	walk->finished_func = NULL;
+	walk->notify = notify;
+
+	/* Otherwise the next step is already queued and frees the walk. */
+	if (walk->operation_id)
+		grl_operation_cancel (walk->operation_id);
+}
+
+gint
+rena_dlna_renderer_walk_get_songs_added (RenaDlnaRendererWalk *walk)
+{
+	return walk->songs_added;
+}
+
+const gchar *
+rena_dlna_renderer_walk_get_source_name (RenaDlnaRendererWalk *walk)
+{
+	return grl_source_get_name (GRL_SOURCE(walk->sources->data));
+}
+
+gboolean
+rena_dlna_renderer_walk_is_cancelled (RenaDlnaRendererWalk *walk)
+{
+	return g_cancellable_is_cancelled (walk->cancellable);
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#ifndef __RENA_DLNA_RENDERER_WALK_H__
+#define __RENA_DLNA_RENDERER_WALK_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <grilo.h>
+
+G_BEGIN_DECLS
+
+typedef struct _RenaDlnaRendererWalk RenaDlnaRendererWalk;
+
+/* Takes the list of musicobjects of one page. */
+typedef void (*RenaDlnaRendererWalkPageFunc)     (GList *list, gpointer user_data);
+/* Called once, when the walk ends or is cancelled. The walk is freed after. */
+typedef void (*RenaDlnaRendererWalkFinishedFunc) (RenaDlnaRendererWalk *walk, gpointer user_data);
+
+RenaDlnaRendererWalk *
+rena_dlna_renderer_walk_new              (GList                            *sources,
+                                          guint                             page_size,
+                                          GCancellable                     *cancellable,
+                                          RenaDlnaRendererWalkPageFunc      page_func,
+                                          RenaDlnaRendererWalkFinishedFunc  finished_func,
+                                          gpointer                          user_data);
+
+void
+rena_dlna_renderer_walk_start            (RenaDlnaRendererWalk *walk);
+
+void
+rena_dlna_renderer_walk_detach           (RenaDlnaRendererWalk *walk,
+                                          GDestroyNotify        notify);
+
+gint
+rena_dlna_renderer_walk_get_songs_added  (RenaDlnaRendererWalk *walk);
+
+const gchar *
+rena_dlna_renderer_walk_get_source_name  (RenaDlnaRendererWalk *walk);
+
+gboolean
+rena_dlna_renderer_walk_is_cancelled     (RenaDlnaRendererWalk *walk);
+
+G_END_DECLS
+
+#endif /* __RENA_DLNA_RENDERER_WALK_H__ */
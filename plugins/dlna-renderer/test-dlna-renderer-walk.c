@@ -0,0 +1,446 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+/*
+ * Paged walk of a local grilo source that stands in for a DLNA server.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <grilo.h>
+
+#include "src/rena-debug.h"
+
+#include "rena-dlna-renderer-walk.h"
+
+/*
+ * Fake source. Serves a small tree, one child per main loop iteration.
+ */
+
+typedef struct {
+	const gchar *id;
+	const gchar *parent;
+	gboolean     container;
+} FakeItem;
+
+static const FakeItem fake_items[] = {
+	{ "A",  NULL, TRUE  },
+	{ "B",  NULL, TRUE  },
+	{ "a1", "A",  FALSE },
+	{ "a2", "A",  FALSE },
+	{ "a3", "A",  FALSE },
+	{ "a4", "A",  FALSE },
+	{ "a5", "A",  FALSE },
+	{ "b1", "B",  FALSE },
+	{ "C",  "B",  TRUE  },
+	{ "b2", "B",  FALSE },
+	{ "b3", "B",  FALSE },
+	{ "c1", "C",  FALSE },
+	{ "c2", "C",  FALSE },
+	{ "c3", "C",  FALSE },
+	{ "c4", "C",  FALSE },
+};
+
+#define FAKE_N_SONGS 12
+
+typedef struct _FakeSource      FakeSource;
+typedef struct _FakeSourceClass FakeSourceClass;
+
+typedef void (*FakeServeFunc) (FakeSource *source, gpointer user_data);
+
+struct _FakeSource {
+	GrlSource      parent;
+
+	guint          browses;
+	guint          max_count;
+	gboolean       sync_cancel;
+	GList         *running;
+
+	FakeServeFunc  serve_func;
+	gpointer       serve_data;
+};
+
+struct _FakeSourceClass {
+	GrlSourceClass parent;
+};
+
+GType fake_source_get_type (void);
+
+G_DEFINE_TYPE (FakeSource, fake_source, GRL_TYPE_SOURCE)
+
+typedef struct {
+	FakeSource          *source;
+	GrlSourceBrowseSpec *bs;
+	GList               *medias;
+	gboolean             cancelled;
+	gboolean             done;
+} FakeBrowse;
+
+static GrlMedia *
+fake_item_media (const FakeItem *item)
+{
+	GrlMedia *media;
+	gchar *url;
+
+#ifdef HAVE_GRILO3
+	media = item->container ? grl_media_container_new () : grl_media_audio_new ();
+#endif
+#ifdef HAVE_GRILO2
+	media = item->container ? grl_media_box_new () : grl_media_audio_new ();
+#endif
+	grl_media_set_id (media, item->id);
+	grl_media_set_title (media, item->id);
+	if (!item->container) {
+		url = g_strdup_printf ("http://127.0.0.1/%s.mp3", item->id);
+		grl_media_set_url (media, url);
+		grl_media_set_duration (media, 180);
+		g_free (url);
+	}
+
+	return media;
+}
+
+static void
+fake_browse_free (FakeBrowse *browse)
+{
+	browse->source->running = g_list_remove (browse->source->running, browse);
+	g_list_free_full (browse->medias, g_object_unref);
+	g_slice_free (FakeBrowse, browse);
+}
+
+static void
+fake_browse_cancelled (FakeBrowse *browse)
+{
+	GError *error;
+
+	error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_CANCELLED, "Cancelled");
+	browse->bs->callback (GRL_SOURCE(browse->source), browse->bs->operation_id,
+	                      NULL, 0, browse->bs->user_data, error);
+	g_error_free (error);
+
+	browse->done = TRUE;
+}
+
+static gboolean
+fake_browse_serve (gpointer data)
+{
+	FakeBrowse *browse = data;
+	GrlMedia *media;
+
+	if (browse->done) {
+		fake_browse_free (browse);
+		return G_SOURCE_REMOVE;
+	}
+
+	if (browse->source->serve_func)
+		browse->source->serve_func (browse->source, browse->source->serve_data);
+
+	if (browse->done) {
+		fake_browse_free (browse);
+		return G_SOURCE_REMOVE;
+	}
+
+	if (browse->cancelled) {
+		fake_browse_cancelled (browse);
+		fake_browse_free (browse);
+		return G_SOURCE_REMOVE;
+	}
+
+	if (browse->medias == NULL) {
+		browse->bs->callback (GRL_SOURCE(browse->source), browse->bs->operation_id,
+		                      NULL, 0, browse->bs->user_data, NULL);
+		fake_browse_free (browse);
+		return G_SOURCE_REMOVE;
+	}
+
+	media = browse->medias->data;
+	browse->medias = g_list_delete_link (browse->medias, browse->medias);
+
+	browse->bs->callback (GRL_SOURCE(browse->source), browse->bs->operation_id,
+	                      media, g_list_length (browse->medias), browse->bs->user_data, NULL);
+
+	if (browse->medias == NULL) {
+		fake_browse_free (browse);
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+fake_source_browse (GrlSource *grl_source, GrlSourceBrowseSpec *bs)
+{
+	FakeSource *source = (FakeSource *) grl_source;
+	FakeBrowse *browse;
+	const gchar *parent = NULL;
+	gint skip, count, i, n = 0;
+
+	source->browses++;
+
+	if (bs->container != NULL)
+		parent = grl_media_get_id (bs->container);
+
+	skip = grl_operation_options_get_skip (bs->options);
+	count = grl_operation_options_get_count (bs->options);
+	source->max_count = MAX (source->max_count, (guint) count);
+
+	browse = g_slice_new0 (FakeBrowse);
+	browse->source = source;
+	browse->bs = bs;
+
+	for (i = 0; i < (gint) G_N_ELEMENTS (fake_items); i++) {
+		if (g_strcmp0 (fake_items[i].parent, parent) != 0)
+			continue;
+		if (n++ < skip)
+			continue;
+		if (count > 0 && (gint) g_list_length (browse->medias) >= count)
+			break;
+		browse->medias = g_list_append (browse->medias, fake_item_media (&fake_items[i]));
+	}
+
+	source->running = g_list_prepend (source->running, browse);
+
+	g_idle_add (fake_browse_serve, browse);
+}
+
+static void
+fake_source_cancel (GrlSource *grl_source, guint operation_id)
+{
+	FakeSource *source = (FakeSource *) grl_source;
+	FakeBrowse *browse;
+	GList *l;
+
+	for (l = source->running; l != NULL; l = l->next) {
+		browse = l->data;
+		if (browse->bs->operation_id != operation_id || browse->done)
+			continue;
+
+		/* Some sources answer from within grl_operation_cancel(). */
+		if (source->sync_cancel)
+			fake_browse_cancelled (browse);
+		else
+			browse->cancelled = TRUE;
+	}
+}
+
+static void
+fake_source_class_init (FakeSourceClass *klass)
+{
+	GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+	source_class->browse = fake_source_browse;
+	source_class->cancel = fake_source_cancel;
+}
+
+static void
+fake_source_init (FakeSource *source)
+{
+}
+
+static FakeSource *
+fake_source_new (void)
+{
+	return g_object_new (fake_source_get_type (),
+	                     "source-id", "rena-fake-dlna",
+	                     "source-name", "Fake DLNA",
+	                     NULL);
+}
+
+/*
+ * Fixture.
+ */
+
+typedef struct {
+	FakeSource           *source;
+	GCancellable         *cancellable;
+	GMainLoop            *loop;
+	RenaDlnaRendererWalk *walk;
+
+	guint                 pages;
+	guint                 songs;
+	guint                 finished;
+	guint                 freed;
+	gboolean              cancelled;
+	guint                 act_at_browse;
+} Fixture;
+
+static void
+fixture_setup (Fixture *fixture, gconstpointer data)
+{
+	fixture->source = fake_source_new ();
+	fixture->cancellable = g_cancellable_new ();
+	fixture->loop = g_main_loop_new (NULL, FALSE);
+}
+
+static void
+fixture_teardown (Fixture *fixture, gconstpointer data)
+{
+	/* Let the fake source release its pending browses. */
+	while (g_main_context_iteration (NULL, FALSE));
+
+	g_assert_null (fixture->source->running);
+
+	g_main_loop_unref (fixture->loop);
+	g_object_unref (fixture->cancellable);
+	g_object_unref (fixture->source);
+}
+
+static void
+fixture_page (GList *list, gpointer user_data)
+{
+	Fixture *fixture = user_data;
+
+	fixture->pages++;
+	fixture->songs += g_list_length (list);
+	g_list_free_full (list, g_object_unref);
+}
+
+static void
+fixture_finished (RenaDlnaRendererWalk *walk, gpointer user_data)
+{
+	Fixture *fixture = user_data;
+
+	fixture->finished++;
+	fixture->cancelled = rena_dlna_renderer_walk_is_cancelled (walk);
+	g_assert_cmpint (rena_dlna_renderer_walk_get_songs_added (walk), ==, fixture->songs);
+	g_assert_cmpstr (rena_dlna_renderer_walk_get_source_name (walk), ==, "Fake DLNA");
+
+	g_main_loop_quit (fixture->loop);
+}
+
+static void
+fixture_freed (gpointer data)
+{
+	Fixture *fixture = data;
+
+	fixture->freed++;
+	g_main_loop_quit (fixture->loop);
+}
+
+static void
+fixture_start (Fixture *fixture, guint page_size)
+{
+	GList *sources;
+
+	sources = g_list_append (NULL, fixture->source);
+	fixture->walk = rena_dlna_renderer_walk_new (sources, page_size, fixture->cancellable,
+	                                             fixture_page, fixture_finished, fixture);
+	g_list_free (sources);
+
+	rena_dlna_renderer_walk_start (fixture->walk);
+}
+
+/* Called while a browse is serving children, so an operation is running. */
+
+static void
+fixture_cancel_serving (FakeSource *source, gpointer user_data)
+{
+	Fixture *fixture = user_data;
+
+	if (source->browses == fixture->act_at_browse && !g_cancellable_is_cancelled (fixture->cancellable))
+		g_cancellable_cancel (fixture->cancellable);
+}
+
+static void
+fixture_detach_serving (FakeSource *source, gpointer user_data)
+{
+	Fixture *fixture = user_data;
+
+	if (source->browses == fixture->act_at_browse && fixture->walk != NULL) {
+		rena_dlna_renderer_walk_detach (fixture->walk, fixture_freed);
+		fixture->walk = NULL;
+	}
+}
+
+/*
+ * Tests.
+ */
+
+static void
+test_walk_pages (Fixture *fixture, gconstpointer data)
+{
+	fixture_start (fixture, 2);
+	g_main_loop_run (fixture->loop);
+
+	g_assert_cmpuint (fixture->finished, ==, 1);
+	g_assert_false (fixture->cancelled);
+	g_assert_cmpuint (fixture->songs, ==, FAKE_N_SONGS);
+	g_assert_cmpuint (fixture->source->max_count, ==, 2);
+	g_assert_cmpuint (fixture->pages, >=, FAKE_N_SONGS / 2);
+}
+
+static void
+test_walk_cancel (Fixture *fixture, gconstpointer data)
+{
+	fixture->act_at_browse = 3;
+	fixture->source->serve_func = fixture_cancel_serving;
+	fixture->source->serve_data = fixture;
+
+	fixture_start (fixture, 2);
+	g_main_loop_run (fixture->loop);
+
+	g_assert_cmpuint (fixture->finished, ==, 1);
+	g_assert_true (fixture->cancelled);
+	g_assert_cmpuint (fixture->songs, <, FAKE_N_SONGS);
+}
+
+static void
+test_walk_detach (Fixture *fixture, gconstpointer data)
+{
+	fixture->source->sync_cancel = GPOINTER_TO_INT (data);
+	fixture->act_at_browse = 3;
+	fixture->source->serve_func = fixture_detach_serving;
+	fixture->source->serve_data = fixture;
+
+	fixture_start (fixture, 2);
+
+	/* Quits once the detached walk frees itself. */
+	g_main_loop_run (fixture->loop);
+
+	g_assert_null (fixture->walk);
+	g_assert_cmpuint (fixture->freed, ==, 1);
+	g_assert_cmpuint (fixture->finished, ==, 0);
+	g_assert_cmpuint (fixture->songs, <, FAKE_N_SONGS);
+
+	/* Nothing else arrives for the detached walk. */
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (fixture->freed, ==, 1);
+	g_assert_cmpuint (fixture->finished, ==, 0);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+	debug_level = 0;
+
+	g_test_init (&argc, &argv, NULL);
+	grl_init (&argc, &argv);
+
+	g_test_add ("/dlna-renderer/walk/pages", Fixture, NULL,
+	            fixture_setup, test_walk_pages, fixture_teardown);
+	g_test_add ("/dlna-renderer/walk/cancel", Fixture, NULL,
+	            fixture_setup, test_walk_cancel, fixture_teardown);
+	g_test_add ("/dlna-renderer/walk/detach", Fixture, GINT_TO_POINTER (FALSE),
+	            fixture_setup, test_walk_detach, fixture_teardown);
+	g_test_add ("/dlna-renderer/walk/detach-sync-cancel", Fixture, GINT_TO_POINTER (TRUE),
+	            fixture_setup, test_walk_detach, fixture_teardown);
+
+	return g_test_run ();
+}
@@ -56,36 +56,43 @@ struct _RenaDlnaPluginPrivate {
 
     RygelMediaServer     *server;
     RygelSimpleContainer *container;
+
+    GHashTable           *items;
+    GPtrArray            *order;
+    guint                 next_id;
 };
 
 RENA_PLUGIN_REGISTER (RENA_TYPE_DLNA_PLUGIN,
                         RenaDlnaPlugin,
                         rena_dlna_plugin)
 
-static void
-rena_dlna_plugin_append_track (RenaDlnaPlugin  *plugin,
-                                 RenaMusicobject *mobj,
-                                 gint               id)
+/* Item ids are never reused, so clients can keep their references while
+ * the shared playlist changes. */
+
+static RygelMusicItem *
+rena_dlna_plugin_append_item (RenaDlnaPlugin *plugin,
+                                const gchar      *file,
+                                const gchar      *title,
+                                const gchar      *artist,
+                                const gchar      *album,
+                                gint              track_no,
+                                gint              length)
 {
 	RygelMusicItem *item = NULL;
 	gchar *uri = NULL, *u_title = NULL, *item_id = NULL, *content_type = NULL;
-	const gchar *file = NULL, *title = NULL;
 	gboolean uncertain;
 
 	RenaDlnaPluginPrivate *priv = plugin->priv;
 
-	title = rena_musicobject_get_title (mobj);
-	u_title = string_is_not_empty(title) ? g_strdup(title) : get_display_name (mobj);
+	u_title = string_is_not_empty(title) ? g_strdup(title) : get_display_filename (file, FALSE);
 
-	item_id = g_strdup_printf ("%06d", id);
+	item_id = g_strdup_printf ("%06u", priv->next_id++);
 	item = rygel_music_item_new (item_id,
 	                             RYGEL_MEDIA_CONTAINER(priv->container),
 	                             u_title,
 	                             RYGEL_MUSIC_ITEM_UPNP_CLASS);
 
 	if (item != NULL) {
-		file = rena_musicobject_get_file (mobj);
-
 		uri = g_filename_to_uri (file, NULL, NULL);
 		rygel_media_object_add_uri (RYGEL_MEDIA_OBJECT (item), uri);
 		g_free (uri);
@@ -94,20 +101,43 @@ rena_dlna_plugin_append_track (RenaDlnaPlugin  *plugin,
 		rygel_media_file_item_set_mime_type (RYGEL_MEDIA_FILE_ITEM (item), content_type);
 		g_free(content_type);
 
-		rygel_music_item_set_track_number (item, rena_musicobject_get_track_no(mobj));
+		rygel_music_item_set_track_number (item, track_no);
 
-		rygel_audio_item_set_album (RYGEL_AUDIO_ITEM(item), rena_musicobject_get_album(mobj));
-		rygel_audio_item_set_duration (RYGEL_AUDIO_ITEM(item), (glong)rena_musicobject_get_length(mobj));
+		rygel_audio_item_set_album (RYGEL_AUDIO_ITEM(item), album);
+		rygel_audio_item_set_duration (RYGEL_AUDIO_ITEM(item), (glong)length);
 
-		rygel_media_object_set_artist (RYGEL_MEDIA_OBJECT(item), rena_musicobject_get_artist(mobj));
+		rygel_media_object_set_artist (RYGEL_MEDIA_OBJECT(item), artist);
 
 		rygel_simple_container_add_child_item (priv->container, RYGEL_MEDIA_ITEM(item));
-
-		g_object_unref (item);
 	}
 
 	g_free(u_title);
 	g_free(item_id);
+
+	return item;
+}
+
+static RygelMusicItem *
+rena_dlna_plugin_append_track (RenaDlnaPlugin  *plugin,
+                                 RenaMusicobject *mobj)
+{
+	return rena_dlna_plugin_append_item (plugin,
+	                                       rena_musicobject_get_file (mobj),
+	                                       rena_musicobject_get_title (mobj),
+	                                       rena_musicobject_get_artist (mobj),
+	                                       rena_musicobject_get_album (mobj),
+	                                       rena_musicobject_get_track_no (mobj),
+	                                       rena_musicobject_get_length (mobj));
+}
+
+static void
+rena_dlna_plugin_clear (RenaDlnaPlugin *plugin)
+{
+	RenaDlnaPluginPrivate *priv = plugin->priv;
+
+	g_hash_table_remove_all (priv->items);
+	g_ptr_array_set_size (priv->order, 0);
+	rygel_simple_container_clear (priv->container);
 }
 
 static void
@@ -115,8 +145,8 @@ rena_dlna_plugin_share_library (RenaDlnaPlugin *plugin)
 {
 	RenaDatabase *cdbase;
 	RenaPreparedStatement *statement;
-	RenaMusicobject *mobj;
-	gint i = 0;
+	RygelMusicItem *item;
+	guint i = 0;
 
 	const gchar *sql = NULL;
 
@@ -126,23 +156,33 @@ rena_dlna_plugin_share_library (RenaDlnaPlugin *plugin)
 
 	set_watch_cursor (rena_application_get_window(priv->rena));
 
-	sql = "SELECT location FROM TRACK "
-	      "INNER JOIN provider ON track.provider = provider.id "
-	      "INNER JOIN provider_type ON provider.type = provider_type.id "
-	      "WHERE provider_type.name  = ?";
+	sql = "SELECT LOCATION.name, TRACK.title, ARTIST.name, ALBUM.name, TRACK.track_no, TRACK.length "
+	      "FROM TRACK "
+	      "INNER JOIN LOCATION ON TRACK.location = LOCATION.id "
+	      "INNER JOIN ARTIST ON TRACK.artist = ARTIST.id "
+	      "INNER JOIN ALBUM ON TRACK.album = ALBUM.id "
+	      "INNER JOIN PROVIDER ON TRACK.provider = PROVIDER.id "
+	      "INNER JOIN PROVIDER_TYPE ON PROVIDER.type = PROVIDER_TYPE.id "
+	      "WHERE PROVIDER_TYPE.name = ?";
 
 	cdbase = rena_application_get_database (priv->rena);
 	statement = rena_database_create_statement (cdbase, sql);
 	rena_prepared_statement_bind_string (statement, 1, "local");
 
 	while (rena_prepared_statement_step (statement)) {
-		mobj = new_musicobject_from_db (cdbase,
-			rena_prepared_statement_get_int (statement, 0));
-		if (G_LIKELY(mobj)) {
-			rena_dlna_plugin_append_track (plugin, mobj, i++);
-			g_object_unref (mobj);
-		}
-		rena_process_gtk_events ();
+		item = rena_dlna_plugin_append_item (plugin,
+			rena_prepared_statement_get_string (statement, 0),
+			rena_prepared_statement_get_string (statement, 1),
+			rena_prepared_statement_get_string (statement, 2),
+			rena_prepared_statement_get_string (statement, 3),
+			rena_prepared_statement_get_int (statement, 4),
+			rena_prepared_statement_get_int (statement, 5));
+		if (G_LIKELY(item))
+			g_object_unref (item);
+
+		/* Have to give control to GTK periodically ... */
+		if ((++i % 128) == 0)
+			rena_process_gtk_events ();
 	}
 	rena_prepared_statement_free (statement);
 
@@ -158,51 +198,129 @@ rena_dlna_plugin_database_changed (RenaDatabaseProvider *provider,
 	if (TRUE)
 		return;
 
-	rygel_simple_container_clear (priv->container);
+	rena_dlna_plugin_clear (plugin);
 	rena_dlna_plugin_share_library (plugin);
 }
 
+/* Share the playlist applying only the differences with the published items.
+ * The items are mapped by the musicobject of each playlist row, so adding a
+ * song publishes one item and removing it withdraws just that one. When the
+ * order differs, the items from the first misplaced row onward are withdrawn
+ * and added again, keeping their ids. */
+
+typedef struct {
+	RenaDlnaPlugin *plugin;
+	GHashTable     *current;
+} RenaDlnaPluginDelta;
+
+static gboolean
+rena_dlna_plugin_remove_stale_item (gpointer key,
+                                      gpointer value,
+                                      gpointer user_data)
+{
+	RenaDlnaPluginDelta *delta = user_data;
+
+	if (g_hash_table_contains (delta->current, key))
+		return FALSE;
+
+	rygel_simple_container_remove_child (delta->plugin->priv->container,
+	                                     RYGEL_MEDIA_OBJECT(value));
+
+	return TRUE;
+}
+
 static void
 rena_dlna_plugin_share_playlist (RenaDlnaPlugin *plugin)
 {
 	RenaPlaylist *playlist;
+	RenaDlnaPluginDelta delta;
+	GHashTable *current;
 	GList *list = NULL, *i;
 	RenaMusicobject *mobj;
-	gint id = 0;
+	RygelMusicItem *item;
+	guint added = 0, removed = 0, moved = 0, j;
 
 	RenaDlnaPluginPrivate *priv = plugin->priv;
 
 	playlist = rena_application_get_playlist (priv->rena);
 
-	set_watch_cursor (rena_application_get_window(priv->rena));
+	list = g_list_reverse (rena_playlist_get_mobj_list (playlist));
 
-	list = rena_playlist_get_mobj_list (playlist);
+	current = g_hash_table_new (g_direct_hash, g_direct_equal);
 	for (i = list; i != NULL; i = i->next) {
 		mobj = i->data;
+		if (mobj != NULL && rena_musicobject_is_local_file(mobj))
+			g_hash_table_add (current, mobj);
+	}
+
+	/* Withdraw the items of removed rows. */
 
-		if (mobj == NULL)
+	for (j = 0; j < priv->order->len;) {
+		if (g_hash_table_contains (current, g_ptr_array_index (priv->order, j)))
+			j++;
+		else
+			g_ptr_array_remove_index (priv->order, j);
+	}
+
+	delta.plugin = plugin;
+	delta.current = current;
+	removed = g_hash_table_foreach_remove (priv->items,
+	                                       rena_dlna_plugin_remove_stale_item,
+	                                       &delta);
+
+	/* Skip the items that are already in place. */
+
+	for (i = list, j = 0; i != NULL; i = i->next) {
+		mobj = i->data;
+
+		if (!g_hash_table_contains (current, mobj))
 			continue;
+		if (j == priv->order->len || g_ptr_array_index (priv->order, j) != mobj)
+			break;
+		j++;
+	}
 
-		if (rena_musicobject_is_local_file(mobj))
-			rena_dlna_plugin_append_track (plugin, mobj, id++);
+	/* Withdraw the rest of the published items. */
 
-		rena_process_gtk_events ();
+	for (moved = priv->order->len - j; j < priv->order->len; j++) {
+		item = g_hash_table_lookup (priv->items, g_ptr_array_index (priv->order, j));
+		rygel_simple_container_remove_child (priv->container, RYGEL_MEDIA_OBJECT(item));
 	}
-	g_list_free(list);
+	g_ptr_array_set_size (priv->order, priv->order->len - moved);
 
-	remove_watch_cursor (rena_application_get_window(priv->rena));
+	/* And publish them again in order, with the new rows. */
+
+	for (; i != NULL; i = i->next) {
+		mobj = i->data;
+
+		if (!g_hash_table_contains (current, mobj))
+			continue;
+
+		item = g_hash_table_lookup (priv->items, mobj);
+		if (item != NULL) {
+			rygel_simple_container_add_child_item (priv->container, RYGEL_MEDIA_ITEM(item));
+		}
+		else {
+			item = rena_dlna_plugin_append_track (plugin, mobj);
+			if (G_UNLIKELY(item == NULL))
+				continue;
+			g_hash_table_insert (priv->items, g_object_ref (mobj), item);
+			added++;
+		}
+		g_ptr_array_add (priv->order, mobj);
+	}
+
+	CDEBUG(DBG_PLUGIN, "DLNA plugin shared playlist: %u added, %u removed, %u moved",
+	       added, removed, moved);
+
+	g_hash_table_destroy (current);
+	g_list_free(list);
 }
 
 static void
 rena_dlna_plugin_playlist_changed (RenaPlaylist   *playlist,
                                      RenaDlnaPlugin *plugin)
 {
-	RenaDlnaPluginPrivate *priv = plugin->priv;
-
-	if (FALSE)
-		return;
-
-	rygel_simple_container_clear (priv->container);
 	rena_dlna_plugin_share_playlist (plugin);
 }
 
@@ -234,6 +352,11 @@ rena_plugin_activate (PeasActivatable *activatable)
 
 	priv->container = rygel_simple_container_new_root (_("Local Music"));
 
+	priv->items = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                                     g_object_unref, g_object_unref);
+	priv->order = g_ptr_array_new ();
+	priv->next_id = 0;
+
 	/* Put initial music on container */
 
 	if (FALSE)
@@ -292,7 +415,9 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 	                                      rena_dlna_plugin_playlist_changed,
 	                                      plugin);
 	                                      
-	rygel_simple_container_clear (priv->container);
+	rena_dlna_plugin_clear (plugin);
+	g_hash_table_destroy (priv->items);
+	g_ptr_array_free (priv->order, TRUE);
 
 	g_object_unref (priv->container);
 	g_object_unref (priv->server);
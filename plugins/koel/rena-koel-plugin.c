@@ -211,9 +211,11 @@ rena_koel_save_cache (RenaKoelPlugin *plugin)
 	RenaKoelPluginPrivate *priv = plugin->priv;
 
 	database = rena_database_get ();
+	rena_database_begin_transaction (database);
 	g_hash_table_foreach (priv->tracks_table,
 	                      rena_koel_plugin_add_track_db,
 	                      database);
+	rena_database_commit_transaction (database);
 	g_object_unref (database);
 }
 
@@ -342,53 +344,59 @@ rena_koel_plugin_set_password (RenaPreferences *preferences, const gchar *pass)
  * Koel plugin.
  */
 
-static const gchar *
-rena_koel_plugin_json_array_get_name (JsonArray *jarray,
-                                        gint64     jid)
+/* Index the objects of an array by its "id" member. The objects are owned by
+ * the array so the table must not outlive it. */
+
+static GHashTable *
+rena_koel_plugin_json_array_index (JsonArray *jarray)
 {
+	GHashTable *table;
 	JsonObject *json_object;
-	gint64 object_id = 0;
-	const gchar *object_name = NULL;
-	GList *l_node = NULL;
-	GList *l_nodes = json_array_get_elements (jarray);
-	for (l_node = l_nodes; l_node != NULL; l_node = g_list_next(l_node))
+	gint64 *object_id;
+	guint i, length;
+
+	table = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+	if (jarray == NULL)
+		return table;
+
+	length = json_array_get_length (jarray);
+	for (i = 0; i < length; i++)
 	{
-		json_object = json_node_get_object ((JsonNode *)l_node->data);
-		object_id = json_object_get_int_member(json_object, "id");
-		if (jid == object_id)
-		{
-			object_name = json_object_get_string_member(json_object, "name");
-			break;
-		}
+		json_object = json_array_get_object_element (jarray, i);
+		if (json_object == NULL || !json_object_has_member (json_object, "id"))
+			continue;
+
+		object_id = g_new (gint64, 1);
+		*object_id = json_object_get_int_member (json_object, "id");
+		g_hash_table_replace (table, object_id, json_object);
 	}
-	g_list_free(l_nodes);
 
-	return object_name;
+	return table;
+}
+
+static const gchar *
+rena_koel_plugin_json_index_get_name (GHashTable *index,
+                                        gint64      jid)
+{
+	JsonObject *json_object = g_hash_table_lookup (index, &jid);
+
+	if (json_object == NULL)
+		return NULL;
+
+	return json_object_get_string_member (json_object, "name");
 }
 
 static gint64
-rena_koel_plugin_json_array_get_int_member (JsonArray   *jarray,
+rena_koel_plugin_json_index_get_int_member (GHashTable  *index,
                                               gint64       jid,
                                               const gchar *tag)
 {
-	JsonObject *json_object;
-	gint64 object_id = 0, integer_tag = 0;
-	GList *l_node = NULL;
-	GList *l_nodes = json_array_get_elements (jarray);
-	for (l_node = l_nodes; l_node != NULL; l_node = g_list_next(l_node))
-	{
-		json_object = json_node_get_object ((JsonNode *)l_node->data);
-		object_id = json_object_get_int_member(json_object, "id");
-		if (jid == object_id)
-		{
-			if (json_object_has_member(json_object, tag))
-				integer_tag = json_object_get_int_member(json_object, tag);
-			break;
-		}
-	}
-	g_list_free(l_nodes);
+	JsonObject *json_object = g_hash_table_lookup (index, &jid);
+
+	if (json_object == NULL || !json_object_has_member (json_object, tag))
+		return 0;
 
-	return integer_tag;
+	return json_object_get_int_member (json_object, tag);
 }
 
 static void
@@ -403,10 +411,12 @@ rena_koel_plugin_cache_provider_done (SoupSession *session,
 	GNotification *notification;
 	GIcon *icon;
 	JsonParser *parser = NULL;
-	JsonNode *root, *albums_node, *artists_node, *songs_node, *interactions_node;
+	JsonNode *root;
 	JsonObject *root_object;
-	JsonArray *albums_array, *artists_array, *songs_array, *interactions_array;
-	GList *l_songs, *l_song, *liked = NULL;
+	JsonArray *songs_array, *interactions_array;
+	GHashTable *albums_index, *artists_index;
+	GList *liked = NULL;
+	guint i, length;
 
 	RenaKoelPlugin *plugin = user_data;
 	RenaKoelPluginPrivate *priv = plugin->priv;
@@ -427,35 +437,45 @@ rena_koel_plugin_cache_provider_done (SoupSession *session,
 		return;
 	}
 
+	RENA_PROFILE_BEGIN(span);
+
 	parser = json_parser_new ();
-	json_parser_load_from_data (parser, msg->response_body->data, -1, NULL);
+	json_parser_load_from_data (parser, msg->response_body->data, msg->response_body->length, NULL);
+
+	/* The text is no longer needed once parsed. */
+	soup_message_body_truncate (msg->response_body);
+
 	root = json_parser_get_root (parser);
+	if (root == NULL || !JSON_NODE_HOLDS_OBJECT (root)) {
+		taskbar = rena_background_task_bar_get ();
+		rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(priv->task_widget));
+		g_object_unref(G_OBJECT(taskbar));
+		g_critical("KOEL ERROR: Invalid response from server");
+		g_object_unref(parser);
+		return;
+	}
 	root_object = json_node_get_object (root);
 
-	albums_node = json_object_get_member(root_object, "albums");
-	albums_array = json_node_get_array (albums_node);
-
-	artists_node = json_object_get_member(root_object, "artists");
-	artists_array = json_node_get_array (artists_node);
+	albums_index = rena_koel_plugin_json_array_index (json_object_get_array_member (root_object, "albums"));
+	artists_index = rena_koel_plugin_json_array_index (json_object_get_array_member (root_object, "artists"));
 
-	songs_node = json_object_get_member(root_object, "songs");
-	songs_array = json_node_get_array (songs_node);
+	songs_array = json_object_get_array_member (root_object, "songs");
+	length = songs_array ? json_array_get_length (songs_array) : 0;
 
-	l_songs = json_array_get_elements (songs_array);
-	for (l_song = l_songs; l_song != NULL; l_song = g_list_next(l_song))
+	for (i = 0; i < length; i++)
 	{
-		JsonObject *song_object = json_node_get_object ((JsonNode *)l_song->data);
+		JsonObject *song_object = json_array_get_object_element (songs_array, i);
 
 		const gchar *song_id = json_object_get_string_member(song_object, "id");
 		const gchar *title = json_object_get_string_member(song_object, "title");
 		gint64 album_id = json_object_get_int_member(song_object, "album_id");
 		gint64 artist_id = json_object_get_int_member(song_object, "artist_id");
 		gint64 track = json_object_get_int_member(song_object, "track");
-		gint64 length = json_object_get_double_member(song_object, "length");
+		gint64 song_length = json_object_get_double_member(song_object, "length");
 
-		const gchar *artist = rena_koel_plugin_json_array_get_name (artists_array, artist_id);
-		const gchar *album = rena_koel_plugin_json_array_get_name (albums_array, album_id);
-		guint64 album_year = rena_koel_plugin_json_array_get_int_member (albums_array, album_id, "year");
+		const gchar *artist = rena_koel_plugin_json_index_get_name (artists_index, artist_id);
+		const gchar *album = rena_koel_plugin_json_index_get_name (albums_index, album_id);
+		guint64 album_year = rena_koel_plugin_json_index_get_int_member (albums_index, album_id, "year");
 		gchar *url = g_strdup_printf("%s/api/%s", priv->server, song_id);
 
 		mobj = g_object_new (RENA_TYPE_MUSICOBJECT,
@@ -467,25 +487,28 @@ rena_koel_plugin_cache_provider_done (SoupSession *session,
 		                     "artist", artist != NULL ? artist : "",
 		                     "album", album != NULL ? album : "",
 		                     "year", (gint)album_year,
-		                     "length", (gint)length,
+		                     "length", (gint)song_length,
 		                     NULL);
 
 		if (G_LIKELY(mobj))
 			rena_koel_cache_insert_track (plugin, mobj);
 
 		/* Have to give control to GTK periodically ... */
-		rena_process_gtk_events ();
+		if ((i % 128) == 0)
+			rena_process_gtk_events ();
 
 		g_free (url);
 	}
 
-	interactions_node = json_object_get_member(root_object, "interactions");
-	interactions_array = json_node_get_array (interactions_node);
+	g_hash_table_destroy (albums_index);
+	g_hash_table_destroy (artists_index);
 
-	l_songs = json_array_get_elements (interactions_array);
-	for (l_song = l_songs; l_song != NULL; l_song = g_list_next(l_song))
+	interactions_array = json_object_get_array_member (root_object, "interactions");
+	length = interactions_array ? json_array_get_length (interactions_array) : 0;
+
+	for (i = 0; i < length; i++)
 	{
-		JsonObject *song_object = json_node_get_object ((JsonNode *)l_song->data);
+		JsonObject *song_object = json_array_get_object_element (interactions_array, i);
 
 		if (!json_object_get_boolean_member (song_object, "liked"))
 			continue;
@@ -503,13 +526,16 @@ rena_koel_plugin_cache_provider_done (SoupSession *session,
 			liked = g_list_prepend (liked, mobj);
 
 		/* Have to give control to GTK periodically ... */
-		rena_process_gtk_events ();
+		if ((i % 128) == 0)
+			rena_process_gtk_events ();
 
 		g_free (url);
 	}
 
 	g_object_unref(parser);
 
+	RENA_PROFILE_END(span, "koel-parse-data");
+
 	/* Upgrade. */
 
 	rena_koel_plugin_set_need_upgrade (plugin, FALSE);
@@ -1188,6 +1214,42 @@ rena_koel_plugin_download_done (RenaBackend       *backend,
 	rena_song_cache_put_location (priv->cache, location, filename);
 }
 
+static void
+rena_koel_plugin_prefetch_upcoming (RenaKoelPlugin *plugin)
+{
+	RenaPlaylist *playlist;
+	RenaMusicobject *mobj;
+	GList *upcoming, *l, *locations = NULL, *uris = NULL;
+	const gchar *location = NULL;
+	guint count = 0;
+
+	RenaKoelPluginPrivate *priv = plugin->priv;
+
+	count = rena_song_cache_get_prefetch_count (priv->cache);
+	if (count == 0 || priv->token == NULL) {
+		rena_song_cache_cancel_prefetch (priv->cache, plugin);
+		return;
+	}
+
+	playlist = rena_application_get_playlist (priv->rena);
+	upcoming = rena_playlist_get_upcoming_mobj_list (playlist, count);
+	for (l = upcoming ; l != NULL ; l = l->next) {
+		mobj = l->data;
+		if (!rena_musicobject_is_koel_file (mobj))
+			continue;
+
+		location = rena_musicobject_get_file (mobj);
+		locations = g_list_append (locations, g_strdup (location));
+		uris = g_list_append (uris, g_strdup_printf ("%s/play?jwt-token=%s", location, priv->token));
+	}
+
+	rena_song_cache_prefetch (priv->cache, plugin, locations, uris);
+
+	g_list_free_full (locations, g_free);
+	g_list_free_full (uris, g_free);
+	g_list_free (upcoming);
+}
+
 static void
 rena_koel_plugin_half_played (RenaBackend    *backend,
                                 RenaKoelPlugin *plugin)
@@ -1211,6 +1273,7 @@ static void
 rena_plugin_activate (PeasActivatable *activatable)
 {
 	RenaBackend *backend;
+	RenaPlaylist *playlist;
 	GMenuItem *item;
 	GSimpleAction *action;
 
@@ -1289,6 +1352,18 @@ rena_plugin_activate (PeasActivatable *activatable)
 	g_signal_connect (backend, "half-played",
 	                  G_CALLBACK(rena_koel_plugin_half_played), plugin);
 
+	/* Prefetch the upcoming songs into the cache */
+
+	playlist = rena_application_get_playlist (priv->rena);
+	g_signal_connect_swapped (playlist, "playlist-set-track",
+	                          G_CALLBACK(rena_koel_plugin_prefetch_upcoming), plugin);
+	g_signal_connect_swapped (playlist, "playlist-changed",
+	                          G_CALLBACK(rena_koel_plugin_prefetch_upcoming), plugin);
+	g_signal_connect_swapped (playlist, "playlist-queue-changed",
+	                          G_CALLBACK(rena_koel_plugin_prefetch_upcoming), plugin);
+	g_signal_connect_swapped (rena_application_get_preferences (priv->rena), "notify::shuffle",
+	                          G_CALLBACK(rena_koel_plugin_prefetch_upcoming), plugin);
+
 	/* Favorites handler */
 
 	g_signal_connect (priv->favorites, "song-added",
@@ -1309,6 +1384,7 @@ static void
 rena_plugin_deactivate (PeasActivatable *activatable)
 {
 	RenaBackend *backend;
+	RenaPlaylist *playlist;
 	RenaDatabaseProvider *provider;
 	RenaPreferences *preferences;
 	gchar *plugin_group = NULL;
@@ -1320,6 +1396,12 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 
 	/* Cache */
 
+	playlist = rena_application_get_playlist (priv->rena);
+	g_signal_handlers_disconnect_by_func (playlist, rena_koel_plugin_prefetch_upcoming, plugin);
+	g_signal_handlers_disconnect_by_func (rena_application_get_preferences (priv->rena),
+	                                      rena_koel_plugin_prefetch_upcoming, plugin);
+	rena_song_cache_cancel_prefetch (priv->cache, plugin);
+
 	g_hash_table_destroy (priv->tracks_table);
 	g_object_unref (priv->cache);
 
@@ -63,6 +63,8 @@
 #define RENA_IS_LASTFM_PLUGIN_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), RENA_TYPE_LASTFM_PLUGIN))
 #define RENA_LASTFM_PLUGIN_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), RENA_TYPE_LASTFM_PLUGIN, RenaLastfmPluginClass))
 
+typedef struct _RenaLastfmScrobbleBatch RenaLastfmScrobbleBatch;
+
 struct _RenaLastfmPluginPrivate {
 	RenaApplication        *rena;
 
@@ -97,6 +99,12 @@ struct _RenaLastfmPluginPrivate {
 
 	guint                     update_timeout_id;
 	guint                     scrobble_timeout_id;
+
+	/* Scrobble journal */
+	RenaDatabase             *cdbase;
+	RenaLastfmScrobbleBatch  *batch;
+	guint                     retry_timeout_id;
+	guint                     retry_backoff;
 };
 typedef struct _RenaLastfmPluginPrivate RenaLastfmPluginPrivate;
 
@@ -116,6 +124,16 @@ RENA_PLUGIN_REGISTER (RENA_TYPE_LASTFM_PLUGIN,
 
 #define WAIT_UPDATE 5
 
+/* Scrobbles are journaled and submitted in order by a single worker. A failed
+ * submission is retried with an exponential backoff, and an entry that Last.fm
+ * keeps rejecting is eventually dropped so it can not block the journal.
+ * Network errors and temporary server failures never count as attempts. */
+
+#define SCROBBLE_BATCH_SIZE     50
+#define SCROBBLE_MAX_ATTEMPTS   5
+#define SCROBBLE_RETRY_MIN      30
+#define SCROBBLE_RETRY_MAX      3600
+
 typedef enum {
 	LASTFM_NONE = 0,
 	LASTFM_GET_SIMILAR,
@@ -1080,59 +1098,296 @@ rena_gmenu_lastfm_import_xspf_action (GSimpleAction *action,
  * Handlers
  */
 
+/*
+ * Scrobble journal.
+ */
+
+typedef struct {
+	gint     id;
+	gchar   *title;
+	gchar   *artist;
+	gchar   *album;
+	gint     track_no;
+	gint     length;
+	time_t   started;
+} RenaLastfmScrobble;
+
+struct _RenaLastfmScrobbleBatch {
+	RenaLastfmPlugin *plugin;
+	LASTFM_SESSION   *session;
+	gboolean          owns_session;
+	GCancellable     *cancellable;
+	GArray           *scrobbles;
+	guint             submitted;
+	gboolean          rejected;
+};
+
+static void
+rena_lastfm_scrobble_clear (gpointer data)
+{
+	RenaLastfmScrobble *scrobble = data;
+
+	g_free (scrobble->title);
+	g_free (scrobble->artist);
+	g_free (scrobble->album);
+}
+
+static void
+rena_lastfm_scrobble_batch_free (gpointer data)
+{
+	RenaLastfmScrobbleBatch *batch = data;
+
+	/* The session was handed over by a disconnect while submitting. */
+	if (batch->owns_session)
+		LASTFM_dinit (batch->session);
+
+	g_object_unref (batch->cancellable);
+	g_array_free (batch->scrobbles, TRUE);
+	g_slice_free (RenaLastfmScrobbleBatch, batch);
+}
+
+static void
+rena_lastfm_journal_init (RenaLastfmPlugin *plugin)
+{
+	RenaLastfmPluginPrivate *priv = plugin->priv;
+
+	priv->cdbase = rena_database_get ();
+	rena_database_exec_query (priv->cdbase,
+		"CREATE TABLE IF NOT EXISTS LASTFM_SCROBBLE "
+			"(id INTEGER PRIMARY KEY,"
+			"title TEXT,"
+			"artist TEXT,"
+			"album TEXT,"
+			"track_no INT,"
+			"length INT,"
+			"started INT,"
+			"attempts INT DEFAULT 0);");
+}
+
+static void
+rena_lastfm_journal_append (RenaLastfmPlugin *plugin,
+                            RenaMusicobject  *mobj,
+                            time_t            started)
+{
+	RenaPreparedStatement *statement;
+	RenaLastfmPluginPrivate *priv = plugin->priv;
+
+	statement = rena_database_create_statement (priv->cdbase,
+		"INSERT INTO LASTFM_SCROBBLE (title, artist, album, track_no, length, started) VALUES (?, ?, ?, ?, ?, ?)");
+	rena_prepared_statement_bind_string (statement, 1, rena_musicobject_get_title (mobj));
+	rena_prepared_statement_bind_string (statement, 2, rena_musicobject_get_artist (mobj));
+	rena_prepared_statement_bind_string (statement, 3, rena_musicobject_get_album (mobj));
+	rena_prepared_statement_bind_int (statement, 4, rena_musicobject_get_track_no (mobj));
+	rena_prepared_statement_bind_int (statement, 5, rena_musicobject_get_length (mobj));
+	rena_prepared_statement_bind_int64 (statement, 6, (gint64) started);
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+}
+
+/* Last.fm answered the scrobble with an error about the entry itself, and
+ * not about the connection, the session or the service availability. */
+
+static gboolean
+rena_lastfm_scrobble_rejected (LASTFM_SESSION *session)
+{
+	const gchar *status = NULL, *error_text = NULL;
+	const gint *error_code = NULL;
+
+	LASTFM_status (session, &status, &error_code, &error_text);
+	if (error_code == NULL)
+		return FALSE;
+
+	switch (*error_code) {
+		case 0:   /* No answer */
+		case 8:   /* Operation failed */
+		case 9:   /* Invalid session key */
+		case 11:  /* Service offline */
+		case 16:  /* Temporarily unavailable */
+		case 29:  /* Rate limit exceeded */
+			return FALSE;
+		default:
+			return TRUE;
+	}
+}
+
 static gpointer
 rena_lastfm_scrobble_thread (gpointer data)
 {
-	IdleMessage *id = NULL;
-	gchar *title = NULL, *artist = NULL, *album = NULL;
-	gint track_no, length, rv;
-	time_t last_time;
+	RenaLastfmScrobble *scrobble;
+	gint rv;
+
+	RenaLastfmScrobbleBatch *batch = data;
+
+	CDEBUG(DBG_PLUGIN, "Scrobbler thread: %u pending", batch->scrobbles->len);
+
+	/* Submit in order, stopping at the first failure to keep the journal sorted. */
+
+	while (batch->submitted < batch->scrobbles->len) {
+		if (g_cancellable_is_cancelled (batch->cancellable))
+			break;
+
+		scrobble = &g_array_index (batch->scrobbles, RenaLastfmScrobble, batch->submitted);
+
+		rv = LASTFM_track_scrobble (batch->session,
+		                            scrobble->title,
+		                            scrobble->album,
+		                            scrobble->artist,
+		                            scrobble->started,
+		                            scrobble->length,
+		                            scrobble->track_no,
+		                            0, NULL);
+		if (rv != LASTFM_STATUS_OK) {
+			batch->rejected = rena_lastfm_scrobble_rejected (batch->session);
+			break;
+		}
+
+		batch->submitted++;
+	}
+
+	return batch;
+}
+
+static gboolean rena_lastfm_scrobble_finished (gpointer data);
+
+static void
+rena_lastfm_journal_submit (RenaLastfmPlugin *plugin)
+{
+	RenaPreparedStatement *statement;
+	RenaLastfmScrobbleBatch *batch;
+	RenaLastfmScrobble scrobble;
+
+	RenaLastfmPluginPrivate *priv = plugin->priv;
+
+	if (priv->batch != NULL || priv->retry_timeout_id)
+		return;
+
+	if (priv->session_id == NULL || priv->status != LASTFM_STATUS_OK)
+		return;
+
+	batch = g_slice_new0 (RenaLastfmScrobbleBatch);
+	batch->plugin = plugin;
+	batch->session = priv->session_id;
+	batch->cancellable = g_cancellable_new ();
+	batch->scrobbles = g_array_sized_new (FALSE, FALSE, sizeof (RenaLastfmScrobble), SCROBBLE_BATCH_SIZE);
+	g_array_set_clear_func (batch->scrobbles, rena_lastfm_scrobble_clear);
+
+	statement = rena_database_create_statement (priv->cdbase,
+		"SELECT id, title, artist, album, track_no, length, started FROM LASTFM_SCROBBLE ORDER BY id LIMIT ?");
+	rena_prepared_statement_bind_int (statement, 1, SCROBBLE_BATCH_SIZE);
+	while (rena_prepared_statement_step (statement)) {
+		scrobble.id = rena_prepared_statement_get_int (statement, 0);
+		scrobble.title = g_strdup (rena_prepared_statement_get_string (statement, 1));
+		scrobble.artist = g_strdup (rena_prepared_statement_get_string (statement, 2));
+		scrobble.album = g_strdup (rena_prepared_statement_get_string (statement, 3));
+		scrobble.track_no = rena_prepared_statement_get_int (statement, 4);
+		scrobble.length = rena_prepared_statement_get_int (statement, 5);
+		scrobble.started = (time_t) rena_prepared_statement_get_int64 (statement, 6);
+		g_array_append_val (batch->scrobbles, scrobble);
+	}
+	rena_prepared_statement_free (statement);
 
+	if (batch->scrobbles->len == 0) {
+		rena_lastfm_scrobble_batch_free (batch);
+		return;
+	}
+
+	if (rena_async_launch_task (RENA_ASYNC_PRIORITY_BACKGROUND, "lastfm-scrobble", batch->cancellable,
+	                            rena_lastfm_scrobble_thread,
+	                            rena_lastfm_scrobble_finished,
+	                            batch, rena_lastfm_scrobble_batch_free))
+		priv->batch = batch;
+}
+
+static gboolean
+rena_lastfm_scrobble_retry (gpointer data)
+{
 	RenaLastfmPlugin *plugin = data;
 	RenaLastfmPluginPrivate *priv = plugin->priv;
 
-	CDEBUG(DBG_PLUGIN, "Scrobbler thread");
+	priv->retry_timeout_id = 0;
+	rena_lastfm_journal_submit (plugin);
 
-	g_mutex_lock (&priv->data_mutex);
-	if (priv->playback_started == 0) {
-		g_mutex_unlock (&priv->data_mutex);
-		return rena_idle_message_new ("Last.fm", _("Last.fm submission failed"), FALSE);
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+rena_lastfm_scrobble_finished (gpointer data)
+{
+	RenaAppNotification *notification;
+	RenaPreparedStatement *statement;
+	RenaLastfmScrobble *scrobble;
+	gboolean failed;
+	guint i;
+
+	RenaLastfmScrobbleBatch *batch = data;
+	RenaLastfmPlugin *plugin = batch->plugin;
+	RenaLastfmPluginPrivate *priv;
+
+	/* Detached on deactivate. The journal keeps what was not deleted. */
+	if (plugin == NULL) {
+		rena_lastfm_scrobble_batch_free (batch);
+		return FALSE;
 	}
 
-	g_object_get (priv->current_mobj,
-	              "title",    &title,
-	              "artist",   &artist,
-	              "album",    &album,
-	              "track-no", &track_no,
-	              "length",   &length,
-	              NULL);
-	last_time = priv->playback_started;
-	g_mutex_unlock (&priv->data_mutex);
+	priv = plugin->priv;
+	priv->batch = NULL;
 
-	rv = LASTFM_track_scrobble (priv->session_id,
-	                            title,
-	                            album,
-	                            artist,
-	                            last_time,
-	                            length,
-	                            track_no,
-	                            0, NULL);
+	failed = batch->submitted < batch->scrobbles->len;
 
-	g_free(title);
-	g_free(artist);
-	g_free(album);
+	rena_database_begin_transaction (priv->cdbase);
+	statement = rena_database_create_statement (priv->cdbase,
+		"DELETE FROM LASTFM_SCROBBLE WHERE id = ?");
+	for (i = 0; i < batch->submitted; i++) {
+		scrobble = &g_array_index (batch->scrobbles, RenaLastfmScrobble, i);
+		rena_prepared_statement_bind_int (statement, 1, scrobble->id);
+		rena_prepared_statement_step (statement);
+		rena_prepared_statement_reset (statement);
+	}
+	rena_prepared_statement_free (statement);
 
-	g_mutex_lock (&priv->data_mutex);
-	priv->playback_started = 0;
-	g_mutex_unlock (&priv->data_mutex);
+	if (failed && batch->rejected) {
+		scrobble = &g_array_index (batch->scrobbles, RenaLastfmScrobble, batch->submitted);
+		statement = rena_database_create_statement (priv->cdbase,
+			"UPDATE LASTFM_SCROBBLE SET attempts = attempts + 1 WHERE id = ?");
+		rena_prepared_statement_bind_int (statement, 1, scrobble->id);
+		rena_prepared_statement_step (statement);
+		rena_prepared_statement_free (statement);
+
+		statement = rena_database_create_statement (priv->cdbase,
+			"DELETE FROM LASTFM_SCROBBLE WHERE attempts >= ?");
+		rena_prepared_statement_bind_int (statement, 1, SCROBBLE_MAX_ATTEMPTS);
+		rena_prepared_statement_step (statement);
+		rena_prepared_statement_free (statement);
+	}
+	rena_database_commit_transaction (priv->cdbase);
 
-	if (rv != LASTFM_STATUS_OK)
-		id = rena_idle_message_new ("Last.fm", _("Last.fm submission failed"), FALSE);
+	if (batch->submitted > 0) {
+		notification = rena_app_notification_new ("Last.fm", _("Track scrobbled on Last.fm"));
+		rena_app_notification_set_timeout (notification, 5);
+		rena_app_notification_show (notification);
+	}
+
+	if (failed) {
+		priv->retry_backoff = priv->retry_backoff ?
+			MIN (priv->retry_backoff * 2, SCROBBLE_RETRY_MAX) : SCROBBLE_RETRY_MIN;
+
+		CDEBUG(DBG_PLUGIN, "Last.fm submission failed, retrying in %u seconds", priv->retry_backoff);
+
+		priv->retry_timeout_id =
+			g_timeout_add_seconds_full (G_PRIORITY_DEFAULT_IDLE, priv->retry_backoff,
+			                            rena_lastfm_scrobble_retry, plugin, NULL);
+	}
 	else {
-		id = rena_idle_message_new ("Last.fm", _("Track scrobbled on Last.fm"), TRUE);
+		priv->retry_backoff = 0;
+
+		/* The task key is released after returning, so continue from an idle. */
+		if (batch->scrobbles->len == SCROBBLE_BATCH_SIZE)
+			priv->retry_timeout_id = g_idle_add (rena_lastfm_scrobble_retry, plugin);
 	}
 
-	return id;
+	rena_lastfm_scrobble_batch_free (batch);
+
+	return FALSE;
 }
 
 static gboolean
@@ -1293,10 +1548,15 @@ rena_lastfm_now_playing_handler (gpointer data)
 	time(&priv->playback_started);
 	g_mutex_unlock (&priv->data_mutex);
 
+	/* Offline the track is just journaled to be scrobbled later */
+	if (priv->status != LASTFM_STATUS_OK)
+		return G_SOURCE_REMOVE;
+
 	/* Launch tread */
-	rena_async_launch (rena_lastfm_now_playing_thread,
-	                     rena_async_set_idle_message,
-	                     plugin);
+	rena_async_launch_task (RENA_ASYNC_PRIORITY_BACKGROUND, NULL, NULL,
+	                        rena_lastfm_now_playing_thread,
+	                        rena_async_set_idle_message,
+	                        plugin, NULL);
 
 	return G_SOURCE_REMOVE;
 }
@@ -1311,14 +1571,13 @@ rena_lastfm_scrobble_handler (gpointer data)
 
 	priv->scrobble_timeout_id = 0;
 
-	if (priv->status != LASTFM_STATUS_OK) {
-		rena_lastfm_no_connection_advice ();
-		return G_SOURCE_REMOVE;
-	}
+	g_mutex_lock (&priv->data_mutex);
+	if (priv->playback_started != 0 && priv->current_mobj != NULL)
+		rena_lastfm_journal_append (plugin, priv->current_mobj, priv->playback_started);
+	priv->playback_started = 0;
+	g_mutex_unlock (&priv->data_mutex);
 
-	rena_async_launch (rena_lastfm_scrobble_thread,
-	                     rena_async_set_idle_message,
-	                     plugin);
+	rena_lastfm_journal_submit (plugin);
 
 	return G_SOURCE_REMOVE;
 }
@@ -1378,9 +1637,6 @@ backend_changed_state_cb (RenaBackend *backend, GParamSpec *pspec, gpointer user
 	if (!priv->has_user || !priv->has_pass)
 		return;
 
-	if (priv->status != LASTFM_STATUS_OK)
-		return;
-
 	mobj = rena_backend_get_musicobject (backend);
 
 	file_source = rena_musicobject_get_source (mobj);
@@ -1529,6 +1785,9 @@ rena_lastfm_connect_idle(gpointer data)
 			rena_lastfm_no_connection_advice ();
 			CDEBUG(DBG_PLUGIN, "Failure to login on lastfm");
 		}
+		else {
+			rena_lastfm_journal_submit (plugin);
+		}
 	}
 
 	rena_lastfm_update_menu_actions (plugin);
@@ -1555,7 +1814,11 @@ rena_lastfm_disconnect (RenaLastfmPlugin *plugin)
 	if (priv->session_id != NULL) {
 		CDEBUG(DBG_PLUGIN, "Disconnecting LASTFM");
 
-		LASTFM_dinit(priv->session_id);
+		/* A submission still uses the session, so it frees it. */
+		if (priv->batch != NULL && priv->batch->session == priv->session_id)
+			priv->batch->owns_session = TRUE;
+		else
+			LASTFM_dinit(priv->session_id);
 
 		priv->session_id = NULL;
 		priv->status = LASTFM_STATUS_INVALID;
@@ -1782,6 +2045,13 @@ rena_plugin_activate (PeasActivatable *activatable)
 	priv->update_timeout_id = 0;
 	priv->scrobble_timeout_id = 0;
 
+	/* Scrobbles pending from previous sessions */
+
+	rena_lastfm_journal_init (plugin);
+	priv->batch = NULL;
+	priv->retry_timeout_id = 0;
+	priv->retry_backoff = 0;
+
 	/* Append menu and settings */
 
 	rena_menubar_append_lastfm (plugin);
@@ -1829,8 +2099,22 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 	g_signal_handlers_disconnect_by_func (rena_application_get_backend (priv->rena),
 	                                      backend_changed_state_cb, plugin);
 
+	/* Detach a running submission, since the database is closed below. */
+
+	if (priv->batch != NULL) {
+		priv->batch->plugin = NULL;
+		g_cancellable_cancel (priv->batch->cancellable);
+	}
+
 	rena_lastfm_disconnect (plugin);
 
+	priv->batch = NULL;
+
+	if (priv->retry_timeout_id) {
+		g_source_remove (priv->retry_timeout_id);
+		priv->retry_timeout_id = 0;
+	}
+
 	/* Settings */
 
 	preferences = rena_application_get_preferences (priv->rena);
@@ -1851,5 +2135,6 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 		g_object_unref (priv->updated_mobj);
 	if (priv->current_mobj)
 		g_object_unref (priv->current_mobj);
+	g_object_unref (priv->cdbase);
 	g_mutex_clear (&priv->data_mutex);
 }
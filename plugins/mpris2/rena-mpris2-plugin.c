@@ -173,20 +173,84 @@ static const gchar mpris2xml[] =
  * Mpris2 implementation.
  */
 
+/* Playlist changes touching more tracks are announced with TrackListReplaced. */
+#define MPRIS_TRACKLIST_MAX_DELTAS 64
+
+static void rena_mpris_update_tracklist (RenaMpris2Plugin *plugin);
+
+/*
+ * Every musicobject exposed on the bus takes an object path from a counter
+ * the first time it is seen, and keeps it while it stays on the playlist.
+ */
+
+static const gchar *
+rena_mpris2_get_track_id (RenaMpris2Plugin *plugin, RenaMusicobject *mobj)
+{
+	RenaMpris2PluginPrivate *priv = plugin->priv;
+	gchar *track_id = NULL;
+
+	track_id = g_hash_table_lookup (priv->track_ids, mobj);
+	if (track_id)
+		return track_id;
+
+	track_id = g_strdup_printf ("%s/TrackList/%" G_GUINT64_FORMAT, MPRIS_PATH, ++priv->next_track_id);
+	g_hash_table_insert (priv->track_ids, g_object_ref (mobj), track_id);
+	g_hash_table_insert (priv->track_mobjs, track_id, mobj);
+
+	return track_id;
+}
+
 static RenaMusicobject *
-get_mobj_at_mpris2_track_id (const gchar *track_id)
+get_mobj_at_mpris2_track_id (RenaMpris2Plugin *plugin, const gchar *track_id)
+{
+	return g_hash_table_lookup (plugin->priv->track_mobjs, track_id);
+}
+
+static void
+rena_mpris2_invalidate_track (RenaMpris2Plugin *plugin, RenaMusicobject *mobj)
+{
+	g_hash_table_remove (plugin->priv->track_metadata, mobj);
+}
+
+static void
+rena_mpris2_forget_track (RenaMpris2Plugin *plugin, RenaMusicobject *mobj)
 {
-	gchar *base = NULL;
-	void *mobj_request = NULL;
+	RenaMpris2PluginPrivate *priv = plugin->priv;
+	const gchar *track_id = NULL;
+
+	track_id = g_hash_table_lookup (priv->track_ids, mobj);
+	if (track_id == NULL)
+		return;
+
+	g_hash_table_remove (priv->track_metadata, mobj);
+	g_hash_table_remove (priv->track_mobjs, track_id);
+	g_hash_table_remove (priv->track_ids, mobj);
+}
+
+/* The backend plays a copy of the playlist row, so each new song drops the
+ * id of the previous copy. The copy is kept alive while current, so it can
+ * not be freed and its address reused by the next one. */
 
-	base = g_strdup_printf("%s/TrackList/", MPRIS_PATH);
+static RenaMusicobject *
+rena_mpris2_get_current_mobj (RenaMpris2Plugin *plugin)
+{
+	RenaBackend *backend;
+	RenaMusicobject *mobj = NULL;
 
-	if(g_str_has_prefix(track_id, base))
-		sscanf(track_id + strlen(base), "%p", &mobj_request);
+	backend = rena_application_get_backend (plugin->priv->rena);
+	if (rena_backend_get_state (backend) == ST_STOPPED)
+		return NULL;
 
-	g_free(base);
+	mobj = rena_backend_get_musicobject (backend);
+	if (mobj != plugin->priv->current_mobj) {
+		if (plugin->priv->current_mobj) {
+			rena_mpris2_forget_track (plugin, plugin->priv->current_mobj);
+			g_object_unref (plugin->priv->current_mobj);
+		}
+		plugin->priv->current_mobj = mobj ? g_object_ref (mobj) : NULL;
+	}
 
-	return mobj_request;
+	return mobj;
 }
 
 /*
@@ -395,12 +459,11 @@ mpris_Player_SetPosition (GDBusMethodInvocation *invocation,
 	gchar *track_id = NULL;
 
 	g_variant_get(parameters, "(ox)", &track_id, &param);
-	mobj = get_mobj_at_mpris2_track_id (track_id);
+	mobj = get_mobj_at_mpris2_track_id (plugin, track_id);
 	g_free(track_id);
 
-	/* FIXME: Ugly hack... */
 	backend = rena_application_get_backend (plugin->priv->rena);
-	current_mobj = rena_backend_get_musicobject (backend);
+	current_mobj = rena_mpris2_get_current_mobj (plugin);
 
 	if(mobj != NULL && mobj == current_mobj) {
 		gint seek = (param / 1000000);
@@ -550,14 +613,12 @@ mpris_Player_put_Shuffle (GVariant *value, GError **error, RenaMpris2Plugin *plu
 }
 
 static GVariant *
-handle_get_trackid (RenaMusicobject *mobj)
+handle_get_trackid (RenaMpris2Plugin *plugin, RenaMusicobject *mobj)
 {
-	gchar *o = alloca(260);
 	if(NULL == mobj)
 		return g_variant_new_object_path("/");
-	g_snprintf(o, 260, "%s/TrackList/%p", MPRIS_PATH, mobj);
 
-	return g_variant_new_object_path(o);
+	return g_variant_new_object_path(rena_mpris2_get_track_id (plugin, mobj));
 }
 
 static void
@@ -570,7 +631,7 @@ handle_strings_request (GVariantBuilder *b, const gchar *tag, const gchar *val)
 }
 
 static void
-handle_get_metadata (RenaMusicobject *mobj, GVariantBuilder *b)
+handle_get_metadata (RenaMpris2Plugin *plugin, RenaMusicobject *mobj, GVariantBuilder *b)
 {
 	const gchar *title, *artist, *album, *genre, *comment, *file;
 	gint track_no, year, length, bitrate, channels, samplerate;
@@ -597,7 +658,7 @@ handle_get_metadata (RenaMusicobject *mobj, GVariantBuilder *b)
 	       g_filename_to_uri(file, NULL, NULL) : g_strdup(file);
 
 	g_variant_builder_add (b, "{sv}", "mpris:trackid",
-		handle_get_trackid(mobj));
+		handle_get_trackid(plugin, mobj));
 	g_variant_builder_add (b, "{sv}", "xesam:url",
 		g_variant_new_string(url));
 	g_variant_builder_add (b, "{sv}", "xesam:title",
@@ -624,24 +685,51 @@ handle_get_metadata (RenaMusicobject *mobj, GVariantBuilder *b)
 	g_free(url);
 }
 
+/* Returns the cached metadata of the track, owned by the plugin. */
+
+static GVariant *
+rena_mpris2_get_track_metadata (RenaMpris2Plugin *plugin, RenaMusicobject *mobj)
+{
+	GVariantBuilder b;
+	GVariant *metadata = NULL;
+
+	metadata = g_hash_table_lookup (plugin->priv->track_metadata, mobj);
+	if (metadata)
+		return metadata;
+
+	g_variant_builder_init (&b, G_VARIANT_TYPE ("a{sv}"));
+	handle_get_metadata (plugin, mobj, &b);
+	metadata = g_variant_ref_sink (g_variant_builder_end (&b));
+
+	g_hash_table_insert (plugin->priv->track_metadata, mobj, metadata);
+
+	return metadata;
+}
+
 static GVariant *
 mpris_Player_get_Metadata (GError **error, RenaMpris2Plugin *plugin)
 {
-	RenaBackend *backend;
 	RenaToolbar *toolbar;
 	RenaAlbumArt *albumart;
+	RenaMusicobject *mobj;
 	gchar *artUrl_uri = NULL;
 	GVariantBuilder b;
+	GVariantIter iter;
+	GVariant *entry;
 	const gchar *arturl;
 
 	CDEBUG(DBG_PLUGIN, "MPRIS Player get Metadata");
 
 	g_variant_builder_init(&b, G_VARIANT_TYPE ("a{sv}"));
 
-	backend = rena_application_get_backend (plugin->priv->rena);
+	mobj = rena_mpris2_get_current_mobj (plugin);
 
-	if (rena_backend_get_state (backend) != ST_STOPPED) {
-		handle_get_metadata(rena_backend_get_musicobject(backend), &b);
+	if (mobj != NULL) {
+		g_variant_iter_init (&iter, rena_mpris2_get_track_metadata (plugin, mobj));
+		while ((entry = g_variant_iter_next_value (&iter))) {
+			g_variant_builder_add_value (&b, entry);
+			g_variant_unref (entry);
+		}
 
 		toolbar = rena_application_get_toolbar (plugin->priv->rena);
 		albumart = rena_toolbar_get_album_art (toolbar);
@@ -656,7 +744,7 @@ mpris_Player_get_Metadata (GError **error, RenaMpris2Plugin *plugin)
 	}
 	else {
 		g_variant_builder_add (&b, "{sv}", "mpris:trackid",
-			handle_get_trackid(NULL));
+			handle_get_trackid(plugin, NULL));
 	}
 	return g_variant_builder_end(&b);
 }
@@ -890,6 +978,7 @@ mpris_TrackList_GetTracksMetadata (GDBusMethodInvocation *invocation,
 	/* In: (ao) out: aa{sv} */
 
 	GVariant *param1 = g_variant_get_child_value(parameters, 0);
+	RenaMusicobject *mobj = NULL;
 	gsize i, length;
 	GVariantBuilder b;
 	const gchar *track_id;
@@ -902,19 +991,19 @@ mpris_TrackList_GetTracksMetadata (GDBusMethodInvocation *invocation,
 	length = g_variant_n_children(param1);
 	
 	for(i = 0; i < length; i++) {
-		g_variant_builder_open(&b, G_VARIANT_TYPE("a{sv}"));
-		RenaMusicobject *mobj= NULL;
-		track_id = g_variant_get_string(g_variant_get_child_value(param1, i), NULL);
-		mobj = get_mobj_at_mpris2_track_id (track_id);
+		g_variant_get_child (param1, i, "&o", &track_id);
+		mobj = get_mobj_at_mpris2_track_id (plugin, track_id);
 		if (mobj) {
-			handle_get_metadata(mobj, &b);
+			g_variant_builder_add_value (&b, rena_mpris2_get_track_metadata (plugin, mobj));
 		} else {
+			g_variant_builder_open(&b, G_VARIANT_TYPE("a{sv}"));
 			g_variant_builder_add (&b, "{sv}", "mpris:trackid",
 			g_variant_new_object_path(track_id));
+			g_variant_builder_close(&b);
 		}
-		g_variant_builder_close(&b);
 	}
 	g_variant_builder_close(&b);
+	g_variant_unref (param1);
 
 	g_dbus_method_invocation_return_value (invocation, g_variant_builder_end (&b));
 }
@@ -976,7 +1065,7 @@ mpris_TrackList_GoTo (GDBusMethodInvocation *invocation,
 
 	CDEBUG(DBG_PLUGIN, "MPRIS Tracklist GoTo");
 
-	mobj = get_mobj_at_mpris2_track_id (track_id);
+	mobj = get_mobj_at_mpris2_track_id (plugin, track_id);
 
 	if (mobj) {
 		playlist = rena_application_get_playlist (plugin->priv->rena);
@@ -993,25 +1082,25 @@ mpris_TrackList_GoTo (GDBusMethodInvocation *invocation,
 static GVariant *
 mpris_TrackList_get_Tracks (GError **error, RenaMpris2Plugin *plugin)
 {
-	RenaPlaylist *playlist;
+	RenaMpris2PluginPrivate *priv = plugin->priv;
 	GVariantBuilder builder;
 	RenaMusicobject *mobj = NULL;
-	GList *list = NULL, *i;
+	guint i;
 
 	CDEBUG(DBG_PLUGIN, "MPRIS Tracklist get Tracks");
 
-	g_variant_builder_init(&builder, G_VARIANT_TYPE("ao"));
+	/* Announce pending changes first, so the answer agrees with the signals. */
+	if (priv->tracklist_update_id) {
+		g_source_remove (priv->tracklist_update_id);
+		priv->tracklist_update_id = 0;
+		rena_mpris_update_tracklist (plugin);
+	}
 
-	playlist = rena_application_get_playlist (plugin->priv->rena);
-	list = rena_playlist_get_mobj_list (playlist);
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("ao"));
 
-	if(list != NULL) {
-		list = g_list_reverse(list);
-		for (i=list; i != NULL; i = i->next) {
-			mobj = i->data;
-			g_variant_builder_add_value(&builder, handle_get_trackid(mobj));
-		}
-		g_list_free(list);
+	for (i = 0; i < priv->tracks->len; i++) {
+		mobj = g_ptr_array_index (priv->tracks, i);
+		g_variant_builder_add_value(&builder, handle_get_trackid(plugin, mobj));
 	}
 
 	return g_variant_builder_end(&builder);
@@ -1367,7 +1456,7 @@ rena_mpris_update_mobj_remove(RenaMpris2Plugin *plugin, RenaMusicobject *mobj)
 
 	CDEBUG(DBG_PLUGIN, "MPRIS update mobj remove");
 
-	tuples[0] = handle_get_trackid(mobj);
+	tuples[0] = handle_get_trackid(plugin, mobj);
 
 	g_dbus_connection_emit_signal (plugin->priv->dbus_connection, NULL, MPRIS_PATH,
 		"org.mpris.MediaPlayer2.TrackList", "TrackRemoved",
@@ -1377,37 +1466,20 @@ rena_mpris_update_mobj_remove(RenaMpris2Plugin *plugin, RenaMusicobject *mobj)
 static void
 rena_mpris_update_mobj_added (RenaMpris2Plugin *plugin,
                                 RenaMusicobject  *mobj,
-                                GtkTreeIter        *iter)
+                                RenaMusicobject  *prev)
 {
-	RenaPlaylist *playlist;
-	GtkTreeModel *model;
-	GtkTreePath *path = NULL;
-	RenaMusicobject *prev = NULL;
 	GVariantBuilder b;
 
 	if(NULL == plugin->priv->dbus_connection)
 		return; /* better safe than sorry */
 
-	playlist = rena_application_get_playlist (plugin->priv->rena);
-	model = rena_playlist_get_model (playlist);
-
 	CDEBUG(DBG_PLUGIN, "MPRIS update mobj added");
 
 	g_variant_builder_init(&b, G_VARIANT_TYPE ("(a{sv}o)"));
-	path = gtk_tree_model_get_path(model, iter);
 
-	if (gtk_tree_path_prev(path)) {
-		prev = current_playlist_mobj_at_path(path, playlist);
-	}
-	gtk_tree_path_free(path);
+	g_variant_builder_add_value(&b, rena_mpris2_get_track_metadata (plugin, mobj));
 
-	g_variant_builder_open(&b, G_VARIANT_TYPE("a{sv}"));
-	handle_get_metadata(mobj, &b);
-	g_variant_builder_close(&b);
-
-	g_variant_builder_add_value(&b, (prev) ?
-		handle_get_trackid(prev) :
-		g_variant_new_object_path("/"));
+	g_variant_builder_add_value(&b, handle_get_trackid(plugin, prev));
 		// or use g_variant_new_string(""); ?
 		// "/" is the only legal empty object path, but
 		// the spec wants an empty string. What do the others do?
@@ -1418,7 +1490,7 @@ rena_mpris_update_mobj_added (RenaMpris2Plugin *plugin,
 }
 
 static void
-rena_mpris_update_mobj_changed(RenaMpris2Plugin *plugin, RenaMusicobject *mobj, gint bitmask)
+rena_mpris_update_mobj_changed(RenaMpris2Plugin *plugin, RenaMusicobject *mobj)
 {
 	GVariantBuilder b;
 
@@ -1427,28 +1499,22 @@ rena_mpris_update_mobj_changed(RenaMpris2Plugin *plugin, RenaMusicobject *mobj,
 
 	CDEBUG(DBG_PLUGIN, "MPRIS update mobj changed");
 
-	g_variant_builder_init(&b, G_VARIANT_TYPE ("(a{sv})"));
-	g_variant_builder_open(&b, G_VARIANT_TYPE("a{sv}"));
+	g_variant_builder_init(&b, G_VARIANT_TYPE ("(oa{sv})"));
 
-	// should we only submit the changed metadata here? The spec is not clear.
-	// If yes, use the portions in the bitmask parameter only.
-	handle_get_metadata(mobj, &b);
-
-	g_variant_builder_close(&b);
+	g_variant_builder_add_value(&b, handle_get_trackid(plugin, mobj));
+	g_variant_builder_add_value(&b, rena_mpris2_get_track_metadata (plugin, mobj));
 
 	g_dbus_connection_emit_signal(plugin->priv->dbus_connection, NULL, MPRIS_PATH,
-		"org.mpris.MediaPlayer2.TrackList", "TrackChanged",
+		"org.mpris.MediaPlayer2.TrackList", "TrackMetadataChanged",
 		g_variant_builder_end(&b), NULL);
 }
 
 static void
 rena_mpris_update_tracklist_replaced (RenaMpris2Plugin *plugin)
 {
-	RenaPlaylist *playlist;
-	RenaBackend *backend;
 	GVariantBuilder b;
 	RenaMusicobject *mobj = NULL;
-	GList *list = NULL, *i;
+	guint i;
 
 	if (NULL == plugin->priv->dbus_connection)
 		return; /* better safe than sorry */
@@ -1458,27 +1524,117 @@ rena_mpris_update_tracklist_replaced (RenaMpris2Plugin *plugin)
 	g_variant_builder_init(&b, G_VARIANT_TYPE ("(aoo)"));
 	g_variant_builder_open(&b, G_VARIANT_TYPE("ao"));
 
-	playlist = rena_application_get_playlist (plugin->priv->rena);
-	list = rena_playlist_get_mobj_list (playlist);
-
-	if(list != NULL) {
-		list = g_list_reverse(list);
-		for (i=list; i != NULL; i = i->next) {
-			mobj = i->data;
-			g_variant_builder_add_value(&b, handle_get_trackid(mobj));
-		}
-		g_list_free(list);
+	for (i = 0; i < plugin->priv->tracks->len; i++) {
+		mobj = g_ptr_array_index (plugin->priv->tracks, i);
+		g_variant_builder_add_value(&b, handle_get_trackid(plugin, mobj));
 	}
 
-	backend = rena_application_get_backend (plugin->priv->rena);
-
 	g_variant_builder_close(&b);
-	g_variant_builder_add_value(&b, handle_get_trackid(rena_backend_get_musicobject(backend)));
+	g_variant_builder_add_value(&b, handle_get_trackid(plugin, rena_mpris2_get_current_mobj (plugin)));
 	g_dbus_connection_emit_signal (plugin->priv->dbus_connection, NULL, MPRIS_PATH,
 		"org.mpris.MediaPlayer2.TrackList", "TrackListReplaced",
 		g_variant_builder_end(&b), NULL);
 }
 
+/* Compares the playlist with the tracks last announced, and emits the
+ * removed and added tracks. Reorders and large changes are announced at
+ * once with TrackListReplaced; the ids of the remaining tracks are kept. */
+
+static void
+rena_mpris_update_tracklist (RenaMpris2Plugin *plugin)
+{
+	RenaPlaylist *playlist;
+	RenaMusicobject *mobj = NULL;
+	GPtrArray *tracks, *kept;
+	GHashTable *present, *known;
+	GList *list = NULL, *removed = NULL, *l;
+	gboolean reordered = FALSE, replaced = FALSE;
+	guint i, j, n_deltas;
+
+	RenaMpris2PluginPrivate *priv = plugin->priv;
+
+	playlist = rena_application_get_playlist (priv->rena);
+	list = g_list_reverse (rena_playlist_get_mobj_list (playlist));
+
+	tracks = g_ptr_array_new_full (g_list_length (list), g_object_unref);
+	present = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (l = list; l != NULL; l = l->next) {
+		g_ptr_array_add (tracks, g_object_ref (l->data));
+		g_hash_table_add (present, l->data);
+	}
+	g_list_free (list);
+
+	kept = g_ptr_array_sized_new (priv->tracks->len);
+	known = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (i = 0; i < priv->tracks->len; i++) {
+		mobj = g_ptr_array_index (priv->tracks, i);
+		if (g_hash_table_contains (present, mobj)) {
+			g_ptr_array_add (kept, mobj);
+			g_hash_table_add (known, mobj);
+		}
+		else {
+			removed = g_list_prepend (removed, mobj);
+		}
+	}
+
+	for (i = 0, j = 0; i < tracks->len && !reordered; i++) {
+		mobj = g_ptr_array_index (tracks, i);
+		if (g_hash_table_contains (known, mobj))
+			reordered = (g_ptr_array_index (kept, j++) != mobj);
+	}
+
+	n_deltas = g_list_length (removed) + (tracks->len - kept->len);
+
+	if (reordered || n_deltas > MPRIS_TRACKLIST_MAX_DELTAS) {
+		replaced = TRUE;
+	}
+	else if (n_deltas > 0) {
+		for (l = removed; l != NULL; l = l->next) {
+			if (g_hash_table_contains (priv->track_ids, l->data))
+				rena_mpris_update_mobj_remove (plugin, l->data);
+		}
+		for (i = 0; i < tracks->len; i++) {
+			mobj = g_ptr_array_index (tracks, i);
+			if (!g_hash_table_contains (known, mobj))
+				rena_mpris_update_mobj_added (plugin, mobj,
+					(i > 0) ? g_ptr_array_index (tracks, i - 1) : NULL);
+		}
+	}
+
+	for (l = removed; l != NULL; l = l->next)
+		rena_mpris2_forget_track (plugin, l->data);
+
+	g_ptr_array_unref (priv->tracks);
+	priv->tracks = tracks;
+
+	if (replaced)
+		rena_mpris_update_tracklist_replaced (plugin);
+
+	g_list_free (removed);
+	g_hash_table_destroy (known);
+	g_hash_table_destroy (present);
+	g_ptr_array_unref (kept);
+}
+
+static gboolean
+rena_mpris_update_tracklist_idle (gpointer user_data)
+{
+	RenaMpris2Plugin *plugin = user_data;
+
+	plugin->priv->tracklist_update_id = 0;
+	rena_mpris_update_tracklist (plugin);
+
+	return FALSE;
+}
+
+static void
+rena_mpris_queue_update_tracklist (RenaMpris2Plugin *plugin)
+{
+	if (plugin->priv->tracklist_update_id == 0)
+		plugin->priv->tracklist_update_id =
+			g_idle_add (rena_mpris_update_tracklist_idle, plugin);
+}
+
 static void
 any_notify_cb (GObject *gobject, GParamSpec *pspec, gpointer user_data)
 {
@@ -1493,6 +1649,77 @@ playlist_any_notify_cb (RenaPlaylist *playlist, gpointer user_data)
 	RenaMpris2Plugin *plugin = user_data;
 
 	rena_mpris_update_any (plugin);
+	rena_mpris_queue_update_tracklist (plugin);
+}
+
+static void
+playlist_rows_reordered_cb (GtkTreeModel *model,
+                            GtkTreePath  *path,
+                            GtkTreeIter  *iter,
+                            gpointer      new_order,
+                            gpointer      user_data)
+{
+	RenaMpris2Plugin *plugin = user_data;
+
+	rena_mpris_queue_update_tracklist (plugin);
+}
+
+/* Rows also change to show the playback state, so the metadata is rebuilt
+ * and only announced when the tags really changed. */
+
+static void
+playlist_row_changed_cb (GtkTreeModel *model,
+                         GtkTreePath  *path,
+                         GtkTreeIter  *iter,
+                         gpointer      user_data)
+{
+	RenaMpris2Plugin *plugin = user_data;
+	RenaMusicobject *mobj = NULL, *current_mobj;
+	GVariant *metadata;
+
+	gtk_tree_model_get (model, iter, P_MOBJ_PTR, &mobj, -1);
+	if (mobj == NULL)
+		return;
+
+	metadata = g_hash_table_lookup (plugin->priv->track_metadata, mobj);
+	if (metadata == NULL)
+		return;
+
+	g_variant_ref (metadata);
+	rena_mpris2_invalidate_track (plugin, mobj);
+	if (!g_variant_equal (metadata, rena_mpris2_get_track_metadata (plugin, mobj))) {
+		rena_mpris_update_mobj_changed (plugin, mobj);
+
+		current_mobj = plugin->priv->current_mobj;
+		if (current_mobj &&
+		    !g_strcmp0 (rena_musicobject_get_file (current_mobj), rena_musicobject_get_file (mobj)))
+			rena_mpris2_invalidate_track (plugin, current_mobj);
+	}
+	g_variant_unref (metadata);
+}
+
+static gboolean
+rena_mpris2_track_metadata_has_file (gpointer key, gpointer value, gpointer user_data)
+{
+	return !g_strcmp0 (rena_musicobject_get_file (key), user_data);
+}
+
+static void
+backend_tags_changed_cb (RenaBackend *backend, gint changed, gpointer user_data)
+{
+	RenaMpris2Plugin *plugin = user_data;
+	RenaMusicobject *mobj;
+
+	mobj = rena_mpris2_get_current_mobj (plugin);
+	if (mobj == NULL)
+		return;
+
+	/* Drops the current song and its playlist row. */
+	g_hash_table_foreach_remove (plugin->priv->track_metadata,
+	                             rena_mpris2_track_metadata_has_file,
+	                             (gpointer) rena_musicobject_get_file (mobj));
+
+	rena_mpris_update_metadata_changed (plugin);
 }
 
 static void
@@ -1546,6 +1773,14 @@ rena_plugin_activate (PeasActivatable *activatable)
 	priv->saved_can_pause = FALSE;
 	priv->saved_can_seek = FALSE;
 
+	priv->track_ids = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, g_free);
+	priv->track_mobjs = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->track_metadata = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_variant_unref);
+	priv->tracks = g_ptr_array_new_with_free_func (g_object_unref);
+	priv->current_mobj = NULL;
+	priv->next_track_id = 0;
+	priv->tracklist_update_id = 0;
+
 	priv->introspection_data = g_dbus_node_info_new_for_xml (mpris2xml, NULL);
 	g_assert (priv->introspection_data != NULL);
 
@@ -1566,10 +1801,17 @@ rena_plugin_activate (PeasActivatable *activatable)
 	g_signal_connect (backend, "notify::volume", G_CALLBACK (any_notify_cb), plugin);
 	g_signal_connect (backend, "notify::state", G_CALLBACK (any_notify_cb), plugin);
 	g_signal_connect (backend, "seeked", G_CALLBACK (seeked_cb), plugin);
+	g_signal_connect (backend, "tags-changed", G_CALLBACK (backend_tags_changed_cb), plugin);
 
 	playlist = rena_application_get_playlist (priv->rena);
 	g_signal_connect (playlist, "playlist-changed",
 	                  G_CALLBACK(playlist_any_notify_cb), plugin);
+	g_signal_connect (rena_playlist_get_model (playlist), "row-changed",
+	                  G_CALLBACK(playlist_row_changed_cb), plugin);
+	g_signal_connect (rena_playlist_get_model (playlist), "rows-reordered",
+	                  G_CALLBACK(playlist_rows_reordered_cb), plugin);
+
+	rena_mpris_update_tracklist (plugin);
 
 	art_cache = rena_application_get_art_cache (priv->rena);
 	g_signal_connect (art_cache, "cache-changed",
@@ -1604,9 +1846,19 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 	backend = rena_application_get_backend (priv->rena);
 	g_signal_handlers_disconnect_by_func (backend, seeked_cb, plugin);
 	g_signal_handlers_disconnect_by_func (backend, any_notify_cb, plugin);
+	g_signal_handlers_disconnect_by_func (backend, backend_tags_changed_cb, plugin);
 
 	playlist = rena_application_get_playlist (priv->rena);
 	g_signal_handlers_disconnect_by_func (playlist, playlist_any_notify_cb, plugin);
+	g_signal_handlers_disconnect_by_func (rena_playlist_get_model (playlist),
+	                                      playlist_row_changed_cb, plugin);
+	g_signal_handlers_disconnect_by_func (rena_playlist_get_model (playlist),
+	                                      playlist_rows_reordered_cb, plugin);
+
+	if (priv->tracklist_update_id) {
+		g_source_remove (priv->tracklist_update_id);
+		priv->tracklist_update_id = 0;
+	}
 
 	art_cache = rena_application_get_art_cache (priv->rena);
 	g_signal_handlers_disconnect_by_func (art_cache, rena_art_cache_changed_handler, plugin);
@@ -1622,4 +1874,10 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 	priv->dbus_connection = NULL;
 
 	g_free (priv->saved_title);
+
+	g_ptr_array_unref (priv->tracks);
+	g_hash_table_destroy (priv->track_metadata);
+	g_hash_table_destroy (priv->track_mobjs);
+	g_hash_table_destroy (priv->track_ids);
+	g_clear_object (&priv->current_mobj);
 }
@@ -59,6 +59,14 @@ struct _RenaMpris2PluginPrivate {
 	gboolean           saved_can_seek;
 
 	RenaBackendState state;
+
+	GHashTable        *track_ids;
+	GHashTable        *track_mobjs;
+	GHashTable        *track_metadata;
+	GPtrArray         *tracks;
+	RenaMusicobject   *current_mobj;
+	guint64            next_track_id;
+	guint              tracklist_update_id;
 };
 
 GType                 rena_mpris2_plugin_get_type           (void) G_GNUC_CONST;
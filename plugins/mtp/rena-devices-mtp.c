@@ -51,6 +51,7 @@
 #include "src/rena-hig.h"
 #include "src/rena.h"
 
+#include "rena-mtp-cache.h"
 #include "rena-mtp-musicobject.h"
 #include "rena-mtp-thread.h"
 #include "rena-mtp-thread-data.h"
@@ -346,6 +347,12 @@ rena_mtp_plugin_tracklist_loaded_idle (RenaMtpThreadTracklistData *data)
 
 	CDEBUG(DBG_PLUGIN, "Mtp plugin tracklist has %i tracks", g_list_length (list));
 
+	/* Remember the metadata read from the device for the next time */
+
+	rena_mtp_cache_update (priv->device_id,
+	                       rena_mtp_thread_tracklist_data_get_tracks (data),
+	                       rena_mtp_thread_tracklist_data_get_removed (data));
+
 	/* Save to database
 	 * TODO: Merge changes instead replace songs.
 	 */
@@ -590,6 +597,7 @@ rena_mtp_detected_ask_action_response (GtkWidget *dialog,
 			g_object_unref(G_OBJECT(taskbar));
 
 			rena_mtp_thread_get_track_list (priv->device_thread,
+			                                  rena_mtp_cache_load (priv->device_id),
 			                                  G_SOURCE_FUNC (rena_mtp_plugin_tracklist_loaded_idle),
 			                                  G_SOURCE_FUNC (rena_mtp_plugin_tracklist_progress_idle),
 			                                  plugin);
@@ -948,6 +956,8 @@ rena_plugin_activate (PeasActivatable *activatable)
 
 	priv->device_thread = rena_mtp_thread_new ();
 
+	rena_mtp_cache_init ();
+
 	/* New Task widget */
 
 	priv->cancellable = g_cancellable_new ();
@@ -0,0 +1,166 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "src/rena-database.h"
+#include "src/rena-prepared-statement.h"
+#include "src/rena-debug.h"
+
+#include "rena-mtp-cache.h"
+
+/*
+ * Track metadata of every device, keyed by its serial number and the
+ * object id, so opening a known device only asks for new or changed files.
+ * Only used from the main thread; the MTP thread receives a loaded copy.
+ */
+
+void
+rena_mtp_cache_init (void)
+{
+	RenaDatabase *database;
+
+	database = rena_database_get ();
+	rena_database_exec_query (database,
+		"CREATE TABLE IF NOT EXISTS MTP_TRACK "
+			"(device TEXT,"
+			"item_id INT,"
+			"filetype INT,"
+			"filename TEXT,"
+			"filesize INT,"
+			"mtime INT,"
+			"title TEXT,"
+			"artist TEXT,"
+			"album TEXT,"
+			"genre TEXT,"
+			"date TEXT,"
+			"tracknumber INT,"
+			"duration INT,"
+			"samplerate INT,"
+			"nochannels INT,"
+			"PRIMARY KEY (device, item_id));");
+	g_object_unref (database);
+}
+
+/*
+ * Returns the cached tracks of the device, as LIBMTP_track_t indexed by
+ * their object id.
+ */
+GHashTable *
+rena_mtp_cache_load (const gchar *device_id)
+{
+	RenaDatabase *database;
+	RenaPreparedStatement *statement;
+	LIBMTP_track_t *track;
+	GHashTable *cache;
+
+	cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                               NULL, (GDestroyNotify) LIBMTP_destroy_track_t);
+
+	database = rena_database_get ();
+	statement = rena_database_create_statement (database,
+		"SELECT item_id, filetype, filename, filesize, mtime, title, artist, album, genre, date, "
+		"tracknumber, duration, samplerate, nochannels FROM MTP_TRACK WHERE device = ?");
+	rena_prepared_statement_bind_string (statement, 1, device_id);
+	while (rena_prepared_statement_step (statement)) {
+		track = LIBMTP_new_track_t ();
+		track->item_id = rena_prepared_statement_get_int64 (statement, 0);
+		track->filetype = rena_prepared_statement_get_int (statement, 1);
+		track->filename = g_strdup (rena_prepared_statement_get_string (statement, 2));
+		track->filesize = rena_prepared_statement_get_int64 (statement, 3);
+		track->modificationdate = rena_prepared_statement_get_int64 (statement, 4);
+		track->title = g_strdup (rena_prepared_statement_get_string (statement, 5));
+		track->artist = g_strdup (rena_prepared_statement_get_string (statement, 6));
+		track->album = g_strdup (rena_prepared_statement_get_string (statement, 7));
+		track->genre = g_strdup (rena_prepared_statement_get_string (statement, 8));
+		track->date = g_strdup (rena_prepared_statement_get_string (statement, 9));
+		track->tracknumber = rena_prepared_statement_get_int (statement, 10);
+		track->duration = rena_prepared_statement_get_int (statement, 11);
+		track->samplerate = rena_prepared_statement_get_int (statement, 12);
+		track->nochannels = rena_prepared_statement_get_int (statement, 13);
+
+		g_hash_table_insert (cache, GUINT_TO_POINTER (track->item_id), track);
+	}
+	rena_prepared_statement_free (statement);
+	g_object_unref (database);
+
+	CDEBUG(DBG_PLUGIN, "Mtp cache has %u tracks of %s", g_hash_table_size (cache), device_id);
+
+	return cache;
+}
+
+/*
+ * Stores the tracks read from the device and forgets the removed ids.
+ */
+void
+rena_mtp_cache_update (const gchar *device_id, GList *tracks, GList *removed)
+{
+	RenaDatabase *database;
+	RenaPreparedStatement *statement;
+	LIBMTP_track_t *track;
+	GList *l;
+
+	if (tracks == NULL && removed == NULL)
+		return;
+
+	database = rena_database_get ();
+	rena_database_begin_transaction (database);
+
+	statement = rena_database_create_statement (database,
+		"DELETE FROM MTP_TRACK WHERE device = ? AND item_id = ?");
+	for (l = removed; l != NULL; l = l->next) {
+		rena_prepared_statement_bind_string (statement, 1, device_id);
+		rena_prepared_statement_bind_int64 (statement, 2, GPOINTER_TO_UINT (l->data));
+		rena_prepared_statement_step (statement);
+		rena_prepared_statement_reset (statement);
+	}
+	rena_prepared_statement_free (statement);
+
+	statement = rena_database_create_statement (database,
+		"INSERT OR REPLACE INTO MTP_TRACK (device, item_id, filetype, filename, filesize, mtime, "
+		"title, artist, album, genre, date, tracknumber, duration, samplerate, nochannels) "
+		"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+	for (l = tracks; l != NULL; l = l->next) {
+		track = l->data;
+		rena_prepared_statement_bind_string (statement, 1, device_id);
+		rena_prepared_statement_bind_int64 (statement, 2, track->item_id);
+		rena_prepared_statement_bind_int (statement, 3, track->filetype);
+		rena_prepared_statement_bind_string (statement, 4, track->filename);
+		rena_prepared_statement_bind_int64 (statement, 5, track->filesize);
+		rena_prepared_statement_bind_int64 (statement, 6, track->modificationdate);
+		rena_prepared_statement_bind_string (statement, 7, track->title);
+		rena_prepared_statement_bind_string (statement, 8, track->artist);
+		rena_prepared_statement_bind_string (statement, 9, track->album);
+		rena_prepared_statement_bind_string (statement, 10, track->genre);
+		rena_prepared_statement_bind_string (statement, 11, track->date);
+		rena_prepared_statement_bind_int (statement, 12, track->tracknumber);
+		rena_prepared_statement_bind_int (statement, 13, track->duration);
+		rena_prepared_statement_bind_int (statement, 14, track->samplerate);
+		rena_prepared_statement_bind_int (statement, 15, track->nochannels);
+		rena_prepared_statement_step (statement);
+		rena_prepared_statement_reset (statement);
+	}
+	rena_prepared_statement_free (statement);
+
+	rena_database_commit_transaction (database);
+	g_object_unref (database);
+
+	CDEBUG(DBG_PLUGIN, "Mtp cache of %s updated: %u tracks stored, %u removed",
+	       device_id, g_list_length (tracks), g_list_length (removed));
+}
@@ -0,0 +1,33 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#ifndef __RENA_MTP_CACHE_H__
+#define __RENA_MTP_CACHE_H__
+
+#include <libmtp.h>
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void        rena_mtp_cache_init   (void);
+GHashTable *rena_mtp_cache_load   (const gchar *device_id);
+void        rena_mtp_cache_update (const gchar *device_id, GList *tracks, GList *removed);
+
+G_END_DECLS
+
+#endif /* __RENA_MTP_CACHE_H__ */
@@ -0,0 +1,266 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "src/rena-debug.h"
+
+#include "rena-mtp-musicobject.h"
+#include "rena-mtp-device.h"
+
+/*
+ * libmtp implementation.
+ */
+
+static void
+rena_mtp_device_report_errors (LIBMTP_mtpdevice_t *mtp_device)
+{
+	LIBMTP_error_t *stack;
+
+	for (stack = LIBMTP_Get_Errorstack (mtp_device); stack != NULL; stack = stack->next) {
+		g_warning ("libmtp error: %s", stack->error_text);
+	}
+
+	LIBMTP_Clear_Errorstack (mtp_device);
+}
+
+static gboolean
+rena_mtp_device_libmtp_get_storage (gpointer device, GArray *storage_ids)
+{
+	LIBMTP_mtpdevice_t *mtp_device = device;
+	LIBMTP_devicestorage_t *storage;
+
+	if (LIBMTP_Get_Storage (mtp_device, LIBMTP_STORAGE_SORTBY_FREESPACE) != 0) {
+		rena_mtp_device_report_errors (mtp_device);
+		return FALSE;
+	}
+
+	for (storage = mtp_device->storage; storage != NULL; storage = storage->next)
+		g_array_append_val (storage_ids, storage->id);
+
+	return TRUE;
+}
+
+static gboolean
+rena_mtp_device_libmtp_list_folder (gpointer device, guint32 storage_id, guint32 leaf, LIBMTP_file_t **files)
+{
+	LIBMTP_mtpdevice_t *mtp_device = device;
+
+	*files = LIBMTP_Get_Files_And_Folders (mtp_device, storage_id, leaf);
+
+	/* libmtp also returns NULL for empty folders, so check the errors. */
+	if (*files == NULL && LIBMTP_Get_Errorstack (mtp_device) != NULL) {
+		rena_mtp_device_report_errors (mtp_device);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static LIBMTP_track_t *
+rena_mtp_device_libmtp_get_track_metadata (gpointer device, guint32 item_id)
+{
+	return LIBMTP_Get_Trackmetadata ((LIBMTP_mtpdevice_t *) device, item_id);
+}
+
+const RenaMtpDeviceOps rena_mtp_device_libmtp_ops = {
+	rena_mtp_device_libmtp_get_storage,
+	rena_mtp_device_libmtp_list_folder,
+	rena_mtp_device_libmtp_get_track_metadata
+};
+
+/*
+ * Listing with the cache.
+ */
+
+typedef struct {
+	const RenaMtpDeviceOps *ops;
+	gpointer                device;
+	const gchar            *device_id;
+	GHashTable             *cache;
+	GList                  *tracks;
+	gboolean                failed;
+	RenaMtpDeviceProgress   progress;
+	gpointer                user_data;
+} RenaMtpDeviceWalk;
+
+static GList *
+rena_mtp_device_list_folder (RenaMtpDeviceWalk *walk,
+                             guint32            storage_id,
+                             guint32            leaf,
+                             GList             *list)
+{
+	RenaMusicobject *mobj = NULL;
+	LIBMTP_file_t *folders = NULL, *lfolder = NULL, *audios = NULL, *laudio = NULL;
+	LIBMTP_file_t *files, *file, *tmp;
+	LIBMTP_track_t *track;
+	gboolean nomedia = FALSE, cached;
+
+	if (!walk->ops->list_folder (walk->device, storage_id, leaf, &files)) {
+		walk->failed = TRUE;
+		return list;
+	}
+
+	file = files;
+	while (file != NULL)
+	{
+		if (file->filetype == LIBMTP_FILETYPE_FOLDER)
+		{
+			if (folders == NULL)
+				folders = lfolder = file;
+			else {
+				lfolder->next = file;
+				lfolder = lfolder->next;
+			}
+		}
+		else if (LIBMTP_FILETYPE_IS_AUDIO(file->filetype))
+		{
+			if (audios == NULL)
+				audios = laudio = file;
+			else {
+				laudio->next = file;
+				laudio = laudio->next;
+			}
+		}
+		else {
+			if (g_ascii_strcasecmp(file->filename, ".nomedia") == 0) {
+				nomedia = TRUE;
+				break;
+			}
+		}
+		file = file->next;
+	}
+
+	if (nomedia == FALSE)
+	{
+		/* Add folders recursively */
+		file = folders;
+		while (file != NULL) {
+			list = rena_mtp_device_list_folder (walk, storage_id, file->item_id, list);
+			file = file->next;
+		}
+
+		/* Add music files, asking the device only for files not cached */
+		file = audios;
+		while (file != NULL)
+		{
+			cached = TRUE;
+			track = g_hash_table_lookup (walk->cache, GUINT_TO_POINTER(file->item_id));
+			if (track != NULL &&
+			    track->filesize == file->filesize &&
+			    track->modificationdate == file->modificationdate &&
+			    g_strcmp0 (track->filename, file->filename) == 0) {
+				g_hash_table_steal (walk->cache, GUINT_TO_POINTER(file->item_id));
+			}
+			else {
+				g_hash_table_remove (walk->cache, GUINT_TO_POINTER(file->item_id));
+				cached = FALSE;
+				track = walk->ops->get_track_metadata (walk->device, file->item_id);
+				if (G_LIKELY(track)) {
+					track->filesize = file->filesize;
+					track->modificationdate = file->modificationdate;
+					walk->tracks = g_list_prepend (walk->tracks, track);
+				}
+			}
+			if (G_LIKELY(track)) {
+				mobj = rena_musicobject_new_from_mtp_track (track);
+				if (G_LIKELY(mobj)) {
+					rena_musicobject_set_provider (mobj, walk->device_id);
+					list = g_list_prepend(list, mobj);
+				}
+				if (cached)
+					LIBMTP_destroy_track_t(track);
+			}
+			file = file->next;
+		}
+	}
+
+	/* Clean memory. */
+	file = files;
+	while (file != NULL) {
+		tmp = file;
+		file = file->next;
+		LIBMTP_destroy_file_t(tmp);
+	}
+
+	if (walk->progress)
+		walk->progress (g_list_length (list), walk->user_data);
+
+	return list;
+}
+
+/*
+ * Lists the audio files of every storage as musicobjects. Files in the
+ * cache with the same name, size and date are taken from it; the others
+ * are read from the device and returned in tracks. The cached ids not seen
+ * are returned in removed, but only when the whole device was listed, so a
+ * folder that failed to list does not forget the tracks below it.
+ */
+GList *
+rena_mtp_device_list_tracks (const RenaMtpDeviceOps *ops,
+                             gpointer                device,
+                             const gchar            *device_id,
+                             GHashTable             *cache,
+                             GList                 **tracks,
+                             GList                 **removed,
+                             RenaMtpDeviceProgress   progress,
+                             gpointer                user_data)
+{
+	RenaMtpDeviceWalk walk;
+	GArray *storage_ids;
+	GList *list = NULL;
+	guint i;
+
+	walk.ops = ops;
+	walk.device = device;
+	walk.device_id = device_id;
+	walk.cache = cache;
+	walk.tracks = NULL;
+	walk.failed = FALSE;
+	walk.progress = progress;
+	walk.user_data = user_data;
+
+	storage_ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+	if (!ops->get_storage (device, storage_ids))
+		walk.failed = TRUE;
+
+	for (i = 0; i < storage_ids->len; i++) {
+		list = rena_mtp_device_list_folder (&walk,
+		                                    g_array_index (storage_ids, guint32, i),
+		                                    LIBMTP_FILES_AND_FOLDERS_ROOT,
+		                                    list);
+	}
+	g_array_free (storage_ids, TRUE);
+
+	/* Cached tracks not found on the device anymore */
+	if (walk.failed)
+		*removed = NULL;
+	else
+		*removed = g_hash_table_get_keys (cache);
+
+	*tracks = walk.tracks;
+
+	CDEBUG(DBG_PLUGIN, "Mtp device listed %u tracks, %u read, %u removed from cache%s",
+	       g_list_length (list), g_list_length (*tracks), g_list_length (*removed),
+	       walk.failed ? " (incomplete listing)" : "");
+
+	return list;
+}
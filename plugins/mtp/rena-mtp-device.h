@@ -0,0 +1,55 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#ifndef __RENA_MTP_DEVICE_H__
+#define __RENA_MTP_DEVICE_H__
+
+#include <libmtp.h>
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The libmtp calls used to list a device, so the listing can also run
+ * against an in-process fake device.
+ */
+typedef struct {
+	/* Fills the ids of the storages. Returns FALSE on error. */
+	gboolean         (*get_storage)        (gpointer device, GArray *storage_ids);
+	/* Lists a folder into files. An empty folder is not an error. */
+	gboolean         (*list_folder)        (gpointer device, guint32 storage_id, guint32 leaf, LIBMTP_file_t **files);
+	LIBMTP_track_t  *(*get_track_metadata) (gpointer device, guint32 item_id);
+} RenaMtpDeviceOps;
+
+extern const RenaMtpDeviceOps rena_mtp_device_libmtp_ops;
+
+typedef void (*RenaMtpDeviceProgress) (guint n_tracks, gpointer user_data);
+
+GList *
+rena_mtp_device_list_tracks (const RenaMtpDeviceOps *ops,
+                             gpointer                device,
+                             const gchar            *device_id,
+                             GHashTable             *cache,
+                             GList                 **tracks,
+                             GList                 **removed,
+                             RenaMtpDeviceProgress   progress,
+                             gpointer                user_data);
+
+G_END_DECLS
+
+#endif /* __RENA_MTP_DEVICE_H__ */
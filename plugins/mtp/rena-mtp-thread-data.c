@@ -87,11 +87,15 @@ rena_mtp_thread_opened_data_get_friendly_name (RenaMtpThreadOpenedData *data)
 struct _RenaMtpThreadTracklistData {
 	gpointer user_data;
 	GList   *list;
+	GList   *tracks;
+	GList   *removed;
 };
 
 RenaMtpThreadTracklistData *
 rena_mtp_thread_tracklist_data_new (gpointer  user_data,
-                                      GList    *list)
+                                      GList    *list,
+                                      GList    *tracks,
+                                      GList    *removed)
 {
 	RenaMtpThreadTracklistData *data;
 
@@ -99,6 +103,8 @@ rena_mtp_thread_tracklist_data_new (gpointer  user_data,
 
 	data->user_data = user_data;
 	data->list = list;
+	data->tracks = tracks;
+	data->removed = removed;
 
 	return data;
 }
@@ -106,6 +112,9 @@ rena_mtp_thread_tracklist_data_new (gpointer  user_data,
 void
 rena_mtp_thread_tracklist_data_free (RenaMtpThreadTracklistData *data)
 {
+	g_list_free_full (data->tracks, (GDestroyNotify) LIBMTP_destroy_track_t);
+	g_list_free (data->removed);
+
 	g_slice_free (RenaMtpThreadTracklistData, data);
 }
 
@@ -121,6 +130,18 @@ rena_mtp_thread_tracklist_data_get_list (RenaMtpThreadTracklistData *data)
 	return data->list;
 }
 
+GList *
+rena_mtp_thread_tracklist_data_get_tracks (RenaMtpThreadTracklistData *data)
+{
+	return data->tracks;
+}
+
+GList *
+rena_mtp_thread_tracklist_data_get_removed (RenaMtpThreadTracklistData *data)
+{
+	return data->removed;
+}
+
 
 /*
  * RenaMtpThreadProgressData *
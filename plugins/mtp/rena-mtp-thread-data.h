@@ -56,7 +56,9 @@ typedef struct _RenaMtpThreadTracklistData RenaMtpThreadTracklistData;
 
 RenaMtpThreadTracklistData *
 rena_mtp_thread_tracklist_data_new (gpointer  user_data,
-                                      GList    *list);
+                                      GList    *list,
+                                      GList    *tracks,
+                                      GList    *removed);
 
 void
 rena_mtp_thread_tracklist_data_free (RenaMtpThreadTracklistData *data);
@@ -67,6 +69,12 @@ rena_mtp_thread_tracklist_data_get_user_data (RenaMtpThreadTracklistData *data);
 GList *
 rena_mtp_thread_tracklist_data_get_list (RenaMtpThreadTracklistData *data);
 
+GList *
+rena_mtp_thread_tracklist_data_get_tracks (RenaMtpThreadTracklistData *data);
+
+GList *
+rena_mtp_thread_tracklist_data_get_removed (RenaMtpThreadTracklistData *data);
+
 
 /*
  * RenaMtpThreadProgressData *
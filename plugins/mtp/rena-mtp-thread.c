@@ -30,6 +30,7 @@
 
 #include "rena-mtp-thread-data.h"
 #include "rena-mtp-musicobject.h"
+#include "rena-mtp-device.h"
 
 #include "rena-mtp-thread.h"
 
@@ -78,6 +79,8 @@ typedef struct {
 	guint                track_id;
 	gchar               *filename;
 
+	GHashTable          *cache;
+
 	gpointer             callback;
 	gpointer             progress_callback;
 	gpointer             user_data;
@@ -134,6 +137,10 @@ destroy_task (RenaMtpThreadTask *task)
 		g_object_unref(G_OBJECT(task->mobj));
 	}
 
+	if (task->cache) {
+		g_hash_table_destroy (task->cache);
+	}
+
 	g_slice_free (RenaMtpThreadTask, task);
 }
 
@@ -265,126 +272,40 @@ get_stats (RenaMtpThread *thread, RenaMtpThreadTask *task)
 	g_free (second_storage_description);
 }
 
-static GList *
-get_track_list_recursive (RenaMtpThread     *thread,
-                          RenaMtpThreadTask *task,
-                          guint                storageid,
-                          gint                 leaf,
-                          GList               *list)
+static void
+get_track_list_progress (guint n_tracks, gpointer user_data)
 {
+	RenaMtpThreadTask *task = user_data;
 	RenaMtpThreadProgressData *data;
-	RenaMusicobject *mobj = NULL;
-	LIBMTP_file_t *folders = NULL, *lfolder = NULL, *audios = NULL, *laudio = NULL;
-	LIBMTP_file_t *files, *file, *tmp;
-	gboolean nomedia = FALSE;
-
-	files = LIBMTP_Get_Files_And_Folders (thread->device,
-	                                      storageid,
-	                                      leaf);
 
-	if (!files) {
-		rena_mtp_thread_report_errors (thread);
-		return list;
-	}
-
-	file = files;
-	while (file != NULL)
-	{
-		if (file->filetype == LIBMTP_FILETYPE_FOLDER)
-		{
-			if (folders == NULL)
-				folders = lfolder = file;
-			else {
-				lfolder->next = file;
-				lfolder = lfolder->next;
-			}
-		}
-		else if (LIBMTP_FILETYPE_IS_AUDIO(file->filetype))
-		{
-			if (audios == NULL)
-				audios = laudio = file;
-			else {
-				laudio->next = file;
-				laudio = laudio->next;
-			}
-		}
-		else {
-			if (g_ascii_strcasecmp(file->filename, ".nomedia") == 0) {
-				nomedia = TRUE;
-				break;
-			}
-		}
-		file = file->next;
-	}
-
-	if (nomedia == FALSE)
-	{
-		/* Add folders recursively */
-		file = folders;
-		while (file != NULL) {
-			list = get_track_list_recursive (thread, task, storageid, file->item_id, list);
-			file = file->next;
-		}
-
-		/* Add music files */
-		file = audios;
-		while (file != NULL)
-		{
-			LIBMTP_track_t *track;
-			track = LIBMTP_Get_Trackmetadata(thread->device, file->item_id);
-			if (G_LIKELY(track)) {
-				mobj = rena_musicobject_new_from_mtp_track (track);
-				if (G_LIKELY(mobj)) {
-					rena_musicobject_set_provider (mobj, thread->device_id);
-					list = g_list_prepend(list, mobj);
-				}
-				LIBMTP_destroy_track_t(track);
-			}
-			file = file->next;
-		}
-	}
-
-	/* Clean memory. */
-	file = files;
-	while (file != NULL) {
-		tmp = file;
-		file = file->next;
-		LIBMTP_destroy_file_t(tmp);
-	}
-
-	data = rena_mtp_thread_progress_data_new (task->user_data,
-	                                            g_list_length (list),
-	                                            0);
+	data = rena_mtp_thread_progress_data_new (task->user_data, n_tracks, 0);
 	g_idle_add ((GSourceFunc) task->progress_callback, data);
-
-	return list;
 }
 
 static void
 get_track_list (RenaMtpThread *thread, RenaMtpThreadTask *task)
 {
 	RenaMtpThreadTracklistData *data;
-	GList *list = NULL;
-	LIBMTP_devicestorage_t *storage;
+	GList *list = NULL, *tracks = NULL, *removed = NULL;
 
 	CDEBUG(DBG_PLUGIN, "Mtp thread %s", G_STRFUNC);
 
-	LIBMTP_Get_Storage (thread->device, LIBMTP_STORAGE_SORTBY_FREESPACE);
-
-	for (storage = thread->device->storage; storage != NULL; storage = storage->next) {
-		list = get_track_list_recursive (thread,
-		                                 task,
-		                                 storage->id,
-		                                 LIBMTP_FILES_AND_FOLDERS_ROOT,
-		                                 list);
-	}
+	list = rena_mtp_device_list_tracks (&rena_mtp_device_libmtp_ops,
+	                                    thread->device,
+	                                    thread->device_id,
+	                                    task->cache,
+	                                    &tracks,
+	                                    &removed,
+	                                    get_track_list_progress,
+	                                    task);
 
 	if (!list) {
 		CDEBUG(DBG_PLUGIN, "Mtp plugin no tracks on the device");
 		rena_mtp_thread_report_errors (thread);
 	}
 
-	data = rena_mtp_thread_tracklist_data_new (task->user_data, list);
+	data = rena_mtp_thread_tracklist_data_new (task->user_data, list, tracks, removed);
+
 	g_idle_add ((GSourceFunc) task->callback, data);
 }
 
@@ -631,6 +552,7 @@ rena_mtp_thread_get_stats (RenaMtpThread *thread,
 
 void
 rena_mtp_thread_get_track_list (RenaMtpThread *thread,
+                                  GHashTable      *cache,
                                   GSourceFunc      finish_func,
                                   GSourceFunc      progress_func,
                                   gpointer         data)
@@ -639,6 +561,7 @@ rena_mtp_thread_get_track_list (RenaMtpThread *thread,
 
 	CDEBUG(DBG_PLUGIN, "Mtp thread %s", G_STRFUNC);
 
+	task->cache = cache;
 	task->callback = finish_func;
 	task->progress_callback = progress_func;
 	task->user_data = data;
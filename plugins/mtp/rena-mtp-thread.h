@@ -57,6 +57,7 @@ rena_mtp_thread_get_stats      (RenaMtpThread           *thread,
 
 void
 rena_mtp_thread_get_track_list (RenaMtpThread           *thread,
+                                  GHashTable                *cache,
                                   GSourceFunc                finish_func,
                                   GSourceFunc                progress_func,
                                   gpointer                   user_data);
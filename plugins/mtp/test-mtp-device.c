@@ -0,0 +1,361 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+/*
+ * Listing of a fake MTP device against the metadata cache.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "src/rena-debug.h"
+
+#include "rena-mtp-device.h"
+
+#define FAKE_STORAGE 0x10001
+
+typedef struct {
+	guint32      item_id;
+	guint32      parent_id;
+	const gchar *filename;
+	guint64      filesize;
+	gboolean     folder;
+} FakeEntry;
+
+typedef struct {
+	GArray   *entries;
+	guint32   failing_folder;
+	gboolean  failing_storage;
+	guint     metadata_calls;
+} FakeDevice;
+
+static const FakeEntry fake_entries[] = {
+	{ 1,  LIBMTP_FILES_AND_FOLDERS_ROOT, "Music",     0,    TRUE  },
+	{ 2,  1,                             "Album A",   0,    TRUE  },
+	{ 3,  1,                             "Album B",   0,    TRUE  },
+	{ 10, 2,                             "a1.mp3",    1000, FALSE },
+	{ 11, 2,                             "a2.mp3",    1100, FALSE },
+	{ 12, 3,                             "b1.mp3",    1200, FALSE },
+	{ 13, 3,                             "b2.mp3",    1300, FALSE },
+	{ 14, 3,                             "cover.jpg", 500,  FALSE },
+};
+
+static FakeDevice *
+fake_device_new (void)
+{
+	FakeDevice *device = g_new0 (FakeDevice, 1);
+
+	device->entries = g_array_new (FALSE, FALSE, sizeof (FakeEntry));
+	g_array_append_vals (device->entries, fake_entries, G_N_ELEMENTS (fake_entries));
+	device->failing_folder = 0;
+
+	return device;
+}
+
+static void
+fake_device_free (FakeDevice *device)
+{
+	g_array_free (device->entries, TRUE);
+	g_free (device);
+}
+
+static FakeEntry *
+fake_device_find (FakeDevice *device, guint32 item_id)
+{
+	guint i;
+
+	for (i = 0; i < device->entries->len; i++) {
+		if (g_array_index (device->entries, FakeEntry, i).item_id == item_id)
+			return &g_array_index (device->entries, FakeEntry, i);
+	}
+	return NULL;
+}
+
+static LIBMTP_track_t *
+fake_device_track (FakeEntry *entry)
+{
+	LIBMTP_track_t *track = LIBMTP_new_track_t ();
+
+	track->item_id = entry->item_id;
+	track->parent_id = entry->parent_id;
+	track->storage_id = FAKE_STORAGE;
+	track->filetype = LIBMTP_FILETYPE_MP3;
+	track->filename = strdup (entry->filename);
+	track->filesize = entry->filesize;
+	track->modificationdate = 1500000000;
+	track->title = g_strdup_printf ("Title of %s", entry->filename);
+	track->artist = strdup ("Artist");
+	track->album = strdup ("Album");
+	track->duration = 180000;
+
+	return track;
+}
+
+static gboolean
+fake_device_get_storage (gpointer device, GArray *storage_ids)
+{
+	FakeDevice *fake = device;
+	guint32 id = FAKE_STORAGE;
+
+	if (fake->failing_storage)
+		return FALSE;
+
+	g_array_append_val (storage_ids, id);
+	return TRUE;
+}
+
+static gboolean
+fake_device_list_folder (gpointer device, guint32 storage_id, guint32 leaf, LIBMTP_file_t **files)
+{
+	FakeDevice *fake = device;
+	LIBMTP_file_t *file, *last = NULL;
+	FakeEntry *entry;
+	guint i;
+
+	*files = NULL;
+
+	if (leaf == fake->failing_folder)
+		return FALSE;
+
+	for (i = 0; i < fake->entries->len; i++) {
+		entry = &g_array_index (fake->entries, FakeEntry, i);
+		if (entry->parent_id != leaf)
+			continue;
+
+		file = LIBMTP_new_file_t ();
+		file->item_id = entry->item_id;
+		file->parent_id = entry->parent_id;
+		file->storage_id = storage_id;
+		file->filename = strdup (entry->filename);
+		file->filesize = entry->filesize;
+		file->modificationdate = 1500000000;
+		if (entry->folder)
+			file->filetype = LIBMTP_FILETYPE_FOLDER;
+		else if (g_str_has_suffix (entry->filename, ".mp3"))
+			file->filetype = LIBMTP_FILETYPE_MP3;
+		else
+			file->filetype = LIBMTP_FILETYPE_JPEG;
+
+		if (last == NULL)
+			*files = file;
+		else
+			last->next = file;
+		last = file;
+	}
+
+	return TRUE;
+}
+
+static LIBMTP_track_t *
+fake_device_get_track_metadata (gpointer device, guint32 item_id)
+{
+	FakeDevice *fake = device;
+	FakeEntry *entry;
+
+	fake->metadata_calls++;
+
+	entry = fake_device_find (fake, item_id);
+	if (entry == NULL || entry->folder)
+		return NULL;
+
+	return fake_device_track (entry);
+}
+
+static const RenaMtpDeviceOps fake_device_ops = {
+	fake_device_get_storage,
+	fake_device_list_folder,
+	fake_device_get_track_metadata
+};
+
+/* The cache as left by a complete listing of the device. */
+
+static GHashTable *
+fake_device_cache_new (FakeDevice *device)
+{
+	GHashTable *cache;
+	FakeEntry *entry;
+	guint i;
+
+	cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                               NULL, (GDestroyNotify) LIBMTP_destroy_track_t);
+
+	for (i = 0; i < device->entries->len; i++) {
+		entry = &g_array_index (device->entries, FakeEntry, i);
+		if (!entry->folder && g_str_has_suffix (entry->filename, ".mp3"))
+			g_hash_table_insert (cache, GUINT_TO_POINTER (entry->item_id), fake_device_track (entry));
+	}
+
+	return cache;
+}
+
+typedef struct {
+	GList *list;
+	GList *tracks;
+	GList *removed;
+} FakeListing;
+
+static void
+fake_listing_run (FakeListing *listing, FakeDevice *device, GHashTable *cache)
+{
+	listing->list = rena_mtp_device_list_tracks (&fake_device_ops, device, "FAKE-SERIAL",
+	                                             cache,
+	                                             &listing->tracks, &listing->removed,
+	                                             NULL, NULL);
+	g_hash_table_destroy (cache);
+}
+
+static void
+fake_listing_clear (FakeListing *listing)
+{
+	g_list_free_full (listing->list, g_object_unref);
+	g_list_free_full (listing->tracks, (GDestroyNotify) LIBMTP_destroy_track_t);
+	g_list_free (listing->removed);
+}
+
+static GHashTable *
+fake_cache_empty (void)
+{
+	return g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                              NULL, (GDestroyNotify) LIBMTP_destroy_track_t);
+}
+
+/*
+ * Tests.
+ */
+
+static void
+test_cold_cache (void)
+{
+	FakeDevice *device = fake_device_new ();
+	FakeListing listing;
+
+	fake_listing_run (&listing, device, fake_cache_empty ());
+
+	g_assert_cmpuint (g_list_length (listing.list), ==, 4);
+	g_assert_cmpuint (g_list_length (listing.tracks), ==, 4);
+	g_assert_cmpuint (g_list_length (listing.removed), ==, 0);
+	g_assert_cmpuint (device->metadata_calls, ==, 4);
+
+	fake_listing_clear (&listing);
+	fake_device_free (device);
+}
+
+static void
+test_warm_cache (void)
+{
+	FakeDevice *device = fake_device_new ();
+	FakeListing listing;
+
+	fake_listing_run (&listing, device, fake_device_cache_new (device));
+
+	g_assert_cmpuint (g_list_length (listing.list), ==, 4);
+	g_assert_cmpuint (g_list_length (listing.tracks), ==, 0);
+	g_assert_cmpuint (g_list_length (listing.removed), ==, 0);
+	g_assert_cmpuint (device->metadata_calls, ==, 0);
+
+	fake_listing_clear (&listing);
+	fake_device_free (device);
+}
+
+static void
+test_changed_files (void)
+{
+	FakeDevice *device = fake_device_new ();
+	GHashTable *cache = fake_device_cache_new (device);
+	FakeEntry added = { 20, 3, "b3.mp3", 1400, FALSE };
+	FakeListing listing;
+	guint i;
+
+	/* a2 rewritten, b1 deleted and b3 copied since the last listing. */
+	fake_device_find (device, 11)->filesize = 2200;
+	for (i = 0; i < device->entries->len; i++) {
+		if (g_array_index (device->entries, FakeEntry, i).item_id == 12) {
+			g_array_remove_index (device->entries, i);
+			break;
+		}
+	}
+	g_array_append_val (device->entries, added);
+
+	fake_listing_run (&listing, device, cache);
+
+	g_assert_cmpuint (g_list_length (listing.list), ==, 4);
+	g_assert_cmpuint (g_list_length (listing.tracks), ==, 2);
+	g_assert_cmpuint (device->metadata_calls, ==, 2);
+	g_assert_cmpuint (g_list_length (listing.removed), ==, 1);
+	g_assert_cmpuint (GPOINTER_TO_UINT (listing.removed->data), ==, 12);
+
+	fake_listing_clear (&listing);
+	fake_device_free (device);
+}
+
+static void
+test_failing_folder (void)
+{
+	FakeDevice *device = fake_device_new ();
+	FakeListing listing;
+
+	/* The tracks of Album B are not seen, but must stay cached. */
+	device->failing_folder = 3;
+
+	fake_listing_run (&listing, device, fake_device_cache_new (device));
+
+	g_assert_cmpuint (g_list_length (listing.list), ==, 2);
+	g_assert_cmpuint (g_list_length (listing.tracks), ==, 0);
+	g_assert_cmpuint (g_list_length (listing.removed), ==, 0);
+
+	fake_listing_clear (&listing);
+	fake_device_free (device);
+}
+
+static void
+test_failing_storage (void)
+{
+	FakeDevice *device = fake_device_new ();
+	FakeListing listing;
+
+	device->failing_storage = TRUE;
+
+	fake_listing_run (&listing, device, fake_device_cache_new (device));
+
+	g_assert_cmpuint (g_list_length (listing.list), ==, 0);
+	g_assert_cmpuint (g_list_length (listing.removed), ==, 0);
+
+	fake_listing_clear (&listing);
+	fake_device_free (device);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+	debug_level = 0;
+
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/mtp/cache/cold", test_cold_cache);
+	g_test_add_func ("/mtp/cache/warm", test_warm_cache);
+	g_test_add_func ("/mtp/cache/changed", test_changed_files);
+	g_test_add_func ("/mtp/cache/failing-folder", test_failing_folder);
+	g_test_add_func ("/mtp/cache/failing-storage", test_failing_storage);
+
+	return g_test_run ();
+}
@@ -99,7 +99,7 @@ rena_block_device_add_to_library (RenaRemovablePlugin *plugin, GMount *mount)
 {
 	RenaDatabaseProvider *provider;
 	RenaScanner *scanner;
-	GSList *provider_list = NULL;
+	GSList *provider_list = NULL, *providers = NULL;
 	GFile       *mount_point;
 	gchar       *mount_path, *name;
 
@@ -121,8 +121,10 @@ rena_block_device_add_to_library (RenaRemovablePlugin *plugin, GMount *mount)
 		                         name,
 		                         "media-removable");
 
+		providers = g_slist_append (NULL, g_strdup (mount_path));
 		scanner = rena_application_get_scanner (priv->rena);
-		rena_scanner_update_library (scanner);
+		rena_scanner_update_providers (scanner, providers);
+		free_str_list (providers);
 
 		g_free (name);
 	}
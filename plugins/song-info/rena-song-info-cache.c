@@ -19,16 +19,58 @@
 
 #include <glib/gstdio.h>
 
+#include "src/rena-database.h"
+#include "src/rena-preferences.h"
 #include "src/rena-utils.h"
 #include "src/rena-musicobject-mgmt.h"
+#include "src/rena-debug.h"
+
+/*
+ * All song info is stored in a single SONG_INFO table keyed by kind and
+ * normalized artist/title. Entries older than the TTL are reported as missing
+ * so they are refreshed, and the least recently used are evicted once the
+ * size cap is exceeded.
+ */
+
+#define DEFAULT_CACHE_TTL     30                  /* Days */
+#define DEFAULT_CACHE_SIZE    (32 * 1024 * 1024)  /* Bytes */
+#define MIGRATE_BATCH_SIZE    256
+#define FLUSH_TIMEOUT         30                  /* Seconds */
+
+#define KEY_INFO_CACHE_TTL    "CacheTTL"
+#define KEY_INFO_CACHE_SIZE   "CacheSize"
+
+typedef enum {
+	INFO_CACHE_LYRICS,
+	INFO_CACHE_ARTIST_BIO,
+	INFO_CACHE_SIMILAR_SONGS
+} RenaInfoCacheKind;
 
 struct _RenaInfoCache {
 	GObject        _parent;
 
 	RenaDatabase *cdbase;
 	gchar          *cache_dir;
+
+	gint64          ttl;
+	gint64          cache_size;
+	gint64          cache_used;
+
+	GDir           *migrate_dir;
+	guint           migrate_id;
+
+	/* Access times of cache hits, kept until the next flush */
+	GHashTable     *hits;
+	guint           flush_id;
 };
 
+typedef struct {
+	RenaInfoCacheKind  kind;
+	gchar             *artist;
+	gchar             *title;
+	gint64             accessed;
+} RenaInfoCacheHit;
+
 enum {
 	SIGNAL_CACHE_CHANGED,
 	LAST_SIGNAL
@@ -38,11 +80,442 @@ static int signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE(RenaInfoCache, rena_info_cache, G_TYPE_OBJECT)
 
+static gboolean rena_info_cache_migrate_batch (gpointer user_data);
+
+/*
+ * Store.
+ */
+
+static gchar *
+rena_info_cache_normalize (const gchar *string)
+{
+	gchar *stripped, *normalized, *result;
+
+	if (string == NULL)
+		return g_strdup ("");
+
+	stripped = g_strstrip (g_strdup (string));
+	normalized = g_utf8_normalize (stripped, -1, G_NORMALIZE_ALL_COMPOSE);
+	result = normalized ? g_utf8_casefold (normalized, -1) : g_strdup (stripped);
+
+	g_free (normalized);
+	g_free (stripped);
+
+	return result;
+}
+
+static void
+rena_info_cache_init_schema (RenaInfoCache *cache)
+{
+	RenaPreparedStatement *statement;
+
+	rena_database_exec_query (cache->cdbase,
+		"CREATE TABLE IF NOT EXISTS SONG_INFO "
+			"(kind INT,"
+			"artist TEXT,"
+			"title TEXT,"
+			"provider TEXT,"
+			"data TEXT,"
+			"size INT,"
+			"saved INT,"
+			"accessed INT,"
+			"PRIMARY KEY(kind, artist, title));");
+	rena_database_exec_query (cache->cdbase,
+		"CREATE INDEX IF NOT EXISTS SONG_INFO_ACCESSED ON SONG_INFO (accessed);");
+
+	statement = rena_database_create_statement (cache->cdbase, "SELECT COALESCE(SUM(size), 0) FROM SONG_INFO");
+	if (rena_prepared_statement_step (statement))
+		cache->cache_used = rena_prepared_statement_get_int64 (statement, 0);
+	rena_prepared_statement_free (statement);
+}
+
+static void
+rena_info_cache_hit_free (RenaInfoCacheHit *hit)
+{
+	g_free (hit->artist);
+	g_free (hit->title);
+	g_slice_free (RenaInfoCacheHit, hit);
+}
+
+/*
+ * Write the pending access times. Must be called inside a transaction.
+ */
+static void
+rena_info_cache_write_hits (RenaInfoCache *cache)
+{
+	RenaPreparedStatement *statement;
+	RenaInfoCacheHit *hit;
+	GHashTableIter iter;
+
+	if (g_hash_table_size (cache->hits) == 0)
+		return;
+
+	CDEBUG(DBG_INFO, "Flushing %u song info cache hits", g_hash_table_size (cache->hits));
+
+	statement = rena_database_create_statement (cache->cdbase,
+		"UPDATE SONG_INFO SET accessed = ? WHERE kind = ? AND artist = ? AND title = ?");
+	g_hash_table_iter_init (&iter, cache->hits);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &hit)) {
+		rena_prepared_statement_bind_int64 (statement, 1, hit->accessed);
+		rena_prepared_statement_bind_int (statement, 2, hit->kind);
+		rena_prepared_statement_bind_string (statement, 3, hit->artist);
+		rena_prepared_statement_bind_string (statement, 4, hit->title);
+		rena_prepared_statement_step (statement);
+		rena_prepared_statement_reset (statement);
+	}
+	rena_prepared_statement_free (statement);
+
+	g_hash_table_remove_all (cache->hits);
+}
+
+static void
+rena_info_cache_flush (RenaInfoCache *cache)
+{
+	if (cache->flush_id) {
+		g_source_remove (cache->flush_id);
+		cache->flush_id = 0;
+	}
+
+	if (g_hash_table_size (cache->hits) == 0)
+		return;
+
+	rena_database_begin_transaction (cache->cdbase);
+	rena_info_cache_write_hits (cache);
+	rena_database_commit_transaction (cache->cdbase);
+}
+
+static gboolean
+rena_info_cache_flush_timeout (gpointer user_data)
+{
+	RenaInfoCache *cache = user_data;
+
+	cache->flush_id = 0;
+	rena_info_cache_flush (cache);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Keep the hit in memory until the next flush, instead of writing on each read.
+ */
+static void
+rena_info_cache_touch (RenaInfoCache     *cache,
+                       RenaInfoCacheKind  kind,
+                       const gchar       *nartist,
+                       const gchar       *ntitle)
+{
+	RenaInfoCacheHit *hit;
+	gchar *key;
+
+	key = g_strdup_printf ("%d\n%s\n%s", kind, nartist, ntitle);
+	hit = g_hash_table_lookup (cache->hits, key);
+	if (hit == NULL) {
+		hit = g_slice_new0 (RenaInfoCacheHit);
+		hit->kind = kind;
+		hit->artist = g_strdup (nartist);
+		hit->title = g_strdup (ntitle);
+		g_hash_table_insert (cache->hits, key, hit);
+	}
+	else {
+		g_free (key);
+	}
+	hit->accessed = g_get_real_time ();
+
+	if (!cache->flush_id)
+		cache->flush_id = g_timeout_add_seconds (FLUSH_TIMEOUT, rena_info_cache_flush_timeout, cache);
+}
+
+static gboolean
+rena_info_cache_is_expired (RenaInfoCache *cache, gint64 saved)
+{
+	if (cache->ttl <= 0)
+		return FALSE;
+
+	return (g_get_real_time () - saved) > cache->ttl;
+}
+
+static void
+rena_info_cache_evict (RenaInfoCache *cache)
+{
+	RenaPreparedStatement *statement, *delete;
+
+	if (cache->cache_size <= 0 || cache->cache_used <= cache->cache_size)
+		return;
+
+	/* Evict by the real access order. */
+	rena_info_cache_write_hits (cache);
+
+	statement = rena_database_create_statement (cache->cdbase,
+		"SELECT kind, artist, title, size FROM SONG_INFO ORDER BY accessed");
+	delete = rena_database_create_statement (cache->cdbase,
+		"DELETE FROM SONG_INFO WHERE kind = ? AND artist = ? AND title = ?");
+
+	while (cache->cache_used > cache->cache_size &&
+	       rena_prepared_statement_step (statement))
+	{
+		rena_prepared_statement_bind_int (delete, 1, rena_prepared_statement_get_int (statement, 0));
+		rena_prepared_statement_bind_string (delete, 2, rena_prepared_statement_get_string (statement, 1));
+		rena_prepared_statement_bind_string (delete, 3, rena_prepared_statement_get_string (statement, 2));
+		rena_prepared_statement_step (delete);
+		rena_prepared_statement_reset (delete);
+
+		cache->cache_used -= rena_prepared_statement_get_int64 (statement, 3);
+
+		CDEBUG(DBG_INFO, "Song info cache evicted: %s - %s",
+		       rena_prepared_statement_get_string (statement, 1),
+		       rena_prepared_statement_get_string (statement, 2));
+	}
+
+	rena_prepared_statement_free (delete);
+	rena_prepared_statement_free (statement);
+}
+
+static void
+rena_info_cache_store (RenaInfoCache     *cache,
+                       RenaInfoCacheKind  kind,
+                       const gchar       *artist,
+                       const gchar       *title,
+                       const gchar       *provider,
+                       const gchar       *data,
+                       gint64             saved)
+{
+	RenaPreparedStatement *statement;
+	gchar *nartist, *ntitle;
+	gint64 size;
+
+	nartist = rena_info_cache_normalize (artist);
+	ntitle = rena_info_cache_normalize (title);
+
+	statement = rena_database_create_statement (cache->cdbase,
+		"SELECT size FROM SONG_INFO WHERE kind = ? AND artist = ? AND title = ?");
+	rena_prepared_statement_bind_int (statement, 1, kind);
+	rena_prepared_statement_bind_string (statement, 2, nartist);
+	rena_prepared_statement_bind_string (statement, 3, ntitle);
+	if (rena_prepared_statement_step (statement))
+		cache->cache_used -= rena_prepared_statement_get_int64 (statement, 0);
+	rena_prepared_statement_free (statement);
+
+	size = strlen (nartist) + strlen (ntitle) + (provider ? strlen (provider) : 0) + strlen (data);
+
+	statement = rena_database_create_statement (cache->cdbase,
+		"INSERT OR REPLACE INTO SONG_INFO (kind, artist, title, provider, data, size, saved, accessed) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+	rena_prepared_statement_bind_int (statement, 1, kind);
+	rena_prepared_statement_bind_string (statement, 2, nartist);
+	rena_prepared_statement_bind_string (statement, 3, ntitle);
+	rena_prepared_statement_bind_string (statement, 4, provider ? provider : "");
+	rena_prepared_statement_bind_string (statement, 5, data);
+	rena_prepared_statement_bind_int64 (statement, 6, size);
+	rena_prepared_statement_bind_int64 (statement, 7, saved);
+	rena_prepared_statement_bind_int64 (statement, 8, g_get_real_time ());
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+
+	cache->cache_used += size;
+
+	g_free (nartist);
+	g_free (ntitle);
+}
+
+static gboolean
+rena_info_cache_contains (RenaInfoCache     *cache,
+                          RenaInfoCacheKind  kind,
+                          const gchar       *artist,
+                          const gchar       *title)
+{
+	RenaPreparedStatement *statement;
+	gchar *nartist, *ntitle;
+	gboolean found = FALSE;
+
+	nartist = rena_info_cache_normalize (artist);
+	ntitle = rena_info_cache_normalize (title);
+
+	statement = rena_database_create_statement (cache->cdbase,
+		"SELECT saved FROM SONG_INFO WHERE kind = ? AND artist = ? AND title = ?");
+	rena_prepared_statement_bind_int (statement, 1, kind);
+	rena_prepared_statement_bind_string (statement, 2, nartist);
+	rena_prepared_statement_bind_string (statement, 3, ntitle);
+	if (rena_prepared_statement_step (statement))
+		found = !rena_info_cache_is_expired (cache, rena_prepared_statement_get_int64 (statement, 0));
+	rena_prepared_statement_free (statement);
+
+	g_free (nartist);
+	g_free (ntitle);
+
+	return found;
+}
+
+static gchar *
+rena_info_cache_lookup (RenaInfoCache     *cache,
+                        RenaInfoCacheKind  kind,
+                        const gchar       *artist,
+                        const gchar       *title,
+                        gchar            **provider)
+{
+	RenaPreparedStatement *statement;
+	gchar *nartist, *ntitle, *data = NULL;
+
+	nartist = rena_info_cache_normalize (artist);
+	ntitle = rena_info_cache_normalize (title);
+
+	statement = rena_database_create_statement (cache->cdbase,
+		"SELECT provider, data, saved FROM SONG_INFO WHERE kind = ? AND artist = ? AND title = ?");
+	rena_prepared_statement_bind_int (statement, 1, kind);
+	rena_prepared_statement_bind_string (statement, 2, nartist);
+	rena_prepared_statement_bind_string (statement, 3, ntitle);
+	if (rena_prepared_statement_step (statement) &&
+	    !rena_info_cache_is_expired (cache, rena_prepared_statement_get_int64 (statement, 2)))
+	{
+		if (provider)
+			*provider = g_strdup (rena_prepared_statement_get_string (statement, 0));
+		data = g_strdup (rena_prepared_statement_get_string (statement, 1));
+	}
+	rena_prepared_statement_free (statement);
+
+	if (data)
+		rena_info_cache_touch (cache, kind, nartist, ntitle);
+
+	g_free (nartist);
+	g_free (ntitle);
+
+	return data;
+}
+
+/*
+ * Migration of the old per song files.
+ */
+
+static gchar *
+rena_info_cache_migrate_read_text (RenaInfoCache *cache, const gchar *ini_path)
+{
+	gchar *text_path, *text = NULL;
+
+	text_path = g_strdup_printf ("%s.txt", ini_path);
+	g_file_get_contents (text_path, &text, NULL, NULL);
+	g_unlink (text_path);
+	g_free (text_path);
+
+	return text;
+}
+
+static void
+rena_info_cache_migrate_file (RenaInfoCache *cache, const gchar *name)
+{
+	GKeyFile *key_file;
+	RenaInfoCacheKind kind = INFO_CACHE_LYRICS;
+	const gchar *group = NULL, *song_group = "Song";
+	gchar *path, *artist = NULL, *title = NULL, *provider = NULL, *data = NULL;
+	gint64 saved = 0;
+
+	path = g_build_filename (cache->cache_dir, name, NULL);
+
+	if (g_str_has_suffix (name, ".lyrics")) {
+		kind = INFO_CACHE_LYRICS;
+		group = "Lyrics";
+	}
+	else if (g_str_has_suffix (name, ".bio")) {
+		kind = INFO_CACHE_ARTIST_BIO;
+		group = "Artist-Bio";
+	}
+	else if (g_str_has_suffix (name, ".similar")) {
+		kind = INFO_CACHE_SIMILAR_SONGS;
+		group = "Similar-Songs";
+		song_group = "Songs";
+	}
+
+	if (group == NULL) {
+		/* Text files are consumed with its ini file, which may still be ahead
+		 * in the directory. Orphans are removed when the migration is done. */
+		g_free (path);
+		return;
+	}
+
+	key_file = g_key_file_new ();
+	if (g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL)) {
+		artist = g_key_file_get_string (key_file, song_group, "Artist", NULL);
+		title = g_key_file_get_string (key_file, song_group, "Title", NULL);
+		provider = g_key_file_get_string (key_file, group, "Provider", NULL);
+		saved = g_key_file_get_int64 (key_file, group, "SavedTime", NULL);
+
+		if (kind == INFO_CACHE_SIMILAR_SONGS)
+			g_file_get_contents (path, &data, NULL, NULL);
+		else
+			data = rena_info_cache_migrate_read_text (cache, path);
+
+		if (artist && data)
+			rena_info_cache_store (cache, kind, artist, title, provider, data, saved);
+	}
+	else if (kind != INFO_CACHE_SIMILAR_SONGS) {
+		g_free (rena_info_cache_migrate_read_text (cache, path));
+	}
+	g_key_file_free (key_file);
+
+	g_unlink (path);
+
+	g_free (artist);
+	g_free (title);
+	g_free (provider);
+	g_free (data);
+	g_free (path);
+}
+
+static void
+rena_info_cache_migrate_done (RenaInfoCache *cache)
+{
+	const gchar *name = NULL;
+	gchar *path;
+
+	g_dir_close (cache->migrate_dir);
+	cache->migrate_dir = NULL;
+	cache->migrate_id = 0;
+
+	/* Every ini file was consumed, so what is left are orphan text files. */
+	cache->migrate_dir = g_dir_open (cache->cache_dir, 0, NULL);
+	if (cache->migrate_dir) {
+		while ((name = g_dir_read_name (cache->migrate_dir)) != NULL) {
+			path = g_build_filename (cache->cache_dir, name, NULL);
+			g_unlink (path);
+			g_free (path);
+		}
+		g_dir_close (cache->migrate_dir);
+		cache->migrate_dir = NULL;
+	}
+
+	if (g_rmdir (cache->cache_dir) == 0)
+		CDEBUG(DBG_INFO, "Song info cache migrated from %s", cache->cache_dir);
+}
+
+static gboolean
+rena_info_cache_migrate_batch (gpointer user_data)
+{
+	RenaInfoCache *cache = user_data;
+	const gchar *name = NULL;
+	guint i = 0;
+
+	rena_database_begin_transaction (cache->cdbase);
+	while (i++ < MIGRATE_BATCH_SIZE &&
+	       (name = g_dir_read_name (cache->migrate_dir)) != NULL)
+		rena_info_cache_migrate_file (cache, name);
+	rena_info_cache_evict (cache);
+	rena_database_commit_transaction (cache->cdbase);
+
+	if (name == NULL) {
+		rena_info_cache_migrate_done (cache);
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/*
+ * RenaInfoCache.
+ */
+
 static void
 rena_info_cache_finalize (GObject *object)
 {
 	RenaInfoCache *cache = RENA_INFO_CACHE(object);
 
+	g_hash_table_destroy (cache->hits);
 	g_free (cache->cache_dir);
 
 	G_OBJECT_CLASS(rena_info_cache_parent_class)->finalize(object);
@@ -53,7 +526,14 @@ rena_info_cache_dispose (GObject *object)
 {
 	RenaInfoCache *cache = RENA_INFO_CACHE(object);
 
+	if (cache->migrate_id) {
+		g_source_remove (cache->migrate_id);
+		g_dir_close (cache->migrate_dir);
+		cache->migrate_dir = NULL;
+		cache->migrate_id = 0;
+	}
 	if (cache->cdbase) {
+		rena_info_cache_flush (cache);
 		g_object_unref (cache->cdbase);
 		cache->cdbase = NULL;
 	}
@@ -83,9 +563,33 @@ rena_info_cache_class_init (RenaInfoCacheClass *klass)
 static void
 rena_info_cache_init (RenaInfoCache *cache)
 {
+	RenaPreferences *preferences;
+	gchar *plugin_group = NULL;
+	gint ttl = 0, cache_size = 0;
+
 	cache->cache_dir = g_build_path (G_DIR_SEPARATOR_S, g_get_user_cache_dir (), "rena", "info", NULL);
-	g_mkdir_with_parents (cache->cache_dir, S_IRWXU);
 	cache->cdbase = rena_database_get ();
+	cache->hits = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                     (GDestroyNotify) rena_info_cache_hit_free);
+
+	/* Hidden preferences. Zero use defaults, and a negative value disable them. */
+	preferences = rena_preferences_get ();
+	plugin_group = rena_preferences_get_plugin_group_name (preferences, "song-info");
+	ttl = rena_preferences_get_integer (preferences, plugin_group, KEY_INFO_CACHE_TTL);
+	cache->ttl = (ttl == 0) ? DEFAULT_CACHE_TTL : ttl;
+	cache->ttl *= G_TIME_SPAN_DAY;
+	cache_size = rena_preferences_get_integer (preferences, plugin_group, KEY_INFO_CACHE_SIZE);
+	cache->cache_size = (cache_size == 0) ? DEFAULT_CACHE_SIZE : (gint64) cache_size * 1024;
+	g_free (plugin_group);
+	g_object_unref (preferences);
+
+	rena_info_cache_init_schema (cache);
+
+	cache->migrate_dir = g_dir_open (cache->cache_dir, 0, NULL);
+	if (cache->migrate_dir)
+		cache->migrate_id = g_idle_add_full (G_PRIORITY_LOW,
+		                                     rena_info_cache_migrate_batch,
+		                                     cache, NULL);
 }
 
 RenaInfoCache *
@@ -109,41 +613,10 @@ rena_info_cache_get (void)
  * Similar songs cache.
  */
 
-static gchar *
-rena_info_cache_build_similar_songs_path (RenaInfoCache *cache, const gchar *title, const gchar *artist)
-{
-	gchar *title_escaped = rena_escape_slashes (title);
-	gchar *artist_escaped = rena_escape_slashes (artist);
-	gchar *result = g_strdup_printf ("%s%s%s-%s.similar", cache->cache_dir, G_DIR_SEPARATOR_S, artist_escaped, title_escaped);
-	g_free (title_escaped);
-	g_free (artist_escaped);
-	return result;
-}
-
-static gchar *
-rena_info_cache_get_similar_songs_uri (RenaInfoCache *cache, const gchar *title, const gchar *artist)
-{
-	gchar *path = rena_info_cache_build_similar_songs_path (cache, title, artist);
-
-	if (g_file_test (path, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR) == FALSE) {
-		g_free (path);
-		return NULL;
-	}
-
-	return path;
-}
-
 gboolean
 rena_info_cache_contains_similar_songs (RenaInfoCache *cache, const gchar *title, const gchar *artist)
 {
-	gchar *path = rena_info_cache_get_similar_songs_uri (cache, title, artist);
-
-	if (path) {
-		g_free (path);
-		return TRUE;
-	}
-
-	return FALSE;
+	return rena_info_cache_contains (cache, INFO_CACHE_SIMILAR_SONGS, artist, title);
 }
 
 GList *
@@ -157,20 +630,20 @@ rena_info_cache_get_similar_songs (RenaInfoCache *cache,
 	GError *error = NULL;
 	GList *list = NULL;
 	guint length = 0, i = 0;
-	gchar *path = NULL, *key = NULL;
+	gchar *data = NULL, *key = NULL;
 	gchar *ifile = NULL, *ititle = NULL, *iartist = NULL;
 
-	path = rena_info_cache_get_similar_songs_uri(cache, title, artist);
-	if (!path)
+	data = rena_info_cache_lookup (cache, INFO_CACHE_SIMILAR_SONGS, artist, title, provider);
+	if (!data)
 		return NULL;
 
 	key_file = g_key_file_new ();
 
-	if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, &error)) {
-		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
-			g_warning ("Error loading key file: %s", error->message);
+	if (!g_key_file_load_from_data (key_file, data, -1, G_KEY_FILE_NONE, &error)) {
+		g_warning ("Error loading similar songs: %s", error->message);
 		g_error_free (error);
-		g_free (path);
+		g_key_file_free (key_file);
+		g_free (data);
 		return NULL;
 	}
 
@@ -203,10 +676,8 @@ rena_info_cache_get_similar_songs (RenaInfoCache *cache,
 		g_free (iartist);
 	}
 
-	*provider = g_key_file_get_string (key_file, "Similar-Songs", "Provider", NULL);
-
 	g_key_file_free (key_file);
-	g_free (path);
+	g_free (data);
 
 	return g_list_reverse (list);
 }
@@ -220,27 +691,17 @@ rena_info_cache_save_similar_songs (RenaInfoCache *cache,
 {
 	RenaMusicobject *mobj;
 	GKeyFile *key_file = NULL;
-	GError *error = NULL;
 	GList *list = NULL;
 	const gchar *file = NULL, *ititle = NULL, *iartist = NULL;
-	gchar *file_entry, *key = NULL;
+	gchar *data, *key = NULL;
 	guint length = 0;
-	gint64 time = 0;
 	gint i = 0;
 
 	key_file = g_key_file_new ();
 
-	g_key_file_set_string (key_file, "Songs", "Title", title);
-	g_key_file_set_string (key_file, "Songs", "Artist", artist);
-
-	time = g_get_real_time ();
-	g_key_file_set_int64 (key_file, "Similar-Songs", "SavedTime", time);
-
 	length = g_list_length (mlist);
 	g_key_file_set_integer (key_file, "Similar-Songs", "NumberOfEntries", length);
 
-	g_key_file_set_string (key_file, "Similar-Songs", "Provider", provider);
-
 	for (list = mlist; list != NULL; list = list->next) {
 		mobj = RENA_MUSICOBJECT(list->data);
 		i++;
@@ -261,11 +722,14 @@ rena_info_cache_save_similar_songs (RenaInfoCache *cache,
 		g_free (key);
 	}
 
-	file_entry = rena_info_cache_build_similar_songs_path(cache, title, artist);
-	if (!g_key_file_save_to_file (key_file, file_entry, &error))
-		g_warning ("Error saving key file: %s", error->message);
-	g_free(file_entry);
+	data = g_key_file_to_data (key_file, NULL, NULL);
+
+	rena_database_begin_transaction (cache->cdbase);
+	rena_info_cache_store (cache, INFO_CACHE_SIMILAR_SONGS, artist, title, provider, data, g_get_real_time ());
+	rena_info_cache_evict (cache);
+	rena_database_commit_transaction (cache->cdbase);
 
+	g_free (data);
 	g_key_file_free (key_file);
 }
 
@@ -273,78 +737,10 @@ rena_info_cache_save_similar_songs (RenaInfoCache *cache,
  * Lyrics cache.
  */
 
-static gchar *
-rena_info_cache_build_lyrics_path (RenaInfoCache *cache, const gchar *title, const gchar *artist)
-{
-	gchar *title_escaped = rena_escape_slashes (title);
-	gchar *artist_escaped = rena_escape_slashes (artist);
-	gchar *result = g_strdup_printf ("%s%s%s-%s.lyrics.txt", cache->cache_dir, G_DIR_SEPARATOR_S, artist_escaped, title_escaped);
-	g_free (title_escaped);
-	g_free (artist_escaped);
-	return result;
-}
-
-static gchar *
-rena_info_cache_get_lyrics_uri (RenaInfoCache *cache, const gchar *title, const gchar *artist)
-{
-	gchar *path = rena_info_cache_build_lyrics_path (cache, title, artist);
-
-	if (g_file_test (path, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR) == FALSE) {
-		g_free (path);
-		return NULL;
-	}
-
-	return path;
-}
-
 gboolean
 rena_info_cache_contains_song_lyrics (RenaInfoCache *cache, const gchar *title, const gchar *artist)
 {
-	gchar *path = rena_info_cache_get_lyrics_uri (cache, title, artist);
-
-	if (path) {
-		g_free (path);
-		return TRUE;
-	}
-
-	return FALSE;
-}
-
-static gchar *
-rena_info_cache_build_ini_lyrics_path (RenaInfoCache *cache, const gchar *title, const gchar *artist)
-{
-	gchar *title_escaped = rena_escape_slashes (title);
-	gchar *artist_escaped = rena_escape_slashes (artist);
-	gchar *result = g_strdup_printf ("%s%s%s-%s.lyrics", cache->cache_dir, G_DIR_SEPARATOR_S, artist_escaped, title_escaped);
-	g_free (title_escaped);
-	g_free (artist_escaped);
-	return result;
-}
-
-static gchar *
-rena_info_cache_get_ini_lyrics_uri (RenaInfoCache *cache, const gchar *title, const gchar *artist)
-{
-	gchar *path = rena_info_cache_build_ini_lyrics_path (cache, title, artist);
-
-	if (g_file_test (path, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR) == FALSE) {
-		g_free (path);
-		return NULL;
-	}
-
-	return path;
-}
-
-gboolean
-rena_info_cache_contains_ini_song_lyrics (RenaInfoCache *cache, const gchar *title, const gchar *artist)
-{
-	gchar *path = rena_info_cache_get_ini_lyrics_uri (cache, title, artist);
-
-	if (path) {
-		g_free (path);
-		return TRUE;
-	}
-
-	return FALSE;
+	return rena_info_cache_contains (cache, INFO_CACHE_LYRICS, artist, title);
 }
 
 gchar *
@@ -353,38 +749,7 @@ rena_info_cache_get_song_lyrics (RenaInfoCache *cache,
                                    const gchar     *artist,
                                    gchar          **provider)
 {
-	GKeyFile *key_file;
-	GError *error = NULL;
-	gchar *path = NULL, *ini_path = NULL, *lyrics = NULL;
-
-	path = rena_info_cache_get_lyrics_uri (cache, title, artist);
-	if (!path)
-		return NULL;
-
-	if (!g_file_get_contents (path, &lyrics, NULL, &error)) {
-		g_warning ("Error loading lyrics file: %s", error->message);
-		g_free (path);
-		return NULL;
-	}
-
-	ini_path = rena_info_cache_get_ini_lyrics_uri (cache, title, artist);
-	if (ini_path) {
-		key_file = g_key_file_new ();
-		if (!g_key_file_load_from_file (key_file, ini_path, G_KEY_FILE_NONE, &error)) {
-			if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
-				g_warning ("Error loading key file: %s", error->message);
-			g_error_free (error);
-		}
-		else {
-			*provider = g_key_file_get_string (key_file, "Lyrics", "Provider", NULL);
-		}
-		g_key_file_free (key_file);
-	}
-
-	g_free (path);
-	g_free (ini_path);
-
-	return lyrics;
+	return rena_info_cache_lookup (cache, INFO_CACHE_LYRICS, artist, title, provider);
 }
 
 void
@@ -394,100 +759,20 @@ rena_info_cache_save_song_lyrics (RenaInfoCache *cache,
                                     const gchar     *provider,
                                     const gchar     *lyrics)
 {
-	GKeyFile *key_file = NULL;
-	GError *error = NULL;
-	gchar *key_path = NULL, *lyrics_path = NULL;
-	gint64 time = 0;
-
-	lyrics_path = rena_info_cache_build_lyrics_path (cache, title, artist);
-	if (!g_file_set_contents (lyrics_path, lyrics, -1, &error)) {
-		g_warning ("Error saving lyrics file: %s", error->message);
-		g_free (lyrics_path);
-		return;
-	}
-
-	key_file = g_key_file_new ();
-
-	g_key_file_set_string (key_file, "Song", "Title", title);
-	g_key_file_set_string (key_file, "Song", "Artist", artist);
-
-	time = g_get_real_time ();
-	g_key_file_set_int64 (key_file, "Lyrics", "SavedTime", time);
-	g_key_file_set_string (key_file, "Lyrics", "Provider", provider);
-
-	key_path = rena_info_cache_build_ini_lyrics_path (cache, title, artist);
-	if (!g_key_file_save_to_file (key_file, key_path, &error))
-		g_warning ("Error saving key file: %s", error->message);
-	g_free (key_path);
-
-	g_key_file_free (key_file);
-	g_free (lyrics_path);
+	rena_database_begin_transaction (cache->cdbase);
+	rena_info_cache_store (cache, INFO_CACHE_LYRICS, artist, title, provider, lyrics, g_get_real_time ());
+	rena_info_cache_evict (cache);
+	rena_database_commit_transaction (cache->cdbase);
 }
 
 /*
  * Artist bio cache.
  */
 
-static gchar *
-rena_info_cache_build_artist_bio_path (RenaInfoCache *cache, const gchar *artist)
-{
-	gchar *artist_escaped = rena_escape_slashes (artist);
-	gchar *result = g_strdup_printf ("%s%s%s.bio.txt", cache->cache_dir, G_DIR_SEPARATOR_S, artist_escaped);
-	g_free (artist_escaped);
-	return result;
-}
-
-static gchar *
-rena_info_cache_get_artist_bio_uri (RenaInfoCache *cache, const gchar *artist)
-{
-	gchar *path = rena_info_cache_build_artist_bio_path (cache, artist);
-	if (g_file_test (path, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR) == FALSE) {
-		g_free (path);
-		return NULL;
-	}
-	return path;
-}
-
 gboolean
 rena_info_cache_contains_artist_bio (RenaInfoCache *cache, const gchar *artist)
 {
-	gchar *path = rena_info_cache_get_artist_bio_uri (cache, artist);
-	if (path) {
-		g_free (path);
-		return TRUE;
-	}
-	return FALSE;
-}
-
-static gchar *
-rena_info_cache_build_ini_artist_bio_path (RenaInfoCache *cache, const gchar *artist)
-{
-	gchar *artist_escaped = rena_escape_slashes (artist);
-	gchar *result = g_strdup_printf ("%s%s%s.bio", cache->cache_dir, G_DIR_SEPARATOR_S, artist_escaped);
-	g_free (artist_escaped);
-	return result;
-}
-
-static gchar *
-rena_info_cache_get_ini_artist_bio_uri (RenaInfoCache *cache, const gchar *artist)
-{
-	gchar *path = rena_info_cache_build_ini_artist_bio_path (cache, artist);
-	if (g_file_test (path, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR) == FALSE) {
-		g_free (path);
-		return NULL;
-	}
-	return path;
-}
-
-gboolean
-rena_info_cache_contains_ini_artist_bio (RenaInfoCache *cache, const gchar *artist)
-{
-	gchar *path = rena_info_cache_get_ini_artist_bio_uri (cache, artist);
-	if (path) {
-		g_free (path);
-		return TRUE;
-	}
-	return FALSE;
+	return rena_info_cache_contains (cache, INFO_CACHE_ARTIST_BIO, artist, NULL);
 }
 
 gchar *
@@ -495,39 +780,7 @@ rena_info_cache_get_artist_bio (RenaInfoCache *cache,
                                   const gchar     *artist,
                                   gchar          **provider)
 {
-	GKeyFile *key_file;
-	GError *error = NULL;
-	gchar *path = NULL, *bio = NULL;
-
-	path = rena_info_cache_get_artist_bio_uri (cache, artist);
-	if (!path)
-		return NULL;
-
-	if (!g_file_get_contents (path, &bio, NULL, &error)) {
-		g_warning ("Error loading artist bio file: %s", error->message);
-		g_free (path);
-		return NULL;
-	}
-
-	path = rena_info_cache_get_ini_artist_bio_uri (cache, artist);
-	if (path) {
-		key_file = g_key_file_new ();
-
-		if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, &error)) {
-			if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
-				g_warning ("Error loading key file: %s", error->message);
-			g_error_free (error);
-			g_free (path);
-			return NULL;
-		}
-
-		*provider = g_key_file_get_string (key_file, "Artist-Bio", "Provider", NULL);
-
-		g_key_file_free (key_file);
-		g_free (path);
-	}
-
-	return bio;
+	return rena_info_cache_lookup (cache, INFO_CACHE_ARTIST_BIO, artist, NULL, provider);
 }
 
 void
@@ -536,31 +789,8 @@ rena_info_cache_save_artist_bio (RenaInfoCache *cache,
                                    const gchar     *provider,
                                    const gchar     *bio)
 {
-	GKeyFile *key_file = NULL;
-	GError *error = NULL;
-	gchar *key_path = NULL, *bio_path = NULL;
-	gint64 time = 0;
-
-	bio_path = rena_info_cache_build_artist_bio_path (cache, artist);
-	if (!g_file_set_contents (bio_path, bio, -1, &error)) {
-		g_warning ("Error saving artist bio file: %s", error->message);
-		g_free (bio_path);
-		return;
-	}
-
-	key_file = g_key_file_new ();
-	g_key_file_set_string (key_file, "Song", "Artist", artist);
-
-	time = g_get_real_time ();
-	g_key_file_set_int64 (key_file, "Artist-Bio", "SavedTime", time);
-	g_key_file_set_string (key_file, "Artist-Bio", "Provider", provider);
-
-	key_path = rena_info_cache_build_ini_artist_bio_path (cache, artist);
-	if (!g_key_file_save_to_file (key_file, key_path, &error))
-		g_warning ("Error saving key file: %s", error->message);
-
-	g_free (key_path);
-	g_free (bio_path);
-
-	g_key_file_free (key_file);
+	rena_database_begin_transaction (cache->cdbase);
+	rena_info_cache_store (cache, INFO_CACHE_ARTIST_BIO, artist, NULL, provider, bio, g_get_real_time ());
+	rena_info_cache_evict (cache);
+	rena_database_commit_transaction (cache->cdbase);
 }
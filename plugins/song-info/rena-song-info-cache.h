@@ -84,10 +84,6 @@ gboolean
 rena_info_cache_contains_artist_bio    (RenaInfoCache *cache,
                                           const gchar     *artist);
 
-gboolean
-rena_info_cache_contains_ini_artist_bio(RenaInfoCache *cache,
-                                          const gchar     *artist);
-
 gchar *
 rena_info_cache_get_artist_bio         (RenaInfoCache *cache,
                                           const gchar     *artist,
@@ -60,6 +60,15 @@ glyr_finished_successfully (glyr_struct *glyr_info)
  * Final threads
  */
 
+static void
+glyr_struct_free (gpointer data)
+{
+	glyr_struct *glyr_info = data;
+
+	glyr_query_destroy (&glyr_info->query);
+	g_slice_free (glyr_struct, glyr_info);
+}
+
 static gboolean
 glyr_finished_thread_update (gpointer data)
 {
@@ -68,8 +77,7 @@ glyr_finished_thread_update (gpointer data)
 	if (glyr_info->head != NULL)
 		glyr_finished_successfully (glyr_info);
 
-	glyr_query_destroy (&glyr_info->query);
-	g_slice_free (glyr_struct, glyr_info);
+	glyr_struct_free (glyr_info);
 
 	return FALSE;
 }
@@ -97,6 +105,7 @@ rena_songinfo_plugin_get_album_art (RenaSongInfoPlugin *plugin,
                                       const gchar          *album)
 {
 	glyr_struct *glyr_info;
+	gchar *key;
 
 	CDEBUG(DBG_INFO, "Get album art handler");
 
@@ -112,8 +121,14 @@ rena_songinfo_plugin_get_album_art (RenaSongInfoPlugin *plugin,
 
 	glyr_info->plugin = plugin;
 
-	rena_async_launch (get_related_info_idle_func,
-	                     glyr_finished_thread_update,
-	                     glyr_info);
+	/* Skipping back and forth should not search the same art twice. */
+	key = g_strdup_printf ("song-info-album-art\x1f%s\x1f%s", artist, album);
+	rena_async_launch_task (RENA_ASYNC_PRIORITY_INTERACTIVE,
+	                        key, NULL,
+	                        get_related_info_idle_func,
+	                        glyr_finished_thread_update,
+	                        glyr_info,
+	                        glyr_struct_free);
+	g_free (key);
 }
 
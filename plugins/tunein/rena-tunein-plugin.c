@@ -45,10 +45,11 @@
 #include "src/rena-window.h"
 #include "src/rena-background-task-bar.h"
 #include "src/rena-background-task-widget.h"
-#include "src/xml_helper.h"
 
 #include "plugins/rena-plugin-macros.h"
 
+#include "rena-tunein-search.h"
+
 #define RENA_TYPE_TUNEIN_PLUGIN         (rena_tunein_plugin_get_type ())
 #define RENA_TUNEIN_PLUGIN(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), RENA_TYPE_TUNEIN_PLUGIN, RenaTuneinPlugin))
 #define RENA_TUNEIN_PLUGIN_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST((k), RENA_TYPE_TUNEIN_PLUGIN, RenaTuneinPlugin))
@@ -59,7 +60,10 @@
 struct _RenaTuneinPluginPrivate {
 	RenaApplication          *rena;
 
-	RenaBackgroundTaskWidget *task_widget;
+	RenaDatabase             *cdbase;
+	SoupSession                *session;
+	GList                      *searches;
+
 	GtkWidget                  *name_entry;
 	GtkActionGroup             *action_group_main_menu;
 	guint                       merge_id_main_menu;
@@ -71,6 +75,8 @@ RENA_PLUGIN_REGISTER (RENA_TYPE_TUNEIN_PLUGIN,
                         RenaTuneinPlugin,
                         rena_tunein_plugin)
 
+#define TUNEIN_SEARCH_URL "http://opml.radiotime.com/Search.aspx?query="
+
 /*
  * Prototypes
  */
@@ -111,118 +117,132 @@ static const gchar *main_menu_xml = "<ui>						\
 </ui>";
 
 /*
- * TuneIn Handlers
+ * One search, shown in the task bar until it finishes.
  */
-static const gchar *
-tunein_helper_get_atribute (XMLNode *xml, const gchar *atribute)
+
+typedef struct {
+	RenaTuneinPlugin         *plugin;
+	RenaBackgroundTaskWidget *task_widget;
+} RenaTuneinPluginSearch;
+
+static RenaTuneinPluginSearch *
+rena_tunein_plugin_search_new (RenaTuneinPlugin *plugin)
 {
-	XMLNode *xi;
+	RenaBackgroundTaskBar *taskbar;
+	RenaTuneinPluginSearch *search;
+
+	search = g_slice_new0 (RenaTuneinPluginSearch);
+	search->plugin = plugin;
+	search->task_widget = rena_background_task_widget_new (_("Searching radio on TuneIn"),
+	                                                         "edit-find",
+	                                                         0,
+	                                                         NULL);
+	g_object_ref (search->task_widget);
 
-	xi = xmlnode_get (xml,CCA {"outline", NULL}, atribute, NULL);
+	taskbar = rena_background_task_bar_get ();
+	rena_background_task_bar_prepend_widget (taskbar, GTK_WIDGET(search->task_widget));
+	g_object_unref(G_OBJECT(taskbar));
 
-	if (xi)
-		return xi->content;
+	plugin->priv->searches = g_list_prepend (plugin->priv->searches, search);
 
-	return NULL;
+	return search;
 }
 
 static void
-rena_tunein_plugin_get_radio_done (SoupSession *session,
-                                     SoupMessage *msg,
-                                     gpointer     user_data)
+rena_tunein_plugin_search_free (RenaTuneinPluginSearch *search)
 {
-	RenaAppNotification *notification;
-	RenaPlaylist *playlist;
 	RenaBackgroundTaskBar *taskbar;
-	RenaDatabase *cdbase;
-	RenaMusicobject *mobj = NULL;
-	XMLNode *xml = NULL, *xi;
-	const gchar *type = NULL, *name = NULL, *url = NULL;
-	gchar *uri_parsed, *name_fixed = NULL;
 
-	RenaTuneinPlugin *plugin = user_data;
-	RenaTuneinPluginPrivate *priv = plugin->priv;
+	if (search->plugin)
+		search->plugin->priv->searches = g_list_remove (search->plugin->priv->searches, search);
 
 	taskbar = rena_background_task_bar_get ();
-	rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(priv->task_widget));
+	rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(search->task_widget));
 	g_object_unref(G_OBJECT(taskbar));
+	g_object_unref (search->task_widget);
 
-	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
-		notification = rena_app_notification_new ("TuneIn", _("There was an error when searching radio on TuneIn"));
-		rena_app_notification_show (notification);
-		return;
-	}
+	g_slice_free (RenaTuneinPluginSearch, search);
+}
 
-	xml = tinycxml_parse ((gchar *)msg->response_body->data);
-	xi = xmlnode_get (xml, CCA{"opml", "body", "outline", NULL }, NULL, NULL);
-	for(;xi;xi= xi->next) {
-		type = tunein_helper_get_atribute (xi, "type");
-		if (g_ascii_strcasecmp(type, "audio") == 0)
-			break;
-	}
+/* The plugin is going away. Searches still running just finish silently. */
 
-	if (xi == NULL) {
-		notification = rena_app_notification_new ("TuneIn", _("Radio was not found"));
-		rena_app_notification_show (notification);
-		xmlnode_free(xml);
-		return;
-	}
+static void
+rena_tunein_plugin_search_detach (gpointer data)
+{
+	RenaTuneinPluginSearch *search = data;
+	search->plugin = NULL;
+}
 
-	name = tunein_helper_get_atribute (xi, "text");
-	url = tunein_helper_get_atribute (xi, "URL");
+static void
+rena_tunein_plugin_search_notify (const gchar *message)
+{
+	RenaAppNotification *notification;
 
-	if (string_is_empty(name) || string_is_empty(url)) {
-		notification = rena_app_notification_new ("TuneIn", _("There was an error when searching radio on TuneIn"));
-		rena_app_notification_show (notification);
-		xmlnode_free(xml);
-		return;
-	}
+	notification = rena_app_notification_new ("TuneIn", message);
+	rena_app_notification_show (notification);
+}
 
-	name_fixed = unescape_HTML (name);
-	uri_parsed = rena_pl_get_first_playlist_item (url);
+static void
+rena_tunein_plugin_append_station (RenaTuneinPlugin *plugin, const gchar *name, const gchar *uri)
+{
+	RenaPlaylist *playlist;
+	RenaDatabase *cdbase;
+	RenaMusicobject *mobj = NULL;
 
-	mobj = new_musicobject_from_location (uri_parsed, name_fixed);
+	RenaTuneinPluginPrivate *priv = plugin->priv;
+
+	mobj = new_musicobject_from_location (uri, name);
 
 	playlist = rena_application_get_playlist (priv->rena);
 	rena_playlist_append_single_song (playlist, mobj);
-	new_radio (playlist, uri_parsed, name_fixed);
+	new_radio (playlist, uri, name);
 
 	cdbase = rena_application_get_database (priv->rena);
 	rena_database_change_playlists_done (cdbase);
+}
 
-	xmlnode_free(xml);
+static void
+rena_tunein_plugin_search_done (RenaTuneinSearchResult  result,
+                                const gchar            *name,
+                                const gchar            *uri,
+                                gpointer                user_data)
+{
+	RenaTuneinPluginSearch *search = user_data;
+
+	if (search->plugin != NULL) {
+		switch (result) {
+			case RENA_TUNEIN_SEARCH_FOUND:
+				rena_tunein_plugin_append_station (search->plugin, name, uri);
+				break;
+			case RENA_TUNEIN_SEARCH_NOT_FOUND:
+				rena_tunein_plugin_search_notify (_("Radio was not found"));
+				break;
+			case RENA_TUNEIN_SEARCH_FAILED:
+				rena_tunein_plugin_search_notify (_("There was an error when searching radio on TuneIn"));
+				break;
+			case RENA_TUNEIN_SEARCH_CANCELLED:
+			default:
+				break;
+		}
+	}
 
-	g_free (name_fixed);
-	g_free (uri_parsed);
+	rena_tunein_plugin_search_free (search);
 }
 
 static void
 rena_tunein_plugin_get_radio (RenaTuneinPlugin *plugin, const gchar *field)
 {
-	RenaBackgroundTaskBar *taskbar;
-	SoupSession *session;
-	SoupMessage *msg;
+	RenaTuneinPluginSearch *search;
 	gchar *escaped_field = NULL, *query = NULL;
 
 	RenaTuneinPluginPrivate *priv = plugin->priv;
 
-	priv->task_widget = rena_background_task_widget_new (_("Searching radio on TuneIn"),
-	                                                       "edit-find",
-	                                                       0,
-	                                                       NULL);
-
-	taskbar = rena_background_task_bar_get ();
-	rena_background_task_bar_prepend_widget (taskbar, GTK_WIDGET(priv->task_widget));
-	g_object_unref(G_OBJECT(taskbar));
-
 	escaped_field = g_uri_escape_string (field, NULL, TRUE);
-	query = g_strdup_printf ("%s%s", "http://opml.radiotime.com/Search.aspx?query=", escaped_field);
-
-	session = soup_session_new ();
+	query = g_strdup_printf ("%s%s", TUNEIN_SEARCH_URL, escaped_field);
 
-	msg = soup_message_new ("GET", query);
-	soup_session_queue_message (session, msg,
-	                            rena_tunein_plugin_get_radio_done, plugin);
+	search = rena_tunein_plugin_search_new (plugin);
+	rena_tunein_search (priv->session, priv->cdbase, query,
+	                    rena_tunein_plugin_search_done, search);
 
 	g_free (escaped_field);
 	g_free (query);
@@ -305,6 +325,14 @@ rena_plugin_activate (PeasActivatable *activatable)
 
 	CDEBUG(DBG_PLUGIN, "TuneIn plugin %s", G_STRFUNC);
 
+	/* A single session keeps the connections alive between searches. */
+
+	priv->session = soup_session_new ();
+	priv->searches = NULL;
+
+	priv->cdbase = rena_database_get ();
+	rena_tunein_cache_init (priv->cdbase);
+
 	/* Attach main menu */
 
 	priv->action_group_main_menu = gtk_action_group_new ("RenaTuneinPlugin");
@@ -343,4 +371,16 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 	priv->merge_id_main_menu = 0;
 
 	rena_menubar_remove_action (priv->rena, "rena-plugins-placeholder", "search-tunein");
+
+	/* Forget the searches and cancel their requests */
+
+	g_list_foreach (priv->searches, (GFunc) rena_tunein_plugin_search_detach, NULL);
+	g_list_free (priv->searches);
+	priv->searches = NULL;
+
+	soup_session_abort (priv->session);
+	g_object_unref (priv->session);
+	priv->session = NULL;
+
+	g_object_unref (priv->cdbase);
 }
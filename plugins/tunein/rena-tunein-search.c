@@ -0,0 +1,399 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "rena-tunein-search.h"
+
+#include "src/rena-debug.h"
+#include "src/rena-utils.h"
+#include "src/xml_helper.h"
+
+/* Responses without Cache-Control are reused for ten minutes. */
+#define TUNEIN_CACHE_DEFAULT_AGE (10 * 60)
+
+/* Content types of the playlists that point to the stream of a station. */
+static const gchar *playlist_types[] = {
+	"audio/x-mpegurl",
+	"audio/mpegurl",
+	"audio/x-scpls",
+	"application/pls+xml",
+	"text/plain",
+	NULL
+};
+
+/*
+ * Response cache.
+ */
+
+void
+rena_tunein_cache_init (RenaDatabase *cdbase)
+{
+	RenaPreparedStatement *statement;
+
+	rena_database_exec_query (cdbase,
+		"CREATE TABLE IF NOT EXISTS TUNEIN_CACHE "
+			"(query TEXT PRIMARY KEY,"
+			"data TEXT,"
+			"expires INT);");
+
+	statement = rena_database_create_statement (cdbase,
+		"DELETE FROM TUNEIN_CACHE WHERE expires <= ?");
+	rena_prepared_statement_bind_int64 (statement, 1, g_get_real_time () / G_USEC_PER_SEC);
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+}
+
+static gchar *
+rena_tunein_cache_lookup (RenaDatabase *cdbase, const gchar *query)
+{
+	RenaPreparedStatement *statement;
+	gchar *data = NULL;
+
+	statement = rena_database_create_statement (cdbase,
+		"SELECT data FROM TUNEIN_CACHE WHERE query = ? AND expires > ?");
+	rena_prepared_statement_bind_string (statement, 1, query);
+	rena_prepared_statement_bind_int64 (statement, 2, g_get_real_time () / G_USEC_PER_SEC);
+	if (rena_prepared_statement_step (statement))
+		data = g_strdup (rena_prepared_statement_get_string (statement, 0));
+	rena_prepared_statement_free (statement);
+
+	return data;
+}
+
+static void
+rena_tunein_cache_store (RenaDatabase *cdbase, const gchar *query, const gchar *data, gint64 max_age)
+{
+	RenaPreparedStatement *statement;
+
+	if (max_age <= 0)
+		return;
+
+	statement = rena_database_create_statement (cdbase,
+		"INSERT OR REPLACE INTO TUNEIN_CACHE (query, data, expires) VALUES (?, ?, ?)");
+	rena_prepared_statement_bind_string (statement, 1, query);
+	rena_prepared_statement_bind_string (statement, 2, data);
+	rena_prepared_statement_bind_int64 (statement, 3, g_get_real_time () / G_USEC_PER_SEC + max_age);
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+}
+
+/* Seconds a response can be reused, following its Cache-Control header. */
+
+static gint64
+rena_tunein_cache_get_max_age (SoupMessage *msg)
+{
+	GHashTable *params;
+	const gchar *cache_control, *value;
+	gint64 max_age = TUNEIN_CACHE_DEFAULT_AGE;
+
+	cache_control = soup_message_headers_get_list (msg->response_headers, "Cache-Control");
+	if (cache_control == NULL)
+		return max_age;
+
+	params = soup_header_parse_param_list (cache_control);
+	if (g_hash_table_contains (params, "no-store") ||
+	    g_hash_table_contains (params, "no-cache"))
+		max_age = 0;
+	else if ((value = g_hash_table_lookup (params, "max-age")) != NULL)
+		max_age = g_ascii_strtoll (value, NULL, 10);
+	soup_header_free_param_list (params);
+
+	return max_age;
+}
+
+/*
+ * TuneIn Handlers
+ */
+static const gchar *
+tunein_helper_get_atribute (XMLNode *xml, const gchar *atribute)
+{
+	XMLNode *xi;
+
+	xi = xmlnode_get (xml,CCA {"outline", NULL}, atribute, NULL);
+
+	if (xi)
+		return xi->content;
+
+	return NULL;
+}
+
+static gboolean
+tunein_helper_is_playlist (const gchar *content_type)
+{
+	guint i;
+
+	for (i = 0; playlist_types[i] != NULL; i++) {
+		if (g_ascii_strcasecmp (content_type, playlist_types[i]) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * One search, from the query to the first station that can be played.
+ */
+
+typedef struct {
+	gchar *name;
+	gchar *url;
+} RenaTuneinStation;
+
+typedef struct {
+	SoupSession          *session;
+	RenaDatabase         *cdbase;
+	gchar                *query;
+	GPtrArray            *stations;
+	guint                 current;
+	gchar                *stream;
+	RenaTuneinSearchFunc  func;
+	gpointer              user_data;
+} RenaTuneinSearch;
+
+static void
+rena_tunein_station_free (gpointer data)
+{
+	RenaTuneinStation *station = data;
+
+	g_free (station->name);
+	g_free (station->url);
+	g_slice_free (RenaTuneinStation, station);
+}
+
+static void
+rena_tunein_search_finish (RenaTuneinSearch       *search,
+                           RenaTuneinSearchResult  result,
+                           RenaTuneinStation      *station)
+{
+	if (result == RENA_TUNEIN_SEARCH_FOUND)
+		search->func (result, station->name, search->stream, search->user_data);
+	else
+		search->func (result, NULL, NULL, search->user_data);
+
+	g_object_unref (search->session);
+	g_object_unref (search->cdbase);
+	g_ptr_array_free (search->stations, TRUE);
+	g_free (search->stream);
+	g_free (search->query);
+	g_slice_free (RenaTuneinSearch, search);
+}
+
+/* First stream listed in a M3U, PLS or plain text playlist. */
+
+static gchar *
+rena_tunein_playlist_get_stream (const gchar *data)
+{
+	gchar **lines, *line, *value, *stream = NULL;
+	guint i;
+
+	lines = g_strsplit_set (data, "\r\n", -1);
+	for (i = 0; lines[i] != NULL && stream == NULL; i++) {
+		line = g_strstrip (lines[i]);
+		if (*line == '#' || *line == '[')
+			continue;
+
+		value = line;
+		if (g_ascii_strncasecmp (line, "File", 4) == 0 && strchr (line, '=') != NULL)
+			value = strchr (line, '=') + 1;
+
+		if (strstr (value, "://") != NULL)
+			stream = g_strdup (value);
+	}
+	g_strfreev (lines);
+
+	return stream;
+}
+
+static void rena_tunein_search_resolve_next (RenaTuneinSearch *search);
+
+/* Anything but a playlist is taken as the stream itself, without reading it. */
+
+static void
+rena_tunein_station_got_headers (SoupMessage *msg, gpointer user_data)
+{
+	RenaTuneinSearch *search = user_data;
+	const gchar *content_type;
+
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code))
+		return;
+
+	content_type = soup_message_headers_get_content_type (msg->response_headers, NULL);
+	if (content_type != NULL && tunein_helper_is_playlist (content_type))
+		return;
+
+	search->stream = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
+	soup_session_cancel_message (search->session, msg, SOUP_STATUS_CANCELLED);
+}
+
+static void
+rena_tunein_station_resolve_done (SoupSession *session,
+                                  SoupMessage *msg,
+                                  gpointer     user_data)
+{
+	SoupBuffer *buffer;
+	RenaTuneinStation *station;
+	RenaTuneinSearch *search = user_data;
+
+	station = g_ptr_array_index (search->stations, search->current);
+
+	CDEBUG(DBG_PLUGIN, "TuneIn station %s resolved with status %u", station->url, msg->status_code);
+
+	if (search->stream == NULL) {
+		if (msg->status_code == SOUP_STATUS_CANCELLED) {
+			rena_tunein_search_finish (search, RENA_TUNEIN_SEARCH_CANCELLED, NULL);
+			return;
+		}
+		if (SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+			buffer = soup_message_body_flatten (msg->response_body);
+			search->stream = rena_tunein_playlist_get_stream (buffer->data);
+			soup_buffer_free (buffer);
+		}
+	}
+
+	if (search->stream != NULL) {
+		rena_tunein_search_finish (search, RENA_TUNEIN_SEARCH_FOUND, station);
+		return;
+	}
+
+	search->current++;
+	rena_tunein_search_resolve_next (search);
+}
+
+/* Only the next station in rank order is requested, once the previous failed. */
+
+static void
+rena_tunein_search_resolve_next (RenaTuneinSearch *search)
+{
+	RenaTuneinStation *station;
+	SoupMessage *msg;
+
+	if (search->current >= search->stations->len) {
+		rena_tunein_search_finish (search, RENA_TUNEIN_SEARCH_FAILED, NULL);
+		return;
+	}
+
+	station = g_ptr_array_index (search->stations, search->current);
+
+	msg = soup_message_new ("GET", station->url);
+	if (msg == NULL) {
+		search->current++;
+		rena_tunein_search_resolve_next (search);
+		return;
+	}
+
+	g_signal_connect (msg, "got-headers",
+	                  G_CALLBACK (rena_tunein_station_got_headers), search);
+	soup_session_queue_message (search->session, msg,
+	                            rena_tunein_station_resolve_done, search);
+}
+
+static void
+rena_tunein_search_parse (RenaTuneinSearch *search, const gchar *data)
+{
+	RenaTuneinStation *station;
+	XMLNode *xml = NULL, *xi;
+	const gchar *type = NULL, *name = NULL, *url = NULL;
+
+	xml = tinycxml_parse ((gchar *)data);
+	xi = xmlnode_get (xml, CCA{"opml", "body", "outline", NULL }, NULL, NULL);
+	for(;xi && search->stations->len < TUNEIN_MAX_RESOLVE; xi = xi->next) {
+		type = tunein_helper_get_atribute (xi, "type");
+		if (type == NULL || g_ascii_strcasecmp(type, "audio") != 0)
+			continue;
+
+		name = tunein_helper_get_atribute (xi, "text");
+		url = tunein_helper_get_atribute (xi, "URL");
+		if (string_is_empty(name) || string_is_empty(url))
+			continue;
+
+		station = g_slice_new0 (RenaTuneinStation);
+		station->name = unescape_HTML (name);
+		station->url = g_strdup (url);
+		g_ptr_array_add (search->stations, station);
+	}
+	xmlnode_free(xml);
+
+	if (search->stations->len == 0) {
+		rena_tunein_search_finish (search, RENA_TUNEIN_SEARCH_NOT_FOUND, NULL);
+		return;
+	}
+
+	rena_tunein_search_resolve_next (search);
+}
+
+static void
+rena_tunein_search_done (SoupSession *session,
+                         SoupMessage *msg,
+                         gpointer     user_data)
+{
+	SoupBuffer *buffer;
+	RenaTuneinSearch *search = user_data;
+
+	if (msg->status_code == SOUP_STATUS_CANCELLED) {
+		rena_tunein_search_finish (search, RENA_TUNEIN_SEARCH_CANCELLED, NULL);
+		return;
+	}
+
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+		rena_tunein_search_finish (search, RENA_TUNEIN_SEARCH_FAILED, NULL);
+		return;
+	}
+
+	buffer = soup_message_body_flatten (msg->response_body);
+	rena_tunein_cache_store (search->cdbase, search->query, buffer->data,
+	                         rena_tunein_cache_get_max_age (msg));
+	rena_tunein_search_parse (search, buffer->data);
+	soup_buffer_free (buffer);
+}
+
+/* The response to the query is read from the cache while it is fresh. */
+
+void
+rena_tunein_search (SoupSession          *session,
+                    RenaDatabase         *cdbase,
+                    const gchar          *query,
+                    RenaTuneinSearchFunc  func,
+                    gpointer              user_data)
+{
+	RenaTuneinSearch *search;
+	SoupMessage *msg;
+	gchar *data = NULL;
+
+	search = g_slice_new0 (RenaTuneinSearch);
+	search->session = g_object_ref (session);
+	search->cdbase = g_object_ref (cdbase);
+	search->query = g_strdup (query);
+	search->stations = g_ptr_array_new_with_free_func (rena_tunein_station_free);
+	search->func = func;
+	search->user_data = user_data;
+
+	data = rena_tunein_cache_lookup (cdbase, query);
+	if (data != NULL) {
+		CDEBUG(DBG_PLUGIN, "TuneIn response cached for %s", query);
+		rena_tunein_search_parse (search, data);
+		g_free (data);
+	}
+	else {
+		msg = soup_message_new ("GET", query);
+		soup_session_queue_message (session, msg,
+		                            rena_tunein_search_done, search);
+	}
+}
@@ -0,0 +1,56 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+#ifndef __RENA_TUNEIN_SEARCH_H__
+#define __RENA_TUNEIN_SEARCH_H__
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include "src/rena-database.h"
+
+G_BEGIN_DECLS
+
+/* Audio results tried, in rank order, until one stream is resolved. */
+#define TUNEIN_MAX_RESOLVE 4
+
+typedef enum {
+	RENA_TUNEIN_SEARCH_FOUND,
+	RENA_TUNEIN_SEARCH_NOT_FOUND,
+	RENA_TUNEIN_SEARCH_FAILED,
+	RENA_TUNEIN_SEARCH_CANCELLED
+} RenaTuneinSearchResult;
+
+/* Called once on the main thread. Name and uri are only set when found. */
+typedef void (*RenaTuneinSearchFunc) (RenaTuneinSearchResult  result,
+                                      const gchar            *name,
+                                      const gchar            *uri,
+                                      gpointer                user_data);
+
+void
+rena_tunein_cache_init   (RenaDatabase *cdbase);
+
+void
+rena_tunein_search       (SoupSession          *session,
+                          RenaDatabase         *cdbase,
+                          const gchar          *query,
+                          RenaTuneinSearchFunc  func,
+                          gpointer              user_data);
+
+G_END_DECLS
+
+#endif /* __RENA_TUNEIN_SEARCH_H__ */
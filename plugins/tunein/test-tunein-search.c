@@ -0,0 +1,448 @@
+/*****************************************************************************/
+/* Copyright (C) 2024 Santelmo Technologies <santelmotechnologies@gmail.com> */
+/*                                                                           */
+/* This program is free software: you can redistribute it and/or modify      */
+/* it under the terms of the GNU General Public License as published by      */
+/* the Free Software Foundation, either version 3 of the License, or         */
+/* (at your option) any later version.                                       */
+/*                                                                           */
+/* This program is distributed in the hope that it will be useful,           */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             */
+/* GNU General Public License for more details.                              */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License         */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
+/*****************************************************************************/
+
+/*
+ * Searches against a local HTTP stand-in of TuneIn, serving canned OPML and
+ * station playlists.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+
+#include "src/rena-debug.h"
+#include "src/rena-database.h"
+
+#include "rena-tunein-search.h"
+
+typedef struct {
+	const gchar *query;
+	guint        status;
+	const gchar *cache_control;
+	const gchar *opml;
+} CannedSearch;
+
+typedef struct {
+	const gchar *path;
+	guint        status;
+	const gchar *content_type;
+	const gchar *body;
+} CannedStation;
+
+#define OPML_BEGIN "<?xml version=\"1.0\" encoding=\"UTF-8\"?><opml version=\"1\">" \
+	"<head><title>Search Results</title></head><body>"
+#define OPML_END   "</body></opml>"
+#define OPML_LINK  "<outline type=\"link\" text=\"Related\" URL=\"@BASE@/tune/m3u\"/>"
+#define OPML_AUDIO(text, path) \
+	"<outline type=\"audio\" text=\"" text "\" URL=\"@BASE@" path "\"/>"
+
+static const CannedSearch canned_searches[] = {
+	{ "rank-order", SOUP_STATUS_OK, NULL,
+	  OPML_BEGIN OPML_LINK
+	  OPML_AUDIO ("Missing", "/tune/missing")
+	  OPML_AUDIO ("M3U &amp; Co", "/tune/m3u")
+	  OPML_AUDIO ("PLS", "/tune/pls")
+	  OPML_AUDIO ("Direct", "/tune/direct")
+	  OPML_END },
+	{ "pls", SOUP_STATUS_OK, NULL,
+	  OPML_BEGIN
+	  OPML_AUDIO ("Empty", "/tune/empty")
+	  OPML_AUDIO ("PLS", "/tune/pls")
+	  OPML_END },
+	{ "direct", SOUP_STATUS_OK, NULL,
+	  OPML_BEGIN
+	  OPML_AUDIO ("Direct", "/tune/direct")
+	  OPML_END },
+	{ "bound", SOUP_STATUS_OK, NULL,
+	  OPML_BEGIN
+	  OPML_AUDIO ("First", "/tune/missing1")
+	  OPML_AUDIO ("Second", "/tune/missing2")
+	  OPML_AUDIO ("Third", "/tune/missing3")
+	  OPML_AUDIO ("Fourth", "/tune/missing4")
+	  OPML_AUDIO ("Fifth", "/tune/m3u")
+	  OPML_END },
+	{ "not-found", SOUP_STATUS_OK, NULL,
+	  OPML_BEGIN OPML_LINK OPML_END },
+	{ "cached", SOUP_STATUS_OK, "max-age=600",
+	  OPML_BEGIN
+	  OPML_AUDIO ("M3U", "/tune/m3u")
+	  OPML_END },
+	{ "no-store", SOUP_STATUS_OK, "no-store",
+	  OPML_BEGIN
+	  OPML_AUDIO ("M3U", "/tune/m3u")
+	  OPML_END },
+	{ "error", SOUP_STATUS_INTERNAL_SERVER_ERROR, NULL, "" },
+};
+
+static const CannedStation canned_stations[] = {
+	{ "/tune/m3u", SOUP_STATUS_OK, "audio/x-mpegurl",
+	  "#EXTM3U\r\n#EXTINF:-1,M3U\r\n@BASE@/stream/m3u\r\n" },
+	{ "/tune/pls", SOUP_STATUS_OK, "audio/x-scpls",
+	  "[playlist]\nNumberOfEntries=1\nFile1=@BASE@/stream/pls\nTitle1=PLS\n" },
+	{ "/tune/empty", SOUP_STATUS_OK, "text/plain", "\n" },
+	{ "/tune/direct", SOUP_STATUS_OK, "audio/mpeg", "\xff\xfb\x90\x00" },
+};
+
+static SoupServer   *server = NULL;
+static SoupSession  *session = NULL;
+static RenaDatabase *cdbase = NULL;
+static GHashTable   *hits = NULL;
+static gchar        *base = NULL;
+
+static gchar *
+expand_base (const gchar *template)
+{
+	gchar **parts, *text;
+
+	parts = g_strsplit (template, "@BASE@", -1);
+	text = g_strjoinv (base, parts);
+	g_strfreev (parts);
+
+	return text;
+}
+
+static guint
+get_hits (const gchar *path)
+{
+	return GPOINTER_TO_UINT (g_hash_table_lookup (hits, path));
+}
+
+static void
+server_callback (SoupServer        *soup_server,
+                 SoupMessage       *msg,
+                 const char        *path,
+                 GHashTable        *query,
+                 SoupClientContext *client,
+                 gpointer           user_data)
+{
+	const gchar *name = NULL, *content_type = NULL, *template = NULL;
+	gchar *key, *body;
+	guint i, status = SOUP_STATUS_NOT_FOUND;
+
+	if (g_strcmp0 (path, "/search") == 0 && query != NULL) {
+		name = g_hash_table_lookup (query, "query");
+		key = g_strdup_printf ("/search?query=%s", name);
+		for (i = 0; i < G_N_ELEMENTS (canned_searches); i++) {
+			if (g_strcmp0 (name, canned_searches[i].query) != 0)
+				continue;
+			status = canned_searches[i].status;
+			content_type = "text/xml";
+			template = canned_searches[i].opml;
+			if (canned_searches[i].cache_control != NULL)
+				soup_message_headers_append (msg->response_headers, "Cache-Control",
+				                             canned_searches[i].cache_control);
+		}
+	}
+	else {
+		key = g_strdup (path);
+		for (i = 0; i < G_N_ELEMENTS (canned_stations); i++) {
+			if (g_strcmp0 (path, canned_stations[i].path) != 0)
+				continue;
+			status = canned_stations[i].status;
+			content_type = canned_stations[i].content_type;
+			template = canned_stations[i].body;
+		}
+	}
+
+	g_hash_table_insert (hits, key, GUINT_TO_POINTER (get_hits (key) + 1));
+
+	soup_message_set_status (msg, status);
+	if (template != NULL && content_type != NULL) {
+		body = expand_base (template);
+		soup_message_set_response (msg, content_type, SOUP_MEMORY_TAKE, body, strlen (body));
+	}
+}
+
+/*
+ * Run a search until it finishes.
+ */
+
+typedef struct {
+	gboolean                done;
+	RenaTuneinSearchResult  result;
+	gchar                  *name;
+	gchar                  *uri;
+} SearchReply;
+
+static void
+search_done (RenaTuneinSearchResult  result,
+             const gchar            *name,
+             const gchar            *uri,
+             gpointer                user_data)
+{
+	SearchReply *reply = user_data;
+
+	g_assert_false (reply->done);
+
+	reply->done = TRUE;
+	reply->result = result;
+	reply->name = g_strdup (name);
+	reply->uri = g_strdup (uri);
+}
+
+static void
+run_search (const gchar *name, SearchReply *reply)
+{
+	gchar *query;
+
+	query = g_strdup_printf ("%s/search?query=%s", base, name);
+
+	memset (reply, 0, sizeof (SearchReply));
+	rena_tunein_search (session, cdbase, query, search_done, reply);
+	while (!reply->done)
+		g_main_context_iteration (NULL, TRUE);
+
+	g_free (query);
+}
+
+static void
+search_reply_clear (SearchReply *reply)
+{
+	g_free (reply->name);
+	g_free (reply->uri);
+}
+
+static void
+assert_stream (SearchReply *reply, const gchar *name, const gchar *path)
+{
+	gchar *uri;
+
+	uri = g_strdup_printf ("%s%s", base, path);
+
+	g_assert_cmpint (reply->result, ==, RENA_TUNEIN_SEARCH_FOUND);
+	g_assert_cmpstr (reply->name, ==, name);
+	g_assert_cmpstr (reply->uri, ==, uri);
+
+	g_free (uri);
+}
+
+/*
+ * Tests
+ */
+
+static void
+test_rank_order (void)
+{
+	SearchReply reply;
+
+	run_search ("rank-order", &reply);
+
+	assert_stream (&reply, "M3U & Co", "/stream/m3u");
+	g_assert_cmpuint (get_hits ("/tune/missing"), ==, 1);
+	g_assert_cmpuint (get_hits ("/tune/m3u"), ==, 1);
+	g_assert_cmpuint (get_hits ("/tune/pls"), ==, 0);
+	g_assert_cmpuint (get_hits ("/tune/direct"), ==, 0);
+
+	search_reply_clear (&reply);
+}
+
+static void
+test_pls (void)
+{
+	SearchReply reply;
+
+	run_search ("pls", &reply);
+
+	assert_stream (&reply, "PLS", "/stream/pls");
+	g_assert_cmpuint (get_hits ("/tune/empty"), ==, 1);
+
+	search_reply_clear (&reply);
+}
+
+static void
+test_direct (void)
+{
+	SearchReply reply;
+
+	run_search ("direct", &reply);
+
+	assert_stream (&reply, "Direct", "/tune/direct");
+
+	search_reply_clear (&reply);
+}
+
+static void
+test_bound (void)
+{
+	SearchReply reply;
+	guint m3u_hits;
+
+	m3u_hits = get_hits ("/tune/m3u");
+
+	run_search ("bound", &reply);
+
+	g_assert_cmpint (reply.result, ==, RENA_TUNEIN_SEARCH_FAILED);
+	g_assert_null (reply.uri);
+	g_assert_cmpuint (get_hits ("/tune/missing1"), ==, 1);
+	g_assert_cmpuint (get_hits ("/tune/missing4"), ==, 1);
+	g_assert_cmpuint (get_hits ("/tune/m3u"), ==, m3u_hits);
+
+	search_reply_clear (&reply);
+}
+
+static void
+test_not_found (void)
+{
+	SearchReply reply;
+	guint m3u_hits;
+
+	m3u_hits = get_hits ("/tune/m3u");
+
+	run_search ("not-found", &reply);
+
+	g_assert_cmpint (reply.result, ==, RENA_TUNEIN_SEARCH_NOT_FOUND);
+	g_assert_cmpuint (get_hits ("/tune/m3u"), ==, m3u_hits);
+
+	search_reply_clear (&reply);
+}
+
+static void
+test_server_error (void)
+{
+	SearchReply reply;
+
+	run_search ("error", &reply);
+
+	g_assert_cmpint (reply.result, ==, RENA_TUNEIN_SEARCH_FAILED);
+
+	search_reply_clear (&reply);
+}
+
+static void
+test_cache_max_age (void)
+{
+	SearchReply reply;
+
+	run_search ("cached", &reply);
+	assert_stream (&reply, "M3U", "/stream/m3u");
+	search_reply_clear (&reply);
+
+	run_search ("cached", &reply);
+	assert_stream (&reply, "M3U", "/stream/m3u");
+	search_reply_clear (&reply);
+
+	g_assert_cmpuint (get_hits ("/search?query=cached"), ==, 1);
+}
+
+static void
+test_cache_no_store (void)
+{
+	SearchReply reply;
+
+	run_search ("no-store", &reply);
+	search_reply_clear (&reply);
+
+	run_search ("no-store", &reply);
+	assert_stream (&reply, "M3U", "/stream/m3u");
+	search_reply_clear (&reply);
+
+	g_assert_cmpuint (get_hits ("/search?query=no-store"), ==, 2);
+}
+
+static void
+start_server (void)
+{
+#if SOUP_CHECK_VERSION (2, 48, 0)
+	GSList *uris;
+	GError *error = NULL;
+
+	server = soup_server_new (NULL, NULL);
+	soup_server_listen_local (server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+	g_assert_no_error (error);
+
+	uris = soup_server_get_uris (server);
+	base = g_strdup_printf ("http://127.0.0.1:%u", soup_uri_get_port (uris->data));
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+#else
+	SoupAddress *address;
+
+	address = soup_address_new ("127.0.0.1", SOUP_ADDRESS_ANY_PORT);
+	soup_address_resolve_sync (address, NULL);
+
+	server = soup_server_new (SOUP_SERVER_INTERFACE, address, NULL);
+	g_assert_nonnull (server);
+	soup_server_run_async (server);
+	g_object_unref (address);
+
+	base = g_strdup_printf ("http://127.0.0.1:%u", soup_server_get_port (server));
+#endif
+
+	soup_server_add_handler (server, NULL, server_callback, NULL, NULL);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+	gchar *config_dir, *rena_dir, *database_file;
+	gint ret;
+
+	debug_level = 0;
+
+	g_test_init (&argc, &argv, NULL);
+
+	/* The database of the test lives in a temporary folder. */
+
+	config_dir = g_dir_make_tmp ("rena-test-tunein-XXXXXX", NULL);
+	g_assert_nonnull (config_dir);
+	g_setenv ("XDG_CONFIG_HOME", config_dir, TRUE);
+	rena_dir = g_build_filename (config_dir, "rena", NULL);
+	g_mkdir_with_parents (rena_dir, 0700);
+
+	cdbase = rena_database_get ();
+	g_assert_true (rena_database_start_successfully (cdbase));
+	rena_tunein_cache_init (cdbase);
+
+	hits = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	start_server ();
+	session = soup_session_new ();
+
+	g_test_add_func ("/tunein/search/rank-order", test_rank_order);
+	g_test_add_func ("/tunein/search/pls", test_pls);
+	g_test_add_func ("/tunein/search/direct", test_direct);
+	g_test_add_func ("/tunein/search/bound", test_bound);
+	g_test_add_func ("/tunein/search/not-found", test_not_found);
+	g_test_add_func ("/tunein/search/server-error", test_server_error);
+	g_test_add_func ("/tunein/cache/max-age", test_cache_max_age);
+	g_test_add_func ("/tunein/cache/no-store", test_cache_no_store);
+
+	ret = g_test_run ();
+
+	soup_session_abort (session);
+	g_object_unref (session);
+	soup_server_disconnect (server);
+	g_object_unref (server);
+	g_hash_table_destroy (hits);
+	g_free (base);
+
+	g_object_unref (cdbase);
+
+	database_file = g_build_filename (rena_dir, "rena.db", NULL);
+	g_unlink (database_file);
+	g_rmdir (rena_dir);
+	g_rmdir (config_dir);
+	g_free (database_file);
+	g_free (rena_dir);
+	g_free (config_dir);
+
+	return ret;
+}
@@ -25,10 +25,6 @@
 #include <gmodule.h>
 #include <math.h>
 
-#define SYNCRONIZED 1
-
-//#define DRAW_DEBUG 1
-
 #include "rena-visualizer-particle.h"
 
 const gdouble SMOOTHING = 0.5;
@@ -43,13 +39,14 @@ const gdouble SPIN_MAX = 0.010;
 const gdouble SIZE_MIN = 0.5;
 const gdouble PSIZE_MAX = 1.25;
 
-#ifdef DRAW_DEBUG
-static gint tick_i = 0;
-static gint draw_i = 0;
-static gint update_i = 0;
-#endif
+/* Particles sharing a color and an alpha step are filled in one path. */
+#define ALPHA_STEPS 8
+#define N_BUCKETS   (RENA_PARTICLE_N_COLORS * ALPHA_STEPS)
+
+/* Number of float arrays allocated in a single block. */
+#define N_FIELDS    14
 
-const gchar *COLORS[] = {
+const gchar *COLORS[RENA_PARTICLE_N_COLORS] = {
 	"#69D2E7",
 	"#1B676B",
 	"#BEF202",
@@ -63,145 +60,208 @@ const gchar *COLORS[] = {
 	"#FF006F"
 };
 
-struct _RenaParticle {
-	GObject        _parent;
-
-	gdouble         x;
-	gdouble         y;
-
-	GdkRGBA         color;
-
-	gdouble         level;
-	gdouble         scale;
-	gdouble         alpha;
-	gdouble         speed;
-	gdouble         size;
-	gdouble         spin;
-	gdouble         band;
-
-	gdouble         smoothedScale;
-	gdouble         smoothedAlpha;
-	gdouble         decayScale;
-	gdouble         decayAlpha;
-	gdouble         rotation;
-	gdouble         energy;
-};
-
-G_DEFINE_TYPE(RenaParticle, rena_particle, G_TYPE_OBJECT)
-
-void
-rena_particle_reset (RenaParticle *particle)
+static void
+rena_particles_reset (RenaParticles *particles, guint i)
 {
-	particle->x = 0;
-	particle->y = 0;
+	particles->x[i] = 0;
+	particles->y[i] = 0;
 
-	particle->level = 1.0 + floor(g_random_double_range (0, 4));
-	particle->scale = g_random_double_range (SCALE_MIN, SCALE_MAX);
-	particle->alpha = g_random_double_range (ALPHA_MIN, ALPHA_MAX);
-	particle->speed = g_random_double_range (SPEED_MIN, SPEED_MAX);
-	gdk_rgba_parse (&particle->color, COLORS[g_random_int_range (0, G_N_ELEMENTS(COLORS))]);
+	particles->level[i] = 1.0 + floor(g_random_double_range (0, 4));
+	particles->scale[i] = g_random_double_range (SCALE_MIN, SCALE_MAX);
+	particles->alpha[i] = g_random_double_range (ALPHA_MIN, ALPHA_MAX);
+	particles->speed[i] = g_random_double_range (SPEED_MIN, SPEED_MAX);
+	particles->color[i] = g_random_int_range (0, RENA_PARTICLE_N_COLORS);
 
-	particle->size = g_random_double_range (SIZE_MIN, PSIZE_MAX);
-	particle->spin = g_random_double_range (SPIN_MIN, SPIN_MAX);
+	particles->size[i] = g_random_double_range (SIZE_MIN, PSIZE_MAX);
+	particles->spin[i] = g_random_double_range (SPIN_MIN, SPIN_MAX);
 
 	if (g_random_double_range (0.0, 1.0) < 0.5)
-		particle->spin *=-1.0;
-
-	particle->smoothedScale = 0.0;
-	particle->smoothedAlpha = 0.0;
-	particle->decayScale = 0.0;
-	particle->decayAlpha = 0.0;
-	particle->rotation = g_random_double_range (0.0, 2*G_PI);
-	particle->energy = 0.0;
+		particles->spin[i] *= -1.0;
+
+	particles->smoothed_scale[i] = 0.0;
+	particles->smoothed_alpha[i] = 0.0;
+	particles->decay_scale[i] = 0.0;
+	particles->decay_alpha[i] = 0.0;
+	particles->rotation[i] = g_random_double_range (0.0, 2*G_PI);
+	particles->energy[i] = 0.0;
 }
 
 void
-rena_particle_move_to (RenaParticle *particle, gint x, gint y)
+rena_particles_scatter (RenaParticles *particles, guint width, guint height)
 {
-	particle->x = x;
-	particle->y = y;
+	guint i;
+
+	for (i = 0 ; i < particles->n_particles ; i++) {
+		rena_particles_reset (particles, i);
+		particles->x[i] = g_random_int_range (1, MAX (width, 2));
+		particles->y[i] = g_random_int_range (1, MAX (height, 2));
+	}
 }
 
-void
-rena_particle_move (RenaParticle *particle, guint width, guint height)
+/*
+ * Advance the animation by a number of frames of the original 75 ms period
+ * the constants were tuned for. Returns FALSE once nothing is left to show.
+ */
+gboolean
+rena_particles_step (RenaParticles *particles, gdouble frames, guint width, guint height)
 {
-	particle->rotation += particle->spin;
-	particle->y -= particle->speed * particle->level;
+	gfloat scale, alpha, extent;
+	gboolean active = FALSE;
+	guint i;
+
+	const gfloat smoothing = 1.0 - pow (0.7, frames);
+	const gfloat decay_scale = pow (0.985, frames);
+	const gfloat decay_alpha = pow (0.975, frames);
+
+	for (i = 0 ; i < particles->n_particles ; i++) {
+		particles->rotation[i] += particles->spin[i] * frames;
+		particles->y[i] -= particles->speed[i] * particles->level[i] * frames;
+
+		extent = particles->size[i] * particles->level[i] * particles->scale[i] * 2;
+		if (particles->y[i] < -extent) {
+			gfloat energy = particles->energy[i];
+			rena_particles_reset (particles, i);
+			particles->energy[i] = energy;
+
+			particles->x[i] = g_random_int_range (0, MAX (width, 1));
+			particles->y[i] = height + (particles->size[i] * particles->scale[i] * particles->level[i] * 2);
+		}
+
+		scale = particles->scale[i] * expf (particles->energy[i]);
+		alpha = particles->alpha[i] * particles->energy[i] * 2;
 
-	if (particle->y < (-particle->size * particle->level * particle->scale * 2))
-	{
-		rena_particle_reset(particle);
+		particles->decay_scale[i] = MAX (particles->decay_scale[i], scale);
+		particles->decay_alpha[i] = MAX (particles->decay_alpha[i], alpha);
 
-		particle->x = g_random_int_range (0, width);
-		particle->y = height + (particle->size * particle->scale * particle->level * 2);
+		particles->smoothed_scale[i] += (particles->decay_scale[i] - particles->smoothed_scale[i]) * smoothing;
+		particles->smoothed_alpha[i] += (particles->decay_alpha[i] - particles->smoothed_alpha[i]) * smoothing;
+
+		particles->decay_scale[i] *= decay_scale;
+		particles->decay_alpha[i] *= decay_alpha;
+
+		if (particles->energy[i] > 0.0 ||
+		    particles->smoothed_alpha[i] / particles->level[i] >= 1.0 / 255)
+			active = TRUE;
 	}
-}
 
-void
-rena_particle_set_energy (RenaParticle *particle, gdouble energy)
-{
-	particle->energy = energy;
+	return active;
 }
 
-void
-rena_particle_draw (RenaParticle *particle, cairo_t *cr)
+static guint
+rena_particles_bucket (RenaParticles *particles, guint i)
 {
-	GdkRGBA *color;
-	const gdouble power = exp (particle->energy);
-	const gdouble scale = particle->scale * power;
-	const gdouble alpha = particle->alpha * particle->energy * 2;
+	gfloat alpha = particles->smoothed_alpha[i] / particles->level[i];
+	guint step;
 
-	particle->decayScale = MAX (particle->decayScale, scale);
-	particle->decayAlpha = MAX (particle->decayAlpha, alpha);
+	if (alpha < 1.0 / 255)
+		return N_BUCKETS;
 
-	particle->smoothedScale += (particle->decayScale - particle->smoothedScale) * 0.3;
-	particle->smoothedAlpha += (particle->decayAlpha - particle->smoothedAlpha) * 0.3;
+	step = MIN ((guint) (alpha * ALPHA_STEPS), ALPHA_STEPS - 1);
 
-	particle->decayScale *= 0.985;
-	particle->decayAlpha *= 0.975;
+	return particles->color[i] * ALPHA_STEPS + step;
+}
 
-	color = gdk_rgba_copy (&particle->color);
-	color->alpha = particle->smoothedAlpha / particle->level;
+/*
+ * Each particle is a rounded segment. Instead of stroking every one under
+ * its own transformation, the outlines are computed here and the particles
+ * are sorted by color and alpha, so each group is filled as a single path.
+ */
+void
+rena_particles_draw (RenaParticles *particles, cairo_t *cr)
+{
+	guint counts[N_BUCKETS + 1] = { 0 };
+	guint starts[N_BUCKETS + 1];
+	gfloat s, half, dx, dy, cx, cy, rot;
+	guint i, j, bucket, first;
+	GdkRGBA *color;
 
-	cairo_save (cr);
+	for (i = 0 ; i < particles->n_particles ; i++)
+		counts[rena_particles_bucket (particles, i)]++;
 
-	cairo_translate (cr, particle->x + cos(particle->rotation * particle->speed) * 250, particle->y);
-	cairo_rotate (cr, particle->rotation);
-	cairo_scale (cr, particle->smoothedScale * particle->level, particle->smoothedScale * particle->level);
+	for (bucket = 0, first = 0 ; bucket <= N_BUCKETS ; bucket++) {
+		starts[bucket] = first;
+		first += counts[bucket];
+	}
 
-	cairo_rectangle (cr, -1.5, -0.5, 3.0, 1.0);
-	cairo_clip (cr);
+	for (i = 0 ; i < particles->n_particles ; i++)
+		particles->order[starts[rena_particles_bucket (particles, i)]++] = i;
 
-	cairo_move_to (cr, particle->size * 0.5, 0.0);
-	cairo_line_to (cr, particle->size * -0.5, 0.0);
+	for (bucket = 0, first = 0 ; bucket < N_BUCKETS ; first += counts[bucket], bucket++) {
+		if (counts[bucket] == 0)
+			continue;
 
-	cairo_set_line_width (cr, 1.0);
-	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-	gdk_cairo_set_source_rgba (cr, color);
-	cairo_stroke (cr);
+		color = &particles->colors[bucket / ALPHA_STEPS];
+		cairo_set_source_rgba (cr, color->red, color->green, color->blue,
+		                       (bucket % ALPHA_STEPS + 0.5) / ALPHA_STEPS);
 
-	cairo_reset_clip(cr);
+		for (j = first ; j < first + counts[bucket] ; j++) {
+			i = particles->order[j];
 
-	cairo_restore (cr);
+			s = particles->smoothed_scale[i] * particles->level[i];
+			half = particles->size[i] * 0.5 * s;
+			rot = particles->rotation[i];
+			dx = cosf (rot) * half;
+			dy = sinf (rot) * half;
+			cx = particles->x[i] + cosf (rot * particles->speed[i]) * 250;
+			cy = particles->y[i];
 
-	gdk_rgba_free (color);
-}
+			cairo_new_sub_path (cr);
+			cairo_arc (cr, cx - dx, cy - dy, s * 0.5, rot + G_PI_2, rot + 3 * G_PI_2);
+			cairo_arc (cr, cx + dx, cy + dy, s * 0.5, rot - G_PI_2, rot + G_PI_2);
+			cairo_close_path (cr);
+		}
 
-static void
-rena_particle_class_init (RenaParticleClass *klass)
-{
+		cairo_fill (cr);
+	}
 }
 
-static void
-rena_particle_init (RenaParticle *particle)
+RenaParticles *
+rena_particles_new (guint n_particles)
 {
-	rena_particle_reset (particle);
+	RenaParticles *particles;
+	gfloat **fields[N_FIELDS];
+	gfloat *block;
+	guint i;
+
+	particles = g_slice_new0 (RenaParticles);
+	particles->n_particles = n_particles;
+
+	fields[0] = &particles->x;
+	fields[1] = &particles->y;
+	fields[2] = &particles->level;
+	fields[3] = &particles->scale;
+	fields[4] = &particles->alpha;
+	fields[5] = &particles->speed;
+	fields[6] = &particles->size;
+	fields[7] = &particles->spin;
+	fields[8] = &particles->rotation;
+	fields[9] = &particles->energy;
+	fields[10] = &particles->smoothed_scale;
+	fields[11] = &particles->smoothed_alpha;
+	fields[12] = &particles->decay_scale;
+	fields[13] = &particles->decay_alpha;
+
+	block = g_new0 (gfloat, N_FIELDS * n_particles);
+	for (i = 0 ; i < N_FIELDS ; i++)
+		*fields[i] = block + i * n_particles;
+
+	particles->color = g_new0 (guint8, n_particles);
+	particles->order = g_new0 (guint16, n_particles);
+
+	for (i = 0 ; i < RENA_PARTICLE_N_COLORS ; i++)
+		gdk_rgba_parse (&particles->colors[i], COLORS[i]);
+
+	for (i = 0 ; i < n_particles ; i++)
+		rena_particles_reset (particles, i);
+
+	return particles;
 }
 
-RenaParticle *
-rena_particle_new (void)
+void
+rena_particles_free (RenaParticles *particles)
 {
-	RenaParticle *particle = g_object_new (RENA_TYPE_PARTICLE, NULL);
-	return particle;
+	g_free (particles->x);
+	g_free (particles->color);
+	g_free (particles->order);
+	g_slice_free (RenaParticles, particles);
 }
-
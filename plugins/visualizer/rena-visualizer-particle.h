@@ -25,39 +25,54 @@
 
 G_BEGIN_DECLS
 
-#define RENA_TYPE_PARTICLE (rena_particle_get_type())
-#define RENA_PARTICLE(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), RENA_TYPE_PARTICLE, RenaParticle))
-#define RENA_PARTICLE_CONST(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), RENA_TYPE_PARTICLE, RenaParticle const))
-#define RENA_PARTICLE_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST ((klass), RENA_TYPE_PARTICLE, RenaParticleClass))
-#define RENA_IS_PARTICLE(obj) (G_TYPE_CHECK_INSTANCE_TYPE ((obj), RENA_TYPE_PARTICLE))
-#define RENA_IS_PARTICLE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), RENA_TYPE_PARTICLE))
-#define RENA_PARTICLE_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), RENA_TYPE_PARTICLE, RenaParticleClass))
-
-typedef struct _RenaParticle RenaParticle;
-typedef struct _RenaParticleClass RenaParticleClass;
-
-struct _RenaParticleClass
-{
-	GObjectClass parent_class;
+#define RENA_PARTICLE_N_COLORS 11
+
+/*
+ * Particles are kept as a structure of arrays, indexed by particle, so each
+ * animation step walks contiguous buffers.
+ */
+
+typedef struct _RenaParticles RenaParticles;
+
+struct _RenaParticles {
+	guint           n_particles;
+
+	gfloat         *x;
+	gfloat         *y;
+	gfloat         *level;
+	gfloat         *scale;
+	gfloat         *alpha;
+	gfloat         *speed;
+	gfloat         *size;
+	gfloat         *spin;
+	gfloat         *rotation;
+	gfloat         *energy;
+
+	gfloat         *smoothed_scale;
+	gfloat         *smoothed_alpha;
+	gfloat         *decay_scale;
+	gfloat         *decay_alpha;
+
+	guint8         *color;
+	guint16        *order;
+
+	GdkRGBA         colors[RENA_PARTICLE_N_COLORS];
 };
 
-void
-rena_particle_reset (RenaParticle *particle);
+RenaParticles *
+rena_particles_new (guint n_particles);
 
 void
-rena_particle_move_to (RenaParticle *particle, gint x, gint y);
+rena_particles_free (RenaParticles *particles);
 
 void
-rena_particle_move (RenaParticle *particle, guint width, guint height);
+rena_particles_scatter (RenaParticles *particles, guint width, guint height);
 
-void
-rena_particle_set_energy (RenaParticle *particle, gdouble energy);
+gboolean
+rena_particles_step (RenaParticles *particles, gdouble frames, guint width, guint height);
 
 void
-rena_particle_draw (RenaParticle *particle, cairo_t *cr);
-
-RenaParticle *
-rena_particle_new (void);
+rena_particles_draw (RenaParticles *particles, cairo_t *cr);
 
 G_END_DECLS
 
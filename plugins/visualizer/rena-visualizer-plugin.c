@@ -112,14 +112,52 @@ rena_gmenu_visualizer (GSimpleAction *action,
  *  Visualizer plugin.
  */
 static void
-rena_visualizer_plugin_update_spectrum (RenaBackend *backend, gpointer value, gpointer user_data)
+rena_visualizer_plugin_update_spectrum (RenaBackend *backend, guint n_bands, const gfloat *magnitudes, gpointer user_data)
 {
-	GValue *magnitudes = value;
-
 	RenaVisualizerPlugin *plugin = user_data;
 	RenaVisualizerPluginPrivate *priv = plugin->priv;
 
-	rena_visualizer_set_magnitudes (priv->visualizer, magnitudes);
+	rena_visualizer_set_magnitudes (priv->visualizer, n_bands, magnitudes);
+}
+
+/*
+ * Only analyze the spectrum while the visualizer is on screen.
+ */
+static void
+rena_visualizer_plugin_set_spectrum_enabled (RenaVisualizerPlugin *plugin, gboolean enabled)
+{
+	RenaBackend *backend;
+
+	RenaVisualizerPluginPrivate *priv = plugin->priv;
+
+	if (priv->spectrum_enabled == enabled)
+		return;
+
+	backend = rena_application_get_backend (priv->rena);
+	if (enabled) {
+		rena_backend_enable_spectrum (backend, RENA_VISUALIZER_BANDS, RENA_VISUALIZER_INTERVAL_MS);
+		g_signal_connect (backend, "spectrum",
+		                  G_CALLBACK(rena_visualizer_plugin_update_spectrum), plugin);
+	}
+	else {
+		g_signal_handlers_disconnect_by_func (backend,
+		                                      rena_visualizer_plugin_update_spectrum, plugin);
+		rena_backend_disable_spectrum (backend);
+	}
+
+	priv->spectrum_enabled = enabled;
+}
+
+static void
+rena_visualizer_plugin_map (GtkWidget *widget, RenaVisualizerPlugin *plugin)
+{
+	rena_visualizer_plugin_set_spectrum_enabled (plugin, TRUE);
+}
+
+static void
+rena_visualizer_plugin_unmap (GtkWidget *widget, RenaVisualizerPlugin *plugin)
+{
+	rena_visualizer_plugin_set_spectrum_enabled (plugin, FALSE);
 }
 
 static void
@@ -180,7 +218,6 @@ rena_visualizer_plugin_remove_menues (RenaVisualizerPlugin *plugin)
 static void
 rena_plugin_activate (PeasActivatable *activatable)
 {
-	RenaBackend *backend;
 	GtkWidget *main_stack;
 
 	RenaVisualizerPlugin *plugin = RENA_VISUALIZER_PLUGIN (activatable);
@@ -197,10 +234,10 @@ rena_plugin_activate (PeasActivatable *activatable)
 	rena_visualizer_plugin_append_menues (plugin);
 
 	/* Connect signals */
-	backend = rena_application_get_backend (priv->rena);
-	rena_backend_enable_spectrum (backend);
-	g_signal_connect (backend, "spectrum",
-	                 G_CALLBACK(rena_visualizer_plugin_update_spectrum), plugin);
+	g_signal_connect (priv->visualizer, "map",
+	                  G_CALLBACK(rena_visualizer_plugin_map), plugin);
+	g_signal_connect (priv->visualizer, "unmap",
+	                  G_CALLBACK(rena_visualizer_plugin_unmap), plugin);
 
 	gtk_widget_show_all (GTK_WIDGET(priv->visualizer));
 }
@@ -208,7 +245,6 @@ rena_plugin_activate (PeasActivatable *activatable)
 static void
 rena_plugin_deactivate (PeasActivatable *activatable)
 {
-	RenaBackend *backend;
 	GtkWidget *main_stack;
 
 	RenaVisualizerPlugin *plugin = RENA_VISUALIZER_PLUGIN (activatable);
@@ -219,10 +255,11 @@ rena_plugin_deactivate (PeasActivatable *activatable)
 	CDEBUG(DBG_PLUGIN, "Visualizer plugin %s", G_STRFUNC);
 
 	/* Disconnect signals */
-	backend = rena_application_get_backend (priv->rena);
-	rena_backend_disable_spectrum (backend);
-	g_signal_handlers_disconnect_by_func (backend,
-	                                      rena_visualizer_plugin_update_spectrum, plugin);
+	g_signal_handlers_disconnect_by_func (priv->visualizer,
+	                                      rena_visualizer_plugin_map, plugin);
+	g_signal_handlers_disconnect_by_func (priv->visualizer,
+	                                      rena_visualizer_plugin_unmap, plugin);
+	rena_visualizer_plugin_set_spectrum_enabled (plugin, FALSE);
 
 	rena_visualizer_plugin_remove_menues (plugin);
 
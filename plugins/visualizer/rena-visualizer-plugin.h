@@ -45,6 +45,8 @@ struct _RenaVisualizerPluginPrivate {
 	GtkActionGroup    *action_group_main_menu;
 	guint              merge_id_main_menu;
   GSimpleAction     *gear_action;
+
+	gboolean           spectrum_enabled;
 };
 
 GType                 rena_visualizer_plugin_get_type        (void) G_GNUC_CONST;
@@ -25,20 +25,13 @@
 #include <gmodule.h>
 #include <math.h>
 
-#define SYNCRONIZED 1
-
-//#define DRAW_DEBUG 1
-
 #include "src/rena-backend.h"
 
 #include "rena-visualizer-particle.h"
 #include "rena-visualizer.h"
 
-#ifdef DRAW_DEBUG
-static gint tick_i = 0;
-static gint draw_i = 0;
-static gint update_i = 0;
-#endif
+/* The animation constants were tuned for redraws at this period. */
+#define RENA_VISUALIZER_FRAME_USEC 75000
 
 #define RENA_TYPE_VISUALIZER (rena_visualizer_get_type())
 #define RENA_VISUALIZER(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), RENA_TYPE_VISUALIZER, RenaVisualizer))
@@ -55,68 +48,102 @@ struct _RenaVisualizer {
 	GtkBox         _parent;
 
 	GtkWidget      *drawing_area;
-	GList          *particles;
+	RenaParticles  *particles;
 
 	guint           width;
 	guint           height;
 
 	guint           tick_id;
+	gint64          frame_time;
 };
 
 G_DEFINE_TYPE(RenaVisualizer, rena_visualizer, GTK_TYPE_BOX)
 
+/*
+ * The animation follows the frame clock of the drawing area, only while it
+ * is mapped, and pauses once the particles have faded out.
+ */
+
+static gboolean
+rena_visualizer_tick (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+	gint64 frame_time;
+	gdouble frames = 1.0;
+
+	RenaVisualizer *visualizer = RENA_VISUALIZER (user_data);
+
+	frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+	if (visualizer->frame_time)
+		frames = CLAMP ((gdouble) (frame_time - visualizer->frame_time) / RENA_VISUALIZER_FRAME_USEC, 0.0, 4.0);
+	visualizer->frame_time = frame_time;
+
+	gtk_widget_queue_draw (widget);
+
+	if (!rena_particles_step (visualizer->particles, frames, visualizer->width, visualizer->height)) {
+		visualizer->tick_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+rena_visualizer_start_ticking (RenaVisualizer *visualizer)
+{
+	if (visualizer->tick_id)
+		return;
+	if (!gtk_widget_get_mapped (visualizer->drawing_area))
+		return;
+
+	visualizer->frame_time = 0;
+	visualizer->tick_id = gtk_widget_add_tick_callback (visualizer->drawing_area,
+	                                                    rena_visualizer_tick,
+	                                                    visualizer, NULL);
+}
+
+static void
+rena_visualizer_stop_ticking (RenaVisualizer *visualizer)
+{
+	if (!visualizer->tick_id)
+		return;
+
+	gtk_widget_remove_tick_callback (visualizer->drawing_area, visualizer->tick_id);
+	visualizer->tick_id = 0;
+}
+
 void
-rena_visualizer_set_magnitudes (RenaVisualizer *visualizer, GValue *magnitudes)
+rena_visualizer_set_magnitudes (RenaVisualizer *visualizer, guint n_bands, const gfloat *magnitudes)
 {
-	RenaParticle *particle = NULL;
-	const GValue *mag = NULL;
-	GList *l = NULL;
+	RenaParticles *particles = visualizer->particles;
 	guint i = 0;
-	gdouble dmag = 0.0;
 
-	if (!gtk_widget_is_visible (GTK_WIDGET(visualizer)))
+	if (!gtk_widget_get_mapped (visualizer->drawing_area))
 		return;
 
-	for (l = visualizer->particles, i = 0 ; l != NULL ; l = l->next, i++)
+	for (i = 0 ; i < particles->n_particles ; i++)
 	{
-		particle = l->data;
-		mag = gst_value_list_get_value (magnitudes, i);
-		if (mag != NULL)
-			dmag = 80.0 + g_value_get_float (mag);
+		if (i < n_bands)
+			particles->energy[i] = (80.0 + magnitudes[i]) / 80;
 		else
-			dmag = 0.0;
-
-		rena_particle_set_energy (particle, dmag/80);
-//		rena_particle_move (particle, visualizer->width, visualizer->height);
+			particles->energy[i] = 0.0;
 	}
 
-#ifdef DRAW_DEBUG
-	update_i++;
-#endif
-
-#ifndef SYNCRONIZED
-	gtk_widget_queue_draw (GTK_WIDGET(visualizer->drawing_area));
-#endif
+	rena_visualizer_start_ticking (visualizer);
 }
 
 void
 rena_visualizer_stop (RenaVisualizer *visualizer)
 {
-	RenaParticle *particle = NULL;
-	GList *l = NULL;
-	for (l = visualizer->particles ; l != NULL ; l = l->next)
-	{
-		particle = l->data;
-		rena_particle_set_energy (particle, 0.0);
-	}
+	RenaParticles *particles = visualizer->particles;
+	guint i = 0;
+
+	for (i = 0 ; i < particles->n_particles ; i++)
+		particles->energy[i] = 0.0;
 }
 
 static gboolean
 rena_visualizer_widget_draw (GtkWidget *widget, cairo_t *cr, gpointer user_data)
 {
-	RenaParticle *particle = NULL;
-	GList *l = NULL;
-
 	RenaVisualizer *visualizer = RENA_VISUALIZER (user_data);
 
 	cairo_set_tolerance (cr, 1.0);
@@ -125,56 +152,32 @@ rena_visualizer_widget_draw (GtkWidget *widget, cairo_t *cr, gpointer user_data)
 	cairo_rectangle (cr, 0, 0, visualizer->width, visualizer->height);
 	cairo_fill (cr);
 
-	for (l = visualizer->particles ; l != NULL ; l = l->next)
-	{
-		particle = l->data;
-		rena_particle_move (particle, visualizer->width, visualizer->height);
-		rena_particle_draw (particle, cr);
-	}
-
-#ifdef DRAW_DEBUG
-	draw_i++;
-	g_critical ("Tick: %i, Draw: %i, Mag: %i", tick_i, draw_i, update_i);
-#endif
+	rena_particles_draw (visualizer->particles, cr);
 
 	return TRUE;
 }
 
-#ifdef SYNCRONIZED
-static gboolean
-rena_visualizer_drawing_tick (gpointer user_data)
-{
-	GtkWidget *widget = GTK_WIDGET (user_data);
-#ifdef DRAW_DEBUG
-	tick_i++;
-#endif
-	if (gtk_widget_is_visible (widget))
-		gtk_widget_queue_draw(widget);
-
-	return G_SOURCE_CONTINUE;
-}
-#endif
-
 static void
 rena_visualizer_size_allocate (GtkWidget *widget, GdkRectangle *allocation, gpointer user_data)
 {
-	RenaParticle *particle = NULL;
-	GList *l = NULL;
-	gint x = 0, y = 0;
-
 	RenaVisualizer *visualizer = RENA_VISUALIZER (user_data);
 
 	visualizer->width = allocation->width;
 	visualizer->height = allocation->height;
 
-	for (l = visualizer->particles ; l != NULL ; l = l->next)
-	{
-		particle = l->data;
-		x = g_random_int_range (1, visualizer->width);
-		y = g_random_int_range (1, visualizer->height);
-		rena_particle_reset (particle);
-		rena_particle_move_to (particle, x, y);
-	}
+	rena_particles_scatter (visualizer->particles, visualizer->width, visualizer->height);
+}
+
+static void
+rena_visualizer_map (GtkWidget *widget, gpointer user_data)
+{
+	rena_visualizer_start_ticking (RENA_VISUALIZER (user_data));
+}
+
+static void
+rena_visualizer_unmap (GtkWidget *widget, gpointer user_data)
+{
+	rena_visualizer_stop_ticking (RENA_VISUALIZER (user_data));
 }
 
 static void
@@ -182,15 +185,11 @@ rena_visualizer_dispose (GObject *object)
 {
 	RenaVisualizer *visualizer = RENA_VISUALIZER (object);
 
-#ifdef SYNCRONIZED
-	if (visualizer->tick_id) {
-		g_source_remove (visualizer->tick_id);
-		visualizer->tick_id = 0;
-	}
-#endif
+	if (visualizer->drawing_area)
+		rena_visualizer_stop_ticking (visualizer);
 
 	if (visualizer->particles) {
-		g_list_free_full (visualizer->particles, g_object_unref);
+		rena_particles_free (visualizer->particles);
 		visualizer->particles = NULL;
 	}
 	G_OBJECT_CLASS (rena_visualizer_parent_class)->dispose (object);
@@ -207,8 +206,8 @@ static void
 rena_visualizer_init (RenaVisualizer *visualizer)
 {
 	GtkWidget *drawing_area;
-	RenaParticle *particle = NULL;
-	gint i = 0;
+
+	visualizer->particles = rena_particles_new (RENA_VISUALIZER_BANDS);
 
 	drawing_area = gtk_drawing_area_new ();
 	gtk_widget_set_size_request (drawing_area, 640, 480);
@@ -218,16 +217,10 @@ rena_visualizer_init (RenaVisualizer *visualizer)
 	                  G_CALLBACK(rena_visualizer_size_allocate), visualizer);
 	g_signal_connect (G_OBJECT (drawing_area), "draw",
 	                  G_CALLBACK (rena_visualizer_widget_draw), visualizer);
-
-#ifdef SYNCRONIZED
-	visualizer->tick_id = g_timeout_add (75, rena_visualizer_drawing_tick, drawing_area);
-#endif
-
-	for (i = 0 ; i < 128 ; i++) {
-		particle = rena_particle_new ();
-		rena_particle_set_energy (particle, 0.0);
-		visualizer->particles = g_list_append (visualizer->particles, particle);
-	}
+	g_signal_connect (drawing_area, "map",
+	                  G_CALLBACK(rena_visualizer_map), visualizer);
+	g_signal_connect (drawing_area, "unmap",
+	                  G_CALLBACK(rena_visualizer_unmap), visualizer);
 
 	visualizer->drawing_area = drawing_area;
 	gtk_widget_set_visible (drawing_area, TRUE);
@@ -25,11 +25,14 @@
 
 G_BEGIN_DECLS
 
+#define RENA_VISUALIZER_BANDS       128
+#define RENA_VISUALIZER_INTERVAL_MS 50
+
 typedef struct _RenaVisualizer RenaVisualizer;
 typedef struct _RenaVisualizerClass RenaVisualizerClass;
 
 void
-rena_visualizer_set_magnitudes (RenaVisualizer *visualizer, GValue *magnitudes);
+rena_visualizer_set_magnitudes (RenaVisualizer *visualizer, guint n_bands, const gfloat *magnitudes);
 
 RenaVisualizer *
 rena_visualizer_new (void);
@@ -93,7 +93,9 @@ GtkWidget * create_info_bar_import_music(RenaApplication *rena)
 
 static void info_bar_update_response_cb(GtkInfoBar *info_bar, gint response_id, gpointer user_data)
 {
+	RenaDatabaseProvider *provider;
 	RenaScanner *scanner;
+	GSList *local_list, *handled_list, *added_list;
 
 	RenaApplication *rena = user_data;
 
@@ -104,8 +106,23 @@ static void info_bar_update_response_cb(GtkInfoBar *info_bar, gint response_id,
 		case GTK_RESPONSE_CANCEL:
 			break;
 		case GTK_RESPONSE_YES:
+			/* Removed folders are already gone from the library, so just
+			 * scan the folders added that have never been analyzed. */
+			provider = rena_database_provider_get ();
+			local_list = rena_database_provider_get_list_by_type (provider, "local");
+			handled_list = rena_provider_get_handled_list_by_type (provider, "local");
+			added_list = rena_string_list_get_added (handled_list, local_list);
+			g_object_unref (provider);
+
 			scanner = rena_application_get_scanner (rena);
-			rena_scanner_update_library (scanner);
+			if (added_list != NULL)
+				rena_scanner_update_providers (scanner, added_list);
+			else
+				rena_scanner_update_library (scanner);
+
+			free_str_list (added_list);
+			free_str_list (handled_list);
+			free_str_list (local_list);
 			break;
 		default:
 			g_warn_if_reached();
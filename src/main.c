@@ -33,7 +33,7 @@
 #include <tag_c.h>
 
 #ifdef DEBUG
-GThread *rena_main_thread = NULL;
+extern GThread *rena_main_thread;
 #endif
 
 gint main(gint argc, gchar *argv[])
@@ -60,10 +60,14 @@ gint main(gint argc, gchar *argv[])
     g_set_application_name(_("Rena Music Player"));
     g_setenv("PULSE_PROP_media.role", "audio", TRUE);
 
+    rena_profile_startup_begin ();
+
     rena = rena_application_new ();
     status = g_application_run (G_APPLICATION (rena), argc, argv);
     g_object_run_dispose (G_OBJECT (rena));
     g_object_unref (rena);
 
+    rena_profile_report ();
+
     return status;
 }
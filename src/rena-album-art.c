@@ -23,11 +23,15 @@
 #include "win32/win32dep.h"
 #endif
 
+#include "rena-art-cache.h"
+
 struct _RenaAlbumArt
 {
    GtkImage parent;
    gchar *path;
    guint size;
+   GdkPixbuf *frame;
+   RenaArtCache *art_cache;
 };
 
 G_DEFINE_TYPE (RenaAlbumArt, rena_album_art, GTK_TYPE_IMAGE)
@@ -58,36 +62,31 @@ rena_album_art_update_image (RenaAlbumArt *albumart)
 {
    GdkPixbuf *pixbuf = NULL, *album_art = NULL, *frame;
    gchar *frame_uri = NULL;
-   GError *error = NULL;
 
    g_return_if_fail(RENA_IS_ALBUM_ART(albumart));
 
-   frame_uri = g_build_filename (PIXMAPDIR, "cover.png", NULL);
-   frame = gdk_pixbuf_new_from_file (frame_uri, NULL);
-   g_free (frame_uri);
+   if (albumart->frame == NULL) {
+      frame_uri = g_build_filename (PIXMAPDIR, "cover.png", NULL);
+      albumart->frame = gdk_pixbuf_new_from_file (frame_uri, NULL);
+      g_free (frame_uri);
+   }
 
    if (albumart->path != NULL) {
-      #ifdef G_OS_WIN32
-      GdkPixbuf *a_pixbuf = gdk_pixbuf_new_from_file (albumart->path, &error);
-      if (a_pixbuf) {
-         album_art = gdk_pixbuf_scale_simple (a_pixbuf, 112, 112, GDK_INTERP_BILINEAR);
-         g_object_unref(G_OBJECT(a_pixbuf));
-      }
-      #else
-      album_art = gdk_pixbuf_new_from_file_at_scale(albumart->path,
-                                                    112,
-                                                    112,
-                                                    FALSE,
-                                                    &error);
-      #endif
-      if (album_art) {
-         gdk_pixbuf_copy_area (album_art, 0, 0, 112, 112, frame, 12, 8);
-         g_object_unref(G_OBJECT(album_art));
-      }
-      else {
-         g_critical("Unable to open image file: %s\n", albumart->path);
-         g_error_free(error);
-      }
+      /* The thumbnail usually is in memory. */
+      album_art = rena_art_cache_get_thumbnail (albumart->art_cache,
+                                                albumart->path,
+                                                RENA_ART_CACHE_THUMBNAIL_SIZE);
+   }
+
+   if (album_art) {
+      frame = gdk_pixbuf_copy (albumart->frame);
+      gdk_pixbuf_copy_area (album_art, 0, 0,
+                            RENA_ART_CACHE_THUMBNAIL_SIZE, RENA_ART_CACHE_THUMBNAIL_SIZE,
+                            frame, 12, 8);
+      g_object_unref(G_OBJECT(album_art));
+   }
+   else {
+      frame = g_object_ref (albumart->frame);
    }
 
    pixbuf = gdk_pixbuf_scale_simple (frame,
@@ -194,6 +193,8 @@ rena_album_art_finalize (GObject *object)
    RenaAlbumArt *albumart = RENA_ALBUM_ART(object);
 
    g_free(albumart->path);
+   g_clear_object(&albumart->frame);
+   g_object_unref(albumart->art_cache);
 
    G_OBJECT_CLASS(rena_album_art_parent_class)->finalize(object);
 }
@@ -279,4 +280,5 @@ rena_album_art_class_init (RenaAlbumArtClass *klass)
 static void
 rena_album_art_init (RenaAlbumArt *albumart)
 {
+   albumart->art_cache = rena_art_cache_get ();
 }
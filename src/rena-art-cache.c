@@ -19,13 +19,47 @@
 
 #include <glib/gstdio.h>
 
+#include "rena-simple-async.h"
 #include "rena-utils.h"
 
 struct _RenaArtCache {
-	GObject _parent;
-	gchar   *cache_dir;
+	GObject     _parent;
+	gchar      *cache_dir;
+	GHashTable *album_checksums;
+	GHashTable *files;
+	GHashTable *pixbufs;
+	GQueue      pixbufs_lru;
 };
 
+/*
+ * Thumbnails are pre-rendered when saving art, at the sizes used by the UI,
+ * and the latest decoded pixbufs are kept in memory.
+ */
+
+static const gint thumbnail_sizes[] = { RENA_ART_CACHE_THUMBNAIL_SIZE };
+
+#define PIXBUF_CACHE_SIZE 64
+
+/* Checksums of the embedded images being ingested, or that failed to decode. */
+
+#define ALBUM_CHECKSUMS_SIZE 256
+
+typedef struct {
+	gchar        *key;
+	gchar        *path;
+	GdkPixbuf    *pixbuf;
+	GList         link;
+} RenaArtCachePixbuf;
+
+typedef struct {
+	RenaArtCache *cache;
+	gchar        *key;
+	gchar        *checksum;
+	gchar        *path;
+	GBytes       *image;
+	gboolean      saved;
+} RenaArtCacheJob;
+
 enum {
 	SIGNAL_CACHE_CHANGED,
 	LAST_SIGNAL
@@ -35,12 +69,26 @@ static int signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE(RenaArtCache, rena_art_cache, G_TYPE_OBJECT)
 
+static void
+rena_art_cache_pixbuf_free (RenaArtCachePixbuf *entry)
+{
+	g_free (entry->key);
+	g_free (entry->path);
+	g_object_unref (entry->pixbuf);
+	g_slice_free (RenaArtCachePixbuf, entry);
+}
+
 static void
 rena_art_cache_finalize (GObject *object)
 {
 	RenaArtCache *cache = RENA_ART_CACHE(object);
 
 	g_free (cache->cache_dir);
+	g_hash_table_destroy (cache->album_checksums);
+	g_hash_table_destroy (cache->files);
+	g_hash_table_destroy (cache->pixbufs);
+	while (!g_queue_is_empty (&cache->pixbufs_lru))
+		rena_art_cache_pixbuf_free (g_queue_pop_head (&cache->pixbufs_lru));
 
 	G_OBJECT_CLASS(rena_art_cache_parent_class)->finalize(object);
 }
@@ -66,8 +114,33 @@ rena_art_cache_class_init (RenaArtCacheClass *klass)
 static void
 rena_art_cache_init (RenaArtCache *cache)
 {
+	GDir *dir;
+	const gchar *name;
+	gchar *thumbnail_dir;
+	guint i;
+
 	cache->cache_dir = g_build_path (G_DIR_SEPARATOR_S, g_get_user_cache_dir (), "rena", "art", NULL);
 	g_mkdir_with_parents (cache->cache_dir, S_IRWXU);
+
+	for (i = 0; i < G_N_ELEMENTS (thumbnail_sizes); i++) {
+		thumbnail_dir = g_strdup_printf ("%s%sthumbnails%s%d", cache->cache_dir, G_DIR_SEPARATOR_S, G_DIR_SEPARATOR_S, thumbnail_sizes[i]);
+		g_mkdir_with_parents (thumbnail_dir, S_IRWXU);
+		g_free (thumbnail_dir);
+	}
+
+	cache->album_checksums = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	/* Read the cache folder once, so lookups does not touch the disk. */
+	cache->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	dir = g_dir_open (cache->cache_dir, 0, NULL);
+	if (dir) {
+		while ((name = g_dir_read_name (dir)) != NULL)
+			g_hash_table_add (cache->files, g_strdup (name));
+		g_dir_close (dir);
+	}
+
+	cache->pixbufs = g_hash_table_new (g_str_hash, g_str_equal);
+	g_queue_init (&cache->pixbufs_lru);
 }
 
 RenaArtCache *
@@ -87,10 +160,205 @@ rena_art_cache_get (void)
 	return cache;
 }
 
+/*
+ * Thumbnails of cached art.
+ */
+
+static gchar *
+rena_art_cache_build_thumbnail_path (RenaArtCache *cache, const gchar *path, gint size)
+{
+	gchar *basename, *result;
+	guint i;
+
+	if (!g_str_has_prefix (path, cache->cache_dir))
+		return NULL;
+
+	for (i = 0; i < G_N_ELEMENTS (thumbnail_sizes); i++) {
+		if (thumbnail_sizes[i] == size)
+			break;
+	}
+	if (i == G_N_ELEMENTS (thumbnail_sizes))
+		return NULL;
+
+	basename = g_path_get_basename (path);
+	result = g_strdup_printf ("%s%sthumbnails%s%d%s%s", cache->cache_dir, G_DIR_SEPARATOR_S, G_DIR_SEPARATOR_S, size, G_DIR_SEPARATOR_S, basename);
+	g_free (basename);
+
+	return result;
+}
+
+static void
+rena_art_cache_save_thumbnail (RenaArtCache *cache, const gchar *path, GdkPixbuf *pixbuf, gint size)
+{
+	GdkPixbuf *thumbnail;
+	GError *error = NULL;
+	gchar *thumbnail_path;
+
+	thumbnail_path = rena_art_cache_build_thumbnail_path (cache, path, size);
+	if (!thumbnail_path)
+		return;
+
+	if (gdk_pixbuf_get_width (pixbuf) != size || gdk_pixbuf_get_height (pixbuf) != size)
+		thumbnail = gdk_pixbuf_scale_simple (pixbuf, size, size, GDK_INTERP_HYPER);
+	else
+		thumbnail = g_object_ref (pixbuf);
+
+	if (!gdk_pixbuf_save (thumbnail, thumbnail_path, "jpeg", &error, "quality", "90", NULL)) {
+		g_warning ("Failed to save thumbnail %s: %s\n", thumbnail_path, error->message);
+		g_error_free (error);
+	}
+
+	g_object_unref (thumbnail);
+	g_free (thumbnail_path);
+}
+
+static void
+rena_art_cache_forget_pixbufs (RenaArtCache *cache, const gchar *path)
+{
+	RenaArtCachePixbuf *entry;
+	GList *l, *next;
+
+	for (l = cache->pixbufs_lru.head; l != NULL; l = next) {
+		next = l->next;
+		entry = l->data;
+		if (g_strcmp0 (entry->path, path))
+			continue;
+		g_hash_table_remove (cache->pixbufs, entry->key);
+		g_queue_unlink (&cache->pixbufs_lru, &entry->link);
+		rena_art_cache_pixbuf_free (entry);
+	}
+}
+
+/*
+ * Mark a new image on path. Must be called on main loop.
+ */
+static void
+rena_art_cache_saved_image (RenaArtCache *cache, const gchar *path)
+{
+	g_hash_table_add (cache->files, g_path_get_basename (path));
+	rena_art_cache_forget_pixbufs (cache, path);
+
+	g_signal_emit (cache, signals[SIGNAL_CACHE_CHANGED], 0);
+}
+
+/*
+ * Decode an image and store it as jpeg on path, with their thumbnails.
+ * It is safe to call it from a worker thread.
+ */
+
+static gboolean
+rena_art_cache_save_image (RenaArtCache *cache, const gchar *path, gconstpointer data, gsize size)
+{
+	GError *error = NULL;
+	guint i;
+
+	GdkPixbuf *pixbuf = rena_gdk_pixbuf_new_from_memory (data, size);
+	if (!pixbuf)
+		return FALSE;
+
+	gdk_pixbuf_save (pixbuf, path, "jpeg", &error, "quality", "100", NULL);
+	if (error) {
+		g_warning ("Failed to save art file %s: %s\n", path, error->message);
+		g_error_free (error);
+		g_object_unref (pixbuf);
+		return FALSE;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (thumbnail_sizes); i++)
+		rena_art_cache_save_thumbnail (cache, path, pixbuf, thumbnail_sizes[i]);
+	g_object_unref (pixbuf);
+
+	return TRUE;
+}
+
+static gboolean
+rena_art_cache_contains_file (RenaArtCache *cache, const gchar *path)
+{
+	gchar *basename = g_path_get_basename (path);
+	gboolean contains = g_hash_table_contains (cache->files, basename);
+	g_free (basename);
+
+	return contains;
+}
+
+/**
+ * rena_art_cache_get_thumbnail:
+ *
+ * Returns: (transfer full): the image on @path scaled to @size, from memory
+ * when it was used recently, or from the pre-rendered thumbnail when it was
+ * cached by us.
+ */
+GdkPixbuf *
+rena_art_cache_get_thumbnail (RenaArtCache *cache, const gchar *path, gint size)
+{
+	RenaArtCachePixbuf *entry;
+	GdkPixbuf *pixbuf = NULL;
+	GError *error = NULL;
+	gchar *key, *thumbnail_path;
+
+	key = g_strdup_printf ("%d\x1f%s", size, path);
+	entry = g_hash_table_lookup (cache->pixbufs, key);
+	if (entry) {
+		g_queue_unlink (&cache->pixbufs_lru, &entry->link);
+		g_queue_push_tail_link (&cache->pixbufs_lru, &entry->link);
+		g_free (key);
+		return g_object_ref (entry->pixbuf);
+	}
+
+	thumbnail_path = rena_art_cache_build_thumbnail_path (cache, path, size);
+	if (thumbnail_path)
+		pixbuf = gdk_pixbuf_new_from_file (thumbnail_path, NULL);
+
+	if (!pixbuf) {
+		#ifdef G_OS_WIN32
+		GdkPixbuf *a_pixbuf = gdk_pixbuf_new_from_file (path, &error);
+		if (a_pixbuf) {
+			pixbuf = gdk_pixbuf_scale_simple (a_pixbuf, size, size, GDK_INTERP_BILINEAR);
+			g_object_unref (a_pixbuf);
+		}
+		#else
+		pixbuf = gdk_pixbuf_new_from_file_at_scale (path, size, size, FALSE, &error);
+		#endif
+		if (!pixbuf) {
+			g_warning ("Unable to open image file %s: %s\n", path, error->message);
+			g_error_free (error);
+			g_free (thumbnail_path);
+			g_free (key);
+			return NULL;
+		}
+		/* Art cached before having thumbnails. */
+		if (thumbnail_path)
+			rena_art_cache_save_thumbnail (cache, path, pixbuf, size);
+	}
+	g_free (thumbnail_path);
+
+	entry = g_slice_new0 (RenaArtCachePixbuf);
+	entry->key = key;
+	entry->path = g_strdup (path);
+	entry->pixbuf = pixbuf;
+	entry->link.data = entry;
+	g_hash_table_insert (cache->pixbufs, entry->key, entry);
+	g_queue_push_tail_link (&cache->pixbufs_lru, &entry->link);
+
+	while (g_queue_get_length (&cache->pixbufs_lru) > PIXBUF_CACHE_SIZE) {
+		entry = g_queue_pop_head (&cache->pixbufs_lru);
+		g_hash_table_remove (cache->pixbufs, entry->key);
+		rena_art_cache_pixbuf_free (entry);
+	}
+
+	return g_object_ref (pixbuf);
+}
+
 /*
  * Album art cache.
  */
 
+static gchar *
+rena_art_cache_build_album_key (const gchar *artist, const gchar *album)
+{
+	return g_strdup_printf ("%s\x1f%s", artist ? artist : "", album ? album : "");
+}
+
 static gchar *
 rena_art_cache_build_album_path (RenaArtCache *cache, const gchar *artist, const gchar *album)
 {
@@ -107,7 +375,7 @@ rena_art_cache_get_album_uri (RenaArtCache *cache, const gchar *artist, const gc
 {
 	gchar *path = rena_art_cache_build_album_path (cache, artist, album);
 
-	if (g_file_test (path, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR) == FALSE) {
+	if (!rena_art_cache_contains_file (cache, path)) {
 		g_free (path);
 		return NULL;
 	}
@@ -131,25 +399,107 @@ rena_art_cache_contains_album (RenaArtCache *cache, const gchar *artist, const g
 void
 rena_art_cache_put_album (RenaArtCache *cache, const gchar *artist, const gchar *album, gconstpointer data, gsize size)
 {
-	GError *error = NULL;
+	gchar *path = rena_art_cache_build_album_path (cache, artist, album);
+	gchar *key = rena_art_cache_build_album_key (artist, album);
 
-	GdkPixbuf *pixbuf = rena_gdk_pixbuf_new_from_memory (data, size);
-	if (!pixbuf)
-		return;
+	/* The image come from elsewhere, so forget the embedded one. */
+	g_hash_table_remove (cache->album_checksums, key);
 
-	gchar *path = rena_art_cache_build_album_path (cache, artist, album);
+	if (rena_art_cache_save_image (cache, path, data, size))
+		rena_art_cache_saved_image (cache, path);
 
-	gdk_pixbuf_save (pixbuf, path, "jpeg", &error, "quality", "100", NULL);
+	g_free (key);
+	g_free (path);
+}
 
-	if (error) {
-		g_warning ("Failed to save albumart file %s: %s\n", path, error->message);
-		g_error_free (error);
+/*
+ * Ingest of embedded album art.
+ * Decode and save on a worker thread, and notify changes on main loop.
+ */
+
+static gpointer
+rena_art_cache_ingest_album_worker (gpointer data)
+{
+	RenaArtCacheJob *job = data;
+	gsize size = 0;
+	gconstpointer image = g_bytes_get_data (job->image, &size);
+
+	job->saved = rena_art_cache_save_image (job->cache, job->path, image, size);
+
+	return job;
+}
+
+static void
+rena_art_cache_job_free (gpointer data)
+{
+	RenaArtCacheJob *job = data;
+
+	g_object_unref (job->cache);
+	g_bytes_unref (job->image);
+	g_free (job->key);
+	g_free (job->checksum);
+	g_free (job->path);
+	g_slice_free (RenaArtCacheJob, job);
+}
+
+static gboolean
+rena_art_cache_ingest_album_finished (gpointer data)
+{
+	RenaArtCacheJob *job = data;
+	const gchar *checksum;
+
+	/* Once saved the cache file is enough. Only failures are remembered. */
+	if (job->saved) {
+		checksum = g_hash_table_lookup (job->cache->album_checksums, job->key);
+		if (g_strcmp0 (checksum, job->checksum) == 0)
+			g_hash_table_remove (job->cache->album_checksums, job->key);
+		rena_art_cache_saved_image (job->cache, job->path);
 	}
 
-	g_signal_emit (cache, signals[SIGNAL_CACHE_CHANGED], 0);
+	rena_art_cache_job_free (job);
 
-	g_free (path);
-	g_object_unref (pixbuf);
+	return FALSE;
+}
+
+void
+rena_art_cache_ingest_album (RenaArtCache *cache, const gchar *artist, const gchar *album, gconstpointer data, gsize size)
+{
+	RenaArtCacheJob *job;
+	const gchar *checksum_old;
+	gchar *checksum, *key;
+
+	if (rena_art_cache_contains_album (cache, artist, album))
+		return;
+
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_MD5, data, size);
+	key = rena_art_cache_build_album_key (artist, album);
+
+	/* Same image already being ingested, or failed, for this album. */
+	checksum_old = g_hash_table_lookup (cache->album_checksums, key);
+	if (g_strcmp0 (checksum_old, checksum) == 0) {
+		g_free (checksum);
+		g_free (key);
+		return;
+	}
+
+	/* Remember it, also when fail to decode, to not try again each tag */
+	if (g_hash_table_size (cache->album_checksums) >= ALBUM_CHECKSUMS_SIZE)
+		g_hash_table_remove_all (cache->album_checksums);
+	g_hash_table_replace (cache->album_checksums, g_strdup (key), g_strdup (checksum));
+
+	job = g_slice_new0 (RenaArtCacheJob);
+	job->cache = g_object_ref (cache);
+	job->key = key;
+	job->checksum = checksum;
+	job->path = rena_art_cache_build_album_path (cache, artist, album);
+	job->image = g_bytes_new (data, size);
+
+	rena_async_launch_task (RENA_ASYNC_PRIORITY_BACKGROUND,
+	                        job->path, NULL,
+	                        rena_art_cache_ingest_album_worker,
+	                        rena_art_cache_ingest_album_finished,
+	                        job,
+	                        rena_art_cache_job_free);
 }
 
 /*
@@ -171,7 +521,7 @@ rena_art_cache_get_artist_uri (RenaArtCache *cache, const gchar *artist)
 {
 	gchar *path = rena_art_cache_build_artist_path (cache, artist);
 
-	if (g_file_test (path, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_REGULAR) == FALSE) {
+	if (!rena_art_cache_contains_file (cache, path)) {
 		g_free (path);
 		return NULL;
 	}
@@ -195,24 +545,11 @@ rena_art_cache_contains_artist (RenaArtCache *cache, const gchar *artist)
 void
 rena_art_cache_put_artist (RenaArtCache *cache, const gchar *artist, gconstpointer data, gsize size)
 {
-	GError *error = NULL;
-
-	GdkPixbuf *pixbuf = rena_gdk_pixbuf_new_from_memory (data, size);
-	if (!pixbuf)
-		return;
-
 	gchar *path = rena_art_cache_build_artist_path (cache, artist);
 
-	gdk_pixbuf_save (pixbuf, path, "jpeg", &error, "quality", "100", NULL);
-
-	if (error) {
-		g_warning ("Failed to save artist art file %s: %s\n", path, error->message);
-		g_error_free (error);
-	}
-
-	g_signal_emit (cache, signals[SIGNAL_CACHE_CHANGED], 0);
+	if (rena_art_cache_save_image (cache, path, data, size))
+		rena_art_cache_saved_image (cache, path);
 
 	g_free (path);
-	g_object_unref (pixbuf);
 }
 
@@ -20,6 +20,7 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
 
 G_BEGIN_DECLS
 
@@ -31,6 +32,9 @@ G_BEGIN_DECLS
 #define RENA_IS_ART_CACHE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), RENA_TYPE_ART_CACHE))
 #define RENA_ART_CACHE_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), RENA_TYPE_ART_CACHE, RenaArtCacheClass))
 
+/* Size of the covers shown by the album art widget */
+#define RENA_ART_CACHE_THUMBNAIL_SIZE 112
+
 typedef struct _RenaArtCache RenaArtCache;
 typedef struct _RenaArtCacheClass RenaArtCacheClass;
 
@@ -45,11 +49,14 @@ RenaArtCache * rena_art_cache_get      (void);
 gchar *          rena_art_cache_get_album_uri   (RenaArtCache *cache, const gchar *artist, const gchar *album);
 gboolean         rena_art_cache_contains_album  (RenaArtCache *cache, const gchar *artist, const gchar *album);
 void             rena_art_cache_put_album       (RenaArtCache *cache, const gchar *artist, const gchar *album, gconstpointer data, gsize size);
+void             rena_art_cache_ingest_album    (RenaArtCache *cache, const gchar *artist, const gchar *album, gconstpointer data, gsize size);
 
 gchar *          rena_art_cache_get_artist_uri  (RenaArtCache *cache, const gchar *artist);
 gboolean         rena_art_cache_contains_artist (RenaArtCache *cache, const gchar *artist);
 void             rena_art_cache_put_artist      (RenaArtCache *cache, const gchar *artist, gconstpointer data, gsize size);
 
+GdkPixbuf *      rena_art_cache_get_thumbnail   (RenaArtCache *cache, const gchar *path, gint size);
+
 G_END_DECLS
 
 #endif /* RENA_ART_CACHE_H */
@@ -68,6 +68,11 @@ struct RenaBackendPrivate {
 	GstElement        *audio_sink;
 	GstElement        *preamp;
 	GstElement        *equalizer;
+	GstElement        *spectrum;
+
+	guint              spectrum_users;
+	guint              spectrum_bands;
+	gfloat            *spectrum_magnitudes;
 
 	guint              timer;
 	guint              cont_playback;
@@ -579,16 +584,11 @@ save_embedded_art (RenaBackend *backend, const GstTagList *taglist)
 	if (!sample)
 		goto out;
 
-	//got art, now check if we need it
+	//got art, let the cache decide if we need it
 
 	const gchar *artist = rena_musicobject_get_artist (priv->mobj);
 	const gchar *album = rena_musicobject_get_album (priv->mobj);
 
-	if (rena_art_cache_contains_album (priv->art_cache, artist, album))
-		goto out;
-
-	//ok, we need it
-
 	GstBuffer *buf = gst_sample_get_buffer (sample);
 	if (!buf)
 		goto out;
@@ -597,7 +597,8 @@ save_embedded_art (RenaBackend *backend, const GstTagList *taglist)
 	if (!gst_buffer_map (buf, &info, GST_MAP_READ))
 		goto out;
 
-	rena_art_cache_put_album (priv->art_cache, artist, album, info.data, info.size);
+	/* Skip it when already ingested and decode it on a worker thread */
+	rena_art_cache_ingest_album (priv->art_cache, artist, album, info.data, info.size);
 
 	gst_buffer_unmap (buf, &info);
 
@@ -823,15 +824,27 @@ static void
 rena_backend_message_element (GstBus *bus, GstMessage *msg, RenaBackend *backend)
 {
 	const GstStructure *gstr;
-	const GValue *magnitudes;
+	const GValue *magnitudes, *mag;
+	guint i, n_bands;
 
-	if (!g_ascii_strcasecmp (GST_OBJECT_NAME(msg->src), "spectrum"))
-	{
-		gstr = gst_message_get_structure(msg);
-		magnitudes = gst_structure_get_value (gstr, "magnitude");
+	RenaBackendPrivate *priv = backend->priv;
 
-		g_signal_emit (backend, signals[SIGNAL_SPECTRUM], 0, magnitudes);
+	if (priv->spectrum == NULL || GST_MESSAGE_SRC (msg) != GST_OBJECT (priv->spectrum))
+		return;
+
+	gstr = gst_message_get_structure(msg);
+	magnitudes = gst_structure_get_value (gstr, "magnitude");
+	if (magnitudes == NULL)
+		return;
+
+	/* Pack the magnitudes once, so consumers not have to walk the GValue list. */
+	n_bands = MIN (gst_value_list_get_size (magnitudes), priv->spectrum_bands);
+	for (i = 0 ; i < n_bands ; i++) {
+		mag = gst_value_list_get_value (magnitudes, i);
+		priv->spectrum_magnitudes[i] = g_value_get_float (mag);
 	}
+
+	g_signal_emit (backend, signals[SIGNAL_SPECTRUM], 0, n_bands, priv->spectrum_magnitudes);
 }
 
 static void
@@ -922,6 +935,8 @@ rena_backend_finalize (GObject *object)
 		priv->temp_location = NULL;
 	}
 
+	g_free (priv->spectrum_magnitudes);
+
 	CDEBUG(DBG_BACKEND, "Pipeline destruction complete");
 
 	G_OBJECT_CLASS (rena_backend_parent_class)->finalize (object);
@@ -977,41 +992,135 @@ rena_backend_init_equalizer_preset (RenaBackend *backend)
 	}
 }
 
+/*
+ * Spectrum analysis is only inserted in the pipeline while some consumer
+ * need it. Each call to enable must be balanced with a call to disable.
+ *
+ * The relink is done from an idle probe on the equalizer src pad, that keeps
+ * the pad blocked between buffers while playing, and runs at once when
+ * nothing is streaming. Probes run in order, so quick toggles are safe.
+ */
+
+static GstPadProbeReturn
+rena_backend_spectrum_link_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+	GstElement *spectrum = user_data, *equalizer, *sink;
+	GstPad *peer;
+
+	equalizer = gst_pad_get_parent_element (pad);
+	peer = gst_pad_get_peer (pad);
+	sink = gst_pad_get_parent_element (peer);
+
+	gst_element_unlink (equalizer, sink);
+	gst_element_link_many (equalizer, spectrum, sink, NULL);
+
+	gst_object_unref (sink);
+	gst_object_unref (peer);
+	gst_object_unref (equalizer);
+
+	return GST_PAD_PROBE_REMOVE;
+}
+
+static GstPadProbeReturn
+rena_backend_spectrum_unlink_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+	GstElement *spectrum = user_data, *equalizer, *sink;
+	GstPad *srcpad, *peer;
+
+	equalizer = gst_pad_get_parent_element (pad);
+	srcpad = gst_element_get_static_pad (spectrum, "src");
+	peer = gst_pad_get_peer (srcpad);
+	sink = gst_pad_get_parent_element (peer);
+
+	gst_element_unlink_many (equalizer, spectrum, sink, NULL);
+	gst_element_link (equalizer, sink);
+
+	gst_element_set_state (spectrum, GST_STATE_NULL);
+	gst_bin_remove (GST_BIN (GST_ELEMENT_PARENT (spectrum)), spectrum);
+
+	gst_object_unref (sink);
+	gst_object_unref (peer);
+	gst_object_unref (srcpad);
+	gst_object_unref (equalizer);
+
+	return GST_PAD_PROBE_REMOVE;
+}
+
 void
-rena_backend_enable_spectrum (RenaBackend *backend)
+rena_backend_enable_spectrum (RenaBackend *backend, guint bands, guint interval_ms)
 {
 	GstElement *spectrum;
+	GstPad *pad;
 
 	RenaBackendPrivate *priv = backend->priv;
 
-	spectrum = gst_element_factory_make ("spectrum", "spectrum");
-	g_object_set (G_OBJECT (spectrum), "bands", 128, "threshold", -80,
-	             "interval", 11000000, "post-messages", TRUE, NULL);
+	if (priv->audiobin == NULL)
+		return;
 
-	gst_bin_add (GST_BIN(priv->audiobin), spectrum);
+	bands = CLAMP (bands, 2, 1024);
+
+	/* The consumer chooses the resolution. Last one wins. */
+	if (bands != priv->spectrum_bands) {
+		g_free (priv->spectrum_magnitudes);
+		priv->spectrum_magnitudes = g_new0 (gfloat, bands);
+		priv->spectrum_bands = bands;
+	}
+
+	if (priv->spectrum != NULL) {
+		g_object_set (G_OBJECT (priv->spectrum), "bands", bands,
+		              "interval", (guint64) interval_ms * GST_MSECOND, NULL);
+		priv->spectrum_users++;
+		return;
+	}
 
-	gst_element_unlink (priv->equalizer, priv->audio_sink);
+	/* Unnamed, since the previous one may still wait to be removed. */
+	spectrum = gst_element_factory_make ("spectrum", NULL);
+	if (spectrum == NULL) {
+		g_warning ("Failed to create the spectrum element.");
+		return;
+	}
 
-	gst_element_link (priv->equalizer, spectrum);
-	gst_element_link (spectrum, priv->audio_sink);
+	CDEBUG(DBG_BACKEND, "Enabling spectrum analysis with %u bands each %u ms", bands, interval_ms);
 
+	g_object_set (G_OBJECT (spectrum), "bands", bands, "threshold", -80,
+	             "interval", (guint64) interval_ms * GST_MSECOND,
+	             "post-messages", TRUE, "message-phase", FALSE, NULL);
+
+	gst_bin_add (GST_BIN(priv->audiobin), spectrum);
 	gst_element_sync_state_with_parent (spectrum);
+
+	pad = gst_element_get_static_pad (priv->equalizer, "src");
+	gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_IDLE,
+	                   rena_backend_spectrum_link_cb,
+	                   gst_object_ref (spectrum), gst_object_unref);
+	gst_object_unref (pad);
+
+	priv->spectrum = spectrum;
+	priv->spectrum_users = 1;
 }
 
 void
 rena_backend_disable_spectrum (RenaBackend *backend)
 {
-	GstElement *spectrum;
+	GstPad *pad;
 
 	RenaBackendPrivate *priv = backend->priv;
 
-	spectrum = gst_bin_get_by_name (GST_BIN(priv->audiobin), "spectrum");
-	gst_element_unlink (priv->equalizer, spectrum);
-	gst_element_unlink (spectrum, priv->audio_sink);
+	if (priv->spectrum == NULL)
+		return;
 
-	gst_element_link (priv->equalizer, priv->audio_sink);
+	if (--priv->spectrum_users > 0)
+		return;
+
+	CDEBUG(DBG_BACKEND, "Disabling spectrum analysis");
+
+	pad = gst_element_get_static_pad (priv->equalizer, "src");
+	gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_IDLE,
+	                   rena_backend_spectrum_unlink_cb,
+	                   gst_object_ref (priv->spectrum), gst_object_unref);
+	gst_object_unref (pad);
 
-	gst_bin_remove (GST_BIN(priv->audiobin), spectrum);
+	priv->spectrum = NULL;
 }
 
 #ifndef G_OS_WIN32
@@ -1220,8 +1329,8 @@ rena_backend_class_init (RenaBackendClass *klass)
 		              G_SIGNAL_RUN_LAST,
 		              G_STRUCT_OFFSET (RenaBackendClass, spectrum),
 		              NULL, NULL,
-		              g_cclosure_marshal_VOID__POINTER,
-		              G_TYPE_NONE, 1, G_TYPE_POINTER);
+		              g_cclosure_marshal_VOID__UINT_POINTER,
+		              G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_POINTER);
 }
 
 static void
@@ -59,7 +59,7 @@ typedef struct {
 	void (*finished) (RenaBackend *backend);
 	void (*error) (RenaBackend *backend, const GError *error);
 	void (*tags_changed) (RenaBackend *backend, gint changed);
-	void (*spectrum) (RenaBackend *backend, gpointer value);
+	void (*spectrum) (RenaBackend *backend, guint n_bands, const gfloat *magnitudes);
 } RenaBackendClass;
 
 gboolean           rena_backend_can_seek             (RenaBackend *backend);
@@ -92,7 +92,7 @@ GstElement        *rena_backend_get_equalizer        (RenaBackend *backend);
 void               rena_backend_update_equalizer     (RenaBackend *backend, const gdouble *bands);
 GstElement        *rena_backend_get_preamp           (RenaBackend *backend);
 
-void               rena_backend_enable_spectrum      (RenaBackend *backend);
+void               rena_backend_enable_spectrum      (RenaBackend *backend, guint bands, guint interval_ms);
 void               rena_backend_disable_spectrum     (RenaBackend *backend);
 
 RenaBackend     *rena_backend_new                  (void);
@@ -40,6 +40,7 @@ static struct RenaCmdLineOptions {
 	gchar *audio_device;
 	gchar *audio_mixer;
 	gchar *logfile;
+	gchar *profile_output;
 	gboolean play;
 	gboolean stop;
 	gboolean pause;
@@ -51,6 +52,7 @@ static struct RenaCmdLineOptions {
 	gboolean dec_volume;
 	gboolean toggle_view;
 	gboolean current_state;
+	gboolean profile;
 	gchar **files;
 } cmdline_options;
 
@@ -61,6 +63,7 @@ clear_cmdline_options ()
 	g_free (cmdline_options.audio_device);
 	g_free (cmdline_options.audio_mixer);
 	g_free (cmdline_options.logfile);
+	g_free (cmdline_options.profile_output);
 	g_strfreev (cmdline_options.files);
 	memset (&cmdline_options, 0, sizeof(cmdline_options));
 }
@@ -131,6 +134,16 @@ cmd_add_files (RenaApplication *rena, GApplicationCommandLine *command_line)
 static void
 process_options (RenaApplication *rena, GApplicationCommandLine *command_line)
 {
+	/* The local command line is parsed before the application starts up,
+	 * so profile from there to also record the startup. */
+	if (cmdline_options.profile_output) {
+		rena_profile_set_output (cmdline_options.profile_output);
+		cmdline_options.profile = TRUE;
+	}
+	if (cmdline_options.profile) {
+		rena_profile_enable ();
+	}
+
 	if (!command_line)
 		return;
 
@@ -188,6 +201,10 @@ static const GOptionEntry cmd_entries[] = {
 	 &debug_level, "Enable Debug ( Levels: 1,2,3,4 )", NULL},
 	{ "log-file", 'l', 0, G_OPTION_ARG_FILENAME,
 	 &cmdline_options.logfile, "Redirects console warnings to the specified FILENAME", N_("FILENAME")},
+	{"profile", 0, 0, G_OPTION_ARG_NONE,
+	 &cmdline_options.profile, "Trace main loop stalls and slow operations, and report them on exit", NULL},
+	{"profile-output", 0, 0, G_OPTION_ARG_FILENAME,
+	 &cmdline_options.profile_output, "Also save the profile report as CSV on FILENAME", N_("FILENAME")},
 	{"play", 'p', 0, G_OPTION_ARG_NONE,
 	 &cmdline_options.play, "Play", NULL},
 	{"stop", 's', 0, G_OPTION_ARG_NONE,
@@ -59,7 +59,9 @@ rena_database_exec_query (RenaDatabase *database,
 
 	CDEBUG(DBG_DB, "%s", query);
 
+	RENA_PROFILE_BEGIN(span);
 	sqlite3_exec(database->priv->sqlitedb, query, NULL, NULL, &err);
+	RENA_PROFILE_END(span, "database-exec-query");
 
 	if (err) {
 		g_critical("SQL Err : %s",  err);
@@ -864,6 +866,9 @@ rena_database_update_local_files_change_tag (RenaDatabase *database, GArray *loc
 
 	CDEBUG (DBG_VERBOSE, "Tags Changed: 0x%x", changed);
 
+	/* All changes in a single transaction. */
+	rena_database_begin_transaction (database);
+
 	if (changed & TAG_TNO_CHANGED) {
 		track_no = rena_musicobject_get_track_no (mobj);
 	}
@@ -899,7 +904,6 @@ rena_database_update_local_files_change_tag (RenaDatabase *database, GArray *loc
 			comment_id = rena_database_add_new_comment (database, comment);
 	}
 
-	rena_database_begin_transaction (database);
 	if (loc_arr) {
 		elem = 0;
 		for (i = 0; i < loc_arr->len; i++) {
@@ -960,12 +964,16 @@ rena_database_flush (RenaDatabase *database)
 void
 rena_database_flush_stale_entries (RenaDatabase *database)
 {
+	RENA_PROFILE_BEGIN(span);
+
 	rena_database_exec_query (database, "DELETE FROM ARTIST WHERE id NOT IN (SELECT artist FROM TRACK);");
 	rena_database_exec_query (database, "DELETE FROM ALBUM WHERE id NOT IN (SELECT album FROM TRACK);");
 	rena_database_exec_query (database, "DELETE FROM GENRE WHERE id NOT IN (SELECT genre FROM TRACK);");
 	rena_database_exec_query (database, "DELETE FROM YEAR WHERE id NOT IN (SELECT year FROM TRACK);");
 	rena_database_exec_query (database, "DELETE FROM COMMENT WHERE id NOT IN (SELECT comment FROM TRACK);");
 	rena_database_exec_query (database, "DELETE FROM PLAYLIST WHERE id NOT IN (SELECT playlist FROM PLAYLIST_TRACKS)");
+
+	RENA_PROFILE_END(span, "database-flush-stale-entries");
 }
 
 static gint
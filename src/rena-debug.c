@@ -15,9 +15,22 @@
 /* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
 /*****************************************************************************/
 
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "rena-debug.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+
+#if defined(G_OS_UNIX) && defined(HAVE_EXECINFO_H)
+#define PROFILE_BACKTRACE 1
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#endif
 
 /* Function to save debug on file. */
 
@@ -62,3 +75,411 @@ rena_log_to_file (const gchar* log_domain,
 	log_domain ? log_domain : "Rena", level_name, message);
 	fclose (logfile);
 }
+
+/*
+ * Profiling.
+ *
+ * Named spans accumulate the time spent on slow operations, and a watchdog
+ * records the iterations of the main loop that take longer than a threshold.
+ * The main thread marks the start of each dispatch on the poll function, and
+ * when the dispatch takes too long a watchdog thread samples a backtrace of
+ * the main thread. The stall is named after the source that was dispatched,
+ * recorded on the main thread by rena_profile_dispatch_begin ().
+ */
+
+#define PROFILE_STALL_THRESHOLD (100 * G_TIME_SPAN_MILLISECOND)
+#define PROFILE_MAX_FRAMES      32
+#define PROFILE_MAX_NAME        64
+
+gboolean rena_profile_enabled = FALSE;
+
+typedef struct {
+	guint   count;
+	gint64  total;
+	gint64  max;
+	gchar  *backtrace;
+} RenaProfileStat;
+
+static GMutex      profile_mutex;
+static GHashTable *profile_spans = NULL;
+static GHashTable *profile_stalls = NULL;
+static GPollFunc   profile_poll_func = NULL;
+static gint64      profile_dispatch_start = 0;
+static gboolean    profile_sampled = FALSE;
+static gchar      *profile_output = NULL;
+
+/* Only used from the main thread. */
+static gchar       profile_dispatch_name[PROFILE_MAX_NAME];
+
+typedef struct {
+	gchar  *phase;
+	gint64  time;
+} RenaProfileMark;
+
+static gint64      profile_startup_time = 0;
+static GArray     *profile_startup_marks = NULL;
+
+#ifdef PROFILE_BACKTRACE
+static pthread_t   profile_main_thread;
+static void       *profile_frames[PROFILE_MAX_FRAMES];
+static volatile sig_atomic_t profile_n_frames = 0;
+#endif
+
+static void
+rena_profile_stat_free (RenaProfileStat *stat)
+{
+	g_free (stat->backtrace);
+	g_slice_free (RenaProfileStat, stat);
+}
+
+static RenaProfileStat *
+rena_profile_stat_add (GHashTable *table, const gchar *name, gint64 elapsed)
+{
+	RenaProfileStat *stat;
+
+	stat = g_hash_table_lookup (table, name);
+	if (stat == NULL) {
+		stat = g_slice_new0 (RenaProfileStat);
+		g_hash_table_insert (table, g_strdup (name), stat);
+	}
+	stat->count++;
+	stat->total += elapsed;
+	stat->max = MAX (stat->max, elapsed);
+
+	return stat;
+}
+
+void
+rena_profile_span_end (const gchar *name, gint64 start)
+{
+	gint64 elapsed = g_get_monotonic_time () - start;
+
+	g_mutex_lock (&profile_mutex);
+	rena_profile_stat_add (profile_spans, name, elapsed);
+	g_mutex_unlock (&profile_mutex);
+
+	CDEBUG(DBG_VERBOSE, "Profile: %s took %" G_GINT64_FORMAT " us", name, elapsed);
+}
+
+/* Names the dispatch running on the main thread. Without a name, the name of
+ * the current GSource is used. */
+
+void
+rena_profile_dispatch_begin (const gchar *name)
+{
+	GSource *source;
+
+	if (!rena_profile_enabled)
+		return;
+
+	if (name == NULL) {
+		source = g_main_current_source ();
+		name = source ? g_source_get_name (source) : NULL;
+	}
+
+	g_strlcpy (profile_dispatch_name, name ? name : "", sizeof (profile_dispatch_name));
+}
+
+/* Time of each startup phase since the process started. */
+
+void
+rena_profile_startup_begin (void)
+{
+	profile_startup_time = g_get_monotonic_time ();
+}
+
+void
+rena_profile_startup_mark (const gchar *phase)
+{
+	RenaProfileMark mark;
+
+	mark.phase = g_strdup (phase);
+	mark.time = g_get_monotonic_time () - profile_startup_time;
+
+	g_mutex_lock (&profile_mutex);
+	if (profile_startup_marks == NULL)
+		profile_startup_marks = g_array_new (FALSE, FALSE, sizeof (RenaProfileMark));
+	g_array_append_val (profile_startup_marks, mark);
+	g_mutex_unlock (&profile_mutex);
+
+	CDEBUG(DBG_INFO, "Startup: %s at %.1f ms", phase, mark.time / 1000.0);
+}
+
+#ifdef PROFILE_BACKTRACE
+/* Runs on the main thread, in the middle of the stall. Only async-signal-safe
+ * code here: backtrace () was already primed, and the frames are resolved
+ * once the main loop returns to poll. */
+static void
+rena_profile_sample_handler (int signum)
+{
+	profile_n_frames = backtrace (profile_frames, PROFILE_MAX_FRAMES);
+}
+
+/* Name the stall after the innermost exported function of rena, skipping the
+ * handler and the signal frame. Symbols look like "binary(function+0x10) [0x0]" */
+static gchar *
+rena_profile_stall_name (gchar **symbols, gint n_symbols)
+{
+	const gchar *start, *end;
+	gint i;
+
+	for (i = 2; symbols && i < n_symbols; i++) {
+		start = strstr (symbols[i], "(rena_");
+		if (start == NULL)
+			continue;
+		start++;
+		end = strpbrk (start, "+)");
+		if (end != NULL)
+			return g_strndup (start, end - start);
+	}
+
+	return NULL;
+}
+#endif
+
+static void
+rena_profile_record_stall (const gchar *source, gint64 elapsed, gboolean sampled)
+{
+	RenaProfileStat *stat;
+	gchar *function = NULL, *name = NULL;
+#ifdef PROFILE_BACKTRACE
+	gchar **symbols = NULL;
+	GString *str;
+	gint i, n_frames;
+
+	n_frames = profile_n_frames;
+	profile_n_frames = 0;
+
+	if (sampled && n_frames > 0) {
+		symbols = backtrace_symbols (profile_frames, n_frames);
+		function = rena_profile_stall_name (symbols, n_frames);
+	}
+#endif
+	if (*source && function)
+		name = g_strdup_printf ("%s (%s)", source, function);
+	else if (*source)
+		name = g_strdup (source);
+	else if (function)
+		name = g_strdup (function);
+	else
+		name = g_strdup ("unknown");
+	g_free (function);
+
+	g_mutex_lock (&profile_mutex);
+	stat = rena_profile_stat_add (profile_stalls, name, elapsed);
+#ifdef PROFILE_BACKTRACE
+	if (stat->backtrace == NULL && symbols != NULL) {
+		str = g_string_new (NULL);
+		for (i = 0; i < n_frames; i++)
+			g_string_append_printf (str, "\t\t%s\n", symbols[i]);
+		stat->backtrace = g_string_free (str, FALSE);
+	}
+#endif
+	g_mutex_unlock (&profile_mutex);
+
+#ifdef PROFILE_BACKTRACE
+	free (symbols);
+#endif
+
+	g_warning ("Main loop stalled %" G_GINT64_FORMAT " ms on %s", elapsed / 1000, name);
+	g_free (name);
+}
+
+static gint
+rena_profile_poll (GPollFD *ufds, guint nfds, gint timeout)
+{
+	gint64 start, now;
+	gboolean sampled;
+	gint ret;
+
+	now = g_get_monotonic_time ();
+
+	g_mutex_lock (&profile_mutex);
+	start = profile_dispatch_start;
+	sampled = profile_sampled;
+	profile_dispatch_start = 0;
+	g_mutex_unlock (&profile_mutex);
+
+	if (start && now - start > PROFILE_STALL_THRESHOLD)
+		rena_profile_record_stall (profile_dispatch_name, now - start, sampled);
+
+	profile_dispatch_name[0] = '\0';
+
+	ret = profile_poll_func (ufds, nfds, timeout);
+
+	g_mutex_lock (&profile_mutex);
+	profile_dispatch_start = g_get_monotonic_time ();
+	profile_sampled = FALSE;
+	g_mutex_unlock (&profile_mutex);
+
+	return ret;
+}
+
+static gpointer
+rena_profile_watchdog (gpointer data)
+{
+	gboolean sample;
+
+	while (TRUE) {
+		g_usleep (PROFILE_STALL_THRESHOLD / 2);
+
+		g_mutex_lock (&profile_mutex);
+		sample = profile_dispatch_start != 0 && !profile_sampled &&
+		         g_get_monotonic_time () - profile_dispatch_start > PROFILE_STALL_THRESHOLD;
+		if (sample)
+			profile_sampled = TRUE;
+		g_mutex_unlock (&profile_mutex);
+
+#ifdef PROFILE_BACKTRACE
+		if (sample)
+			pthread_kill (profile_main_thread, SIGPROF);
+#endif
+	}
+
+	return NULL;
+}
+
+void
+rena_profile_enable (void)
+{
+#ifdef PROFILE_BACKTRACE
+	struct sigaction action;
+#endif
+
+	if (rena_profile_enabled)
+		return;
+
+	profile_spans = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) rena_profile_stat_free);
+	profile_stalls = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) rena_profile_stat_free);
+
+#ifdef PROFILE_BACKTRACE
+	/* The first backtrace () may allocate, so not do it from the handler. */
+	profile_n_frames = backtrace (profile_frames, PROFILE_MAX_FRAMES);
+	profile_n_frames = 0;
+
+	profile_main_thread = pthread_self ();
+	memset (&action, 0, sizeof (action));
+	action.sa_handler = rena_profile_sample_handler;
+	sigemptyset (&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction (SIGPROF, &action, NULL);
+#endif
+
+	profile_poll_func = g_main_context_get_poll_func (NULL);
+	g_main_context_set_poll_func (NULL, rena_profile_poll);
+
+	g_thread_unref (g_thread_new ("Profile watchdog", rena_profile_watchdog, NULL));
+
+	rena_profile_enabled = TRUE;
+}
+
+static gint
+rena_profile_compare_total (gconstpointer a, gconstpointer b, gpointer table)
+{
+	const RenaProfileStat *stat_a = g_hash_table_lookup (table, a);
+	const RenaProfileStat *stat_b = g_hash_table_lookup (table, b);
+
+	return (stat_a->total < stat_b->total) - (stat_a->total > stat_b->total);
+}
+
+static void
+rena_profile_print_table (const gchar *title, GHashTable *table)
+{
+	RenaProfileStat *stat;
+	GList *names, *l;
+
+	g_printerr ("%s:\n", title);
+
+	names = g_hash_table_get_keys (table);
+	names = g_list_sort_with_data (names, rena_profile_compare_total, table);
+	for (l = names; l != NULL; l = l->next) {
+		stat = g_hash_table_lookup (table, l->data);
+		g_printerr ("\t%-40s %6u calls %10.1f ms total %8.1f ms avg %8.1f ms max\n",
+		            (const gchar *) l->data, stat->count,
+		            stat->total / 1000.0,
+		            stat->total / 1000.0 / stat->count,
+		            stat->max / 1000.0);
+		if (stat->backtrace)
+			g_printerr ("%s", stat->backtrace);
+	}
+	g_list_free (names);
+}
+
+static void
+rena_profile_print_startup (void)
+{
+	RenaProfileMark *mark;
+	guint i;
+
+	if (profile_startup_marks == NULL)
+		return;
+
+	g_printerr ("Startup timeline:\n");
+	for (i = 0; i < profile_startup_marks->len; i++) {
+		mark = &g_array_index (profile_startup_marks, RenaProfileMark, i);
+		g_printerr ("\t%-40s %10.1f ms\n", mark->phase, mark->time / 1000.0);
+	}
+}
+
+/* Machine readable report, to compare between builds. */
+
+void
+rena_profile_set_output (const gchar *filename)
+{
+	g_free (profile_output);
+	profile_output = g_strdup (filename);
+}
+
+static void
+rena_profile_write_table (GString *str, const gchar *kind, GHashTable *table)
+{
+	RenaProfileStat *stat;
+	GHashTableIter iter;
+	gpointer name;
+
+	g_hash_table_iter_init (&iter, table);
+	while (g_hash_table_iter_next (&iter, &name, (gpointer *) &stat)) {
+		g_string_append_printf (str, "%s,%s,%u,%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT "\n",
+		                        kind, (const gchar *) name, stat->count,
+		                        stat->total, stat->total / stat->count, stat->max);
+	}
+}
+
+static void
+rena_profile_write_output (void)
+{
+	RenaProfileMark *mark;
+	GError *error = NULL;
+	GString *str;
+	guint i;
+
+	str = g_string_new ("kind,name,count,total_us,avg_us,max_us\n");
+	rena_profile_write_table (str, "span", profile_spans);
+	rena_profile_write_table (str, "stall", profile_stalls);
+	for (i = 0; profile_startup_marks && i < profile_startup_marks->len; i++) {
+		mark = &g_array_index (profile_startup_marks, RenaProfileMark, i);
+		g_string_append_printf (str, "startup,%s,1,%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT "\n",
+		                        mark->phase, mark->time, mark->time, mark->time);
+	}
+
+	if (!g_file_set_contents (profile_output, str->str, str->len, &error)) {
+		g_warning ("Unable to save profile on %s: %s", profile_output, error->message);
+		g_error_free (error);
+	}
+	g_string_free (str, TRUE);
+}
+
+void
+rena_profile_report (void)
+{
+	if (!rena_profile_enabled)
+		return;
+
+	g_mutex_lock (&profile_mutex);
+	rena_profile_print_table ("Timing spans", profile_spans);
+	rena_profile_print_table ("Main loop stalls", profile_stalls);
+	rena_profile_print_startup ();
+	if (profile_output)
+		rena_profile_write_output ();
+	g_mutex_unlock (&profile_mutex);
+}
@@ -35,6 +35,28 @@ extern gint debug_level;
 	if (G_UNLIKELY(_lvl <= debug_level))	\
 		g_debug(_fmt, ##__VA_ARGS__);
 
+/* Profiling. Enabled with --profile, and reported on exit. */
+
+extern gboolean rena_profile_enabled;
+
+#define RENA_PROFILE_BEGIN(_span)					\
+	gint64 _span = G_UNLIKELY(rena_profile_enabled) ? g_get_monotonic_time () : 0;
+
+#define RENA_PROFILE_END(_span, _name)				\
+	if (G_UNLIKELY(_span != 0))					\
+		rena_profile_span_end (_name, _span);
+
+void rena_profile_enable     (void);
+void rena_profile_set_output (const gchar *filename);
+void rena_profile_span_end (const gchar *name, gint64 start);
+void rena_profile_dispatch_begin (const gchar *name);
+void rena_profile_report   (void);
+
+/* Startup timeline. Always recorded, and reported with the profile. */
+
+void rena_profile_startup_begin (void);
+void rena_profile_startup_mark  (const gchar *phase);
+
 void
 rena_log_to_file (const gchar* log_domain,
                     GLogLevelFlags log_level,
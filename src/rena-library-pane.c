@@ -51,39 +51,49 @@
 
 #include "rena-window-ui.h"
 
-struct _RenaLibraryPane {
-	GtkBox           __parent__;
+/* What fills and filters the library store. Kept apart from the widgets,
+ * so the library can also be built without a display. */
 
+struct _RenaLibraryView {
 	/* Global database and preferences instances */
 	RenaDatabase    *cdbase;
 	RenaPreferences *preferences;
 
+	/* Tree view order. TODO: Rework and remove it. */
+	GSList          *nodes;
+
+	/* Filter stuff */
+	gchar           *filter_entry;
+
+	/* Fixbuf used on library tree. */
+	GdkPixbuf       *pixbuf_artist;
+	GdkPixbuf       *pixbuf_album;
+	GdkPixbuf       *pixbuf_track;
+	GdkPixbuf       *pixbuf_genre;
+	GdkPixbuf       *pixbuf_dir;
+};
+
+struct _RenaLibraryPane {
+	GtkBox           __parent__;
+
+	/* Store, database and preferences */
+	RenaLibraryView *view;
+
 	/* Tree view */
 	GtkTreeStore      *library_store;
 	GtkWidget         *library_tree;
 	GtkWidget         *search_entry;
 	GtkWidget         *pane_title;
 
-	/* Tree view order. TODO: Rework and remove it. */
-	GSList            *library_tree_nodes;
-
 	/* Useful flags */
 	gboolean           dragging;
 	gboolean           view_change;
 
 	/* Filter stuff */
-	gchar             *filter_entry;
 	guint              filter_id;
 	gboolean           filter_active;
 	guint              pulse_id;
 
-	/* Fixbuf used on library tree. */
-	GdkPixbuf         *pixbuf_artist;
-	GdkPixbuf         *pixbuf_album;
-	GdkPixbuf         *pixbuf_track;
-	GdkPixbuf         *pixbuf_genre;
-	GdkPixbuf         *pixbuf_dir;
-
 	/* Menu */
 	GtkBuilder        *builder;
 	GSimpleActionGroup *actions;
@@ -102,35 +112,6 @@ static int signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE(RenaLibraryPane, rena_library_pane, GTK_TYPE_BOX)
 
-/* Node types in library view */
-
-typedef enum {
-	NODE_CATEGORY_PLAYLIST,
-	NODE_CATEGORY_RADIO,
-	NODE_CATEGORY_PROVIDER,
-	NODE_FOLDER,
-	NODE_GENRE,
-	NODE_ARTIST,
-	NODE_ALBUM,
-	NODE_TRACK,
-	NODE_BASENAME,
-	NODE_PLAYLIST,
-	NODE_RADIO
-} LibraryNodeType;
-
-/* Columns in Library view */
-
-enum library_columns {
-	L_PIXBUF,
-	L_NODE_DATA,
-	L_NODE_BOLD,
-	L_NODE_TYPE,
-	L_DATABASE_ID,
-	L_MACH,
-	L_VISIBILE,
-	N_L_COLUMNS
-};
-
 typedef enum {
 	RENA_RESPONSE_SKIP,
 	RENA_RESPONSE_SKIP_ALL,
@@ -183,7 +164,7 @@ rena_library_pane_folder_action (GSimpleAction *action,
                                    gpointer       user_data)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (user_data);
-	rena_preferences_set_library_style(library->preferences, FOLDERS);
+	rena_preferences_set_library_style(library->view->preferences, FOLDERS);
 }
 
 static void
@@ -192,7 +173,7 @@ rena_library_pane_artist_action (GSimpleAction *action,
                                    gpointer       user_data)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (user_data);
-	rena_preferences_set_library_style(library->preferences, ARTIST);
+	rena_preferences_set_library_style(library->view->preferences, ARTIST);
 }
 
 static void
@@ -201,7 +182,7 @@ rena_library_pane_album_action (GSimpleAction *action,
                                   gpointer       user_data)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (user_data);
-	rena_preferences_set_library_style(library->preferences, ALBUM);
+	rena_preferences_set_library_style(library->view->preferences, ALBUM);
 }
 
 static void
@@ -210,7 +191,7 @@ rena_library_pane_genre_action (GSimpleAction *action,
                                   gpointer       user_data)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (user_data);
-	rena_preferences_set_library_style(library->preferences, GENRE);
+	rena_preferences_set_library_style(library->view->preferences, GENRE);
 }
 
 static void
@@ -219,7 +200,7 @@ rena_library_pane_artist_album_action (GSimpleAction *action,
                                          gpointer       user_data)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (user_data);
-	rena_preferences_set_library_style(library->preferences, ARTIST_ALBUM);
+	rena_preferences_set_library_style(library->view->preferences, ARTIST_ALBUM);
 }
 
 static void
@@ -228,7 +209,7 @@ rena_library_pane_genre_album_action (GSimpleAction *action,
                                         gpointer       user_data)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (user_data);
-	rena_preferences_set_library_style(library->preferences, GENRE_ALBUM);
+	rena_preferences_set_library_style(library->view->preferences, GENRE_ALBUM);
 }
 
 static void
@@ -237,7 +218,7 @@ rena_library_pane_genre_artist_action (GSimpleAction *action,
                                          gpointer       user_data)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (user_data);
-	rena_preferences_set_library_style(library->preferences, GENRE_ARTIST);
+	rena_preferences_set_library_style(library->view->preferences, GENRE_ARTIST);
 }
 
 static void
@@ -246,7 +227,7 @@ rena_library_pane_genre_artist_album_action (GSimpleAction *action,
                                                gpointer       user_data)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (user_data);
-	rena_preferences_set_library_style(library->preferences, GENRE_ARTIST_ALBUM);
+	rena_preferences_set_library_style(library->view->preferences, GENRE_ARTIST_ALBUM);
 }
 
 /*
@@ -465,7 +446,7 @@ add_child_node_folder(GtkTreeModel *model,
 		      GtkTreeIter *iter,
 		      GtkTreeIter *p_iter,
 		      const gchar *node_data,
-		      RenaLibraryPane *clibrary)
+		      RenaLibraryView *view)
 {
 	GtkTreeIter l_iter;
 	gchar *data = NULL;
@@ -490,7 +471,7 @@ add_child_node_folder(GtkTreeModel *model,
 
 	/* Insert the new folder after the last subdirectory by order */
 	gtk_tree_store_insert_before (GTK_TREE_STORE(model), iter, p_iter, valid ? &l_iter : NULL);
-	gtk_tree_store_set (GTK_TREE_STORE(model), iter, L_PIXBUF, clibrary->pixbuf_dir,
+	gtk_tree_store_set (GTK_TREE_STORE(model), iter, L_PIXBUF, view->pixbuf_dir,
 	                    L_NODE_DATA, node_data,
 	                    L_NODE_BOLD, PANGO_WEIGHT_NORMAL,
 	                    L_NODE_TYPE, NODE_FOLDER,
@@ -509,7 +490,7 @@ add_child_node_file(GtkTreeModel *model,
 		    GtkTreeIter *p_iter,
 		    const gchar *node_data,
 		    int location_id,
-		    RenaLibraryPane *clibrary)
+		    RenaLibraryView *view)
 {
 	GtkTreeIter l_iter;
 	gchar *data = NULL;
@@ -534,7 +515,7 @@ add_child_node_file(GtkTreeModel *model,
 	/* Insert the new file after the last file by order */
 	gtk_tree_store_insert_before (GTK_TREE_STORE(model), iter, p_iter, valid ? &l_iter : NULL);
 	gtk_tree_store_set (GTK_TREE_STORE(model), iter,
-	                    L_PIXBUF, clibrary->pixbuf_track,
+	                    L_PIXBUF, view->pixbuf_track,
 	                    L_NODE_DATA, node_data,
 	                    L_NODE_BOLD, PANGO_WEIGHT_NORMAL,
 	                    L_NODE_TYPE, NODE_BASENAME,
@@ -551,7 +532,7 @@ add_folder_file(GtkTreeModel *model,
                 const gchar *filepath,
                 int location_id,
                 GtkTreeIter *p_iter,
-                RenaLibraryPane *clibrary)
+                RenaLibraryView *view)
 {
 	gchar **subpaths = NULL;		/* To be freed */
 
@@ -569,9 +550,9 @@ add_folder_file(GtkTreeModel *model,
 	for (i = 0; subpaths[i]; i++) {
 		if (!find_child_node(subpaths[i], &search_iter, p_iter, model)) {
 			if(i < len)
-				add_child_node_folder(model, &iter, p_iter, subpaths[i], clibrary);
+				add_child_node_folder(model, &iter, p_iter, subpaths[i], view);
 			else
-				add_child_node_file(model, &iter, p_iter, subpaths[i], location_id, clibrary);
+				add_child_node_file(model, &iter, p_iter, subpaths[i], location_id, view);
 			p_iter = &iter;
 		}
 		else {
@@ -595,7 +576,7 @@ add_child_node_by_tags (GtkTreeModel *model,
                        const gchar *year,
                        const gchar *artist,
                        const gchar *track,
-                       RenaLibraryPane *clibrary)
+                       RenaLibraryView *view)
 {
 	GtkTreeIter iter, iter2, search_iter;
 	gchar *node_data = NULL;
@@ -605,13 +586,13 @@ add_child_node_by_tags (GtkTreeModel *model,
 	gboolean need_gfree = FALSE;
 
 	/* Iterate through library tree node types */ 
-	tot_levels = g_slist_length(clibrary->library_tree_nodes);
+	tot_levels = g_slist_length(view->nodes);
 	while (node_level < tot_levels) {
 		/* Set data to be added to the tree node depending on the type of node */
-		node_type = GPOINTER_TO_INT(g_slist_nth_data(clibrary->library_tree_nodes, node_level));
+		node_type = GPOINTER_TO_INT(g_slist_nth_data(view->nodes, node_level));
 		switch (node_type) {
 			case NODE_TRACK:
-				node_pixbuf = clibrary->pixbuf_track;
+				node_pixbuf = view->pixbuf_track;
 				if (string_is_not_empty(track)) {
 					node_data = (gchar *)track;
 				}
@@ -621,12 +602,12 @@ add_child_node_by_tags (GtkTreeModel *model,
 				}
 				break;
 			case NODE_ARTIST:
-				node_pixbuf = clibrary->pixbuf_artist;
+				node_pixbuf = view->pixbuf_artist;
 				node_data = string_is_not_empty(artist) ? (gchar *)artist : _("Unknown Artist");
 				break;
 			case NODE_ALBUM:
-				node_pixbuf = clibrary->pixbuf_album;
-				if (rena_preferences_get_sort_by_year(clibrary->preferences)) {
+				node_pixbuf = view->pixbuf_album;
+				if (rena_preferences_get_sort_by_year(view->preferences)) {
 					node_data = g_strconcat ((string_is_not_empty(year) && (atoi(year) > 0)) ? year : _("Unknown"),
 					                          " - ",
 					                          string_is_not_empty(album) ? album : _("Unknown Album"),
@@ -638,7 +619,7 @@ add_child_node_by_tags (GtkTreeModel *model,
 				}
 				break;
 			case NODE_GENRE:
-				node_pixbuf = clibrary->pixbuf_genre;
+				node_pixbuf = view->pixbuf_genre;
 				node_data = string_is_not_empty(genre) ? (gchar *)genre : _("Unknown Genre");
 				break;
 			case NODE_CATEGORY_PLAYLIST:
@@ -779,7 +760,7 @@ append_uri_string_list(GtkTreeIter *r_iter,
 		case NODE_TRACK:
 		case NODE_BASENAME:
 			gtk_tree_model_get(model, r_iter, L_DATABASE_ID, &location_id, -1);
-			filename = rena_database_get_filename_from_location_id(clibrary->cdbase, location_id);
+			filename = rena_database_get_filename_from_location_id(clibrary->view->cdbase, location_id);
 			break;
 		case NODE_PLAYLIST:
 		case NODE_RADIO:
@@ -962,7 +943,7 @@ trash_or_unlink_row (GArray *loc_arr, gboolean unlink, RenaLibraryPane *library)
 	for(i = 0; i < loc_arr->len; i++) {
 		location_id = g_array_index(loc_arr, gint, i);
 		if (location_id) {
-			filename = rena_database_get_filename_from_location_id (library->cdbase, location_id);
+			filename = rena_database_get_filename_from_location_id (library->view->cdbase, location_id);
 			if (filename && g_file_test(filename, G_FILE_TEST_EXISTS)) {
 				file = g_file_new_for_path(filename);
 
@@ -1016,7 +997,7 @@ trash_or_unlink_row (GArray *loc_arr, gboolean unlink, RenaLibraryPane *library)
 				g_object_unref(G_OBJECT(file));
 			}
 			if (deleted) {
-				rena_database_forget_location (library->cdbase, location_id);
+				rena_database_forget_location (library->view->cdbase, location_id);
 			}
 		}
 	}
@@ -1413,8 +1394,8 @@ rena_library_pane_set_all_visible_func (GtkTreeModel *model,
                                           GtkTreeIter  *iter,
                                           gpointer      data)
 {
-	RenaLibraryPane *library = data;
-	if (library->filter_entry != NULL)
+	RenaLibraryView *view = data;
+	if (view->filter_entry != NULL)
 		return TRUE;
 
 	/* Have to give control to GTK periodically ... */
@@ -1490,9 +1471,9 @@ rena_libary_pane_filter_tree_func (GtkTreeModel *model,
 	gchar *node_data = NULL, *u_str;
 	gboolean p_mach;
 
-	RenaLibraryPane *library = data;
+	RenaLibraryView *view = data;
 
-	if (library->filter_entry == NULL)
+	if (view->filter_entry == NULL)
 		return TRUE;
 
 	/* Have to give control to GTK periodically ... */
@@ -1505,7 +1486,7 @@ rena_libary_pane_filter_tree_func (GtkTreeModel *model,
 
 	gtk_tree_model_get(model, iter, L_NODE_DATA, &node_data, -1);
 	u_str = g_utf8_strdown(node_data, -1);
-	if (rena_strstr_lv(u_str, library->filter_entry, library->preferences))
+	if (rena_strstr_lv(u_str, view->filter_entry, view->preferences))
 	{
 		/* Set visible the match row */
 		gtk_tree_store_set (GTK_TREE_STORE(model), iter,
@@ -1528,6 +1509,28 @@ rena_libary_pane_filter_tree_func (GtkTreeModel *model,
 	return FALSE;
 }
 
+/* Sets the text searched in the library, or none if empty. */
+
+void
+rena_library_view_set_filter (RenaLibraryView *view, const gchar *text)
+{
+	if (view->filter_entry != NULL) {
+		g_free (view->filter_entry);
+		view->filter_entry = NULL;
+	}
+
+	if (string_is_not_empty(text))
+		view->filter_entry = g_utf8_strdown (text, -1);
+}
+
+/* Set visibility of rows in the library store. */
+
+void
+rena_library_view_filter (RenaLibraryView *view, GtkTreeModel *model)
+{
+	gtk_tree_model_foreach (model, rena_libary_pane_filter_tree_func, view);
+}
+
 static void
 rena_library_pane_do_filter (RenaLibraryPane *library)
 {
@@ -1545,8 +1548,7 @@ rena_library_pane_do_filter (RenaLibraryPane *library)
 	rena_process_gtk_events ();
 
 	/* Set visibility of rows in the library store. */
-	gtk_tree_model_foreach (GTK_TREE_MODEL(library->library_store),
-	                        rena_libary_pane_filter_tree_func, library);
+	rena_library_view_filter (library->view, GTK_TREE_MODEL(library->library_store));
 
 	/* Have to give control to GTK periodically ... */
 	rena_process_gtk_events ();
@@ -1586,7 +1588,7 @@ rena_library_pane_show_all (RenaLibraryPane *library)
 
 	/* Set all nodes visibles. */
 	gtk_tree_model_foreach (GTK_TREE_MODEL(library->library_store),
-	                        rena_library_pane_set_all_visible_func, library);
+	                        rena_library_pane_set_all_visible_func, library->view);
 
 	/* Have to give control to GTK periodically ... */
 	rena_process_gtk_events ();
@@ -1623,14 +1625,16 @@ rena_library_pane_do_refilter (RenaLibraryPane *clibrary)
 		return TRUE;
 
 	clibrary->filter_active = TRUE;
-	needle = g_strdup(clibrary->filter_entry);
+	needle = g_strdup(clibrary->view->filter_entry);
 
 	rena_process_gtk_events ();
 
-	if (clibrary->filter_entry != NULL)
+	RENA_PROFILE_BEGIN(span);
+	if (clibrary->view->filter_entry != NULL)
 		rena_library_pane_do_filter (clibrary);
 	else
 		rena_library_pane_show_all (clibrary);
+	RENA_PROFILE_END(span, "library-search");
 
 	/* Have to give control to GTK periodically ... */
 	rena_process_gtk_events ();
@@ -1639,7 +1643,7 @@ rena_library_pane_do_refilter (RenaLibraryPane *clibrary)
 	clibrary->filter_active = FALSE;
 
 	/* If changed the needle search again. */
-	if (needle && g_ascii_strcasecmp(needle, clibrary->filter_entry))
+	if (needle && g_ascii_strcasecmp(needle, clibrary->view->filter_entry))
 		ret = TRUE;
 
 	g_free(needle);
@@ -1668,19 +1672,10 @@ static void
 simple_library_search_keyrelease_handler (GtkEntry          *entry,
                                           RenaLibraryPane *clibrary)
 {
-	const gchar *filter_entry = NULL;
-
-	if (!rena_preferences_get_instant_search(clibrary->preferences))
+	if (!rena_preferences_get_instant_search(clibrary->view->preferences))
 		return;
 
-	if (clibrary->filter_entry != NULL) {
-		g_free (clibrary->filter_entry);
-		clibrary->filter_entry = NULL;
-	}
-
-	filter_entry = gtk_entry_get_text (entry);
-	if (string_is_not_empty(filter_entry))
-		clibrary->filter_entry = g_utf8_strdown (filter_entry, -1);
+	rena_library_view_set_filter (clibrary->view, gtk_entry_get_text (entry));
 
 	rena_library_panel_queue_refilter(clibrary);
 }
@@ -1689,18 +1684,10 @@ gboolean
 simple_library_search_activate_handler (GtkEntry          *entry,
                                         RenaLibraryPane *clibrary)
 {
-	const gchar *filter_entry = NULL;
-
-	if (!rena_preferences_get_instant_search(clibrary->preferences))
+	if (!rena_preferences_get_instant_search(clibrary->view->preferences))
 		return FALSE;
 
-	if (clibrary->filter_entry != NULL) {
-		g_free (clibrary->filter_entry);
-		clibrary->filter_entry = NULL;
-	}
-	filter_entry = gtk_entry_get_text (entry);
-	if (string_is_not_empty(filter_entry))
-		clibrary->filter_entry = g_utf8_strdown (filter_entry, -1);
+	rena_library_view_set_filter (clibrary->view, gtk_entry_get_text (entry));
 
 	rena_library_panel_queue_refilter (clibrary);
 
@@ -1792,112 +1779,144 @@ rena_library_need_update_view(RenaPreferences *preferences, gint changed)
 gboolean
 rena_library_need_update(RenaLibraryPane *clibrary, gint changed)
 {
-	return rena_library_need_update_view(clibrary->preferences, changed);
+	return rena_library_need_update_view(clibrary->view->preferences, changed);
 }
 
 /********************************/
 /* Library view order selection */
 /********************************/
 
-static void
-library_pane_update_style (RenaLibraryPane *library)
+void
+rena_library_view_update_style (RenaLibraryView *view)
 {
-	g_slist_free (library->library_tree_nodes);
-	library->library_tree_nodes = NULL;
+	g_slist_free (view->nodes);
+	view->nodes = NULL;
 
-	switch (rena_preferences_get_library_style(library->preferences)) {
+	switch (rena_preferences_get_library_style(view->preferences)) {
 		case FOLDERS:
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 					       GINT_TO_POINTER(NODE_FOLDER));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				              GINT_TO_POINTER(NODE_BASENAME));
-			gtk_label_set_text (GTK_LABEL(library->pane_title), _("Folders structure"));
 			break;
 		case ARTIST:
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_ARTIST));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_TRACK));
-			gtk_label_set_text (GTK_LABEL(library->pane_title), _("Artist"));
 			break;
 		case ALBUM:
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_ALBUM));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_TRACK));
-			gtk_label_set_text (GTK_LABEL(library->pane_title), _("Album"));
 			break;
 		case GENRE:
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_GENRE));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_TRACK));
-			gtk_label_set_text (GTK_LABEL(library->pane_title), _("Genre"));
 			break;
 		case ARTIST_ALBUM:
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_ARTIST));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_ALBUM));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_TRACK));
-			gtk_label_set_text (GTK_LABEL(library->pane_title), _("Artist / Album"));
 			break;
 		case GENRE_ARTIST:
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_GENRE));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_ARTIST));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_TRACK));
-			gtk_label_set_text (GTK_LABEL(library->pane_title), _("Genre / Artist"));
 			break;
 		case GENRE_ALBUM:
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_GENRE));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_ALBUM));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_TRACK));
-			gtk_label_set_text (GTK_LABEL(library->pane_title), _("Genre / Album"));
 			break;
 		case GENRE_ARTIST_ALBUM:
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_GENRE));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_ARTIST));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_ALBUM));
-			library->library_tree_nodes =
-				g_slist_append(library->library_tree_nodes,
+			view->nodes =
+				g_slist_append(view->nodes,
 				               GINT_TO_POINTER(NODE_TRACK));
-			gtk_label_set_text (GTK_LABEL(library->pane_title), _("Genre / Artist / Album"));
 			break;
 		default:
 			break;
 	}
 }
 
+static void
+library_pane_update_style (RenaLibraryPane *library)
+{
+	const gchar *title = NULL;
+
+	rena_library_view_update_style (library->view);
+
+	switch (rena_preferences_get_library_style(library->view->preferences)) {
+		case FOLDERS:
+			title = _("Folders structure");
+			break;
+		case ARTIST:
+			title = _("Artist");
+			break;
+		case ALBUM:
+			title = _("Album");
+			break;
+		case GENRE:
+			title = _("Genre");
+			break;
+		case ARTIST_ALBUM:
+			title = _("Artist / Album");
+			break;
+		case GENRE_ARTIST:
+			title = _("Genre / Artist");
+			break;
+		case GENRE_ALBUM:
+			title = _("Genre / Album");
+			break;
+		case GENRE_ARTIST_ALBUM:
+			title = _("Genre / Artist / Album");
+			break;
+		default:
+			break;
+	}
+
+	if (title)
+		gtk_label_set_text (GTK_LABEL(library->pane_title), title);
+}
+
 static void
 library_pane_change_style (GObject *gobject, GParamSpec *pspec, RenaLibraryPane *library)
 {
@@ -1919,7 +1938,7 @@ library_view_append_playlists(GtkTreeModel *model,
 	GtkTreeIter iter;
 
 	sql = "SELECT name FROM PLAYLIST WHERE name != ? ORDER BY name COLLATE NOCASE DESC";
-	statement = rena_database_create_statement (clibrary->cdbase, sql);
+	statement = rena_database_create_statement (clibrary->view->cdbase, sql);
 	rena_prepared_statement_bind_string (statement, 1, SAVE_PLAYLIST_STATE);
 
 	while (rena_prepared_statement_step (statement)) {
@@ -1928,7 +1947,7 @@ library_view_append_playlists(GtkTreeModel *model,
 		library_store_prepend_node(model,
 		                           &iter,
 		                           p_iter,
-		                           clibrary->pixbuf_track,
+		                           clibrary->view->pixbuf_track,
 		                           playlist,
 		                           NODE_PLAYLIST,
 		                           0);
@@ -1948,14 +1967,14 @@ library_view_append_radios(GtkTreeModel *model,
 	GtkTreeIter iter;
 
 	sql = "SELECT name FROM RADIO ORDER BY name COLLATE NOCASE DESC";
-	statement = rena_database_create_statement (clibrary->cdbase, sql);
+	statement = rena_database_create_statement (clibrary->view->cdbase, sql);
 	while (rena_prepared_statement_step (statement)) {
 		radio = rena_prepared_statement_get_string(statement, 0);
 
 		library_store_prepend_node(model,
 		                           &iter,
 		                           p_iter,
-		                           clibrary->pixbuf_track,
+		                           clibrary->view->pixbuf_track,
 		                           radio,
 		                           NODE_RADIO,
 		                           0);
@@ -1966,7 +1985,7 @@ library_view_append_radios(GtkTreeModel *model,
 }
 
 static void
-rena_library_view_append_provider_by_folder (RenaLibraryPane *clibrary,
+rena_library_view_append_provider_by_folder (RenaLibraryView   *view,
                                                GtkTreeModel      *model,
                                                GtkTreeIter       *p_iter,
                                                const gchar       *provider)
@@ -1978,9 +1997,9 @@ rena_library_view_append_provider_by_folder (RenaLibraryPane *clibrary,
 
 	sql = "SELECT name, id FROM LOCATION WHERE id IN (SELECT location FROM TRACK WHERE PROVIDER = ?) ORDER BY name DESC";
 
-	statement = rena_database_create_statement (clibrary->cdbase, sql);
+	statement = rena_database_create_statement (view->cdbase, sql);
 
-	provider_id = rena_database_find_provider (clibrary->cdbase, provider);
+	provider_id = rena_database_find_provider (view->cdbase, provider);
 	rena_prepared_statement_bind_int (statement, 1, provider_id);
 
 	while (rena_prepared_statement_step (statement)) {
@@ -1999,7 +2018,7 @@ rena_library_view_append_provider_by_folder (RenaLibraryPane *clibrary,
 		                filename,
 		                rena_prepared_statement_get_int(statement, 1),
 		                p_iter,
-		                clibrary);
+		                view);
 		rena_process_gtk_events ();
 	}
 
@@ -2007,7 +2026,7 @@ rena_library_view_append_provider_by_folder (RenaLibraryPane *clibrary,
 }
 
 static void
-rena_library_view_append_provider_by_tags (RenaLibraryPane *clibrary,
+rena_library_view_append_provider_by_tags (RenaLibraryView   *view,
                                              GtkTreeModel      *model,
                                              GtkTreeIter       *p_iter,
                                              const gchar       *provider)
@@ -2017,14 +2036,14 @@ rena_library_view_append_provider_by_tags (RenaLibraryPane *clibrary,
 	gint provider_id = 0;
 
 	/* Get order needed to sqlite query. */
-	switch(rena_preferences_get_library_style(clibrary->preferences)) {
+	switch(rena_preferences_get_library_style(view->preferences)) {
 		case FOLDERS:
 			break;
 		case ARTIST:
 			order_str = g_strdup("ARTIST.name COLLATE NOCASE DESC, TRACK.title COLLATE NOCASE DESC");
 			break;
 		case ALBUM:
-			if (rena_preferences_get_sort_by_year(clibrary->preferences))
+			if (rena_preferences_get_sort_by_year(view->preferences))
 				order_str = g_strdup("YEAR.year COLLATE NOCASE DESC, ALBUM.name COLLATE NOCASE DESC, TRACK.title COLLATE NOCASE DESC");
 			else
 				order_str = g_strdup("ALBUM.name COLLATE NOCASE DESC, TRACK.title COLLATE NOCASE DESC");
@@ -2033,7 +2052,7 @@ rena_library_view_append_provider_by_tags (RenaLibraryPane *clibrary,
 			order_str = g_strdup("GENRE.name COLLATE NOCASE DESC, TRACK.title COLLATE NOCASE DESC");
 			break;
 		case ARTIST_ALBUM:
-			if (rena_preferences_get_sort_by_year(clibrary->preferences))
+			if (rena_preferences_get_sort_by_year(view->preferences))
 				order_str = g_strdup("ARTIST.name COLLATE NOCASE DESC, YEAR.year COLLATE NOCASE DESC, ALBUM.name COLLATE NOCASE DESC, TRACK.track_no COLLATE NOCASE DESC");
 			else
 				order_str = g_strdup("ARTIST.name COLLATE NOCASE DESC, ALBUM.name COLLATE NOCASE DESC, TRACK.track_no COLLATE NOCASE DESC");
@@ -2042,13 +2061,13 @@ rena_library_view_append_provider_by_tags (RenaLibraryPane *clibrary,
 			order_str = g_strdup("GENRE.name COLLATE NOCASE DESC, ARTIST.name COLLATE NOCASE DESC, TRACK.title COLLATE NOCASE DESC");
 			break;
 		case GENRE_ALBUM:
-			if (rena_preferences_get_sort_by_year(clibrary->preferences))
+			if (rena_preferences_get_sort_by_year(view->preferences))
 				order_str = g_strdup("GENRE.name COLLATE NOCASE DESC, YEAR.year COLLATE NOCASE DESC, ALBUM.name COLLATE NOCASE DESC, TRACK.track_no COLLATE NOCASE DESC");
 			else
 				order_str = g_strdup("GENRE.name COLLATE NOCASE DESC, ALBUM.name COLLATE NOCASE DESC, TRACK.track_no COLLATE NOCASE DESC");
 			break;
 		case GENRE_ARTIST_ALBUM:
-			if (rena_preferences_get_sort_by_year(clibrary->preferences))
+			if (rena_preferences_get_sort_by_year(view->preferences))
 				order_str = g_strdup("GENRE.name COLLATE NOCASE DESC, ARTIST.name COLLATE NOCASE DESC, YEAR.year COLLATE NOCASE DESC, ALBUM.name COLLATE NOCASE DESC, TRACK.track_no COLLATE NOCASE DESC");
 			else
 				order_str = g_strdup("GENRE.name COLLATE NOCASE DESC, ARTIST.name COLLATE NOCASE DESC, ALBUM.name COLLATE NOCASE DESC, TRACK.track_no COLLATE NOCASE DESC");
@@ -2063,8 +2082,8 @@ rena_library_view_append_provider_by_tags (RenaLibraryPane *clibrary,
 	                        "WHERE PROVIDER = ? AND ARTIST.id = TRACK.artist AND TRACK.year = YEAR.id AND ALBUM.id = TRACK.album AND GENRE.id = TRACK.genre AND LOCATION.id = TRACK.location "
 	                        "ORDER BY %s;", order_str);
 
-	statement = rena_database_create_statement (clibrary->cdbase, sql);
-	provider_id = rena_database_find_provider (clibrary->cdbase, provider);
+	statement = rena_database_create_statement (view->cdbase, sql);
+	provider_id = rena_database_find_provider (view->cdbase, provider);
 	rena_prepared_statement_bind_int (statement, 1, provider_id);
 
 	while (rena_prepared_statement_step (statement)) {
@@ -2077,7 +2096,7 @@ rena_library_view_append_provider_by_tags (RenaLibraryPane *clibrary,
 		                       rena_prepared_statement_get_string(statement, 2),
 		                       rena_prepared_statement_get_string(statement, 1),
 		                       rena_prepared_statement_get_string(statement, 0),
-		                       clibrary);
+		                       view);
 
 		/* Have to give control to GTK periodically ... */
 		rena_process_gtk_events ();
@@ -2088,6 +2107,20 @@ rena_library_view_append_provider_by_tags (RenaLibraryPane *clibrary,
 	g_free(sql);
 }
 
+/* Appends the songs of a provider below p_iter, in the current style. */
+
+void
+rena_library_view_append_provider (RenaLibraryView *view,
+                                   GtkTreeModel    *model,
+                                   GtkTreeIter     *p_iter,
+                                   const gchar     *provider)
+{
+	if (rena_preferences_get_library_style(view->preferences) == FOLDERS)
+		rena_library_view_append_provider_by_folder (view, model, p_iter, provider);
+	else
+		rena_library_view_append_provider_by_tags (view, model, p_iter, provider);
+}
+
 void
 library_pane_view_reload(RenaLibraryPane *clibrary)
 {
@@ -2098,6 +2131,8 @@ library_pane_view_reload(RenaLibraryPane *clibrary)
 	GSList *provider_list, *l;
 	gchar *icon_name, *friendly_name = NULL;
 
+	RENA_PROFILE_BEGIN(span);
+
 	clibrary->view_change = TRUE;
 
 	set_watch_cursor (GTK_WIDGET(clibrary));
@@ -2118,7 +2153,7 @@ library_pane_view_reload(RenaLibraryPane *clibrary)
 			      &iter,
 			      NULL);
 	gtk_tree_store_set(GTK_TREE_STORE(model), &iter,
-			   L_PIXBUF, clibrary->pixbuf_dir,
+			   L_PIXBUF, clibrary->view->pixbuf_dir,
 			   L_NODE_DATA, _("Playlists"),
 			   L_NODE_BOLD, PANGO_WEIGHT_BOLD,
 			   L_NODE_TYPE, NODE_CATEGORY_PLAYLIST,
@@ -2134,7 +2169,7 @@ library_pane_view_reload(RenaLibraryPane *clibrary)
 			      &iter,
 			      NULL);
 	gtk_tree_store_set(GTK_TREE_STORE(model), &iter,
-			   L_PIXBUF, clibrary->pixbuf_dir,
+			   L_PIXBUF, clibrary->view->pixbuf_dir,
 			   L_NODE_DATA, _("Radios"),
 			   L_NODE_BOLD, PANGO_WEIGHT_BOLD,
 			   L_NODE_TYPE, NODE_CATEGORY_RADIO,
@@ -2164,11 +2199,11 @@ library_pane_view_reload(RenaLibraryPane *clibrary)
 		friendly_name = rena_database_provider_get_friendly_name (provider, l->data);
 
 		gtk_tree_store_set (GTK_TREE_STORE(model), &iter,
-		                    L_PIXBUF, pixbuf ? pixbuf : clibrary->pixbuf_dir,
+		                    L_PIXBUF, pixbuf ? pixbuf : clibrary->view->pixbuf_dir,
 		                    L_NODE_DATA, friendly_name,
 		                    L_NODE_BOLD, PANGO_WEIGHT_BOLD,
 		                    L_NODE_TYPE, NODE_CATEGORY_PROVIDER,
-		                    L_DATABASE_ID, rena_database_find_provider (clibrary->cdbase, l->data),
+		                    L_DATABASE_ID, rena_database_find_provider (clibrary->view->cdbase, l->data),
 		                    L_MACH, FALSE,
 		                    L_VISIBILE, TRUE,
 		                    -1);
@@ -2186,12 +2221,7 @@ library_pane_view_reload(RenaLibraryPane *clibrary)
 			friendly_name = NULL;
 		}
 
-		if (rena_preferences_get_library_style(clibrary->preferences) == FOLDERS) {
-			rena_library_view_append_provider_by_folder (clibrary, model, &iter, l->data);
-		}
-		else {
-			rena_library_view_append_provider_by_tags (clibrary, model, &iter, l->data);
-		}
+		rena_library_view_append_provider (clibrary->view, model, &iter, l->data);
 	}
 
 	/* Sensitive, set model and filter */
@@ -2212,6 +2242,8 @@ library_pane_view_reload(RenaLibraryPane *clibrary)
 
 	g_slist_free_full (provider_list, g_free);
 	g_object_unref (provider);
+
+	RENA_PROFILE_END(span, "library-reload");
 }
 
 static void
@@ -2295,7 +2327,7 @@ rena_library_pane_get_mobj_list (RenaLibraryPane *library)
 
 		for (i = list; i != NULL; i = i->next) {
 			path = i->data;
-			mlist = append_library_row_to_mobj_list (library->cdbase, path, model, mlist);
+			mlist = append_library_row_to_mobj_list (library->view->cdbase, path, model, mlist);
 			gtk_tree_path_free (path);
 
 			/* Have to give control to GTK periodically ... */
@@ -2333,11 +2365,11 @@ rena_library_pane_rename_item (RenaLibraryPane *library)
 				gtk_tree_model_get(model, &iter, L_NODE_TYPE, &node_type, -1);
 
 				if(node_type == NODE_PLAYLIST)
-					rena_database_update_playlist_name (library->cdbase, playlist, n_playlist);
+					rena_database_update_playlist_name (library->view->cdbase, playlist, n_playlist);
 				else if (node_type == NODE_RADIO)
-					rena_database_update_radio_name (library->cdbase, playlist, n_playlist);
+					rena_database_update_radio_name (library->view->cdbase, playlist, n_playlist);
 
-				rena_database_change_playlists_done(library->cdbase);
+				rena_database_change_playlists_done(library->view->cdbase);
 
 				g_free(n_playlist);
 			}
@@ -2375,10 +2407,10 @@ rena_library_pane_remove_item (RenaLibraryPane *library)
 
 				if (delete_existing_item_dialog(playlist, gtk_widget_get_toplevel(GTK_WIDGET(library)))) {
 					if(node_type == NODE_PLAYLIST) {
-						rena_database_delete_playlist (library->cdbase, playlist);
+						rena_database_delete_playlist (library->view->cdbase, playlist);
 					}
 					else if (node_type == NODE_RADIO) {
-						rena_database_delete_radio (library->cdbase, playlist);
+						rena_database_delete_radio (library->view->cdbase, playlist);
 					}
 					removed = TRUE;
 				}
@@ -2390,7 +2422,7 @@ rena_library_pane_remove_item (RenaLibraryPane *library)
 	}
 
 	if (removed)
-		rena_database_change_playlists_done (library->cdbase);
+		rena_database_change_playlists_done (library->view->cdbase);
 }
 
 static void
@@ -2460,7 +2492,7 @@ rena_library_pane_export_playlist (RenaLibraryPane *library)
 				gtk_tree_model_get(model, &iter, L_NODE_DATA,
 						   &playlist, -1);
 				if (save_m3u_playlist(chan, playlist,
-						      filename, library->cdbase) < 0) {
+						      filename, library->view->cdbase) < 0) {
 					g_warning("Unable to save M3U playlist: %s",
 						  filename);
 					g_free(playlist);
@@ -2599,7 +2631,7 @@ rena_library_pane_edit_tags (RenaLibraryPane *library)
 			gtk_tree_model_get(model, &iter,
 					   L_DATABASE_ID, &location_id, -1);
 
-			omobj = new_musicobject_from_db(library->cdbase, location_id);
+			omobj = new_musicobject_from_db(library->view->cdbase, location_id);
 		}
 		else {
 			omobj = rena_musicobject_new();
@@ -2610,7 +2642,7 @@ rena_library_pane_edit_tags (RenaLibraryPane *library)
 				rena_musicobject_set_artist(omobj, node_data);
 				break;
 			case NODE_ALBUM:
-				if (rena_preferences_get_sort_by_year(library->preferences)) {
+				if (rena_preferences_get_sort_by_year(library->view->preferences)) {
 					split_album = g_strsplit(node_data, " - ", 2);
 					rena_musicobject_set_year(omobj, atoi (split_album[0]));
 					rena_musicobject_set_album(omobj, split_album[1]);
@@ -2687,7 +2719,7 @@ rena_library_pane_delete_from_hdd (RenaLibraryPane *library)
 		if(result == GTK_RESPONSE_YES){
 			loc_arr = g_array_new(TRUE, TRUE, sizeof(gint));
 
-			rena_database_begin_transaction(library->cdbase);
+			rena_database_begin_transaction(library->view->cdbase);
 			for (i=list; i != NULL; i = i->next) {
 				path = i->data;
 				get_location_ids(path, loc_arr, model, library);
@@ -2696,11 +2728,11 @@ rena_library_pane_delete_from_hdd (RenaLibraryPane *library)
 				/* Have to give control to GTK periodically ... */
 				rena_process_gtk_events ();
 			}
-			rena_database_commit_transaction(library->cdbase);
+			rena_database_commit_transaction(library->view->cdbase);
 
 			g_array_free(loc_arr, TRUE);
 
-			rena_database_flush_stale_entries (library->cdbase);
+			rena_database_flush_stale_entries (library->view->cdbase);
 
 			provider = rena_database_provider_get ();
 			rena_provider_update_done (provider);
@@ -2739,19 +2771,19 @@ rena_library_pane_delete_from_db (RenaLibraryPane *library)
 		if( result == GTK_RESPONSE_YES ){
 			/* Delete all the rows */
 
-			rena_database_begin_transaction (library->cdbase);
+			rena_database_begin_transaction (library->view->cdbase);
 
 			for (i=list; i != NULL; i = i->next) {
 				path = i->data;
-				delete_row_from_db(library->cdbase, path, model);
+				delete_row_from_db(library->view->cdbase, path, model);
 
 				/* Have to give control to GTK periodically ... */
 				rena_process_gtk_events ();
 			}
 
-			rena_database_commit_transaction (library->cdbase);
+			rena_database_commit_transaction (library->view->cdbase);
 
-			rena_database_flush_stale_entries (library->cdbase);
+			rena_database_flush_stale_entries (library->view->cdbase);
 
 			provider = rena_database_provider_get ();
 			rena_provider_update_done (provider);
@@ -2886,8 +2918,45 @@ rena_library_tree_context_menu_new (RenaLibraryPane *library)
 /* Construction of library pane */
 /********************************/
 
-static GtkTreeStore *
-rena_library_pane_store_new()
+RenaLibraryView *
+rena_library_view_new (void)
+{
+	RenaLibraryView *view;
+
+	view = g_slice_new0 (RenaLibraryView);
+	view->cdbase = rena_database_get ();
+	view->preferences = rena_preferences_get ();
+
+	rena_library_view_update_style (view);
+
+	return view;
+}
+
+void
+rena_library_view_free (RenaLibraryView *view)
+{
+	if (view->pixbuf_dir)
+		g_object_unref (view->pixbuf_dir);
+	if (view->pixbuf_artist)
+		g_object_unref (view->pixbuf_artist);
+	if (view->pixbuf_album)
+		g_object_unref (view->pixbuf_album);
+	if (view->pixbuf_track)
+		g_object_unref (view->pixbuf_track);
+	if (view->pixbuf_genre)
+		g_object_unref (view->pixbuf_genre);
+
+	g_free (view->filter_entry);
+	g_slist_free (view->nodes);
+
+	g_object_unref (view->cdbase);
+	g_object_unref (view->preferences);
+
+	g_slice_free (RenaLibraryView, view);
+}
+
+GtkTreeStore *
+rena_library_view_store_new (void)
 {
 	GtkTreeStore *store;
 	store = gtk_tree_store_new(N_L_COLUMNS,
@@ -2963,7 +3032,7 @@ rena_library_pane_search_entry_new(RenaLibraryPane *clibrary)
 {
 	GtkWidget *search_entry;
 
-	search_entry = rena_search_entry_new(clibrary->preferences);
+	search_entry = rena_search_entry_new(clibrary->view->preferences);
 
 	g_signal_connect (G_OBJECT(search_entry),
 	                  "changed",
@@ -3019,69 +3088,69 @@ rena_library_pane_init_pixbufs(RenaLibraryPane *librarypane)
 	gint icon_size = get_library_icon_size();
 
 	pix_uri = g_build_filename (PIXMAPDIR, "artist.png", NULL);
-	librarypane->pixbuf_artist =
+	librarypane->view->pixbuf_artist =
 		gdk_pixbuf_new_from_file_at_scale(pix_uri,
 		                                  icon_size, icon_size,
 		                                  TRUE,
 		                                  NULL);
-	if (!librarypane->pixbuf_artist)
+	if (!librarypane->view->pixbuf_artist)
 		g_warning("Unable to load artist png");
 	g_free (pix_uri);
 
-	librarypane->pixbuf_album =
+	librarypane->view->pixbuf_album =
 		gtk_icon_theme_load_icon(icontheme,
 		                         "media-optical",
 		                         icon_size, GTK_ICON_LOOKUP_FORCE_SIZE,
 		                         NULL);
 
-	if (!librarypane->pixbuf_album) {
+	if (!librarypane->view->pixbuf_album) {
 		pix_uri = g_build_filename (PIXMAPDIR, "album.png", NULL);
-		librarypane->pixbuf_album =
+		librarypane->view->pixbuf_album =
 			gdk_pixbuf_new_from_file_at_scale(pix_uri,
 			                                  icon_size, icon_size,
 			                                  TRUE, NULL);
 		g_free (pix_uri);
 	}
-	if (!librarypane->pixbuf_album)
+	if (!librarypane->view->pixbuf_album)
 		g_warning("Unable to load album png");
 
-	librarypane->pixbuf_track =
+	librarypane->view->pixbuf_track =
 		gtk_icon_theme_load_icon(icontheme,
 		                         "audio-x-generic",
 		                         icon_size, GTK_ICON_LOOKUP_FORCE_SIZE,
 		                         NULL);
-	if (!librarypane->pixbuf_track) {
+	if (!librarypane->view->pixbuf_track) {
 		pix_uri = g_build_filename (PIXMAPDIR, "track.png", NULL);
-		librarypane->pixbuf_track =
+		librarypane->view->pixbuf_track =
 			gdk_pixbuf_new_from_file_at_scale(pix_uri,
 			                                  icon_size, icon_size,
 			                                  TRUE, NULL);
 		g_free (pix_uri);
 	}
-	if (!librarypane->pixbuf_track)
+	if (!librarypane->view->pixbuf_track)
 		g_warning("Unable to load track png");
 
 	pix_uri = g_build_filename (PIXMAPDIR, "genre.png", NULL);
-	librarypane->pixbuf_genre =
+	librarypane->view->pixbuf_genre =
 		gdk_pixbuf_new_from_file_at_scale(pix_uri,
 		                                  icon_size, icon_size,
 		                                  TRUE, NULL);
-	if (!librarypane->pixbuf_genre)
+	if (!librarypane->view->pixbuf_genre)
 		g_warning("Unable to load genre png");
 	g_free (pix_uri);
 
-	librarypane->pixbuf_dir =
+	librarypane->view->pixbuf_dir =
 		gtk_icon_theme_load_icon(icontheme,
 		                         "folder-music",
 		                         icon_size, GTK_ICON_LOOKUP_FORCE_SIZE,
 		                         NULL);
-	if (!librarypane->pixbuf_dir)
-		librarypane->pixbuf_dir =
+	if (!librarypane->view->pixbuf_dir)
+		librarypane->view->pixbuf_dir =
 			gtk_icon_theme_load_icon(icontheme,
 			                         "folder",
 			                         icon_size, GTK_ICON_LOOKUP_FORCE_SIZE,
 			                         NULL);
-	if (!librarypane->pixbuf_dir)
+	if (!librarypane->view->pixbuf_dir)
 		g_warning("Unable to load folder png");
 }
 
@@ -3127,12 +3196,11 @@ rena_library_pane_init (RenaLibraryPane *library)
 
 	/* Get usefuls instances */
 
-	library->cdbase = rena_database_get ();
-	library->preferences = rena_preferences_get ();
+	library->view = rena_library_view_new ();
 
 	/* Create the store */
 
-	library->library_store = rena_library_pane_store_new();
+	library->library_store = rena_library_view_store_new();
 
 	/* Create the widgets */
 
@@ -3152,10 +3220,8 @@ rena_library_pane_init (RenaLibraryPane *library)
 
 	/* Init the rest of flags */
 
-	library->filter_entry = NULL;
 	library->dragging = FALSE;
 	library->view_change = FALSE;
-	library->library_tree_nodes = NULL;
 
 	/* Init drag and drop */
 
@@ -3176,10 +3242,10 @@ rena_library_pane_init (RenaLibraryPane *library)
 	g_signal_connect (G_OBJECT (library->library_tree), "key-press-event",
 	                  G_CALLBACK(rena_library_pane_tree_key_press), library);
 
-	g_signal_connect (library->cdbase, "PlaylistsChanged",
+	g_signal_connect (library->view->cdbase, "PlaylistsChanged",
 	                  G_CALLBACK (update_library_playlist_changes), library);
 
-	g_signal_connect (library->preferences, "notify::library-style",
+	g_signal_connect (library->view->preferences, "notify::library-style",
 	                  G_CALLBACK (library_pane_change_style), library);
 
 	provider = rena_database_provider_get ();
@@ -3195,28 +3261,9 @@ rena_library_pane_finalize (GObject *object)
 {
 	RenaLibraryPane *library = RENA_LIBRARY_PANE (object);
 
-	if (library->pixbuf_dir)
-		g_object_unref (library->pixbuf_dir);
-	if (library->pixbuf_artist)
-		g_object_unref (library->pixbuf_artist);
-	if (library->pixbuf_album)
-		g_object_unref (library->pixbuf_album);
-	if (library->pixbuf_track)
-		g_object_unref (library->pixbuf_track);
-	if (library->pixbuf_genre)
-		g_object_unref (library->pixbuf_genre);
-
-	if (library->filter_entry != NULL) {
-		g_free (library->filter_entry);
-		library->filter_entry = NULL;
-	}
-
-	g_object_unref (library->cdbase);
-	g_object_unref (library->preferences);
+	rena_library_view_free (library->view);
 	g_object_unref (library->library_store);
 
-	g_slist_free (library->library_tree_nodes);
-
 	g_object_unref (library->builder);
 	g_object_unref (library->actions);
 
@@ -52,6 +52,47 @@ typedef enum {
 	LAST_LIBRARY_STYLE
 } RenaLibraryStyle;
 
+/* Node types in library view */
+
+typedef enum {
+	NODE_CATEGORY_PLAYLIST,
+	NODE_CATEGORY_RADIO,
+	NODE_CATEGORY_PROVIDER,
+	NODE_FOLDER,
+	NODE_GENRE,
+	NODE_ARTIST,
+	NODE_ALBUM,
+	NODE_TRACK,
+	NODE_BASENAME,
+	NODE_PLAYLIST,
+	NODE_RADIO
+} LibraryNodeType;
+
+/* Columns in Library view */
+
+enum library_pane_columns {
+	L_PIXBUF,
+	L_NODE_DATA,
+	L_NODE_BOLD,
+	L_NODE_TYPE,
+	L_DATABASE_ID,
+	L_MACH,
+	L_VISIBILE,
+	N_L_COLUMNS
+};
+
+/* Library store, also usable without a display */
+
+typedef struct _RenaLibraryView RenaLibraryView;
+
+RenaLibraryView *rena_library_view_new             (void);
+void             rena_library_view_free            (RenaLibraryView *view);
+GtkTreeStore    *rena_library_view_store_new       (void);
+void             rena_library_view_update_style    (RenaLibraryView *view);
+void             rena_library_view_append_provider (RenaLibraryView *view, GtkTreeModel *model, GtkTreeIter *p_iter, const gchar *provider);
+void             rena_library_view_set_filter      (RenaLibraryView *view, const gchar *text);
+void             rena_library_view_filter          (RenaLibraryView *view, GtkTreeModel *model);
+
 /* Functions */
 
 GList * rena_library_pane_get_mobj_list (RenaLibraryPane *library);
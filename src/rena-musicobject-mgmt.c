@@ -36,12 +36,11 @@ new_musicobject_from_file(const gchar *file, const gchar *provider)
 
 	mime_type = rena_file_get_music_type(file);
 
-	mobj = g_object_new (RENA_TYPE_MUSICOBJECT,
-	                     "file", file,
-	                     "source", FILE_LOCAL,
-	                     "provider", provider,
-	                     "mime-type", mime_type,
-	                     NULL);
+	mobj = rena_musicobject_new ();
+	rena_musicobject_set_file (mobj, file);
+	rena_musicobject_set_source (mobj, FILE_LOCAL);
+	rena_musicobject_set_provider (mobj, provider);
+	rena_musicobject_set_mime_type (mobj, mime_type);
 
 	g_free (mime_type);
 
@@ -57,11 +56,47 @@ new_musicobject_from_file(const gchar *file, const gchar *provider)
 	return NULL;
 }
 
+/* Musicobject of a row that selects, in order: LOCATION.name, PROVIDER_TYPE.name,
+ * PROVIDER.name, MIME_TYPE.name, TRACK.title, ARTIST.name, ALBUM.name,
+ * GENRE.name, COMMENT.name, YEAR.year, TRACK.track_no, TRACK.length,
+ * TRACK.bitrate, TRACK.channels and TRACK.samplerate. */
+
+RenaMusicobject *
+new_musicobject_from_db_row (RenaPreparedStatement *statement)
+{
+	RenaMusicEnum *enum_map = NULL;
+	RenaMusicobject *mobj = NULL;
+
+	/* Avoid properties here. It is called for each song in playlists. */
+	mobj = rena_musicobject_new ();
+	rena_musicobject_set_file (mobj, rena_prepared_statement_get_string (statement, 0));
+	rena_musicobject_set_provider (mobj, rena_prepared_statement_get_string (statement, 2));
+	rena_musicobject_set_mime_type (mobj, rena_prepared_statement_get_string (statement, 3));
+	rena_musicobject_set_title (mobj, rena_prepared_statement_get_string (statement, 4));
+	rena_musicobject_set_artist (mobj, rena_prepared_statement_get_string (statement, 5));
+	rena_musicobject_set_album (mobj, rena_prepared_statement_get_string (statement, 6));
+	rena_musicobject_set_genre (mobj, rena_prepared_statement_get_string (statement, 7));
+	rena_musicobject_set_comment (mobj, rena_prepared_statement_get_string (statement, 8));
+	rena_musicobject_set_year (mobj, rena_prepared_statement_get_int (statement, 9));
+	rena_musicobject_set_track_no (mobj, rena_prepared_statement_get_int (statement, 10));
+	rena_musicobject_set_length (mobj, rena_prepared_statement_get_int (statement, 11));
+	rena_musicobject_set_bitrate (mobj, rena_prepared_statement_get_int (statement, 12));
+	rena_musicobject_set_channels (mobj, rena_prepared_statement_get_int (statement, 13));
+	rena_musicobject_set_samplerate (mobj, rena_prepared_statement_get_int (statement, 14));
+
+	enum_map = rena_music_enum_get ();
+	rena_musicobject_set_source (mobj,
+		rena_music_enum_map_get(enum_map,
+			rena_prepared_statement_get_string (statement, 1)));
+	g_object_unref (enum_map);
+
+	return mobj;
+}
+
 RenaMusicobject *
 new_musicobject_from_db(RenaDatabase *cdbase, gint location_id)
 {
 	RenaPreparedStatement *statement = NULL;
-	RenaMusicEnum *enum_map = NULL;
 	RenaMusicobject *mobj = NULL;
 
 	CDEBUG(DBG_MOBJ, "Creating new musicobject with location id: %d", location_id);
@@ -78,28 +113,7 @@ new_musicobject_from_db(RenaDatabase *cdbase, gint location_id)
 
 	if (rena_prepared_statement_step (statement))
 	{
-		mobj = g_object_new (RENA_TYPE_MUSICOBJECT,
-		                     "file", rena_prepared_statement_get_string (statement, 0),
-		                     "provider", rena_prepared_statement_get_string (statement, 2),
-		                     "mime-type", rena_prepared_statement_get_string (statement, 3),
-		                     "title", rena_prepared_statement_get_string (statement, 4),
-		                     "artist", rena_prepared_statement_get_string (statement, 5),
-		                     "album", rena_prepared_statement_get_string (statement, 6),
-		                     "genre", rena_prepared_statement_get_string (statement, 7),
-		                     "comment", rena_prepared_statement_get_string (statement, 8),
-		                     "year", rena_prepared_statement_get_int (statement, 9),
-		                     "track-no", rena_prepared_statement_get_int (statement, 10),
-		                     "length", rena_prepared_statement_get_int (statement, 11),
-		                     "bitrate", rena_prepared_statement_get_int (statement, 12),
-		                     "channels", rena_prepared_statement_get_int (statement, 13),
-		                     "samplerate", rena_prepared_statement_get_int (statement, 14),
-		                     NULL);
-
-		enum_map = rena_music_enum_get ();
-		rena_musicobject_set_source (mobj,
-			rena_music_enum_map_get(enum_map,
-				rena_prepared_statement_get_string (statement, 1)));
-		g_object_unref (enum_map);
+		mobj = new_musicobject_from_db_row (statement);
 	}
 	else
 	{
@@ -39,6 +39,9 @@ RenaMusicobject *
 new_musicobject_from_db                   (RenaDatabase *cdbase,
                                            gint location_id);
 
+RenaMusicobject *
+new_musicobject_from_db_row               (RenaPreparedStatement *statement);
+
 RenaMusicobject *
 new_musicobject_from_location             (const gchar *uri,
                                            const gchar *name);
@@ -17,17 +17,25 @@
 
 #include "rena-musicobject.h"
 
+#include <string.h>
+
+/*
+ * The provider, mime type and tags shared between songs are interned on a
+ * pool of strings, so large playlists hold a single copy of each artist,
+ * album or genre. The file and title are unique and owned by each object.
+ */
+
 struct _RenaMusicobjectPrivate
 {
 	gchar *file;
-	RenaMusicSource source;
-	gchar *provider;
-	gchar *mime_type;
 	gchar *title;
-	gchar *artist;
-	gchar *album;
-	gchar *genre;
-	gchar *comment;
+	const gchar *provider;
+	const gchar *mime_type;
+	const gchar *artist;
+	const gchar *album;
+	const gchar *genre;
+	const gchar *comment;
+	RenaMusicSource source;
 	guint year;
 	guint track_no;
 	gint length;
@@ -36,6 +44,16 @@ struct _RenaMusicobjectPrivate
 	gint samplerate;
 };
 
+typedef struct {
+	guint ref_count;
+	gchar str[1];
+} RenaPooledString;
+
+static GHashTable *string_pool = NULL;
+static GMutex      string_pool_mutex;
+
+#define POOLED_STRING(_str) ((RenaPooledString *) ((_str) - G_STRUCT_OFFSET (RenaPooledString, str)))
+
 G_DEFINE_TYPE_WITH_PRIVATE(RenaMusicobject, rena_musicobject, G_TYPE_OBJECT)
 
 enum
@@ -61,6 +79,73 @@ enum
 
 static GParamSpec *gParamSpecs[LAST_PROP];
 
+static const gchar *
+rena_musicobject_intern (const gchar *str)
+{
+	RenaPooledString *pooled;
+	gsize len;
+
+	if (str == NULL)
+		return NULL;
+
+	g_mutex_lock (&string_pool_mutex);
+	if (G_UNLIKELY (string_pool == NULL))
+		string_pool = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+	pooled = g_hash_table_lookup (string_pool, str);
+	if (pooled) {
+		pooled->ref_count++;
+	}
+	else {
+		len = strlen (str);
+		pooled = g_malloc (G_STRUCT_OFFSET (RenaPooledString, str) + len + 1);
+		pooled->ref_count = 1;
+		memcpy (pooled->str, str, len + 1);
+		g_hash_table_insert (string_pool, pooled->str, pooled);
+	}
+	g_mutex_unlock (&string_pool_mutex);
+
+	return pooled->str;
+}
+
+static const gchar *
+rena_musicobject_intern_ref (const gchar *interned)
+{
+	if (interned == NULL)
+		return NULL;
+
+	g_mutex_lock (&string_pool_mutex);
+	POOLED_STRING(interned)->ref_count++;
+	g_mutex_unlock (&string_pool_mutex);
+
+	return interned;
+}
+
+static void
+rena_musicobject_intern_unref (const gchar *interned)
+{
+	RenaPooledString *pooled;
+
+	if (interned == NULL)
+		return;
+
+	pooled = POOLED_STRING(interned);
+
+	g_mutex_lock (&string_pool_mutex);
+	if (--pooled->ref_count == 0)
+		g_hash_table_remove (string_pool, pooled->str);
+	g_mutex_unlock (&string_pool_mutex);
+}
+
+static void
+rena_musicobject_intern_replace (const gchar **interned, const gchar *str)
+{
+	const gchar *old = *interned;
+
+	*interned = rena_musicobject_intern (str);
+	rena_musicobject_intern_unref (old);
+}
+
 /**
  * rena_musicobject_new:
  *
@@ -78,25 +163,38 @@ rena_musicobject_new (void)
 RenaMusicobject *
 rena_musicobject_dup (RenaMusicobject *musicobject)
 {
+	RenaMusicobjectPrivate *priv, *dpriv;
+	RenaMusicobject *dup;
+
 	g_return_val_if_fail(RENA_IS_MUSICOBJECT(musicobject), NULL);
 
-	return g_object_new (RENA_TYPE_MUSICOBJECT,
-	                     "file", rena_musicobject_get_file(musicobject),
-	                     "source", rena_musicobject_get_source (musicobject),
-	                     "provider", rena_musicobject_get_provider (musicobject),
-	                     "mime-type", rena_musicobject_get_mime_type(musicobject),
-	                     "title", rena_musicobject_get_title(musicobject),
-	                     "artist", rena_musicobject_get_artist(musicobject),
-	                     "album", rena_musicobject_get_album(musicobject),
-	                     "genre", rena_musicobject_get_genre(musicobject),
-	                     "comment", rena_musicobject_get_comment(musicobject),
-	                     "year", rena_musicobject_get_year(musicobject),
-	                     "track-no", rena_musicobject_get_track_no(musicobject),
-	                     "length", rena_musicobject_get_length(musicobject),
-	                     "bitrate", rena_musicobject_get_bitrate(musicobject),
-	                     "channels", rena_musicobject_get_channels(musicobject),
-	                     "samplerate", rena_musicobject_get_samplerate(musicobject),
-	                     NULL);
+	dup = rena_musicobject_new ();
+
+	priv = musicobject->priv;
+	dpriv = dup->priv;
+
+	/* Copy all fields without go through properties. */
+	g_free (dpriv->file);
+	g_free (dpriv->title);
+	rena_musicobject_intern_unref (dpriv->provider);
+	rena_musicobject_intern_unref (dpriv->mime_type);
+	rena_musicobject_intern_unref (dpriv->artist);
+	rena_musicobject_intern_unref (dpriv->album);
+	rena_musicobject_intern_unref (dpriv->genre);
+	rena_musicobject_intern_unref (dpriv->comment);
+
+	*dpriv = *priv;
+
+	dpriv->file = g_strdup (priv->file);
+	dpriv->title = g_strdup (priv->title);
+	rena_musicobject_intern_ref (dpriv->provider);
+	rena_musicobject_intern_ref (dpriv->mime_type);
+	rena_musicobject_intern_ref (dpriv->artist);
+	rena_musicobject_intern_ref (dpriv->album);
+	rena_musicobject_intern_ref (dpriv->genre);
+	rena_musicobject_intern_ref (dpriv->comment);
+
+	return dup;
 }
 
 /**
@@ -294,8 +392,7 @@ rena_musicobject_set_provider (RenaMusicobject *musicobject,
 
 	priv = musicobject->priv;
 
-	g_free(priv->provider);
-	priv->provider = g_strdup(provider);
+	rena_musicobject_intern_replace (&priv->provider, provider);
 }
 
 
@@ -324,8 +421,7 @@ rena_musicobject_set_mime_type (RenaMusicobject *musicobject,
 
 	priv = musicobject->priv;
 
-	g_free (priv->mime_type);
-	priv->mime_type = g_strdup(mime_type);
+	rena_musicobject_intern_replace (&priv->mime_type, mime_type);
 }
 
 /**
@@ -382,8 +478,7 @@ rena_musicobject_set_artist (RenaMusicobject *musicobject,
 
 	priv = musicobject->priv;
 
-	g_free(priv->artist);
-	priv->artist = g_strdup(artist);
+	rena_musicobject_intern_replace (&priv->artist, artist);
 }
 
 /**
@@ -411,8 +506,7 @@ rena_musicobject_set_album (RenaMusicobject *musicobject,
 
 	priv = musicobject->priv;
 
-	g_free(priv->album);
-	priv->album = g_strdup(album);
+	rena_musicobject_intern_replace (&priv->album, album);
 }
 
 /**
@@ -440,8 +534,7 @@ rena_musicobject_set_genre (RenaMusicobject *musicobject,
 
 	priv = musicobject->priv;
 
-	g_free(priv->genre);
-	priv->genre = g_strdup(genre);
+	rena_musicobject_intern_replace (&priv->genre, genre);
 }
 
 /**
@@ -469,8 +562,7 @@ rena_musicobject_set_comment (RenaMusicobject *musicobject,
 
 	priv = musicobject->priv;
 
-	g_free(priv->comment);
-	priv->comment = g_strdup(comment);
+	rena_musicobject_intern_replace (&priv->comment, comment);
 }
 
 /**
@@ -649,13 +741,13 @@ rena_musicobject_finalize (GObject *object)
 	priv = RENA_MUSICOBJECT(object)->priv;
 
 	g_free(priv->file);
-	g_free(priv->mime_type);
-	g_free(priv->provider);
 	g_free(priv->title);
-	g_free(priv->artist);
-	g_free(priv->album);
-	g_free(priv->genre);
-	g_free(priv->comment);
+	rena_musicobject_intern_unref(priv->mime_type);
+	rena_musicobject_intern_unref(priv->provider);
+	rena_musicobject_intern_unref(priv->artist);
+	rena_musicobject_intern_unref(priv->album);
+	rena_musicobject_intern_unref(priv->genre);
+	rena_musicobject_intern_unref(priv->comment);
 
 	G_OBJECT_CLASS(rena_musicobject_parent_class)->finalize(object);
 }
@@ -973,7 +1065,19 @@ rena_musicobject_class_init (RenaMusicobjectClass *klass)
 static void
 rena_musicobject_init (RenaMusicobject *musicobject)
 {
-   musicobject->priv = G_TYPE_INSTANCE_GET_PRIVATE(musicobject,
-                                                   RENA_TYPE_MUSICOBJECT,
-                                                   RenaMusicobjectPrivate);
+   RenaMusicobjectPrivate *priv;
+
+   priv = musicobject->priv = G_TYPE_INSTANCE_GET_PRIVATE(musicobject,
+                                                          RENA_TYPE_MUSICOBJECT,
+                                                          RenaMusicobjectPrivate);
+
+   /* Defaults of string properties, no longer set on construction. */
+   priv->file = g_strdup ("");
+   priv->title = g_strdup ("");
+   priv->provider = rena_musicobject_intern ("");
+   priv->mime_type = rena_musicobject_intern ("");
+   priv->artist = rena_musicobject_intern ("");
+   priv->album = rena_musicobject_intern ("");
+   priv->genre = rena_musicobject_intern ("");
+   priv->comment = rena_musicobject_intern ("");
 }
@@ -61,7 +61,7 @@ typedef enum {
 	FILE_HTTP      = -3
 } RenaMusicSource;
 
-#define RENA_MUSICOBJECT_PARAM_STRING G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS
+#define RENA_MUSICOBJECT_PARAM_STRING G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 
 RenaMusicobject *
 rena_musicobject_new (void);
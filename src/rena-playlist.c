@@ -99,6 +99,7 @@ enum
 	PLAYLIST_SET_TRACK,
 	PLAYLIST_CHANGE_TAGS,
 	PLAYLIST_CHANGED,
+	PLAYLIST_QUEUE_CHANGED,
 	LAST_SIGNAL
 };
 
@@ -781,16 +782,24 @@ static void delete_rand_track_refs(GtkTreePath *path, RenaPlaylist *cplaylist)
 	}
 }
 
+/* Mark a track of the playlist store as played or not */
+
+void
+rena_playlist_store_set_played (GtkTreeModel *model, GtkTreePath *path, gboolean played)
+{
+	GtkTreeIter iter;
+
+	if (gtk_tree_model_get_iter (model, &iter, path))
+		gtk_list_store_set (GTK_LIST_STORE(model), &iter, P_PLAYED, played, -1);
+}
+
 /* Mark a track in current playlist as dirty */
 
 static void
 rena_playlist_set_dirty_track (RenaPlaylist *playlist,
                                  GtkTreePath    *path)
 {
-	GtkTreeIter iter;
-
-	if (gtk_tree_model_get_iter (playlist->model, &iter, path))
-		gtk_list_store_set (GTK_LIST_STORE(playlist->model), &iter, P_PLAYED, TRUE, -1);
+	rena_playlist_store_set_played (playlist->model, path, TRUE);
 
 	if (playlist->unplayed_tracks)
 		playlist->unplayed_tracks--;
@@ -801,11 +810,7 @@ rena_playlist_set_dirty_track (RenaPlaylist *playlist,
 static void
 rena_playlist_unset_dirty_track (RenaPlaylist *cplaylist, GtkTreePath *path)
 {
-	GtkTreeModel *model = cplaylist->model;
-	GtkTreeIter iter;
-
-	if (gtk_tree_model_get_iter(model, &iter, path))
-		gtk_list_store_set(GTK_LIST_STORE(model), &iter, P_PLAYED, FALSE, -1);
+	rena_playlist_store_set_played (cplaylist->model, path, FALSE);
 
 	cplaylist->unplayed_tracks++;
 }
@@ -968,28 +973,35 @@ get_first_random_track (RenaPlaylist *playlist)
 static GtkTreePath *
 get_next_unplayed_random_track (RenaPlaylist *playlist)
 {
-	gint rnd;
+	if (playlist->changing || !playlist->unplayed_tracks)
+		return NULL;
+
+	return rena_playlist_store_get_unplayed_random (playlist->model, playlist->rand);
+}
+
+/* Return path of a random track of the store not played yet. There must be
+ * at least one. */
+
+GtkTreePath *
+rena_playlist_store_get_unplayed_random (GtkTreeModel *model, GRand *rand)
+{
+	gint rnd, no_tracks;
 	GtkTreePath *path = NULL;
 	GtkTreeIter iter;
 	gboolean played = TRUE;
 
-	while (played && playlist->unplayed_tracks) {
-		rnd = g_rand_int_range (playlist->rand,
-		                        0,
-		                        playlist->no_tracks);
-		path = get_nth_track (playlist, rnd);
-		if (!path) {
+	no_tracks = gtk_tree_model_iter_n_children (model, NULL);
+
+	while (played) {
+		rnd = g_rand_int_range (rand, 0, no_tracks);
+		if (!gtk_tree_model_iter_nth_child (model, &iter, NULL, rnd)) {
 			g_printerr("No track at position : %d\n", rnd);
 			return NULL;
 		}
 
-		if (gtk_tree_model_get_iter (playlist->model, &iter, path))
-			gtk_tree_model_get (playlist->model, &iter, P_PLAYED, &played, -1);
-
-		if (played) {
-			gtk_tree_path_free(path);
-			path = NULL;
-		}
+		gtk_tree_model_get (model, &iter, P_PLAYED, &played, -1);
+		if (!played)
+			path = gtk_tree_model_get_path (model, &iter);
 	}
 	return path;
 }
@@ -1487,6 +1499,8 @@ rena_playlist_dequeue_handler (RenaPlaylist *cplaylist)
 	g_list_foreach (list, (GFunc) delete_queue_track_refs, cplaylist);
 	requeue_track_refs(cplaylist);
 	g_list_free_full (list, (GDestroyNotify) gtk_tree_path_free);
+
+	g_signal_emit (cplaylist, signals[PLAYLIST_QUEUE_CHANGED], 0);
 }
 
 
@@ -1521,6 +1535,8 @@ rena_playlist_queue_handler (RenaPlaylist *cplaylist)
 	}
 	requeue_track_refs(cplaylist);
 	g_list_free (list);
+
+	g_signal_emit (cplaylist, signals[PLAYLIST_QUEUE_CHANGED], 0);
 }
 
 /* Toglle queue state of selection on current playlist. */
@@ -1555,6 +1571,8 @@ rena_playlist_toggle_queue_selected (RenaPlaylist *cplaylist)
 	}
 	requeue_track_refs(cplaylist);
 	g_list_free (list);
+
+	g_signal_emit (cplaylist, signals[PLAYLIST_QUEUE_CHANGED], 0);
 }
 
 /* Remove selected rows from current playlist */
@@ -1844,6 +1862,8 @@ rena_playlist_remove_all (RenaPlaylist *playlist)
 	RenaMusicobject *mobj = NULL;
 	gboolean ret;
 
+	RENA_PROFILE_BEGIN(span);
+
 	set_watch_cursor (GTK_WIDGET(playlist));
 
 	clear_rand_track_refs(playlist);
@@ -1866,6 +1886,8 @@ rena_playlist_remove_all (RenaPlaylist *playlist)
 	playlist->unplayed_tracks = 0;
 
 	g_signal_emit (playlist, signals[PLAYLIST_CHANGED], 0);
+
+	RENA_PROFILE_END(span, "playlist-remove-all");
 }
 
 /* Update a list of references in the current playlist */
@@ -2035,24 +2057,14 @@ rena_playlist_update_current_track(RenaPlaylist *cplaylist, gint changed, RenaMu
 	gtk_tree_path_free(path);
 }
 
-/* Insert a track to the current playlist */
+/* Fill a row of the playlist store with the tags of a musicobject */
 
-static void
-insert_current_playlist(RenaPlaylist *cplaylist,
-			RenaMusicobject *mobj,
-			GtkTreeViewDropPosition droppos,
-			GtkTreeIter *pos)
+void
+rena_playlist_store_set_mobj (GtkListStore *store, GtkTreeIter *iter, RenaMusicobject *mobj)
 {
-	GtkTreeIter iter;
 	const gchar *title, *artist, *album, *genre, *comment, *mimetype;
 	gint track_no, year, length, bitrate;
 	gchar *ch_length = NULL, *ch_track_no = NULL, *ch_year = NULL, *ch_bitrate = NULL, *ch_filename = NULL;
-	GtkTreeModel *model = cplaylist->model;
-
-	if (!mobj) {
-		g_warning("Dangling entry in current playlist");
-		return;
-	}
 
 	title = rena_musicobject_get_title(mobj);
 	artist = rena_musicobject_get_artist(mobj);
@@ -2076,12 +2088,7 @@ insert_current_playlist(RenaPlaylist *cplaylist,
 
 	ch_filename = get_display_name(mobj);
 
-	if (droppos == GTK_TREE_VIEW_DROP_AFTER)
-		gtk_list_store_insert_after(GTK_LIST_STORE(model), &iter, pos);
-	else
-		gtk_list_store_insert_before(GTK_LIST_STORE(model), &iter, pos);
-
-	gtk_list_store_set(GTK_LIST_STORE(model), &iter,
+	gtk_list_store_set(store, iter,
 	                   P_MOBJ_PTR, mobj,
 	                   P_QUEUE, NULL,
 	                   P_BUBBLE, FALSE,
@@ -2100,6 +2107,43 @@ insert_current_playlist(RenaPlaylist *cplaylist,
 	                   P_PLAYED, FALSE,
 	                   -1);
 
+	g_free(ch_length);
+	g_free(ch_track_no);
+	g_free(ch_year);
+	g_free(ch_bitrate);
+	g_free(ch_filename);
+}
+
+void
+rena_playlist_store_append_mobj (GtkListStore *store, RenaMusicobject *mobj, GtkTreeIter *iter)
+{
+	gtk_list_store_append(store, iter);
+	rena_playlist_store_set_mobj (store, iter, mobj);
+}
+
+/* Insert a track to the current playlist */
+
+static void
+insert_current_playlist(RenaPlaylist *cplaylist,
+			RenaMusicobject *mobj,
+			GtkTreeViewDropPosition droppos,
+			GtkTreeIter *pos)
+{
+	GtkTreeIter iter;
+	GtkTreeModel *model = cplaylist->model;
+
+	if (!mobj) {
+		g_warning("Dangling entry in current playlist");
+		return;
+	}
+
+	if (droppos == GTK_TREE_VIEW_DROP_AFTER)
+		gtk_list_store_insert_after(GTK_LIST_STORE(model), &iter, pos);
+	else
+		gtk_list_store_insert_before(GTK_LIST_STORE(model), &iter, pos);
+
+	rena_playlist_store_set_mobj (GTK_LIST_STORE(model), &iter, mobj);
+
 	/* Increment global count of tracks */
 
 	cplaylist->no_tracks++;
@@ -2107,12 +2151,6 @@ insert_current_playlist(RenaPlaylist *cplaylist,
 
 	/* Have to give control to GTK periodically ... */
 	rena_process_gtk_events ();
-
-	g_free(ch_length);
-	g_free(ch_track_no);
-	g_free(ch_year);
-	g_free(ch_bitrate);
-	g_free(ch_filename);
 }
 
 /* Append a track to the current playlist */
@@ -2121,9 +2159,6 @@ static void
 append_current_playlist_ex(RenaPlaylist *cplaylist, RenaMusicobject *mobj, GtkTreePath **path)
 {
 	GtkTreeIter iter;
-	const gchar *title, *artist, *album, *genre, *comment, *mimetype;
-	gint track_no, year, length, bitrate;
-	gchar *ch_length = NULL, *ch_track_no = NULL, *ch_year = NULL, *ch_bitrate = NULL, *ch_filename = NULL;
 	GtkTreeModel *model = cplaylist->model;
 
 	if (!mobj) {
@@ -2131,47 +2166,7 @@ append_current_playlist_ex(RenaPlaylist *cplaylist, RenaMusicobject *mobj, GtkTr
 		return;
 	}
 
-	title = rena_musicobject_get_title(mobj);
-	artist = rena_musicobject_get_artist(mobj);
-	album = rena_musicobject_get_album(mobj);
-	genre = rena_musicobject_get_genre(mobj);
-	track_no = rena_musicobject_get_track_no(mobj);
-	year = rena_musicobject_get_year(mobj);
-	comment = rena_musicobject_get_comment(mobj);
-	mimetype = rena_musicobject_get_mime_type(mobj);
-	length = rena_musicobject_get_length(mobj);
-	bitrate = rena_musicobject_get_bitrate(mobj);
-
-	if(track_no > 0)
-		ch_track_no = g_strdup_printf("%d", track_no);
-	if(year > 0)
-		ch_year = g_strdup_printf("%d", year);
-	if(length > 0)
-		ch_length = convert_length_str(length);
-	if(bitrate)
-		ch_bitrate = g_strdup_printf("%d", bitrate);
-
-	ch_filename = get_display_name(mobj);
-
-	gtk_list_store_append(GTK_LIST_STORE(model), &iter);
-	gtk_list_store_set(GTK_LIST_STORE(model), &iter,
-	                   P_MOBJ_PTR, mobj,
-	                   P_QUEUE, NULL,
-	                   P_BUBBLE, FALSE,
-	                   P_STATUS_PIXBUF, NULL,
-	                   P_TRACK_NO, ch_track_no,
-	                   P_TITLE, string_is_not_empty(title) ? title : ch_filename,
-	                   P_ARTIST, artist,
-	                   P_ALBUM, album,
-	                   P_GENRE, genre,
-	                   P_BITRATE, ch_bitrate,
-	                   P_YEAR, ch_year,
-	                   P_COMMENT, comment,
-	                   P_LENGTH, ch_length,
-	                   P_FILENAME, ch_filename,
-	                   P_MIMETYPE, mimetype,
-	                   P_PLAYED, FALSE,
-	                   -1);
+	rena_playlist_store_append_mobj (GTK_LIST_STORE(model), mobj, &iter);
 
 	/* Increment global count of tracks */
 
@@ -2180,12 +2175,6 @@ append_current_playlist_ex(RenaPlaylist *cplaylist, RenaMusicobject *mobj, GtkTr
 
 	if(path)
 		*path = gtk_tree_model_get_path(model, &iter);
-
-	g_free(ch_length);
-	g_free(ch_track_no);
-	g_free(ch_year);
-	g_free(ch_bitrate);
-	g_free(ch_filename);
 }
 
 static void
@@ -2258,6 +2247,8 @@ rena_playlist_append_mobj_list(RenaPlaylist *cplaylist, GList *list)
 	gint column;
 	GList *l;
 
+	RENA_PROFILE_BEGIN(span);
+
 	prev_tracks = rena_playlist_get_no_tracks(cplaylist);
 
 	/* TODO: rena_playlist_set_changing() should be set cursor automatically. */
@@ -2280,6 +2271,8 @@ rena_playlist_append_mobj_list(RenaPlaylist *cplaylist, GList *list)
 	if(gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE(cplaylist->model),
 	                                        &column, &order))
 		select_numered_path_of_current_playlist(cplaylist, prev_tracks, TRUE);
+
+	RENA_PROFILE_END(span, "playlist-append");
 }
 
 /* Test if the song is already in the mobj list */
@@ -3101,6 +3094,69 @@ rena_playlist_get_mobj_list(RenaPlaylist* cplaylist)
 	return list;
 }
 
+/* Get a list of the next music objects that will be played.
+ * Queued tracks first, then the shuffle history or the sequential order.
+ * The random tracks not yet chosen are unpredictable, and are not included. */
+
+GList *
+rena_playlist_get_upcoming_mobj_list (RenaPlaylist *playlist, guint n)
+{
+	GtkTreePath *path = NULL;
+	GtkTreeIter iter;
+	RenaMusicobject *mobj = NULL;
+	GSList *qlist;
+	GList *rlist, *list = NULL;
+	gboolean valid = FALSE;
+	guint count = 0;
+
+	if (playlist->changing || playlist->no_tracks == 0 || n == 0)
+		return NULL;
+
+	for (qlist = playlist->queue_track_refs ; qlist != NULL && count < n ; qlist = qlist->next) {
+		path = gtk_tree_row_reference_get_path (qlist->data);
+		mobj = path ? current_playlist_mobj_at_path (path, playlist) : NULL;
+		if (G_LIKELY(mobj)) {
+			list = g_list_prepend (list, mobj);
+			count++;
+		}
+		gtk_tree_path_free (path);
+	}
+
+	if (rena_preferences_get_shuffle (playlist->preferences)) {
+		rlist = g_list_find (playlist->rand_track_refs, playlist->curr_rand_ref);
+		for (rlist = rlist ? rlist->next : NULL ; rlist != NULL && count < n ; rlist = rlist->next) {
+			path = gtk_tree_row_reference_get_path (rlist->data);
+			mobj = path ? current_playlist_mobj_at_path (path, playlist) : NULL;
+			if (G_LIKELY(mobj)) {
+				list = g_list_prepend (list, mobj);
+				count++;
+			}
+			gtk_tree_path_free (path);
+		}
+	}
+	else {
+		if (playlist->curr_seq_ref) {
+			path = gtk_tree_row_reference_get_path (playlist->curr_seq_ref);
+			if (path && gtk_tree_model_get_iter (playlist->model, &iter, path))
+				valid = gtk_tree_model_iter_next (playlist->model, &iter);
+			gtk_tree_path_free (path);
+		}
+		else {
+			valid = gtk_tree_model_get_iter_first (playlist->model, &iter);
+		}
+		while (valid && count < n) {
+			gtk_tree_model_get (playlist->model, &iter, P_MOBJ_PTR, &mobj, -1);
+			if (G_LIKELY(mobj)) {
+				list = g_list_prepend (list, mobj);
+				count++;
+			}
+			valid = gtk_tree_model_iter_next (playlist->model, &iter);
+		}
+	}
+
+	return g_list_reverse (list);
+}
+
 /* Get a list of selected music objects on current playlist */
 
 GList *
@@ -3208,7 +3264,9 @@ rena_playlist_save_playlist_state (RenaPlaylist* cplaylist)
 	if (!gtk_tree_model_get_iter_first(cplaylist->model, &iter))
 		return;
 
+	RENA_PROFILE_BEGIN(span);
 	save_playlist(cplaylist, playlist_id, SAVE_COMPLETE);
+	RENA_PROFILE_END(span, "playlist-save-state");
 
 	/* Save reference to current song. */
 
@@ -3295,7 +3353,9 @@ rena_playlist_init_playlist_state (RenaPlaylist *cplaylist)
 	gchar *ref = NULL;
 	GtkTreePath *path = NULL;
 
+	RENA_PROFILE_BEGIN(span);
 	rena_playlist_restore_tracks (cplaylist);
+	RENA_PROFILE_END(span, "playlist-restore-state");
 
 	ref = rena_preferences_get_string(cplaylist->preferences,
 	                                    GROUP_PLAYLIST,
@@ -3737,18 +3797,12 @@ update_current_playlist_view_playback_state_cb (RenaBackend *backend, GParamSpec
 	update_current_playlist_view_track(cplaylist, backend);
 }
 
-static GtkWidget*
-create_current_playlist_view (RenaPlaylist *cplaylist)
-{
-	GtkWidget *current_playlist;
-	GtkListStore *store;
-	GtkTreeSelection *selection;
-	GtkTreeModel *model;
-	GtkTreeSortable *sortable;
-
-	/* Create the tree store */
+/* Create the store of the current playlist */
 
-	store = gtk_list_store_new(N_P_COLUMNS,
+GtkListStore *
+rena_playlist_store_new (void)
+{
+	return gtk_list_store_new(N_P_COLUMNS,
 				   G_TYPE_POINTER,	/* Pointer to musicobject */
 				   G_TYPE_STRING,	/* Queue No String */
 				   G_TYPE_BOOLEAN,	/* Show Bublle Queue */
@@ -3765,6 +3819,20 @@ create_current_playlist_view (RenaPlaylist *cplaylist)
 				   G_TYPE_STRING,	/* Filename */
 				   G_TYPE_STRING,	/* Mimetype */
 				   G_TYPE_BOOLEAN);	/* Played flag */
+}
+
+static GtkWidget*
+create_current_playlist_view (RenaPlaylist *cplaylist)
+{
+	GtkWidget *current_playlist;
+	GtkListStore *store;
+	GtkTreeSelection *selection;
+	GtkTreeModel *model;
+	GtkTreeSortable *sortable;
+
+	/* Create the tree store */
+
+	store = rena_playlist_store_new ();
 
 	/* Create the tree view */
 
@@ -4475,6 +4543,15 @@ rena_playlist_class_init (RenaPlaylistClass *klass)
 		              NULL, NULL,
 		              g_cclosure_marshal_VOID__VOID,
 		              G_TYPE_NONE, 0);
+
+	signals[PLAYLIST_QUEUE_CHANGED] =
+		g_signal_new ("playlist-queue-changed",
+		              G_TYPE_FROM_CLASS (gobject_class),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (RenaPlaylistClass, playlist_queue_changed),
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__VOID,
+		              G_TYPE_NONE, 0);
 }
 
 RenaPlaylist *
@@ -35,6 +35,7 @@ typedef struct {
 	void (*playlist_set_track) (RenaPlaylist *playlist, RenaMusicobject *mobj);
 	void (*playlist_change_tags) (RenaPlaylist *playlist, gint changes, RenaMusicobject *mobj);
 	void (*playlist_changed) (RenaPlaylist *playlist);
+	void (*playlist_queue_changed) (RenaPlaylist *playlist);
 } RenaPlaylistClass;
 
 /* Columns in current playlist view */
@@ -119,6 +120,7 @@ rena_playlist_select_title_of_artist (RenaPlaylist *cplaylist,
                                         const gchar    *artist);
 
 GList *rena_playlist_get_mobj_list(RenaPlaylist* cplaylist);
+GList *rena_playlist_get_upcoming_mobj_list(RenaPlaylist *playlist, guint n);
 GList *rena_playlist_get_selection_mobj_list(RenaPlaylist* cplaylist);
 GList *rena_playlist_get_selection_ref_list(RenaPlaylist *cplaylist);
 
@@ -150,6 +152,14 @@ void            rena_playlist_remove_plugin_action (RenaPlaylist *cplaylist, Gtk
 
 RenaDatabase *rena_playlist_get_database(RenaPlaylist* cplaylist);
 
+/* Playlist store, also usable without a display */
+
+GtkListStore *rena_playlist_store_new                 (void);
+void          rena_playlist_store_set_mobj            (GtkListStore *store, GtkTreeIter *iter, RenaMusicobject *mobj);
+void          rena_playlist_store_append_mobj         (GtkListStore *store, RenaMusicobject *mobj, GtkTreeIter *iter);
+void          rena_playlist_store_set_played          (GtkTreeModel *model, GtkTreePath *path, gboolean played);
+GtkTreePath  *rena_playlist_store_get_unplayed_random (GtkTreeModel *model, GRand *rand);
+
 RenaPlaylist *rena_playlist_new  (void);
 
 
@@ -32,9 +32,6 @@
 
 #ifdef HAVE_PLPARSER
 #include <totem-pl-parser.h>
-#else
-#include <fcntl.h>
-#include "xml_helper.h"
 #endif
 
 #include "rena-app-notification.h"
@@ -42,6 +39,7 @@
 #include "rena-file-utils.h"
 #include "rena-utils.h"
 #include "rena-musicobject-mgmt.h"
+#include "rena-simple-async.h"
 #include "rena.h"
 
 /* Playlist management */
@@ -739,308 +737,679 @@ rena_totem_pl_parser_parse_from_uri (const gchar *uri)
 
 	return plitems;
 }
-#else
-GSList *
-rena_pl_parser_parse_xspf (const gchar *filename)
-{
-	XMLNode *xml = NULL, *xi, *xl;
-	gchar *contents, *f_file, *uri, *base;
-	GSList *list = NULL;
-	GError *err = NULL;
-	GFile *file;
-	gsize size;
+#endif
 
-	file = g_file_new_for_path (filename);
+/*
+ * Incremental playlist parser.
+ *
+ * Entries are handed out in chunks, so huge playlists are never held in
+ * memory as a whole. With totem-pl-parser the list is parsed at once and
+ * only the chunks are emulated.
+ */
 
-	if (!g_file_load_contents (file, NULL, &contents, &size, NULL, NULL)) {
-		goto out;
-    	}
+#define RENA_PL_PARSER_BUFFER_SIZE (64 * 1024)
 
-	if (g_utf8_validate (contents, -1, NULL) == FALSE) {
-		gchar *fixed;
-		fixed = g_convert (contents, -1, "UTF-8", "ISO8859-1", NULL, NULL, NULL);
-		if (fixed != NULL) {
-			g_free (contents);
-			contents = fixed;
-		}
-	}
+struct _RenaPlParser {
+#ifdef HAVE_PLPARSER
+	GSList              *entries;
+#else
+	RenaPlaylistType     format;
+	gchar               *base;
+	GIOChannel          *chan;
+	GMarkupParseContext *context;
+	GString             *text;
+	gboolean             in_location;
+	gboolean             sniffed;
+	gboolean             latin1;
+	gboolean             eof;
+	GQueue               queue;
+#endif
+};
 
-	base = get_display_filename(filename, TRUE);
+#ifndef HAVE_PLPARSER
+static void
+rena_pl_parser_push_entry (RenaPlParser *parser, const gchar *entry)
+{
+	gchar *uri = NULL;
 
-	xml = tinycxml_parse(contents);
+	if (g_path_is_absolute(entry) || g_strrstr(entry, "://"))
+		uri = g_strdup(entry);
+	else
+		uri = g_build_filename (parser->base, entry, NULL);
 
-	xi = xmlnode_get(xml,CCA { "playlist","trackList","track",NULL},NULL,NULL);
-	for(;xi;xi= xi->next) {
-		xl = xmlnode_get(xi,CCA {"track","location",NULL},NULL,NULL);
+	g_queue_push_tail (&parser->queue, uri);
+}
 
-		if (xl && xl->content) {
-			f_file = g_filename_from_uri(xl->content, NULL, &err);
+static void
+rena_pl_parser_push_uri (RenaPlParser *parser, const gchar *entry)
+{
+	gchar *f_file = NULL;
+	GError *err = NULL;
 
-			if (!f_file) {
-				g_warning("Unable to get filename from UTF-8 string: %s",
-					  xl->content);
-				g_error_free(err);
-				err = NULL;
-				continue;
-			}
+	if (!g_str_has_prefix (entry, "file:")) {
+		rena_pl_parser_push_entry (parser, entry);
+		return;
+	}
+
+	f_file = g_filename_from_uri(entry, NULL, &err);
+	if (!f_file) {
+		g_warning("Unable to get filename from UTF-8 string: %s", entry);
+		g_error_free(err);
+		return;
+	}
+	rena_pl_parser_push_entry (parser, f_file);
+	g_free(f_file);
+}
+
+/* XSPF keeps the files in <track><location>, and ASX in <entry><ref href>.
+ * ASX element names are case insensitive. */
 
-			if (g_path_is_absolute(f_file))
-				uri = g_strdup(f_file);
-			else {
-				uri = g_build_filename (base, f_file, NULL);
+static void
+rena_pl_parser_start_element (GMarkupParseContext  *context,
+                              const gchar          *element_name,
+                              const gchar         **attribute_names,
+                              const gchar         **attribute_values,
+                              gpointer              user_data,
+                              GError              **error)
+{
+	RenaPlParser *parser = user_data;
+	const GSList *stack;
+	guint i;
+
+	if (parser->format == PL_FORMAT_XSPF) {
+		stack = g_markup_parse_context_get_element_stack (context);
+		if (g_strcmp0 (element_name, "location") == 0 &&
+		    stack->next && g_strcmp0 (stack->next->data, "track") == 0) {
+			parser->in_location = TRUE;
+			g_string_truncate (parser->text, 0);
+		}
+	}
+	else if (g_ascii_strcasecmp (element_name, "ref") == 0) {
+		for (i = 0; attribute_names[i] != NULL; i++) {
+			if (g_ascii_strcasecmp (attribute_names[i], "href") == 0) {
+				rena_pl_parser_push_uri (parser, attribute_values[i]);
+				break;
 			}
-			list = g_slist_append (list, uri);
-			g_free(f_file);
 		}
 	}
+}
 
-	xmlnode_free(xml);
-	g_free(contents);
-	g_free(base);
+static void
+rena_pl_parser_end_element (GMarkupParseContext  *context,
+                            const gchar          *element_name,
+                            gpointer              user_data,
+                            GError              **error)
+{
+	RenaPlParser *parser = user_data;
 
-out:
-	g_object_unref (file);
-	
-	return list;
+	if (!parser->in_location || g_strcmp0 (element_name, "location") != 0)
+		return;
+
+	parser->in_location = FALSE;
+	g_strstrip (parser->text->str);
+	if (*parser->text->str)
+		rena_pl_parser_push_uri (parser, parser->text->str);
 }
 
-GSList *
-rena_pl_parser_parse_pls (const gchar *file)
+static void
+rena_pl_parser_text (GMarkupParseContext  *context,
+                     const gchar          *text,
+                     gsize                 text_len,
+                     gpointer              user_data,
+                     GError              **error)
 {
-	GKeyFile *plskeyfile;
-	GError *error = NULL;
-	GSList *list = NULL;
-	guint i, nentries;
-	gchar key[128], *file_entry = NULL, *uri = NULL, *base = NULL;
+	RenaPlParser *parser = user_data;
+
+	if (parser->in_location)
+		g_string_append_len (parser->text, text, text_len);
+}
 
-	base = get_display_filename(file, TRUE);
+static const GMarkupParser rena_pl_markup_parser = {
+	rena_pl_parser_start_element,
+	rena_pl_parser_end_element,
+	rena_pl_parser_text,
+	NULL,
+	NULL
+};
 
-	plskeyfile = g_key_file_new();
+static void
+rena_pl_parser_read_markup (RenaPlParser *parser)
+{
+	gchar buffer[RENA_PL_PARSER_BUFFER_SIZE], *fixed = NULL;
+	const gchar *end = NULL;
+	gsize len = 0;
+	GError *err = NULL;
+	GIOStatus status;
 
-	if (!g_key_file_load_from_file(plskeyfile, file, G_KEY_FILE_NONE, &error)) {
-		g_critical("Unable to load pls playlist, err: %s", error->message);
+	status = g_io_channel_read_chars (parser->chan, buffer, sizeof(buffer), &len, NULL);
+	if (status != G_IO_STATUS_NORMAL || len == 0) {
+		if (!g_markup_parse_context_end_parse (parser->context, &err)) {
+			g_warning ("Unable to parse playlist: %s", err->message);
+			g_error_free (err);
+		}
+		parser->eof = TRUE;
+		return;
 	}
-	else {
-		nentries = g_key_file_get_integer (plskeyfile, "playlist", "NumberOfEntries", NULL);
-		if (nentries > 0) {
-			for (i = 1; i <= nentries; i++) {
-				g_snprintf (key, 128, "File%d", i);
-				file_entry = g_key_file_get_string(plskeyfile, "playlist", key, NULL);
-				if (NULL == file_entry)
-					continue;
-
-				if (g_path_is_absolute(file_entry))
-					uri = g_strdup(file_entry);
-				else {
-					uri = g_build_filename (base, file_entry, NULL);
-				}
-				list = g_slist_append (list, uri);
-				g_free(file_entry);
-			}
+
+	/* Old files are sometimes in latin1. Decide it with the first chunk,
+	 * ignoring a character cut at the end of it. */
+
+	if (!parser->sniffed) {
+		if (!g_utf8_validate (buffer, len, &end))
+			parser->latin1 = (buffer + len - end) > 3;
+		parser->sniffed = TRUE;
+	}
+
+	if (parser->latin1) {
+		fixed = g_convert (buffer, len, "UTF-8", "ISO8859-1", NULL, &len, NULL);
+		if (fixed == NULL) {
+			parser->eof = TRUE;
+			return;
 		}
 	}
-	g_key_file_free (plskeyfile);
-	g_free(base);
 
-	return list;
+	if (!g_markup_parse_context_parse (parser->context, fixed ? fixed : buffer, len, &err)) {
+		g_warning ("Unable to parse playlist: %s", err->message);
+		g_error_free (err);
+		parser->eof = TRUE;
+	}
+	g_free (fixed);
 }
 
-/* Load a M3U playlist, and add tracks to current playlist */
+/* M3U lists a file per line, PLS uses FileN=file keys. */
 
-GSList *
-rena_pl_parser_parse_m3u (const gchar *file)
+static void
+rena_pl_parser_read_line (RenaPlParser *parser)
 {
 	GError *err = NULL;
-	GIOChannel *chan = NULL;
-	gint fd;
 	gsize len, term;
-	gchar *str, *filename, *f_file, *uri, *base;
-	GSList *list = NULL;
+	gchar *str = NULL, *line, *f_file;
 
-	fd = g_open(file, O_RDONLY, 0);
-	if (fd == -1) {
-		g_critical("Unable to open file : %s",
-			   file);
-		return NULL;
+	if (g_io_channel_read_line (parser->chan, &str, &len, &term, &err) != G_IO_STATUS_NORMAL) {
+		if (err) {
+			g_warning ("Unable to read playlist: %s", err->message);
+			g_error_free (err);
+		}
+		parser->eof = TRUE;
+		return;
 	}
 
-	chan = g_io_channel_unix_new(fd);
-	if (!chan) {
-		g_critical("Unable to open an IO channel for file: %s", file);
-		goto exit_close;
-	}
+	str[term] = '\0';
+	line = g_strstrip (str);
 
-	base = get_display_filename(file, TRUE);
+	if (parser->format == PL_FORMAT_PLS) {
+		if (g_ascii_strncasecmp (line, "File", 4) != 0 || !g_ascii_isdigit (line[4]))
+			goto exit;
+		line = g_strstr_len (line, -1, "=");
+		if (line == NULL)
+			goto exit;
+		line = g_strstrip (line + 1);
+	}
 
-	while (g_io_channel_read_line(chan, &str, &len, &term, &err) ==
-	       G_IO_STATUS_NORMAL) {
+	if (*line == '\0' || *line == '#')
+		goto exit;
 
-		if (!str || !len)
-			break;
+	f_file = g_filename_from_utf8(line, -1, NULL, NULL, &err);
+	if (!f_file) {
+		g_warning("Unable to get filename from UTF-8 string: %s", line);
+		g_error_free(err);
+		goto exit;
+	}
+	rena_pl_parser_push_entry (parser, f_file);
+	g_free (f_file);
 
-		/* Skip lines containing #EXTM3U or #EXTINF */
+exit:
+	g_free (str);
+}
+#endif
 
-		if (g_strrstr(str, "#EXTM3U") || g_strrstr(str, "#EXTINF")) {
-			g_free(str);
-			continue;
-		}
+RenaPlParser *
+rena_pl_parser_new (const gchar *filename)
+{
+	RenaPlParser *parser;
+#ifdef HAVE_PLPARSER
+	gchar *uri = g_filename_to_uri (filename, NULL, NULL);
 
-		filename = g_strndup(str, term);
+	parser = g_slice_new0 (RenaPlParser);
+	parser->entries = rena_totem_pl_parser_parse_from_uri (uri);
+	g_free (uri);
+#else
+	RenaPlaylistType format;
+	GIOChannel *chan;
+	GError *err = NULL;
 
-		f_file = g_filename_from_utf8(filename, -1, NULL, NULL, &err);
-		if (!f_file) {
-			g_warning("Unable to get filename from UTF-8 string: %s",
-				  filename);
-			g_error_free(err);
-			err = NULL;
-			goto continue_read;
-		}
+	format = rena_pl_parser_guess_format_from_extension (filename);
+	if (format == PL_FORMAT_UNKNOWN) {
+		g_debug ("Unable to guess playlist format : %s", filename);
+		return NULL;
+	}
 
-		if (g_path_is_absolute(f_file))
-			uri = g_strdup(f_file);
-		else {
-			uri = g_build_filename (base, f_file, NULL);
-		}
-		list = g_slist_append (list, uri);
+	chan = g_io_channel_new_file (filename, "r", &err);
+	if (!chan) {
+		g_critical ("Unable to open playlist %s: %s", filename, err->message);
+		g_error_free (err);
+		return NULL;
+	}
 
-		rena_process_gtk_events ();
+	parser = g_slice_new0 (RenaPlParser);
+	parser->format = format;
+	parser->base = get_display_filename (filename, TRUE);
+	parser->chan = chan;
+	g_queue_init (&parser->queue);
 
-		g_free(f_file);
-	continue_read:
-		g_free(filename);
-		g_free(str);
+	if (format == PL_FORMAT_XSPF || format == PL_FORMAT_ASX) {
+		g_io_channel_set_encoding (chan, NULL, NULL);
+		parser->text = g_string_new (NULL);
+		parser->context = g_markup_parse_context_new (&rena_pl_markup_parser, 0, parser, NULL);
 	}
+#endif
+	return parser;
+}
 
-	CDEBUG(DBG_INFO, "Loaded M3U playlist: %s", file);
-
-	g_free(base);
+/* Returns the next @max_entries files of the playlist, or NULL at its end. */
 
-	if (g_io_channel_shutdown(chan, TRUE, &err) != G_IO_STATUS_NORMAL) {
-		g_critical("Unable to open M3U playlist: %s", file);
-		g_error_free(err);
-		err = NULL;
+GSList *
+rena_pl_parser_read_entries (RenaPlParser *parser, guint max_entries)
+{
+	GSList *list = NULL;
+	guint i;
+#ifdef HAVE_PLPARSER
+	GSList *l;
+
+	list = parser->entries;
+	for (i = 1, l = list; l != NULL && i < max_entries; i++)
+		l = l->next;
+	if (l != NULL) {
+		parser->entries = l->next;
+		l->next = NULL;
+	}
+	else {
+		parser->entries = NULL;
+	}
+#else
+	while (!parser->eof && g_queue_get_length (&parser->queue) < max_entries) {
+		if (parser->context)
+			rena_pl_parser_read_markup (parser);
+		else
+			rena_pl_parser_read_line (parser);
 	}
-	g_io_channel_unref(chan);
-
-exit_close:
-	close(fd);
 
+	for (i = 0; i < max_entries && !g_queue_is_empty (&parser->queue); i++)
+		list = g_slist_prepend (list, g_queue_pop_head (&parser->queue));
+	list = g_slist_reverse (list);
+#endif
 	return list;
 }
 
+void
+rena_pl_parser_free (RenaPlParser *parser)
+{
+#ifdef HAVE_PLPARSER
+	g_slist_free_full (parser->entries, g_free);
+#else
+	if (parser->context)
+		g_markup_parse_context_free (parser->context);
+	if (parser->text)
+		g_string_free (parser->text, TRUE);
+	g_queue_foreach (&parser->queue, (GFunc) g_free, NULL);
+	g_queue_clear (&parser->queue);
+	g_io_channel_unref (parser->chan);
+	g_free (parser->base);
+#endif
+	g_slice_free (RenaPlParser, parser);
+}
+
+#ifndef HAVE_PLPARSER
 GSList *
-rena_pl_parser_parse (RenaPlaylistType format, const gchar *filename)
+rena_pl_parser_parse_from_file_by_extension (const gchar *filename)
 {
-	GSList *list = NULL;
+	RenaPlParser *parser;
+	GSList *list = NULL, *entries;
 
-	switch (format)
-	{
-	case PL_FORMAT_M3U:
-		list = rena_pl_parser_parse_m3u (filename);
-		break;
-	case PL_FORMAT_PLS:
-		list = rena_pl_parser_parse_pls (filename);
-		break;
-	case PL_FORMAT_ASX:
-		//list = rena_pl_parser_parse_asx (filename);
-		break;
-	case PL_FORMAT_XSPF:
-		list = rena_pl_parser_parse_xspf (filename);
-		break;
-	default:
-	break;
-    }
+	parser = rena_pl_parser_new (filename);
+	if (parser == NULL)
+		return NULL;
+
+	while ((entries = rena_pl_parser_read_entries (parser, RENA_PL_PARSER_CHUNK_SIZE)) != NULL)
+		list = g_slist_concat (list, entries);
 
-    return list;
+	rena_pl_parser_free (parser);
+
+	CDEBUG(DBG_INFO, "Loaded playlist: %s", filename);
+
+	return list;
 }
+#endif
 
-GSList *rena_pl_parser_parse_from_file_by_extension (const gchar *filename)
+/* Resolve the files known by the library with a single query, that reads
+ * all the tags of the chunk. Files not found are left as NULL, to be read
+ * from disk. */
+
+static void
+rena_pl_parser_lookup_library (RenaDatabase *cdbase, GPtrArray *files, GPtrArray *mobjs)
 {
-	RenaPlaylistType format = PL_FORMAT_UNKNOWN;
-	GSList *list = NULL;
+	RenaPreparedStatement *statement;
+	RenaMusicobject *mobj;
+	GHashTable *found, *taken;
+	GString *sql;
+	guint i;
 
-	if ((format = rena_pl_parser_guess_format_from_extension (filename)) != PL_FORMAT_UNKNOWN) {
-		list = rena_pl_parser_parse (format, filename);
+	if (files->len == 0)
+		return;
+
+	sql = g_string_new (
+		"SELECT LOCATION.name, PROVIDER_TYPE.name, PROVIDER.name, MIME_TYPE.name, TRACK.title, ARTIST.name, ALBUM.name, GENRE.name, COMMENT.name, YEAR.year, TRACK.track_no, TRACK.length, TRACK.bitrate, TRACK.channels, TRACK.samplerate "
+		"FROM TRACK "
+		"INNER JOIN LOCATION ON TRACK.location = LOCATION.id "
+		"INNER JOIN PROVIDER ON TRACK.provider = PROVIDER.id "
+		"INNER JOIN PROVIDER_TYPE ON PROVIDER.type = PROVIDER_TYPE.id "
+		"INNER JOIN MIME_TYPE ON TRACK.file_type = MIME_TYPE.id "
+		"INNER JOIN ARTIST ON TRACK.artist = ARTIST.id "
+		"INNER JOIN ALBUM ON TRACK.album = ALBUM.id "
+		"INNER JOIN GENRE ON TRACK.genre = GENRE.id "
+		"INNER JOIN COMMENT ON TRACK.comment = COMMENT.id "
+		"INNER JOIN YEAR ON TRACK.year = YEAR.id "
+		"WHERE LOCATION.name IN (?");
+	for (i = 1; i < files->len; i++)
+		g_string_append (sql, ", ?");
+	g_string_append_c (sql, ')');
+
+	found = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
+
+	statement = rena_database_create_statement (cdbase, sql->str);
+	for (i = 0; i < files->len; i++)
+		rena_prepared_statement_bind_string (statement, i + 1, g_ptr_array_index (files, i));
+	while (rena_prepared_statement_step (statement)) {
+		mobj = new_musicobject_from_db_row (statement);
+		g_hash_table_replace (found, (gpointer) rena_musicobject_get_file (mobj), mobj);
 	}
-	else {
-		g_debug ("Unable to guess playlist format : %s", filename);
+	rena_prepared_statement_free (statement);
+
+	/* A playlist can list the same file more than once, and each row needs
+	 * its own musicobject. */
+	taken = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (i = 0; i < files->len; i++) {
+		mobj = g_hash_table_lookup (found, g_ptr_array_index (files, i));
+		if (mobj == NULL)
+			continue;
+		if (g_hash_table_contains (taken, mobj)) {
+			mobj = rena_musicobject_dup (mobj);
+		}
+		else {
+			g_hash_table_add (taken, mobj);
+			g_object_ref (mobj);
+		}
+		g_ptr_array_index (mobjs, i) = mobj;
 	}
 
-	return list;
+	g_hash_table_destroy (taken);
+	g_hash_table_destroy (found);
+	g_string_free (sql, TRUE);
+}
+
+static void
+rena_pl_parser_set_chunk (GPtrArray *files, GPtrArray *mobjs, GSList *entries)
+{
+	GSList *l;
+
+	g_ptr_array_set_size (files, 0);
+	g_ptr_array_set_size (mobjs, 0);
+
+	for (l = entries; l != NULL; l = l->next) {
+		g_ptr_array_add (files, l->data);
+		g_ptr_array_add (mobjs, NULL);
+	}
+	g_slist_free (entries);
 }
-#endif
 
 GList *
 rena_pl_parser_append_mobj_list_by_extension (GList *mlist, const gchar *file)
 {
-	GSList *list = NULL, *i = NULL;
+	RenaPlParser *parser;
+	RenaDatabase *cdbase;
 	RenaMusicobject *mobj;
+	GPtrArray *files, *mobjs;
+	GSList *entries;
+	guint i;
+
+	parser = rena_pl_parser_new (file);
+	if (parser == NULL)
+		return mlist;
+
+	cdbase = rena_database_get ();
+	files = g_ptr_array_new_with_free_func (g_free);
+	mobjs = g_ptr_array_new ();
+
+	while ((entries = rena_pl_parser_read_entries (parser, RENA_PL_PARSER_CHUNK_SIZE)) != NULL) {
+		rena_pl_parser_set_chunk (files, mobjs, entries);
+		rena_pl_parser_lookup_library (cdbase, files, mobjs);
+
+		for (i = 0; i < files->len; i++) {
+			mobj = g_ptr_array_index (mobjs, i);
+			if (mobj == NULL)
+				mobj = new_musicobject_from_file (g_ptr_array_index (files, i), NULL);
+			if (G_LIKELY(mobj))
+				mlist = g_list_append(mlist, mobj);
+		}
 
-#ifdef HAVE_PLPARSER
-	gchar *uri = g_filename_to_uri (file, NULL, NULL);
-	list = rena_totem_pl_parser_parse_from_uri(uri);
-	g_free (uri);
-#else
-	list = rena_pl_parser_parse_from_file_by_extension (file);
-#endif
+		rena_process_gtk_events ();
+	}
 
-	for (i = list; i != NULL; i = i->next) {
-		mobj = new_musicobject_from_file(i->data, NULL);
-		if (G_LIKELY(mobj))
-			mlist = g_list_append(mlist, mobj);
+	g_ptr_array_free (mobjs, TRUE);
+	g_ptr_array_free (files, TRUE);
+	g_object_unref (cdbase);
 
-		rena_process_gtk_events ();
+	rena_pl_parser_free (parser);
+
+	return mlist;
+}
+
+/*
+ * Playlist import.
+ *
+ * The playlist is opened on a worker thread. Then each step reads the tags
+ * of the files of the current chunk not known by the library and the next
+ * chunk of the playlist on a worker thread. Then the current chunk is
+ * appended in order and the new one is looked up on the library.
+ *
+ * Files opened together are kept in a queue by a single import, so other
+ * files are appended after the playlists opened before them, and two
+ * playlists never mix their chunks.
+ */
+
+typedef struct {
+	RenaApplication *rena;
+	GQueue           sources;
+	gchar           *playlist;
+	RenaPlParser    *parser;
+	GPtrArray       *files;
+	GPtrArray       *mobjs;
+	GSList          *next_entries;
+	gint             tried;
+	gint             added;
+} RenaPlImport;
+
+static void
+rena_pl_import_free (RenaPlImport *import)
+{
+	guint i;
 
-		g_free(i->data);
+	for (i = 0; i < import->mobjs->len; i++) {
+		if (g_ptr_array_index (import->mobjs, i) != NULL)
+			g_object_unref (g_ptr_array_index (import->mobjs, i));
 	}
-	g_slist_free(list);
+	g_ptr_array_free (import->mobjs, TRUE);
+	g_ptr_array_free (import->files, TRUE);
+	g_slist_free_full (import->next_entries, g_free);
+	g_queue_foreach (&import->sources, (GFunc) g_free, NULL);
+	g_queue_clear (&import->sources);
+	if (import->parser)
+		rena_pl_parser_free (import->parser);
+	g_free (import->playlist);
+	g_slice_free (RenaPlImport, import);
+}
 
-	return mlist;
+static RenaPlImport *pl_import_running = NULL;
+
+static gpointer
+rena_pl_import_worker (gpointer data)
+{
+	RenaPlImport *import = data;
+	guint i;
+
+	if (import->parser == NULL) {
+		import->parser = rena_pl_parser_new (import->playlist);
+		if (import->parser == NULL)
+			return import;
+	}
+
+	for (i = 0; i < import->files->len; i++) {
+		if (g_ptr_array_index (import->mobjs, i) == NULL)
+			g_ptr_array_index (import->mobjs, i) =
+				new_musicobject_from_file (g_ptr_array_index (import->files, i), NULL);
+	}
+
+	import->next_entries = rena_pl_parser_read_entries (import->parser, RENA_PL_PARSER_CHUNK_SIZE);
+
+	return import;
 }
 
-void rena_pl_parser_open_from_file_by_extension (const gchar *file, RenaApplication *rena)
+static gboolean rena_pl_import_finished (gpointer data);
+
+/* The current playlist was consumed. Open the next sources in order, until
+ * the next playlist to import. */
+
+static void
+rena_pl_import_next_source (RenaPlImport *import)
 {
 	RenaAppNotification *notification;
 	RenaPlaylist *playlist;
-	GSList *list = NULL, *i = NULL;
 	GList *mlist = NULL;
-	gchar *summary;
-	gint try = 0, added = 0;
+	gchar *summary, *file;
+
+	if (import->parser) {
+		summary = g_strdup_printf(_("Added %d songs from %d of the imported playlist."), import->added, import->tried);
+
+		notification = rena_app_notification_new (summary, NULL);
+		rena_app_notification_show (notification);
+
+		g_free(summary);
+
+		rena_pl_parser_free (import->parser);
+		import->parser = NULL;
+		import->added = import->tried = 0;
+	}
+	g_free (import->playlist);
+	import->playlist = NULL;
+
+	playlist = rena_application_get_playlist (import->rena);
+
+	while ((file = g_queue_pop_head (&import->sources)) != NULL) {
+		if (rena_file_get_media_type (file) == MEDIA_TYPE_PLAYLIST) {
+			import->playlist = file;
+			break;
+		}
+		mlist = append_mobj_list_from_unknown_filename (mlist, file);
+		g_free (file);
+	}
+
+	if (mlist) {
+		rena_playlist_append_mobj_list (playlist, mlist);
+		g_list_free (mlist);
+	}
+
+	if (import->playlist == NULL) {
+		pl_import_running = NULL;
+		rena_pl_import_free (import);
+		return;
+	}
+
+	rena_async_launch_task (RENA_ASYNC_PRIORITY_LONG, NULL, NULL,
+	                        rena_pl_import_worker, rena_pl_import_finished,
+	                        import, NULL);
+}
+
+static gboolean
+rena_pl_import_finished (gpointer data)
+{
+	RenaPlaylist *playlist;
+	RenaDatabase *cdbase;
 	RenaMusicobject *mobj;
+	GList *mlist = NULL;
+	guint i;
 
-#ifdef HAVE_PLPARSER
-	gchar *uri = g_filename_to_uri (file, NULL, NULL);
-	list = rena_totem_pl_parser_parse_from_uri(uri);
-	g_free (uri);
-#else
-	list = rena_pl_parser_parse_from_file_by_extension (file);
-#endif
+	RenaPlImport *import = data;
+
+	/* Append the chunk read */
 
-	for (i = list; i != NULL; i = i->next) {
-		try++;
-		mobj = new_musicobject_from_file(i->data, NULL);
+	for (i = import->files->len; i > 0; i--) {
+		mobj = g_ptr_array_index (import->mobjs, i - 1);
 		if (G_LIKELY(mobj)) {
-			added++;
-			mlist = g_list_append(mlist, mobj);
+			mlist = g_list_prepend (mlist, mobj);
+			g_ptr_array_index (import->mobjs, i - 1) = NULL;
+			import->added++;
 		}
+	}
+	import->tried += import->files->len;
 
-		rena_process_gtk_events ();
+	if (mlist) {
+		playlist = rena_application_get_playlist (import->rena);
+		rena_playlist_append_mobj_list (playlist, mlist);
+		g_list_free (mlist);
+	}
 
-		g_free(i->data);
+	/* Look up the next one or finish */
+
+	rena_pl_parser_set_chunk (import->files, import->mobjs, import->next_entries);
+	import->next_entries = NULL;
+
+	if (import->files->len == 0) {
+		rena_pl_import_next_source (import);
+		return FALSE;
 	}
 
-	playlist = rena_application_get_playlist (rena);
-	rena_playlist_append_mobj_list (playlist, mlist);
+	cdbase = rena_application_get_database (import->rena);
+	rena_pl_parser_lookup_library (cdbase, import->files, import->mobjs);
+
+	rena_async_launch_task (RENA_ASYNC_PRIORITY_LONG, NULL, NULL,
+	                        rena_pl_import_worker, rena_pl_import_finished,
+	                        import, NULL);
+
+	return FALSE;
+}
 
-	summary = g_strdup_printf(_("Added %d songs from %d of the imported playlist."), added, try);
+/* Append the files, folders and playlists in order. Playlists are imported
+ * in chunks in the background, and what follows them waits its turn. */
 
-	notification = rena_app_notification_new (summary, NULL);
-	rena_app_notification_show (notification);
+void rena_pl_parser_open_files (GSList *files, RenaApplication *rena)
+{
+	RenaPlImport *import = pl_import_running;
+	GSList *l;
+
+	if (import == NULL) {
+		import = g_slice_new0 (RenaPlImport);
+		import->rena = rena;
+		g_queue_init (&import->sources);
+		import->files = g_ptr_array_new_with_free_func (g_free);
+		import->mobjs = g_ptr_array_new ();
+	}
 
-	g_free(summary);
+	for (l = files; l != NULL; l = l->next)
+		g_queue_push_tail (&import->sources, g_strdup (l->data));
+
+	/* Already busy with a playlist. It takes these files when done. */
+	if (pl_import_running != NULL)
+		return;
+
+	pl_import_running = import;
+	rena_pl_import_next_source (import);
+}
+
+void rena_pl_parser_open_from_file_by_extension (const gchar *file, RenaApplication *rena)
+{
+	GSList files = { (gpointer) file, NULL };
 
-	g_slist_free(list);
-	g_list_free(mlist);
+	rena_pl_parser_open_files (&files, rena);
 }
 
 gchar *
@@ -54,11 +54,21 @@ rena_playlist_database_insert_playlist (RenaDatabase *cdbase, const gchar *playl
 void rena_playlist_save_selection (RenaPlaylist *playlist, const gchar *name);
 void rena_playlist_save_playlist  (RenaPlaylist *playlist, const gchar *name);
 
+/* Files handed out by each read of the incremental parser. */
+#define RENA_PL_PARSER_CHUNK_SIZE 256
+
+typedef struct _RenaPlParser RenaPlParser;
+
+RenaPlParser *rena_pl_parser_new          (const gchar *filename);
+GSList       *rena_pl_parser_read_entries (RenaPlParser *parser, guint max_entries);
+void          rena_pl_parser_free         (RenaPlParser *parser);
+
 GList *
 rena_pl_parser_append_mobj_list_by_extension (GList *mlist, const gchar *file);
 GSList *rena_pl_parser_parse_from_file_by_extension (const gchar *filename);
 GSList *rena_totem_pl_parser_parse_from_uri(const gchar *uri);
 void rena_pl_parser_open_from_file_by_extension(const gchar *file, RenaApplication *rena);
+void rena_pl_parser_open_files (GSList *files, RenaApplication *rena);
 gchar * rena_pl_get_first_playlist_item (const gchar *uri);
 
 gchar *
@@ -35,6 +35,11 @@ struct _RenaPluginsEngine {
 	PeasEngine        *peas_engine;
 	PeasExtensionSet  *peas_exten_set;
 
+	gchar            **startup_plugins;
+	guint              startup_index;
+	guint              startup_id;
+	gboolean           sidebar2_visible;
+
 	gboolean           starting;
 	gboolean           shutdown;
 };
@@ -81,7 +86,18 @@ rena_plugins_engine_shutdown (RenaPluginsEngine *engine)
 
 	engine->shutdown = TRUE;
 
-	loaded_plugins = peas_engine_get_loaded_plugins (engine->peas_engine);
+	if (engine->startup_id) {
+		g_source_remove (engine->startup_id);
+		engine->startup_id = 0;
+	}
+
+	/* Closed before all plugins were activated, so keep the list to load. */
+
+	if (engine->starting)
+		loaded_plugins = g_strdupv (engine->startup_plugins);
+	else
+		loaded_plugins = peas_engine_get_loaded_plugins (engine->peas_engine);
+
 	if (loaded_plugins) {
 		preferences = rena_application_get_preferences (RENA_APPLICATION(engine->object));
 		rena_preferences_set_string_list (preferences,
@@ -95,11 +111,51 @@ rena_plugins_engine_shutdown (RenaPluginsEngine *engine)
 	peas_engine_set_loaded_plugins (engine->peas_engine, NULL);
 }
 
+/* Plugins are activated one by one from a low priority idle, so the
+ * window keeps responding between them. */
+
+static gboolean
+rena_plugins_engine_load_next (gpointer user_data)
+{
+	RenaPreferences *preferences;
+	PeasPluginInfo *info;
+	const gchar *name = NULL;
+
+	RenaPluginsEngine *engine = user_data;
+
+	if (engine->startup_plugins)
+		name = engine->startup_plugins[engine->startup_index];
+
+	if (name == NULL) {
+		/* FIXME: Hack to allow hide sidebar when init. */
+		preferences = rena_application_get_preferences (RENA_APPLICATION(engine->object));
+		rena_preferences_set_secondary_lateral_panel (preferences, engine->sidebar2_visible);
+
+		engine->startup_id = 0;
+		engine->starting = FALSE;
+
+		rena_profile_startup_mark ("plugins");
+
+		return FALSE;
+	}
+	engine->startup_index++;
+
+	info = peas_engine_get_plugin_info (engine->peas_engine, name);
+	if (info) {
+		CDEBUG(DBG_PLUGIN,"Activating plugin: %s", name);
+
+		RENA_PROFILE_BEGIN(activate_span);
+		peas_engine_load_plugin (engine->peas_engine, info);
+		RENA_PROFILE_END(activate_span, "Plugin activation");
+	}
+
+	return TRUE;
+}
+
 void
 rena_plugins_engine_startup (RenaPluginsEngine *engine)
 {
 	RenaPreferences *preferences;
-	gchar **loaded_plugins = NULL;
 	const gchar *default_plugins[] = {"notify", "mpris2", "song-info", NULL};
 
 	CDEBUG(DBG_PLUGIN,"Plugins engine startup");
@@ -107,21 +163,22 @@ rena_plugins_engine_startup (RenaPluginsEngine *engine)
 	preferences = rena_application_get_preferences (RENA_APPLICATION(engine->object));
 
 	if (string_is_not_empty (rena_preferences_get_installed_version (preferences))) {
-		loaded_plugins = rena_preferences_get_string_list (preferences,
-		                                                     "PLUGINS",
-		                                                     "Activated",
-		                                                     NULL);
-
-		if (loaded_plugins) {
-			peas_engine_set_loaded_plugins (engine->peas_engine, (const gchar **) loaded_plugins);
-			g_strfreev(loaded_plugins);
-		}
+		engine->startup_plugins = rena_preferences_get_string_list (preferences,
+		                                                              "PLUGINS",
+		                                                              "Activated",
+		                                                              NULL);
 	}
 	else {
-		peas_engine_set_loaded_plugins (engine->peas_engine, (const gchar **) default_plugins);
+		engine->startup_plugins = g_strdupv ((gchar **) default_plugins);
 	}
 
-	engine->starting = FALSE;
+	engine->sidebar2_visible = rena_preferences_get_secondary_lateral_panel (preferences);
+
+	engine->startup_index = 0;
+	engine->startup_id = g_idle_add_full (G_PRIORITY_LOW,
+	                                      rena_plugins_engine_load_next,
+	                                      engine,
+	                                      NULL);
 }
 
 /*
@@ -134,6 +191,15 @@ rena_plugins_engine_dispose (GObject *object)
 
 	CDEBUG(DBG_PLUGIN,"Dispose plugins engine");
 
+	if (engine->startup_id) {
+		g_source_remove (engine->startup_id);
+		engine->startup_id = 0;
+	}
+	if (engine->startup_plugins) {
+		g_strfreev (engine->startup_plugins);
+		engine->startup_plugins = NULL;
+	}
+
 	if (engine->peas_exten_set) {
 		g_object_unref (engine->peas_exten_set);
 		engine->peas_exten_set = NULL;
@@ -269,6 +269,23 @@ rena_preferences_set_integer (RenaPreferences *preferences,
 	                        integer);
 }
 
+/**
+ * rena_preferences_get_int64:
+ *
+ */
+gint64
+rena_preferences_get_int64 (RenaPreferences *preferences,
+                            const gchar     *group_name,
+                            const gchar     *key)
+{
+	g_return_val_if_fail(RENA_IS_PREFERENCES(preferences), 0);
+
+	return g_key_file_get_int64 (preferences->priv->rc_keyfile,
+	                             group_name,
+	                             key,
+	                             NULL);
+}
+
 /**
  * rena_preferences_get_string:
  *
@@ -65,6 +65,8 @@ struct _RenaPreferencesClass
 #define KEY_INSTANT_SEARCH         "instant_filter"
 #define KEY_APPROXIMATE_SEARCH     "aproximate_search"
 #define KEY_CACHE_SIZE             "cache_size"
+#define KEY_CACHE_PREFETCH_COUNT   "cache_prefetch_count"
+#define KEY_CACHE_PREFETCH_RATE    "cache_prefetch_rate"
 
 #define GROUP_PLAYLIST "Playlist"
 #define KEY_SAVE_PLAYLIST          "save_playlist"
@@ -180,6 +182,11 @@ rena_preferences_set_integer (RenaPreferences *preferences,
                                 const gchar       *key,
                                       gint         integer);
 
+gint64
+rena_preferences_get_int64 (RenaPreferences *preferences,
+                            const gchar     *group_name,
+                            const gchar     *key);
+
 gchar *
 rena_preferences_get_string (RenaPreferences *preferences,
                                const gchar *group_name,
@@ -70,6 +70,13 @@ rena_prepared_statement_bind_int (RenaPreparedStatement *statement, gint n, gint
 		on_sqlite_error (statement);
 }
 
+void
+rena_prepared_statement_bind_int64 (RenaPreparedStatement *statement, gint n, gint64 value)
+{
+	if (sqlite3_bind_int64 (statement->stmt, n, value) != SQLITE_OK)
+		on_sqlite_error (statement);
+}
+
 
 gboolean
 rena_prepared_statement_step (RenaPreparedStatement *statement)
@@ -89,6 +96,12 @@ rena_prepared_statement_get_int (RenaPreparedStatement *statement, gint column)
 	return sqlite3_column_int (statement->stmt, column);
 }
 
+gint64
+rena_prepared_statement_get_int64 (RenaPreparedStatement *statement, gint column)
+{
+	return sqlite3_column_int64 (statement->stmt, column);
+}
+
 const gchar *
 rena_prepared_statement_get_string (RenaPreparedStatement *statement, gint column)
 {
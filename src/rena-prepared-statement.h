@@ -28,8 +28,10 @@ typedef struct RenaPreparedStatement RenaPreparedStatement;
 void                     rena_prepared_statement_free              (RenaPreparedStatement *statement);
 void                     rena_prepared_statement_bind_string       (RenaPreparedStatement *statement, gint n, const gchar *value);
 void                     rena_prepared_statement_bind_int          (RenaPreparedStatement *statement, gint n, gint value);
+void                     rena_prepared_statement_bind_int64        (RenaPreparedStatement *statement, gint n, gint64 value);
 gboolean                 rena_prepared_statement_step              (RenaPreparedStatement *statement);
 gint                     rena_prepared_statement_get_int           (RenaPreparedStatement *statement, gint column);
+gint64                   rena_prepared_statement_get_int64         (RenaPreparedStatement *statement, gint column);
 const gchar *            rena_prepared_statement_get_string        (RenaPreparedStatement *statement, gint column);
 void                     rena_prepared_statement_reset             (RenaPreparedStatement *statement);
 const gchar *            rena_prepared_statement_get_sql           (RenaPreparedStatement *statement);
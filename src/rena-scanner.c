@@ -49,6 +49,7 @@ struct _RenaScanner {
 	GSList            *folder_scanned;
 	GSList            *playlists;
 	gchar             *curr_provider;
+	gboolean           scoped;
 
 	GTimeVal          last_update;
 	/* Threads */
@@ -222,16 +223,78 @@ rena_scanner_finished_dialog_delete (GtkDialog *dialog, GdkEvent  *event, gpoint
 	return FALSE;
 }
 
+/* Replaces the songs of the scanned providers with the ones found, and
+ * imports the playlists detected. */
+
+static void
+rena_scanner_save_tracks (RenaScanner *scanner)
+{
+	RenaDatabase *database;
+	RenaDatabaseProvider *provider;
+	GSList *list;
+
+	database = rena_database_get();
+	provider = rena_database_provider_get ();
+
+	RENA_PROFILE_BEGIN(span);
+	rena_database_begin_transaction (database);
+
+	/* Remove songs of local providers */
+
+	for (list = scanner->folder_list; list != NULL; list = list->next)
+		rena_provider_forget_songs (provider, list->data);
+
+	/* Append new songs */
+
+	g_hash_table_foreach (scanner->tracks_table,
+	                      rena_scanner_add_track_db,
+	                      database);
+
+	/* Set local providers as visible */
+
+	for (list = scanner->folder_list; list != NULL; list = list->next)
+		rena_provider_set_visible (provider, list->data, TRUE);
+
+	/* Import playlist detected. */
+
+	for (list = scanner->playlists ; list != NULL; list = list->next)
+		rena_scanner_import_playlist(database, list->data);
+
+	rena_database_commit_transaction (database);
+	RENA_PROFILE_END(span, "scanner-database-insert");
+
+	rena_provider_update_done (provider);
+
+	g_object_unref (provider);
+	g_object_unref(database);
+}
+
+static void
+rena_scanner_clear (RenaScanner *scanner)
+{
+	g_hash_table_remove_all(scanner->tracks_table);
+	free_str_list(scanner->folder_list);
+	scanner->folder_list = NULL;
+	free_str_list(scanner->folder_scanned);
+	scanner->folder_scanned = NULL;
+
+	free_str_list(scanner->playlists);
+	scanner->playlists = NULL;
+
+	scanner->no_files = 0;
+	scanner->files_scanned = 0;
+	scanner->scoped = FALSE;
+
+	g_cancellable_reset (scanner->cancellable);
+}
+
 static gboolean
 rena_scanner_worker_finished (gpointer data)
 {
 	RenaBackgroundTaskBar *taskbar;
 	RenaPreferences *preferences;
-	RenaDatabase *database;
-	RenaDatabaseProvider *provider;
 	GtkWidget *msg_dialog;
 	gchar *last_scan_time = NULL;
-	GSList *list;
 
 	RenaScanner *scanner = data;
 
@@ -273,52 +336,23 @@ rena_scanner_worker_finished (gpointer data)
 		/* Save new database and update the library view */
 
 		set_watch_cursor(msg_dialog);
-
-		database = rena_database_get();
-		provider = rena_database_provider_get ();
-
-		rena_database_begin_transaction (database);
-
-		/* Remove songs of local providers */
-
-		for (list = scanner->folder_list; list != NULL; list = list->next)
-			rena_provider_forget_songs (provider, list->data);
-
-		/* Append new songs */
-
-		g_hash_table_foreach (scanner->tracks_table,
-		                      rena_scanner_add_track_db,
-		                      database);
-
-		/* Set local providers as visible */
-
-		for (list = scanner->folder_list; list != NULL; list = list->next)
-			rena_provider_set_visible (provider, list->data, TRUE);
-
-		/* Import playlist detected. */
-
-		for (list = scanner->playlists ; list != NULL; list = list->next)
-			rena_scanner_import_playlist(database, list->data);
-
-		rena_database_commit_transaction (database);
-
-		rena_provider_update_done (provider);
-
-		g_object_unref (provider);
-		g_object_unref(database);
-
+		rena_scanner_save_tracks (scanner);
 		remove_watch_cursor(msg_dialog);
 
-		/* Save finished time and folders scanned. */
+		/* Save finished time and folders scanned. Scans limited to some
+		 * providers did not look at the rest, so keep the time of the last
+		 * complete one. */
 
-		g_get_current_time(&scanner->last_update);
-		last_scan_time = g_time_val_to_iso8601(&scanner->last_update);
 		preferences = rena_preferences_get();
-		rena_preferences_set_string(preferences,
-			                     GROUP_LIBRARY,
-			                     KEY_LIBRARY_LAST_SCANNED,
-			                     last_scan_time);
-		g_free(last_scan_time);
+		if (!scanner->scoped) {
+			g_get_current_time(&scanner->last_update);
+			last_scan_time = g_time_val_to_iso8601(&scanner->last_update);
+			rena_preferences_set_string(preferences,
+				                     GROUP_LIBRARY,
+				                     KEY_LIBRARY_LAST_SCANNED,
+				                     last_scan_time);
+			g_free(last_scan_time);
+		}
 
 		rena_preferences_set_lock_library (preferences, FALSE);
 
@@ -342,19 +376,8 @@ rena_scanner_worker_finished (gpointer data)
 
 	/* Clean memory */
 
-	g_hash_table_remove_all(scanner->tracks_table);
-	free_str_list(scanner->folder_list);
-	scanner->folder_list = NULL;
-	free_str_list(scanner->folder_scanned);
-	scanner->folder_scanned = NULL;
-
-	free_str_list(scanner->playlists);
-	scanner->playlists = NULL;
-
-	scanner->no_files = 0;
-	scanner->files_scanned = 0;
+	rena_scanner_clear (scanner);
 
-	g_cancellable_reset (scanner->cancellable);
 	scanner->update_timeout = 0;
 
 	return FALSE;
@@ -430,6 +453,8 @@ rena_scanner_scan_worker(gpointer data)
 
 	RenaScanner *scanner = data;
 
+	RENA_PROFILE_BEGIN(span);
+
 	for(list = scanner->folder_list ; list != NULL; list = list->next) {
 		if(g_cancellable_is_cancelled (scanner->cancellable))
 			break;
@@ -441,6 +466,8 @@ rena_scanner_scan_worker(gpointer data)
 		rena_scanner_scan_handler(scanner, list->data);
 	}
 
+	RENA_PROFILE_END(span, "scanner-scan");
+
 	return scanner;
 }
 
@@ -522,6 +549,8 @@ rena_scanner_update_worker(gpointer data)
 
 	RenaScanner *scanner = data;
 
+	RENA_PROFILE_BEGIN(span);
+
 	/* Clean removed files */
 
 	g_hash_table_iter_init (&iter, scanner->tracks_table);
@@ -559,16 +588,35 @@ rena_scanner_update_worker(gpointer data)
 		}
 	}
 
+	RENA_PROFILE_END(span, "scanner-update");
+
 	return scanner;
 }
 
-void
-rena_scanner_update_library(RenaScanner *scanner)
+static RenaBackgroundTaskWidget *
+rena_scanner_task_widget_new (RenaScanner *scanner)
+{
+	RenaBackgroundTaskWidget *task_widget;
+
+	task_widget = rena_background_task_widget_new (_("Searching files to analyze"),
+	                                                 "drive-harddisk",
+	                                                 0,
+	                                                 scanner->cancellable);
+	g_object_ref (G_OBJECT(task_widget));
+
+	return task_widget;
+}
+
+/* Starts the scan of the folders in folder_list. Updates keep the songs
+ * of the already handled folders in folder_scanned, and only analyze
+ * again the files changed since the last scan. */
+
+static void
+rena_scanner_start (RenaScanner *scanner, gboolean update)
 {
 	RenaBackgroundTaskBar *taskbar;
 	RenaPreferences *preferences;
 	RenaDatabase *database;
-	RenaDatabaseProvider *provider;
 	RenaPreparedStatement *statement;
 	RenaMusicobject *mobj = NULL;
 	gchar *last_scan_time = NULL;
@@ -576,14 +624,11 @@ rena_scanner_update_library(RenaScanner *scanner)
 	guint location_id;
 	GSList *list;
 
-	if(scanner->update_timeout)
-		return;
-
 	preferences = rena_preferences_get();
 
 	rena_preferences_set_lock_library (preferences, TRUE);
 
-	/* Get last time that update the library and folders to analyze */
+	/* Get last time that update the library */
 
 	last_scan_time = rena_preferences_get_string(preferences,
 	                                               GROUP_LIBRARY,
@@ -595,13 +640,11 @@ rena_scanner_update_library(RenaScanner *scanner)
 	}
 	g_object_unref(G_OBJECT(preferences));
 
-	provider = rena_database_provider_get ();
-	scanner->folder_list = rena_database_provider_get_list_by_type (provider, "local");
-	scanner->folder_scanned = rena_provider_get_handled_list_by_type (provider, "local");
-	g_object_unref (provider);
-
 	/* Update the gui */
 
+	if (scanner->task_widget == NULL)
+		scanner->task_widget = rena_scanner_task_widget_new (scanner);
+
 	scanner->update_timeout =
 		g_timeout_add_seconds(1, (GSourceFunc)rena_scanner_update_progress, scanner);
 
@@ -611,88 +654,152 @@ rena_scanner_update_library(RenaScanner *scanner)
 
 	/* Append the files from database that no changed. */
 
-	database = rena_database_get();
-	for (list = scanner->folder_scanned; list != NULL; list = list->next)
-	{
-		if (rena_string_list_is_present (scanner->folder_list, list->data))
+	if (update) {
+		database = rena_database_get();
+		for (list = scanner->folder_scanned; list != NULL; list = list->next)
 		{
-			sql = "SELECT location FROM TRACK WHERE provider = ?";
-			statement = rena_database_create_statement (database, sql);
-
-			rena_prepared_statement_bind_int (statement, 1,
-				rena_database_find_provider (database, list->data));
-
-			while (rena_prepared_statement_step (statement)) {
-				location_id = rena_prepared_statement_get_int (statement, 0);
-				mobj = new_musicobject_from_db(database, location_id);
-				if (G_LIKELY(mobj)) {
-					g_hash_table_insert(scanner->tracks_table,
-					                    g_strdup(rena_musicobject_get_file(mobj)),
-					                    mobj);
-				}
+			if (rena_string_list_is_present (scanner->folder_list, list->data))
+			{
+				sql = "SELECT location FROM TRACK WHERE provider = ?";
+				statement = rena_database_create_statement (database, sql);
+
+				rena_prepared_statement_bind_int (statement, 1,
+					rena_database_find_provider (database, list->data));
+
+				while (rena_prepared_statement_step (statement)) {
+					location_id = rena_prepared_statement_get_int (statement, 0);
+					mobj = new_musicobject_from_db(database, location_id);
+					if (G_LIKELY(mobj)) {
+						g_hash_table_insert(scanner->tracks_table,
+						                    g_strdup(rena_musicobject_get_file(mobj)),
+						                    mobj);
+					}
 
-				rena_process_gtk_events ();
+					rena_process_gtk_events ();
+				}
+				rena_prepared_statement_free (statement);
 			}
-			rena_prepared_statement_free (statement);
 		}
+		g_object_unref(database);
 	}
-	g_object_unref(database);
 
 	/* Launch threads */
 
 	scanner->no_files_thread = g_thread_new("Count no files", rena_scanner_count_no_files_worker, scanner);
 
-	scanner->worker_thread = rena_async_launch_full(rena_scanner_update_worker,
+	scanner->worker_thread = rena_async_launch_full(update ? rena_scanner_update_worker : rena_scanner_scan_worker,
 	                                                  rena_scanner_worker_finished,
 	                                                  scanner);
 }
 
 void
-rena_scanner_scan_library(RenaScanner *scanner)
+rena_scanner_update_library(RenaScanner *scanner)
 {
-	RenaBackgroundTaskBar *taskbar;
-	RenaPreferences *preferences;
 	RenaDatabaseProvider *provider;
-	gchar *last_scan_time = NULL;
 
 	if(scanner->update_timeout)
 		return;
 
-	preferences = rena_preferences_get();
-	rena_preferences_set_lock_library (preferences, TRUE);
+	provider = rena_database_provider_get ();
+	scanner->folder_list = rena_database_provider_get_list_by_type (provider, "local");
+	scanner->folder_scanned = rena_provider_get_handled_list_by_type (provider, "local");
+	g_object_unref (provider);
 
-	/* Get last time that update the library and folders to analyze */
+	rena_scanner_start (scanner, TRUE);
+}
 
-	last_scan_time = rena_preferences_get_string(preferences,
-	                                               GROUP_LIBRARY,
-	                                               KEY_LIBRARY_LAST_SCANNED);
-	if (last_scan_time) {
-		if (!g_time_val_from_iso8601(last_scan_time, &scanner->last_update))
-			g_warning("Unable to convert last rescan time");
-		g_free(last_scan_time);
+/* Update only the given local providers, leaving the rest of the library
+ * untouched. Providers never scanned are analyzed from scratch. */
+
+void
+rena_scanner_update_providers (RenaScanner *scanner, GSList *providers)
+{
+	RenaDatabaseProvider *provider;
+	GSList *handled, *list;
+
+	if(scanner->update_timeout)
+		return;
+
+	provider = rena_database_provider_get ();
+	handled = rena_provider_get_handled_list_by_type (provider, "local");
+	g_object_unref (provider);
+
+	for (list = providers; list != NULL; list = list->next) {
+		scanner->folder_list = g_slist_append (scanner->folder_list, g_strdup (list->data));
+		if (rena_string_list_is_present (handled, list->data))
+			scanner->folder_scanned = g_slist_append (scanner->folder_scanned, g_strdup (list->data));
 	}
-	g_object_unref(G_OBJECT(preferences));
+	free_str_list (handled);
+
+	scanner->scoped = TRUE;
+
+	rena_scanner_start (scanner, TRUE);
+}
+
+void
+rena_scanner_scan_library(RenaScanner *scanner)
+{
+	RenaDatabaseProvider *provider;
+
+	if(scanner->update_timeout)
+		return;
 
 	provider = rena_database_provider_get ();
 	scanner->folder_list = rena_database_provider_get_list_by_type (provider, "local");
 	scanner->folder_scanned = rena_provider_get_handled_list_by_type (provider, "local");
 	g_object_unref (provider);
 
-	/* Update the gui */
+	rena_scanner_start (scanner, FALSE);
+}
 
-	scanner->update_timeout = g_timeout_add_seconds(1, (GSourceFunc)rena_scanner_update_progress, scanner);
+/* Rescan only the given local providers. */
 
-	taskbar = rena_background_task_bar_get ();
-	rena_background_task_bar_prepend_widget (taskbar, GTK_WIDGET(scanner->task_widget));
-	g_object_unref(G_OBJECT(taskbar));
+void
+rena_scanner_scan_providers (RenaScanner *scanner, GSList *providers)
+{
+	GSList *list;
 
-	/* Launch threads */
+	if(scanner->update_timeout)
+		return;
 
-	scanner->no_files_thread = g_thread_new("Count no files", rena_scanner_count_no_files_worker, scanner);
+	for (list = providers; list != NULL; list = list->next)
+		scanner->folder_list = g_slist_append (scanner->folder_list, g_strdup (list->data));
 
-	scanner->worker_thread = rena_async_launch_full(rena_scanner_scan_worker,
-	                                                  rena_scanner_worker_finished,
-	                                                  scanner);
+	scanner->scoped = TRUE;
+
+	rena_scanner_start (scanner, FALSE);
+}
+
+/* Scans the given local providers on the calling thread and without any
+ * widget, for tools that have no display. Returns the number of songs
+ * found, that are kept until rena_scanner_save_scanned(). */
+
+guint
+rena_scanner_scan_providers_sync (RenaScanner *scanner, GSList *providers)
+{
+	GSList *list;
+
+	if(scanner->update_timeout)
+		return 0;
+
+	for (list = providers; list != NULL; list = list->next)
+		scanner->folder_list = g_slist_append (scanner->folder_list, g_strdup (list->data));
+
+	scanner->scoped = TRUE;
+
+	rena_scanner_scan_worker (scanner);
+
+	return g_hash_table_size (scanner->tracks_table);
+}
+
+void
+rena_scanner_save_scanned (RenaScanner *scanner)
+{
+	if(scanner->update_timeout)
+		return;
+
+	rena_scanner_save_tracks (scanner);
+	rena_scanner_clear (scanner);
 }
 
 void
@@ -718,24 +825,15 @@ RenaScanner *
 rena_scanner_new()
 {
 	RenaScanner *scanner;
-	RenaBackgroundTaskWidget *task_widget;
 
 	scanner = g_slice_new0(RenaScanner);
 
 	scanner->cancellable = g_cancellable_new ();
 	g_object_ref (G_OBJECT(scanner->cancellable));
 
-	/* Create background task widget */
-
-	task_widget = rena_background_task_widget_new (_("Searching files to analyze"),
-	                                                 "drive-harddisk",
-	                                                 0,
-	                                                 scanner->cancellable);
-	g_object_ref (G_OBJECT(task_widget));
-
-	/* Init the rest and save references */
+	/* The background task widget is created on the first scan */
 
-	scanner->task_widget = task_widget;
+	scanner->task_widget = NULL;
 	scanner->tracks_table = g_hash_table_new_full (g_str_hash,
 	                                               g_str_equal,
 	                                               g_free,
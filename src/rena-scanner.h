@@ -23,9 +23,21 @@ typedef struct _RenaScanner RenaScanner;
 void
 rena_scanner_update_library(RenaScanner *scanner);
 
+void
+rena_scanner_update_providers (RenaScanner *scanner, GSList *providers);
+
 void
 rena_scanner_scan_library(RenaScanner *scanner);
 
+void
+rena_scanner_scan_providers (RenaScanner *scanner, GSList *providers);
+
+guint
+rena_scanner_scan_providers_sync (RenaScanner *scanner, GSList *providers);
+
+void
+rena_scanner_save_scanned (RenaScanner *scanner);
+
 void
 rena_scanner_free(RenaScanner *scanner);
 
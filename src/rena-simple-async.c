@@ -18,12 +18,18 @@
 #include "rena-simple-async.h"
 
 #include "rena-app-notification.h"
+#include "rena-debug.h"
 
 struct _AsyncSimple {
 	gpointer userdata;
 	gpointer finished_data;
 	GThreadFunc func_w;
 	GSourceFunc func_f;
+	GDestroyNotify destroy;
+	GCancellable *cancellable;
+	RenaAsyncPriority priority;
+	guint64 sequence;
+	gchar *key;
 };
 
 struct _IdleMessage {
@@ -78,15 +84,59 @@ rena_async_set_idle_message (gpointer user_data)
 
 /* Launch a asynchronous operation (worker_func), and when finished use another
  * function (finish_func) in the main loop using the information returned by
- * the asynchronous operation. */
+ * the asynchronous operation.
+ *
+ * The operations share a bounded pool of threads. Interactive ones run before
+ * the background ones, and otherwise in order of arrival. Long running ones,
+ * that can block for seconds on disk or network, have their own pool so they
+ * never hold the threads of the others. */
+
+#define ASYNC_MAX_THREADS      4
+#define ASYNC_MAX_LONG_THREADS 2
+
+static GThreadPool *async_pool = NULL;
+static GThreadPool *async_long_pool = NULL;
+static GHashTable  *async_keys = NULL;
+static GMutex       async_mutex;
+static guint64      async_sequence = 0;
+
+static void
+rena_async_free (AsyncSimple *as)
+{
+	if (as->key) {
+		g_mutex_lock (&async_mutex);
+		g_hash_table_remove (async_keys, as->key);
+		g_mutex_unlock (&async_mutex);
+		g_free (as->key);
+	}
+	if (as->cancellable)
+		g_object_unref (as->cancellable);
+	g_slice_free (AsyncSimple, as);
+}
 
 static gboolean
 rena_async_finished(gpointer data)
 {
 	AsyncSimple *as = data;
 
+	rena_profile_dispatch_begin ("rena_async_finished");
+
 	as->func_f(as->finished_data);
-	g_slice_free(AsyncSimple, as);
+	rena_async_free (as);
+
+	return FALSE;
+}
+
+static gboolean
+rena_async_dropped (gpointer data)
+{
+	AsyncSimple *as = data;
+
+	rena_profile_dispatch_begin ("rena_async_dropped");
+
+	if (as->destroy)
+		as->destroy (as->userdata);
+	rena_async_free (as);
 
 	return FALSE;
 }
@@ -103,20 +153,114 @@ rena_async_worker(gpointer data)
 	return NULL;
 }
 
-void
-rena_async_launch (GThreadFunc worker_func, GSourceFunc finish_func, gpointer user_data)
+static void
+rena_async_pool_func (gpointer data, gpointer user_data)
+{
+	AsyncSimple *as = data;
+
+	/* Cancelled while waiting on queue. */
+	if (as->cancellable && g_cancellable_is_cancelled (as->cancellable)) {
+		g_idle_add_full(G_PRIORITY_HIGH_IDLE, rena_async_dropped, as, NULL);
+		return;
+	}
+
+	rena_async_worker (as);
+}
+
+static gint
+rena_async_compare_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
+	const AsyncSimple *as_a = a, *as_b = b;
+
+	if (as_a->priority != as_b->priority)
+		return (as_a->priority < as_b->priority) ? -1 : 1;
+
+	return (as_a->sequence < as_b->sequence) ? -1 : 1;
+}
+
+static gpointer
+rena_async_pool_init (gpointer data)
+{
+	async_pool = g_thread_pool_new (rena_async_pool_func, NULL,
+	                                ASYNC_MAX_THREADS, FALSE,
+	                                NULL);
+	g_thread_pool_set_sort_function (async_pool, rena_async_compare_func, NULL);
+
+	async_long_pool = g_thread_pool_new (rena_async_pool_func, NULL,
+	                                     ASYNC_MAX_LONG_THREADS, FALSE,
+	                                     NULL);
+	g_thread_pool_set_sort_function (async_long_pool, rena_async_compare_func, NULL);
+
+	async_keys = g_hash_table_new (g_str_hash, g_str_equal);
+
+	return NULL;
+}
+
+/**
+ * rena_async_launch_task:
+ * @priority: The queue of the task. Use %RENA_ASYNC_PRIORITY_LONG for work
+ *  that can block for seconds.
+ * @key: (nullable): A key that identifies the task. While a task with the
+ *  same key is pending or running, the new one is dropped.
+ * @cancellable: (nullable): If cancelled before it runs, the task is dropped.
+ * @destroy: (nullable): Function used to free @userdata of dropped tasks.
+ *
+ * Returns: %TRUE if the task was queued.
+ */
+gboolean
+rena_async_launch_task (RenaAsyncPriority  priority,
+                        const gchar       *key,
+                        GCancellable      *cancellable,
+                        GThreadFunc        worker_func,
+                        GSourceFunc        finish_func,
+                        gpointer           userdata,
+                        GDestroyNotify     destroy)
+{
+	static GOnce pool_once = G_ONCE_INIT;
 	AsyncSimple *as;
 
+	g_once (&pool_once, rena_async_pool_init, NULL);
+
+	g_mutex_lock (&async_mutex);
+	if (key && g_hash_table_contains (async_keys, key)) {
+		g_mutex_unlock (&async_mutex);
+		if (destroy)
+			destroy (userdata);
+		return FALSE;
+	}
+
 	as = g_slice_new0(AsyncSimple);
 	as->func_w = worker_func;
 	as->func_f = finish_func;
-	as->userdata = user_data;
-	as->finished_data = NULL;
+	as->userdata = userdata;
+	as->destroy = destroy;
+	as->priority = priority;
+	as->sequence = async_sequence++;
+	if (cancellable)
+		as->cancellable = g_object_ref (cancellable);
+	if (key) {
+		as->key = g_strdup (key);
+		g_hash_table_add (async_keys, as->key);
+	}
+	g_mutex_unlock (&async_mutex);
+
+	if (priority == RENA_ASYNC_PRIORITY_LONG)
+		g_thread_pool_push (async_long_pool, as, NULL);
+	else
+		g_thread_pool_push (async_pool, as, NULL);
 
-	g_thread_unref(g_thread_new("Launch async", rena_async_worker, as));
+	return TRUE;
 }
 
+void
+rena_async_launch (GThreadFunc worker_func, GSourceFunc finish_func, gpointer user_data)
+{
+	rena_async_launch_task (RENA_ASYNC_PRIORITY_INTERACTIVE, NULL, NULL,
+	                        worker_func, finish_func, user_data, NULL);
+}
+
+/* Long running operations that need to be joined keep their own thread. */
+
 GThread *
 rena_async_launch_full (GThreadFunc worker_func, GSourceFunc finish_func, gpointer userdata)
 {
@@ -19,9 +19,16 @@
 #define RENA_SIMPLE_ASYNC_H
 
 #include <glib.h>
+#include <gio/gio.h>
 
 typedef struct _AsyncSimple AsyncSimple;
 
+typedef enum {
+	RENA_ASYNC_PRIORITY_INTERACTIVE,
+	RENA_ASYNC_PRIORITY_BACKGROUND,
+	RENA_ASYNC_PRIORITY_LONG
+} RenaAsyncPriority;
+
 typedef struct _IdleMessage IdleMessage;
 
 IdleMessage *
@@ -36,6 +43,14 @@ gboolean rena_async_set_idle_message (gpointer user_data);
 
 void     rena_async_launch           (GThreadFunc worker_func, GSourceFunc finish_func, gpointer userdata);
 
+gboolean rena_async_launch_task      (RenaAsyncPriority  priority,
+                                      const gchar       *key,
+                                      GCancellable      *cancellable,
+                                      GThreadFunc        worker_func,
+                                      GSourceFunc        finish_func,
+                                      gpointer           userdata,
+                                      GDestroyNotify     destroy);
+
 GThread *rena_async_launch_full      (GThreadFunc worker_func, GSourceFunc finish_func, gpointer userdata);
 
 #endif /* RENA_SIMPLE_ASYNC_H */
@@ -21,22 +21,197 @@
 
 #include <glib/gstdio.h>
 #include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "rena-debug.h"
+
+/*
+ * The index of cached songs lives in memory and is mirrored lazily on the
+ * CACHE table. The lru queue goes from least to most recently used song.
+ */
+
+typedef struct {
+	gint            location_id;
+	gchar          *location;
+	gchar          *basename;
+	gint64          size;
+	gint            playcount;
+	gint64          timestamp;
+	gboolean        dirty;
+	GList           link;
+} RenaSongCacheEntry;
+
+typedef struct {
+	RenaSongCache *cache;
+	gpointer        owner;
+	gchar          *location;
+	gchar          *uri;
+	gchar          *basename;
+	gchar          *part_filename;
+	GInputStream   *source;      /* Song already downloaded by the player */
+	GCancellable   *cancellable;
+	guint64         bytes;
+	gint64          start_time;
+	gboolean        done;
+} RenaSongCachePrefetch;
 
 struct _RenaSongCache {
 	GObject        _parent;
 	RenaDatabase *cdbase;
 	gchar          *cache_dir;
-	gint            cache_size;
+	gint64          cache_size;
+	gint64          cache_used;
+
+	/* Index of cached songs */
+	GHashTable     *entries;
+	GQueue          lru;
+	GQueue          dirty;
+	guint           flush_id;
+
+	/* Prefetch of upcoming songs */
+	guint           prefetch_count;
+	guint           prefetch_rate;
+	GMutex          prefetch_mutex;
+	GQueue         *prefetch_queue;
+	RenaSongCachePrefetch *prefetch_current;
+	gboolean        prefetch_running;
 };
 
+#define DEFAULT_CACHE_SIZE     (G_GINT64_CONSTANT(1) << 30) /* 1GB */
+#define DEFAULT_PREFETCH_COUNT 2
+#define DEFAULT_PREFETCH_RATE  1024 /* KiB/s */
+#define FLUSH_TIMEOUT          30 /* Seconds */
+
 G_DEFINE_TYPE(RenaSongCache, rena_song_cache, G_TYPE_OBJECT)
 
+/*
+ * Index of cached songs.
+ */
+
+static RenaSongCacheEntry *
+rena_song_cache_entry_new (gint location_id, const gchar *location, const gchar *basename)
+{
+	RenaSongCacheEntry *entry;
+
+	entry = g_slice_new0 (RenaSongCacheEntry);
+	entry->location_id = location_id;
+	entry->location = g_strdup (location);
+	entry->basename = g_strdup (basename);
+	entry->link.data = entry;
+
+	return entry;
+}
+
+static void
+rena_song_cache_entry_free (RenaSongCacheEntry *entry)
+{
+	g_free (entry->location);
+	g_free (entry->basename);
+	g_slice_free (RenaSongCacheEntry, entry);
+}
+
+static void
+rena_song_cache_flush (RenaSongCache *cache)
+{
+	RenaPreparedStatement *statement;
+	RenaSongCacheEntry *entry;
+
+	if (cache->flush_id) {
+		g_source_remove (cache->flush_id);
+		cache->flush_id = 0;
+	}
+
+	if (g_queue_is_empty (&cache->dirty))
+		return;
+
+	CDEBUG(DBG_INFO, "Flushing %u cache hits", g_queue_get_length (&cache->dirty));
+
+	statement = rena_database_create_statement (cache->cdbase, "UPDATE CACHE SET playcount = ?, timestamp = ? WHERE id = ?");
+	rena_database_begin_transaction (cache->cdbase);
+	while ((entry = g_queue_pop_head (&cache->dirty)) != NULL) {
+		rena_prepared_statement_bind_int (statement, 1, entry->playcount);
+		rena_prepared_statement_bind_int64 (statement, 2, entry->timestamp);
+		rena_prepared_statement_bind_int (statement, 3, entry->location_id);
+		rena_prepared_statement_step (statement);
+		rena_prepared_statement_reset (statement);
+		entry->dirty = FALSE;
+	}
+	rena_database_commit_transaction (cache->cdbase);
+	rena_prepared_statement_free (statement);
+}
+
+static gboolean
+rena_song_cache_flush_timeout (gpointer user_data)
+{
+	RenaSongCache *cache = user_data;
+
+	cache->flush_id = 0;
+	rena_song_cache_flush (cache);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Add the entry as the most recently used song.
+ */
+static void
+rena_song_cache_index_add (RenaSongCache *cache, RenaSongCacheEntry *entry)
+{
+	g_queue_push_tail_link (&cache->lru, &entry->link);
+	if (entry->location != NULL)
+		g_hash_table_replace (cache->entries, entry->location, entry);
+	cache->cache_used += entry->size;
+}
+
+static void
+rena_song_cache_index_remove (RenaSongCache *cache, RenaSongCacheEntry *entry)
+{
+	g_queue_unlink (&cache->lru, &entry->link);
+	if (entry->location != NULL &&
+	    g_hash_table_lookup (cache->entries, entry->location) == entry)
+		g_hash_table_remove (cache->entries, entry->location);
+	if (entry->dirty)
+		g_queue_remove (&cache->dirty, entry);
+	cache->cache_used -= entry->size;
+}
+
+static void
+rena_song_cache_load (RenaSongCache *cache)
+{
+	RenaPreparedStatement *statement;
+	RenaSongCacheEntry *entry;
+
+	statement = rena_database_create_statement (cache->cdbase,
+		"SELECT CACHE.id, LOCATION.name, CACHE.name, CACHE.size, CACHE.playcount, CACHE.timestamp "
+		"FROM CACHE LEFT JOIN LOCATION ON CACHE.id = LOCATION.id ORDER BY CACHE.timestamp");
+	while (rena_prepared_statement_step (statement)) {
+		/* Songs of forgotten locations just wait to be evicted. */
+		entry = rena_song_cache_entry_new (rena_prepared_statement_get_int (statement, 0),
+		                                   rena_prepared_statement_get_string (statement, 1),
+		                                   rena_prepared_statement_get_string (statement, 2));
+		entry->size = rena_prepared_statement_get_int64 (statement, 3);
+		entry->playcount = rena_prepared_statement_get_int (statement, 4);
+		entry->timestamp = rena_prepared_statement_get_int64 (statement, 5);
+		rena_song_cache_index_add (cache, entry);
+	}
+	rena_prepared_statement_free (statement);
+
+	CDEBUG(DBG_INFO, "Song cache: %u songs, %" G_GINT64_FORMAT " of %" G_GINT64_FORMAT " bytes used",
+	       g_queue_get_length (&cache->lru), cache->cache_used, cache->cache_size);
+}
+
 static void
 rena_song_cache_finalize (GObject *object)
 {
 	RenaSongCache *cache = RENA_SONG_CACHE(object);
 
 	g_free (cache->cache_dir);
+	g_hash_table_destroy (cache->entries);
+	while (!g_queue_is_empty (&cache->lru))
+		rena_song_cache_entry_free (g_queue_pop_head (&cache->lru));
+	g_queue_clear (&cache->dirty);
+	g_queue_free (cache->prefetch_queue);
+	g_mutex_clear (&cache->prefetch_mutex);
 
 	G_OBJECT_CLASS(rena_song_cache_parent_class)->finalize(object);
 }
@@ -47,6 +222,7 @@ rena_song_cache_dispose (GObject *object)
 	RenaSongCache *cache = RENA_SONG_CACHE(object);
 
 	if (cache->cdbase) {
+		rena_song_cache_flush (cache);
 		g_object_unref (cache->cdbase);
 		cache->cdbase = NULL;
 	}
@@ -67,16 +243,31 @@ static void
 rena_song_cache_init (RenaSongCache *cache)
 {
 	RenaPreferences *preferences;
+	gint prefetch_count = 0, prefetch_rate = 0;
 
 	cache->cdbase = rena_database_get ();
 	cache->cache_dir = g_build_path (G_DIR_SEPARATOR_S, g_get_user_cache_dir (), "rena", "songs", NULL);
 	g_mkdir_with_parents (cache->cache_dir, S_IRWXU);
 
 	preferences = rena_preferences_get ();
-	cache->cache_size = rena_preferences_get_integer (preferences, GROUP_GENERAL, KEY_CACHE_SIZE);
-	if (cache->cache_size == 0)
-		cache->cache_size = 1*1024*1024*1024; /* 1GB by default */
+	cache->cache_size = rena_preferences_get_int64 (preferences, GROUP_GENERAL, KEY_CACHE_SIZE);
+	if (cache->cache_size <= 0)
+		cache->cache_size = DEFAULT_CACHE_SIZE;
+
+	/* Hidden preferences. Zero use defaults, and a negative value disable them. */
+	prefetch_count = rena_preferences_get_integer (preferences, GROUP_GENERAL, KEY_CACHE_PREFETCH_COUNT);
+	cache->prefetch_count = (prefetch_count == 0) ? DEFAULT_PREFETCH_COUNT : MAX (0, prefetch_count);
+	prefetch_rate = rena_preferences_get_integer (preferences, GROUP_GENERAL, KEY_CACHE_PREFETCH_RATE);
+	cache->prefetch_rate = (prefetch_rate == 0) ? DEFAULT_PREFETCH_RATE : MAX (0, prefetch_rate);
 	g_object_unref (G_OBJECT(preferences));
+
+	cache->entries = g_hash_table_new (g_str_hash, g_str_equal);
+	g_queue_init (&cache->lru);
+	g_queue_init (&cache->dirty);
+	rena_song_cache_load (cache);
+
+	g_mutex_init (&cache->prefetch_mutex);
+	cache->prefetch_queue = g_queue_new ();
 }
 
 RenaSongCache *
@@ -96,154 +287,483 @@ rena_song_cache_get (void)
 	return cache;
 }
 
-static gboolean
-rena_song_cache_drop_song (RenaSongCache *cache, const gchar *basename)
+static void
+rena_song_cache_drop_song (RenaSongCache *cache, RenaSongCacheEntry *entry)
 {
 	RenaPreparedStatement *statement;
 	gchar *filename = NULL;
-	GFile *file;
-	gboolean done = FALSE;
-
-	filename = g_strdup_printf ("%s%s%s", cache->cache_dir, G_DIR_SEPARATOR_S, basename);
-	file = g_file_new_for_path (filename);
-
-	done = g_file_delete (file, NULL, NULL);
-	if (done) {
-		statement = rena_database_create_statement (cache->cdbase, "DELETE FROM CACHE WHERE name = ?");
-		rena_prepared_statement_bind_string (statement, 1, basename);
-		rena_prepared_statement_step (statement);
-		rena_prepared_statement_free (statement);
-	}
 
+	filename = g_strdup_printf ("%s%s%s", cache->cache_dir, G_DIR_SEPARATOR_S, entry->basename);
+	g_unlink (filename);
 	g_free (filename);
-	g_object_unref (file);
 
-	return done;
+	statement = rena_database_create_statement (cache->cdbase, "DELETE FROM CACHE WHERE name = ?");
+	rena_prepared_statement_bind_string (statement, 1, entry->basename);
+	rena_prepared_statement_step (statement);
+	rena_prepared_statement_free (statement);
+
+	rena_song_cache_index_remove (cache, entry);
+	rena_song_cache_entry_free (entry);
 }
 
 static void
 rena_song_cache_purge (RenaSongCache *cache)
 {
-	RenaPreparedStatement *statement;
-	gint cache_used = 0, song_size = 0;
-	const gchar *basename = NULL;
-
-	statement = rena_database_create_statement (cache->cdbase, "SELECT SUM (size) FROM CACHE");
-	if (rena_prepared_statement_step (statement))
-		cache_used = rena_prepared_statement_get_int (statement, 0);
-	rena_prepared_statement_free (statement);
+	RenaSongCacheEntry *entry;
 
-	if (cache->cache_size < cache_used)
-	{
-		statement = rena_database_create_statement (cache->cdbase, "SELECT name, size FROM CACHE ORDER BY timestamp");
-		while (rena_prepared_statement_step (statement))
-		{
-			basename = rena_prepared_statement_get_string (statement, 0);
-			song_size = rena_prepared_statement_get_int (statement, 1);
-			if (rena_song_cache_drop_song(cache, basename))
-			{
-				cache_used -= song_size;
-				if (cache->cache_size > cache_used)
-					break;
-			}
-		}
-		rena_prepared_statement_free (statement);
+	while (cache->cache_used > cache->cache_size &&
+	       (entry = g_queue_peek_head (&cache->lru)) != NULL) {
+		CDEBUG(DBG_INFO, "Evicting song from cache: %s", entry->basename);
+		rena_song_cache_drop_song (cache, entry);
 	}
 }
 
-void
-rena_song_cache_put_location (RenaSongCache *cache, const gchar *location, const gchar *filename)
+static gboolean
+rena_song_cache_contains_location (RenaSongCache *cache, const gchar *location)
+{
+	return g_hash_table_contains (cache->entries, location);
+}
+
+static void
+rena_song_cache_insert (RenaSongCache *cache, gint location_id, const gchar *location, const gchar *basename, const gchar *filename)
 {
 	RenaPreparedStatement *statement;
-	GFile *file, *destination;
-	gchar *dest_filename = NULL, *file_basename = NULL;
-	gint size = 0, timestamp = 0;
-	gint location_id = 0;
+	RenaSongCacheEntry *entry;
 	struct stat sbuf;
 
-	location_id = rena_database_find_location (cache->cdbase, location);
+	entry = rena_song_cache_entry_new (location_id, location, basename);
+	entry->playcount = 1;
+	if (g_stat(filename, &sbuf) == 0) {
+		entry->timestamp = sbuf.st_mtime;
+		entry->size = sbuf.st_size;
+	}
 
-	/* FIXME: Gstreamer 'download' even if it is a local file */
-	statement = rena_database_create_statement (cache->cdbase, "SELECT name FROM CACHE WHERE id = ?");
+	statement = rena_database_create_statement (cache->cdbase, "INSERT OR REPLACE INTO CACHE (id, name, size, playcount, timestamp) VALUES (?, ?, ?, ?, ?)");
 	rena_prepared_statement_bind_int (statement, 1, location_id);
-	if (rena_prepared_statement_step (statement)) {
-		rena_prepared_statement_free (statement);
-		return;
-	}
+	rena_prepared_statement_bind_string (statement, 2, basename);
+	rena_prepared_statement_bind_int64 (statement, 3, entry->size);
+	rena_prepared_statement_bind_int (statement, 4, entry->playcount);
+	rena_prepared_statement_bind_int64 (statement, 5, entry->timestamp);
+	rena_prepared_statement_step (statement);
 	rena_prepared_statement_free (statement);
 
-	/* TODO: Do it async... */
-	file = g_file_new_for_path (filename);
-	file_basename = g_file_get_basename(file);
-	dest_filename = g_strdup_printf ("%s%s%s", cache->cache_dir, G_DIR_SEPARATOR_S, file_basename);
-	destination = g_file_new_for_path (dest_filename);
-	if (g_file_copy (file, destination, G_FILE_COPY_NONE, NULL, NULL, NULL, NULL)) {
-		if (g_stat(dest_filename, &sbuf) == 0) {
-			timestamp = sbuf.st_mtime;
-			size = sbuf.st_size;
-		}
+	rena_song_cache_index_add (cache, entry);
+}
 
-		statement = rena_database_create_statement (cache->cdbase, "INSERT INTO CACHE (id, name, size, playcount, timestamp) VALUES (?, ?, ?, ?, ?)");
-		rena_prepared_statement_bind_int (statement, 1, location_id);
-		rena_prepared_statement_bind_string (statement, 2, file_basename);
-		rena_prepared_statement_bind_int (statement, 3, size);
-		rena_prepared_statement_bind_int (statement, 4, 1);
-		rena_prepared_statement_bind_int (statement, 5, timestamp);
-		rena_prepared_statement_step (statement);
-		rena_prepared_statement_free (statement);
-	}
+/*
+ * Move the song to the end of the lru, and keep the hit until the next flush.
+ */
+static void
+rena_song_cache_touch (RenaSongCache *cache, RenaSongCacheEntry *entry)
+{
+	g_queue_unlink (&cache->lru, &entry->link);
+	g_queue_push_tail_link (&cache->lru, &entry->link);
 
-	/* Clean cache if necessary. */
-	rena_song_cache_purge (cache);
+	entry->playcount++;
+	entry->timestamp = g_get_real_time () / G_USEC_PER_SEC;
 
-	g_object_unref(file);
-	g_object_unref(destination);
-	g_free (file_basename);
-	g_free (dest_filename);
+	if (!entry->dirty) {
+		entry->dirty = TRUE;
+		g_queue_push_tail (&cache->dirty, entry);
+	}
+	if (!cache->flush_id)
+		cache->flush_id = g_timeout_add_seconds (FLUSH_TIMEOUT, rena_song_cache_flush_timeout, cache);
 }
 
 gchar *
 rena_song_cache_get_from_location (RenaSongCache *cache, const gchar *location)
 {
-	RenaPreparedStatement *statement;
-	gchar *basename = NULL, *filename = NULL;
-	gint location_id = 0;
-	GTimeVal tv;
+	RenaSongCacheEntry *entry;
+	gchar *filename = NULL;
 
-	location_id = rena_database_find_location (cache->cdbase, location);
+	entry = g_hash_table_lookup (cache->entries, location);
+	if (entry == NULL)
+		return NULL;
 
-	statement = rena_database_create_statement (cache->cdbase, "SELECT name FROM CACHE WHERE id = ?");
-	rena_prepared_statement_bind_int (statement, 1, location_id);
-	if (rena_prepared_statement_step (statement))
-		basename = g_strdup (rena_prepared_statement_get_string (statement, 0));
-	rena_prepared_statement_free (statement);
+	filename = g_strdup_printf ("%s%s%s", cache->cache_dir, G_DIR_SEPARATOR_S, entry->basename);
+	if (g_file_test(filename, G_FILE_TEST_EXISTS)) {
+		rena_song_cache_touch (cache, entry);
+	}
+	else {
+		rena_song_cache_drop_song (cache, entry);
+		g_free (filename);
+		filename = NULL;
+	}
+
+	return filename;
+}
+
+/*
+ * Prefetch of upcoming songs.
+ *
+ * A single worker thread download the songs in order into the cache folder,
+ * and the main loop register them in the database when each one finish.
+ * Songs the player already downloaded are copied by the same worker, first.
+ */
+
+static RenaSongCachePrefetch *
+rena_song_cache_prefetch_new (RenaSongCache *cache, gpointer owner, const gchar *location, const gchar *uri)
+{
+	RenaSongCachePrefetch *item;
+
+	item = g_slice_new0 (RenaSongCachePrefetch);
+	item->cache = g_object_ref (cache);
+	item->owner = owner;
+	item->location = g_strdup (location);
+	item->uri = g_strdup (uri);
+	item->basename = g_compute_checksum_for_string (G_CHECKSUM_MD5, location, -1);
+	item->part_filename = g_strdup_printf ("%s%s%s.part", cache->cache_dir, G_DIR_SEPARATOR_S, item->basename);
+	item->cancellable = g_cancellable_new ();
+
+	return item;
+}
+
+static void
+rena_song_cache_prefetch_free (RenaSongCachePrefetch *item)
+{
+	g_object_unref (item->cache);
+	g_clear_object (&item->source);
+	g_object_unref (item->cancellable);
+	g_free (item->location);
+	g_free (item->uri);
+	g_free (item->basename);
+	g_free (item->part_filename);
+	g_slice_free (RenaSongCachePrefetch, item);
+}
+
+static GstPadProbeReturn
+rena_song_cache_prefetch_throttle (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+	RenaSongCachePrefetch *item = user_data;
+	gint64 elapsed, expected;
+	guint rate = item->cache->prefetch_rate;
+
+	item->bytes += gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info));
 
-	if (basename != NULL) {
-		filename = g_strdup_printf ("%s%s%s", cache->cache_dir, G_DIR_SEPARATOR_S, basename);
-		if (g_file_test(filename, G_FILE_TEST_EXISTS)) {
-			statement = rena_database_create_statement (cache->cdbase, "UPDATE CACHE SET playcount = playcount + 1 WHERE id = ?");
-			rena_prepared_statement_bind_int (statement, 1, location_id);
-			rena_prepared_statement_step (statement);
-			rena_prepared_statement_free (statement);
-
-			g_get_current_time(&tv);
-			statement = rena_database_create_statement (cache->cdbase, "UPDATE CACHE SET timestamp = ? WHERE id = ?");
-			rena_prepared_statement_bind_int (statement, 1, tv.tv_sec);
-			rena_prepared_statement_bind_int (statement, 2, location_id);
-			rena_prepared_statement_step (statement);
-			rena_prepared_statement_free (statement);
+	if (rate == 0)
+		return GST_PAD_PROBE_OK;
+
+	/* Sleep the streaming thread until the bytes fit in the rate limit */
+	elapsed = g_get_monotonic_time () - item->start_time;
+	expected = (item->bytes * G_USEC_PER_SEC) / ((guint64) rate * 1024);
+	if (expected > elapsed && !g_cancellable_is_cancelled (item->cancellable))
+		g_usleep (MIN (expected - elapsed, G_USEC_PER_SEC / 4));
+
+	return GST_PAD_PROBE_OK;
+}
+
+static gboolean
+rena_song_cache_prefetch_download (RenaSongCachePrefetch *item)
+{
+	GstElement *pipeline, *source, *sink;
+	GstMessage *message;
+	GstBus *bus;
+	GstPad *pad;
+	GError *error = NULL;
+	gboolean finished = FALSE, success = FALSE;
+
+	source = gst_element_make_from_uri (GST_URI_SRC, item->uri, "source", &error);
+	if (source == NULL) {
+		g_warning ("Unable to prefetch %s: %s", item->location, error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	sink = gst_element_factory_make ("filesink", "sink");
+	if (sink == NULL) {
+		gst_object_unref (source);
+		return FALSE;
+	}
+	g_object_set (sink, "location", item->part_filename, NULL);
+
+	pipeline = gst_pipeline_new ("prefetch");
+	gst_bin_add_many (GST_BIN(pipeline), source, sink, NULL);
+	gst_element_link (source, sink);
+
+	pad = gst_element_get_static_pad (source, "src");
+	gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+	                   rena_song_cache_prefetch_throttle, item, NULL);
+	gst_object_unref (pad);
+
+	item->bytes = 0;
+	item->start_time = g_get_monotonic_time ();
+
+	gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+	bus = gst_element_get_bus (pipeline);
+	while (!finished && !g_cancellable_is_cancelled (item->cancellable)) {
+		message = gst_bus_timed_pop_filtered (bus, 100 * GST_MSECOND,
+		                                      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+		if (message == NULL)
+			continue;
+
+		if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS) {
+			success = TRUE;
 		}
 		else {
-			statement = rena_database_create_statement (cache->cdbase, "DELETE FROM CACHE WHERE id = ?");
-			rena_prepared_statement_bind_int (statement, 1, location_id);
-			rena_prepared_statement_step (statement);
-			rena_prepared_statement_free (statement);
-			g_free (filename);
-			filename = NULL;
+			gst_message_parse_error (message, &error, NULL);
+			g_warning ("Unable to prefetch %s: %s", item->location, error->message);
+			g_error_free (error);
 		}
-		g_free (basename);
+		gst_message_unref (message);
+		finished = TRUE;
 	}
+	gst_object_unref (bus);
 
-	return filename;
+	gst_element_set_state (pipeline, GST_STATE_NULL);
+	gst_object_unref (pipeline);
+
+	if (g_cancellable_is_cancelled (item->cancellable))
+		success = FALSE;
+
+	if (!success)
+		g_unlink (item->part_filename);
+
+	return success;
+}
+
+static gboolean
+rena_song_cache_prefetch_copy (RenaSongCachePrefetch *item)
+{
+	GFile *part;
+	GFileOutputStream *output;
+	GError *error = NULL;
+	gboolean success = FALSE;
+
+	part = g_file_new_for_path (item->part_filename);
+	output = g_file_replace (part, NULL, FALSE, G_FILE_CREATE_PRIVATE, item->cancellable, &error);
+	if (output != NULL) {
+		success = g_output_stream_splice (G_OUTPUT_STREAM(output), item->source,
+		                                  G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+		                                  G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+		                                  item->cancellable, &error) >= 0;
+		g_object_unref (output);
+	}
+	g_object_unref (part);
+
+	if (error != NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("Unable to cache %s: %s", item->location, error->message);
+		g_error_free (error);
+	}
+
+	if (!success)
+		g_unlink (item->part_filename);
+
+	return success;
+}
+
+static gboolean
+rena_song_cache_prefetch_finished (gpointer user_data)
+{
+	RenaSongCachePrefetch *item = user_data;
+	RenaSongCache *cache = item->cache;
+	gchar *filename = NULL;
+	gint location_id = 0;
+
+	if (!item->done)
+		goto exit;
+
+	/* Maybe the song was played and cached meanwhile. */
+	if (g_cancellable_is_cancelled (item->cancellable) ||
+	    rena_song_cache_contains_location (cache, item->location)) {
+		g_unlink (item->part_filename);
+		goto exit;
+	}
+
+	filename = g_strdup_printf ("%s%s%s", cache->cache_dir, G_DIR_SEPARATOR_S, item->basename);
+	if (g_rename (item->part_filename, filename) == 0) {
+		CDEBUG(DBG_INFO, "Prefetched song in cache: %s", item->location);
+		location_id = rena_database_find_location (cache->cdbase, item->location);
+		rena_song_cache_insert (cache, location_id, item->location, item->basename, filename);
+		rena_song_cache_purge (cache);
+	}
+	else {
+		g_unlink (item->part_filename);
+	}
+	g_free (filename);
+
+exit:
+	rena_song_cache_prefetch_free (item);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+rena_song_cache_prefetch_worker_done (gpointer user_data)
+{
+	g_object_unref (G_OBJECT(user_data));
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer
+rena_song_cache_prefetch_worker (gpointer user_data)
+{
+	RenaSongCache *cache = user_data;
+	RenaSongCachePrefetch *item;
+
+	while (TRUE) {
+		g_mutex_lock (&cache->prefetch_mutex);
+		item = g_queue_pop_head (cache->prefetch_queue);
+		cache->prefetch_current = item;
+		if (item == NULL)
+			cache->prefetch_running = FALSE;
+		g_mutex_unlock (&cache->prefetch_mutex);
+
+		if (item == NULL)
+			break;
+
+		if (item->source != NULL)
+			item->done = rena_song_cache_prefetch_copy (item);
+		else
+			item->done = rena_song_cache_prefetch_download (item);
+
+		g_mutex_lock (&cache->prefetch_mutex);
+		cache->prefetch_current = NULL;
+		g_mutex_unlock (&cache->prefetch_mutex);
+
+		g_idle_add (rena_song_cache_prefetch_finished, item);
+	}
+
+	g_idle_add (rena_song_cache_prefetch_worker_done, cache);
+
+	return NULL;
+}
+
+static gboolean
+rena_song_cache_string_list_contains (GList *list, const gchar *str)
+{
+	GList *l;
+	for (l = list ; l != NULL ; l = l->next) {
+		if (g_strcmp0 (l->data, str) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static RenaSongCachePrefetch *
+rena_song_cache_prefetch_find (RenaSongCache *cache, const gchar *location)
+{
+	RenaSongCachePrefetch *item;
+	GList *l;
+
+	for (l = cache->prefetch_queue->head ; l != NULL ; l = l->next) {
+		item = l->data;
+		if (g_strcmp0 (item->location, location) == 0)
+			return item;
+	}
+	return NULL;
 }
 
+/* Must be called with the prefetch mutex locked. */
+
+static void
+rena_song_cache_prefetch_start (RenaSongCache *cache)
+{
+	if (cache->prefetch_running || g_queue_is_empty (cache->prefetch_queue))
+		return;
+
+	cache->prefetch_running = TRUE;
+	g_thread_unref (g_thread_new ("Song cache prefetch",
+	                              rena_song_cache_prefetch_worker,
+	                              g_object_ref (cache)));
+}
+
+/*
+ * The song the player downloaded is opened here, so it can be copied even if
+ * the player removes it, and it waits in the queue ahead of the downloads.
+ */
+void
+rena_song_cache_put_location (RenaSongCache *cache, const gchar *location, const gchar *filename)
+{
+	RenaSongCachePrefetch *item;
+	GFileInputStream *source;
+	GFile *file;
+	GError *error = NULL;
+
+	/* FIXME: Gstreamer 'download' even if it is a local file */
+	if (rena_song_cache_contains_location (cache, location))
+		return;
+
+	file = g_file_new_for_path (filename);
+	source = g_file_read (file, NULL, &error);
+	g_object_unref (file);
+	if (source == NULL) {
+		g_warning ("Unable to cache %s: %s", location, error->message);
+		g_error_free (error);
+		return;
+	}
+
+	g_mutex_lock (&cache->prefetch_mutex);
+
+	/* A pending download of the same song is no longer needed. */
+	item = rena_song_cache_prefetch_find (cache, location);
+	if (item != NULL) {
+		g_queue_remove (cache->prefetch_queue, item);
+		rena_song_cache_prefetch_free (item);
+	}
+
+	item = rena_song_cache_prefetch_new (cache, NULL, location, NULL);
+	item->source = G_INPUT_STREAM(source);
+	g_queue_push_head (cache->prefetch_queue, item);
+
+	rena_song_cache_prefetch_start (cache);
+
+	g_mutex_unlock (&cache->prefetch_mutex);
+}
+
+guint
+rena_song_cache_get_prefetch_count (RenaSongCache *cache)
+{
+	return cache->prefetch_count;
+}
+
+void
+rena_song_cache_prefetch (RenaSongCache *cache, gpointer owner, GList *locations, GList *uris)
+{
+	RenaSongCachePrefetch *item;
+	GList *l, *u, *next;
+
+	g_mutex_lock (&cache->prefetch_mutex);
+
+	/* The order changed. Forget the old requests of this owner.. */
+	for (l = cache->prefetch_queue->head ; l != NULL ; l = next) {
+		next = l->next;
+		item = l->data;
+		if (item->owner != owner)
+			continue;
+		g_queue_delete_link (cache->prefetch_queue, l);
+		rena_song_cache_prefetch_free (item);
+	}
+
+	/* ..and cancel the current download only if no longer needed. */
+	item = cache->prefetch_current;
+	if (item && item->owner == owner &&
+	    !rena_song_cache_string_list_contains (locations, item->location))
+		g_cancellable_cancel (item->cancellable);
+
+	for (l = locations, u = uris ; l != NULL && u != NULL ; l = l->next, u = u->next) {
+		if (item && item->owner == owner && !g_strcmp0 (item->location, l->data))
+			continue;
+
+		if (rena_song_cache_contains_location (cache, l->data))
+			continue;
+		if (rena_song_cache_prefetch_find (cache, l->data) != NULL)
+			continue;
+		if (rena_database_find_location (cache->cdbase, l->data) == 0)
+			continue;
+
+		g_queue_push_tail (cache->prefetch_queue,
+		                   rena_song_cache_prefetch_new (cache, owner, l->data, u->data));
+	}
+
+	rena_song_cache_prefetch_start (cache);
+
+	g_mutex_unlock (&cache->prefetch_mutex);
+}
+
+void
+rena_song_cache_cancel_prefetch (RenaSongCache *cache, gpointer owner)
+{
+	rena_song_cache_prefetch (cache, owner, NULL, NULL);
+}
@@ -44,6 +44,10 @@ RenaSongCache *rena_song_cache_get                (void);
 void             rena_song_cache_put_location      (RenaSongCache *cache, const gchar *location, const gchar *filename);
 gchar           *rena_song_cache_get_from_location (RenaSongCache *cache, const gchar *location);
 
+guint            rena_song_cache_get_prefetch_count (RenaSongCache *cache);
+void             rena_song_cache_prefetch           (RenaSongCache *cache, gpointer owner, GList *locations, GList *uris);
+void             rena_song_cache_cancel_prefetch    (RenaSongCache *cache, gpointer owner);
+
 
 G_END_DECLS
 
@@ -15,13 +15,34 @@
 /* along with this program.  If not, see <http://www.gnu.org/licenses/>.     */
 /*****************************************************************************/
 
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "rena-tagger.h"
 
+#if defined(GETTEXT_PACKAGE)
+#include <glib/gi18n-lib.h>
+#else
+#include <glib/gi18n.h>
+#endif
+
 #include "rena-musicobject.h"
 #include "rena-database.h"
 #include "rena-database-provider.h"
 #include "rena-library-pane.h"
 #include "rena-tags-mgmt.h"
+#include "rena-app-notification.h"
+#include "rena-background-task-bar.h"
+#include "rena-background-task-widget.h"
+#include "rena-simple-async.h"
+#include "rena-debug.h"
+
+/*
+ * Changes are applied by a single writer in order. Files are written on a
+ * worker thread, and then the database is updated in one transaction only
+ * with the songs written successfully.
+ */
 
 struct _RenaTaggerPrivate
 {
@@ -32,10 +53,23 @@ struct _RenaTaggerPrivate
 	GPtrArray         *file_arr;
 
 	RenaDatabase    *cdbase;
+
+	/* Writer job */
+	GArray            *written_arr;
+	GPtrArray         *failed_arr;
+	GCancellable      *cancellable;
+	RenaBackgroundTaskWidget *task_widget;
+	guint              timeout_id;
+	gint               progress;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE(RenaTagger, rena_tagger, G_TYPE_OBJECT)
 
+static GQueue      tagger_queue = G_QUEUE_INIT;
+static RenaTagger *tagger_running = NULL;
+
+static void rena_tagger_run_next (void);
+
 void
 rena_tagger_set_changes(RenaTagger *tagger, RenaMusicobject *mobj, gint changed)
 {
@@ -45,6 +79,8 @@ rena_tagger_set_changes(RenaTagger *tagger, RenaMusicobject *mobj, gint changed)
 	priv->changed = changed;
 }
 
+/* Files and locations are parallel arrays. Either could be unknown. */
+
 void
 rena_tagger_add_file(RenaTagger *tagger, const gchar *file)
 {
@@ -52,8 +88,7 @@ rena_tagger_add_file(RenaTagger *tagger, const gchar *file)
 	RenaTaggerPrivate *priv = tagger->priv;
 
 	location_id = rena_database_find_location(priv->cdbase, file);
-	if (G_LIKELY(location_id))
-		g_array_append_val(priv->loc_arr, location_id);
+	g_array_append_val(priv->loc_arr, location_id);
 
 	g_ptr_array_add(priv->file_arr, g_strdup(file));
 }
@@ -68,27 +103,165 @@ rena_tagger_add_location_id(RenaTagger *tagger, gint location_id)
 	g_array_append_val(priv->loc_arr, location_id);
 
 	file = rena_database_get_filename_from_location_id(priv->cdbase, location_id);
-	if (G_LIKELY(file))
-		g_ptr_array_add(priv->file_arr, file);
+	g_ptr_array_add(priv->file_arr, file);
 }
 
-void
-rena_tagger_apply_changes(RenaTagger *tagger)
+static gboolean
+rena_tagger_update_progress (gpointer user_data)
 {
-	RenaDatabaseProvider *provider;
+	RenaTagger *tagger = user_data;
+	RenaTaggerPrivate *priv = tagger->priv;
+
+	rena_background_task_widget_set_job_progress (priv->task_widget,
+		g_atomic_int_get (&priv->progress));
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+rena_tagger_write_worker (gpointer data)
+{
+	RenaTagger *tagger = data;
+	RenaTaggerPrivate *priv = tagger->priv;
+	const gchar *file;
+	gint location_id;
+	guint i;
+
+	for (i = 0; i < priv->file_arr->len; i++) {
+		if (g_cancellable_is_cancelled (priv->cancellable))
+			break;
+
+		file = g_ptr_array_index (priv->file_arr, i);
+		location_id = g_array_index (priv->loc_arr, gint, i);
+
+		if (file && !rena_musicobject_save_tags_to_file ((gchar *) file, priv->mobj, priv->changed))
+			g_ptr_array_add (priv->failed_arr, g_strdup (file));
+		else if (location_id)
+			g_array_append_val (priv->written_arr, location_id);
+
+		g_atomic_int_set (&priv->progress, i + 1);
+	}
+
+	return tagger;
+}
 
+static void
+rena_tagger_report_failed (RenaTagger *tagger)
+{
+	RenaAppNotification *notification;
 	RenaTaggerPrivate *priv = tagger->priv;
+	GString *message;
+	guint i;
+
+	message = g_string_new (NULL);
+	g_string_append_printf (message,
+		ngettext ("Unable to save tags of %u file:", "Unable to save tags of %u files:", priv->failed_arr->len),
+		priv->failed_arr->len);
+	for (i = 0; i < MIN (priv->failed_arr->len, 5); i++)
+		g_string_append_printf (message, "\n%s", (const gchar *) g_ptr_array_index (priv->failed_arr, i));
+	if (priv->failed_arr->len > 5)
+		g_string_append (message, "\n...");
+
+	notification = rena_app_notification_new (_("Edit tags"), message->str);
+	rena_app_notification_show (notification);
+
+	g_string_free (message, TRUE);
+}
 
-	if(priv->file_arr->len)
-		rena_update_local_files_change_tag(priv->file_arr, priv->changed, priv->mobj);
+static gboolean
+rena_tagger_write_finished (gpointer data)
+{
+	RenaBackgroundTaskBar *taskbar;
+	RenaDatabaseProvider *provider;
+	RenaTagger *tagger = data;
+	RenaTaggerPrivate *priv = tagger->priv;
 
-	if(priv->loc_arr->len) {
-		rena_database_update_local_files_change_tag(priv->cdbase, priv->loc_arr, priv->changed, priv->mobj);
+	if (priv->task_widget) {
+		g_source_remove (priv->timeout_id);
+		priv->timeout_id = 0;
+
+		taskbar = rena_background_task_bar_get ();
+		rena_background_task_bar_remove_widget (taskbar, GTK_WIDGET(priv->task_widget));
+		g_object_unref (G_OBJECT(taskbar));
+		g_object_unref (priv->task_widget);
+		priv->task_widget = NULL;
+	}
+
+	if (priv->written_arr->len) {
+		rena_database_update_local_files_change_tag (priv->cdbase, priv->written_arr, priv->changed, priv->mobj);
 
 		provider = rena_database_provider_get ();
 		rena_provider_update_done (provider);
 		g_object_unref (provider);
 	}
+
+	if (priv->failed_arr->len)
+		rena_tagger_report_failed (tagger);
+
+	tagger_running = NULL;
+	g_object_unref (tagger);
+
+	rena_tagger_run_next ();
+
+	return FALSE;
+}
+
+static void
+rena_tagger_run_next (void)
+{
+	RenaBackgroundTaskBar *taskbar;
+	RenaTaggerPrivate *priv;
+	RenaTagger *tagger;
+
+	if (tagger_running != NULL)
+		return;
+
+	tagger = g_queue_pop_head (&tagger_queue);
+	if (tagger == NULL)
+		return;
+
+	tagger_running = tagger;
+	priv = tagger->priv;
+
+	/* Show the progress only when it can take a while. */
+	if (priv->file_arr->len > 1) {
+		priv->task_widget = rena_background_task_widget_new (_("Saving tags"),
+		                                                     "document-save",
+		                                                     priv->file_arr->len,
+		                                                     priv->cancellable);
+		g_object_ref (G_OBJECT(priv->task_widget));
+
+		taskbar = rena_background_task_bar_get ();
+		rena_background_task_bar_prepend_widget (taskbar, GTK_WIDGET(priv->task_widget));
+		g_object_unref (G_OBJECT(taskbar));
+
+		priv->timeout_id = g_timeout_add (250, rena_tagger_update_progress, tagger);
+	}
+
+	rena_async_launch_task (RENA_ASYNC_PRIORITY_LONG, NULL, NULL,
+	                        rena_tagger_write_worker,
+	                        rena_tagger_write_finished,
+	                        tagger, NULL);
+}
+
+/**
+ * rena_tagger_apply_changes:
+ *
+ * Queue the changes to be written. It returns immediately, and the files and
+ * the library are updated in background.
+ */
+void
+rena_tagger_apply_changes(RenaTagger *tagger)
+{
+	RenaTaggerPrivate *priv = tagger->priv;
+
+	if (!priv->changed || !priv->file_arr->len)
+		return;
+
+	CDEBUG(DBG_VERBOSE, "Queue tags changes: 0x%x on %u files", priv->changed, priv->file_arr->len);
+
+	g_queue_push_tail (&tagger_queue, g_object_ref (tagger));
+	rena_tagger_run_next ();
 }
 
 static void
@@ -105,6 +278,10 @@ rena_tagger_dispose (GObject *object)
 		g_object_unref (priv->cdbase);
 		priv->cdbase = NULL;
 	}
+	if (priv->cancellable) {
+		g_object_unref (priv->cancellable);
+		priv->cancellable = NULL;
+	}
 
 	G_OBJECT_CLASS (rena_tagger_parent_class)->dispose (object);
 }
@@ -117,6 +294,8 @@ rena_tagger_finalize (GObject *object)
 
 	g_array_free(priv->loc_arr, TRUE);
 	g_ptr_array_free(priv->file_arr, TRUE);
+	g_array_free(priv->written_arr, TRUE);
+	g_ptr_array_free(priv->failed_arr, TRUE);
 
 	G_OBJECT_CLASS(rena_tagger_parent_class)->finalize(object);
 }
@@ -146,6 +325,10 @@ rena_tagger_init (RenaTagger *tagger)
 	priv->loc_arr = g_array_new(TRUE, TRUE, sizeof(gint));
 	priv->file_arr = g_ptr_array_new_with_free_func(g_free);
 
+	priv->written_arr = g_array_new(TRUE, TRUE, sizeof(gint));
+	priv->failed_arr = g_ptr_array_new_with_free_func(g_free);
+	priv->cancellable = g_cancellable_new ();
+
 	priv->cdbase = rena_database_get();
 }
 
@@ -219,28 +219,3 @@ confirm_title_multiple_tracks(const gchar *title, GtkWidget *parent)
 
 	return (response == GTK_RESPONSE_YES);
 }
-
-void
-rena_update_local_files_change_tag(GPtrArray *file_arr, gint changed, RenaMusicobject *mobj)
-{
-	guint i = 0;
-	gchar *elem;
-
-	if (!changed)
-		return;
-
-	if (!file_arr)
-		return;
-
-	CDEBUG(DBG_VERBOSE, "Tags Changed: 0x%x", changed);
-
-	/* This is so fscking horrible. */
-
-	if (file_arr) {
-		for (i = 0; i < file_arr->len; i++) {
-			elem = g_ptr_array_index(file_arr, i);
-			if (elem)
-				(void)rena_musicobject_save_tags_to_file(elem, mobj, changed);
-		}
-	}
-}
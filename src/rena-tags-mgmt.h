@@ -26,6 +26,5 @@ gboolean rena_musicobject_set_tags_from_file(RenaMusicobject *mobj, const gchar
 gboolean rena_musicobject_save_tags_to_file(gchar *file, RenaMusicobject *mobj, int changed);
 gboolean confirm_tno_multiple_tracks(gint tno, GtkWidget *parent);
 gboolean confirm_title_multiple_tracks(const gchar *title, GtkWidget *parent);
-void rena_update_local_files_change_tag(GPtrArray *file_arr, gint changed, RenaMusicobject *mobj);
 
 #endif /* RENA_TAGS_MGMT_H */
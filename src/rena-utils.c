@@ -744,11 +744,14 @@ gboolean validate_album_art_pattern(const gchar *pattern)
 	return ret;
 }
 
+#ifdef DEBUG
+GThread *rena_main_thread = NULL;
+#endif
+
 void
 rena_process_gtk_events ()
 {
 #ifdef DEBUG
-	extern GThread *rena_main_thread;
 	if (g_thread_self () != rena_main_thread)
 		g_warning ("THREAD SAFETY ERROR!");
 #endif
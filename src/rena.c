@@ -87,6 +87,8 @@ struct _RenaApplication {
 
 	GBinding          *sidebar2_binding;
 
+	guint              startup_id;
+
 #ifdef HAVE_LIBPEAS
 	RenaPluginsEngine *plugins_engine;
 #endif
@@ -109,10 +111,8 @@ rena_open_files_dialog_close_button_cb (GtkWidget *widget, gpointer data)
 static void
 rena_open_files_dialog_add_button_cb (GtkWidget *widget, gpointer data)
 {
-	RenaPlaylist *playlist;
-	GSList *files = NULL, *l;
+	GSList *files = NULL;
 	gboolean add_recursively;
-	GList *mlist = NULL;
 
 	GtkWidget *window = g_object_get_data(data, "window");
 	GtkWidget *chooser = g_object_get_data(data, "chooser");
@@ -133,14 +133,9 @@ rena_open_files_dialog_add_button_cb (GtkWidget *widget, gpointer data)
 	gtk_widget_destroy(window);
 
 	if (files) {
-		for (l = files; l != NULL; l = l->next) {
-			mlist = append_mobj_list_from_unknown_filename(mlist, l->data);
-		}
+		/* Playlists are imported in chunks in the background. */
+		rena_pl_parser_open_files (files, rena);
 		g_slist_free_full(files, g_free);
-
-		playlist = rena_application_get_playlist (rena);
-		rena_playlist_append_mobj_list (playlist, mlist);
-		g_list_free (mlist);
 	}
 }
 
@@ -686,22 +681,27 @@ rena_application_provider_want_update (RenaDatabaseProvider *provider,
 	RenaDatabase *database;
 	RenaScanner *scanner;
 	RenaPreparedStatement *statement;
+	GSList *providers = NULL;
 	const gchar *sql, *provider_type = NULL;
 
-	sql = "SELECT name FROM provider_type WHERE id IN (SELECT type FROM provider WHERE id = ?)";
+	sql = "SELECT provider_type.name, provider.name FROM provider JOIN provider_type ON provider.type = provider_type.id WHERE provider.id = ?";
 
 	database = rena_application_get_database (rena);
 	statement = rena_database_create_statement (database, sql);
 	rena_prepared_statement_bind_int (statement, 1, provider_id);
-	if (rena_prepared_statement_step (statement))
+	if (rena_prepared_statement_step (statement)) {
 		provider_type = rena_prepared_statement_get_string (statement, 0);
+		if (g_ascii_strcasecmp (provider_type, "local") == 0)
+			providers = g_slist_append (providers, g_strdup (rena_prepared_statement_get_string (statement, 1)));
+	}
+	rena_prepared_statement_free (statement);
 
-	if (g_ascii_strcasecmp (provider_type, "local") == 0)
+	if (providers != NULL)
 	{
 		scanner = rena_application_get_scanner (rena);
-		rena_scanner_update_library (scanner);
+		rena_scanner_update_providers (scanner, providers);
+		free_str_list (providers);
 	}
-	rena_prepared_statement_free (statement);
 }
 
 static void
@@ -712,22 +712,27 @@ rena_application_provider_want_upgrade (RenaDatabaseProvider *provider,
 	RenaDatabase *database;
 	RenaScanner *scanner;
 	RenaPreparedStatement *statement;
+	GSList *providers = NULL;
 	const gchar *sql, *provider_type = NULL;
 
-	sql = "SELECT name FROM provider_type WHERE id IN (SELECT type FROM provider WHERE id = ?)";
+	sql = "SELECT provider_type.name, provider.name FROM provider JOIN provider_type ON provider.type = provider_type.id WHERE provider.id = ?";
 
 	database = rena_application_get_database (rena);
 	statement = rena_database_create_statement (database, sql);
 	rena_prepared_statement_bind_int (statement, 1, provider_id);
-	if (rena_prepared_statement_step (statement))
+	if (rena_prepared_statement_step (statement)) {
 		provider_type = rena_prepared_statement_get_string (statement, 0);
+		if (g_ascii_strcasecmp (provider_type, "local") == 0)
+			providers = g_slist_append (providers, g_strdup (rena_prepared_statement_get_string (statement, 1)));
+	}
+	rena_prepared_statement_free (statement);
 
-	if (g_ascii_strcasecmp (provider_type, "local") == 0)
+	if (providers != NULL)
 	{
 		scanner = rena_application_get_scanner (rena);
-		rena_scanner_scan_library (scanner);
+		rena_scanner_scan_providers (scanner, providers);
+		free_str_list (providers);
 	}
-	rena_prepared_statement_free (statement);
 }
 
 static void
@@ -867,6 +872,10 @@ rena_application_get_library (RenaApplication *rena)
 RenaPreferencesDialog *
 rena_application_get_preferences_dialog (RenaApplication *rena)
 {
+	if (rena->setting_dialog == NULL) {
+		rena->setting_dialog = rena_preferences_dialog_get ();
+		rena_preferences_dialog_set_parent (rena->setting_dialog, GTK_WIDGET (rena->mainwindow));
+	}
 	return rena->setting_dialog;
 }
 
@@ -1075,6 +1084,72 @@ rena_application_dispose (GObject *object)
 	G_OBJECT_CLASS (rena_application_parent_class)->dispose (object);
 }
 
+/*
+ * Startup phases.
+ *
+ * Startup only builds what is needed to paint the window with the library
+ * and the restored playlist. The first frame schedules the interactive phase
+ * in an idle, and the plugins are then activated one by one at low priority.
+ * A hidden window never paints, so the phase then starts once the main loop
+ * is idle, and a window that does not paint in time is not waited for.
+ */
+
+#define FIRST_PAINT_TIMEOUT 5 /* Seconds */
+
+static gboolean rena_application_interactive_phase (gpointer user_data);
+
+static gboolean
+rena_application_first_paint (GtkWidget *widget, cairo_t *cr, RenaApplication *rena)
+{
+	g_signal_handlers_disconnect_by_func (widget, rena_application_first_paint, rena);
+
+	rena_profile_startup_mark ("first paint");
+
+	if (rena->startup_id)
+		g_source_remove (rena->startup_id);
+	rena->startup_id = g_idle_add (rena_application_interactive_phase, rena);
+
+	return FALSE;
+}
+
+static gboolean
+rena_application_interactive_phase (gpointer user_data)
+{
+	RenaApplication *rena = user_data;
+
+	rena->startup_id = 0;
+	g_signal_handlers_disconnect_by_func (rena->mainwindow, rena_application_first_paint, rena);
+
+	rena_profile_startup_mark ("interactive");
+
+	/* Plugins append their settings to the dialog. */
+
+	rena_application_get_preferences_dialog (rena);
+
+#ifdef HAVE_LIBPEAS
+	rena_plugins_engine_startup (rena->plugins_engine);
+#endif
+
+	return FALSE;
+}
+
+/* Names the stalls of the handlers of GTK, which all run below this. */
+
+static void
+rena_application_profile_event (GdkEvent *event, gpointer data)
+{
+	static GEnumClass *event_types = NULL;
+	GEnumValue *value;
+
+	if (G_UNLIKELY(event_types == NULL))
+		event_types = g_type_class_ref (GDK_TYPE_EVENT_TYPE);
+
+	value = g_enum_get_value (event_types, event->type);
+	rena_profile_dispatch_begin (value ? value->value_name : "GDK event");
+
+	gtk_main_do_event (event);
+}
+
 static void
 rena_application_startup (GApplication *application)
 {
@@ -1089,8 +1164,13 @@ rena_application_startup (GApplication *application)
 
 	RenaApplication *rena = RENA_APPLICATION (application);
 
+	rena_profile_startup_mark ("startup");
+
 	G_APPLICATION_CLASS (rena_application_parent_class)->startup (application);
 
+	if (rena_profile_enabled)
+		gdk_event_handler_set (rena_application_profile_event, NULL, NULL);
+
 	/* Allocate memory for simple structures */
 
 	rena->preferences = rena_preferences_get();
@@ -1224,19 +1304,6 @@ rena_application_startup (GApplication *application)
 		                        rena->sidebar2, "visible",
 		                        binding_flags);
 
-	rena->setting_dialog = rena_preferences_dialog_get ();
-	rena_preferences_dialog_set_parent (rena->setting_dialog, GTK_WIDGET (rena->mainwindow));
-
-	#ifdef HAVE_LIBPEAS
-	gboolean sidebar2_visible = // FIXME: Hack to allow hide sidebar when init.
-		rena_preferences_get_secondary_lateral_panel(rena->preferences);
-
-	rena_plugins_engine_startup (rena->plugins_engine);
-
-	rena_preferences_set_secondary_lateral_panel(rena->preferences,
-	                                               sidebar2_visible);
-	#endif
-
 	/* If first run and the desktop is gnome adapts style. */
 
 	if (rena_application_is_first_run (rena)) {
@@ -1257,6 +1324,20 @@ rena_application_startup (GApplication *application)
 	/* Finally fill the library and the playlist */
 
 	rena_init_gui_state (rena);
+
+	rena_profile_startup_mark ("window");
+
+	/* Defer the rest until the window is painted */
+
+	if (gtk_widget_get_visible (rena->mainwindow)) {
+		g_signal_connect_after (rena->mainwindow, "draw",
+		                        G_CALLBACK(rena_application_first_paint), rena);
+		rena->startup_id = g_timeout_add_seconds (FIRST_PAINT_TIMEOUT,
+		                                          rena_application_interactive_phase, rena);
+	}
+	else {
+		rena->startup_id = g_idle_add (rena_application_interactive_phase, rena);
+	}
 }
 
 static void
@@ -1266,6 +1347,12 @@ rena_application_shutdown (GApplication *application)
 
 	CDEBUG(DBG_INFO, "Rena shutdown: Saving curret state.");
 
+	if (rena->startup_id) {
+		g_source_remove (rena->startup_id);
+		rena->startup_id = 0;
+	}
+	g_signal_handlers_disconnect_by_func (rena->mainwindow, rena_application_first_paint, rena);
+
 	if (rena_preferences_get_restore_playlist (rena->preferences))
 		rena_playlist_save_playlist_state (rena->playlist);
 
@@ -1302,19 +1389,18 @@ static void
 rena_application_open (GApplication *application, GFile **files, gint n_files, const gchar *hint)
 {
 	RenaApplication *rena = RENA_APPLICATION (application);
+	GSList *paths = NULL;
+	gchar *path;
 	gint i;
-	GList *mlist = NULL;
 
-	for (i = 0; i < n_files; i++) {
-		gchar *path = g_file_get_path (files[i]);
-		mlist = append_mobj_list_from_unknown_filename (mlist, path);
-		g_free (path);
+	for (i = n_files - 1; i >= 0; i--) {
+		path = g_file_get_path (files[i]);
+		if (path)
+			paths = g_slist_prepend (paths, path);
 	}
 
-	if (mlist) {
-		rena_playlist_append_mobj_list (rena->playlist, mlist);
-		g_list_free (mlist);
-	}
+	rena_pl_parser_open_files (paths, rena);
+	g_slist_free_full (paths, g_free);
 
 	gtk_window_present (GTK_WINDOW (rena->mainwindow));
 }